@@ -0,0 +1,37 @@
+/*
+ * File: alloc-count.c
+ * -------------------
+ * Counts heap allocations by wrapping the glibc allocator entry points
+ */
+
+#include <alloc-count.h>
+#include <stdlib.h>
+
+static size_t num_allocations = 0;
+
+size_t allocation_count(void) {
+  return num_allocations;
+}
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+  num_allocations++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  num_allocations++;
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  num_allocations++;
+  return __libc_realloc(ptr, size);
+}
+
+#endif // __GLIBC__
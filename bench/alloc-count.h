@@ -0,0 +1,30 @@
+/*
+ * File: alloc-count.h
+ * -------------------
+ * Presents a counter of the number of calls made to the heap allocator, for
+ * reporting how many allocations a benchmark performs. The counter is only
+ * maintained when building against glibc, elsewhere it always reads zero.
+ */
+
+#ifndef LISP_ALLOC_COUNT_H
+#define LISP_ALLOC_COUNT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Function: allocation_count
+ * --------------------------
+ * Gets the number of calls to malloc, calloc and realloc made so far by the process
+ * @return: The total number of allocations made
+ */
+size_t allocation_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LISP_ALLOC_COUNT_H
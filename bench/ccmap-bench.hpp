@@ -0,0 +1,82 @@
+#ifndef LISP_CCMAP_BENCH_HPP
+#define LISP_CCMAP_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <ccmap.h>
+#include <pthread.h>
+
+// Number of keys in the tables that are shared by the threads of a benchmark
+static const int kSharedKeys = 1 << 16;
+
+// Lookups by many threads in one concurrent map. Throughput (items per second, over real
+// time) should grow with the number of threads, up to the number of cores.
+static CConcurrentMap *shared_ccmap;
+static void BM_ccmap_lookup(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    shared_ccmap = ccmap_create(sizeof(int), sizeof(int), roberts_hash, NULL, NULL, NULL, kSharedKeys);
+    for (int i = 0; i < kSharedKeys; i++)
+      ccmap_insert(shared_ccmap, &i, &i);
+  }
+
+  int key = state.thread_index() * 997;
+  for (auto _ : state) {
+    int value;
+    benchmark::DoNotOptimize(ccmap_lookup(shared_ccmap, &key, &value));
+    key = (key + 1) & (kSharedKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) ccmap_dispose(shared_ccmap);
+}
+BENCHMARK(BM_ccmap_lookup)->ThreadRange(1, 16)->UseRealTime();
+
+// Lookups by many threads in a CMap behind one mutex, which serializes them
+static CMap *shared_cmap;
+static pthread_mutex_t shared_cmap_lock = PTHREAD_MUTEX_INITIALIZER;
+static void BM_locked_cmap_lookup(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    shared_cmap = cmap_create(sizeof(int), sizeof(int), roberts_hash, NULL, NULL, NULL, 0);
+    cmap_reserve(shared_cmap, kSharedKeys);
+    for (int i = 0; i < kSharedKeys; i++)
+      cmap_insert(shared_cmap, &i, &i);
+  }
+
+  int key = state.thread_index() * 997;
+  for (auto _ : state) {
+    int value = 0;
+    pthread_mutex_lock(&shared_cmap_lock);
+    const int *found = (const int *) cmap_lookup(shared_cmap, &key);
+    if (found != NULL) value = *found;
+    pthread_mutex_unlock(&shared_cmap_lock);
+    benchmark::DoNotOptimize(value);
+    key = (key + 1) & (kSharedKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) cmap_dispose(shared_cmap);
+}
+BENCHMARK(BM_locked_cmap_lookup)->ThreadRange(1, 16)->UseRealTime();
+
+// A mix of nine lookups to every update (of a key that is already there) by many threads
+static void BM_ccmap_mixed(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    shared_ccmap = ccmap_create(sizeof(int), sizeof(int), roberts_hash, NULL, NULL, NULL, kSharedKeys);
+    for (int i = 0; i < kSharedKeys; i++)
+      ccmap_insert(shared_ccmap, &i, &i);
+  }
+
+  int key = state.thread_index() * 997;
+  int n = 0;
+  for (auto _ : state) {
+    int value = key;
+    if (++n % 10 == 0) ccmap_insert(shared_ccmap, &key, &value);
+    else benchmark::DoNotOptimize(ccmap_lookup(shared_ccmap, &key, &value));
+    key = (key + 1) & (kSharedKeys - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) ccmap_dispose(shared_ccmap);
+}
+BENCHMARK(BM_ccmap_mixed)->ThreadRange(1, 16)->UseRealTime();
+
+#endif // LISP_CCMAP_BENCH_HPP
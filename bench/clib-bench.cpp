@@ -6,6 +6,9 @@
 #include <cmath>
 
 #include <cmap-bench.hpp>
+#include <ccmap-bench.hpp>
+#include <cset-bench.hpp>
+#include <hash-bench.hpp>
 
 namespace {
 
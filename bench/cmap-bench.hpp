@@ -9,8 +9,10 @@ static void BM_map_insert(benchmark::State &state) {
   int k = 23;
   int v = 10;
 
+  // the same key is inserted and removed, so that the table neither grows nor fills
   for (auto _ : state) {
     cmap_insert(cm, &k, &v);
+    cmap_remove(cm, &k);
   }
 
   cmap_dispose(cm);
@@ -24,6 +26,9 @@ static void BM_map_repeated_insertion(benchmark::State &state) {
     for (int i = 0; i < state.range(0); i++) {
       cmap_insert(cm, &i, &i);
     }
+    state.PauseTiming();
+    cmap_clear(cm);
+    state.ResumeTiming();
   }
   cmap_dispose(cm);
 }
@@ -46,5 +51,44 @@ static void BM_map_insert_delete(benchmark::State &state) {
 }
 BENCHMARK(BM_map_insert_delete)->Ranges({{1 << 6, 1 << 12}, {1 << 7, 1 << 13}});
 
+// Insertion of n keys into a new table, which starts at the default capacity and grows as it
+// fills (or, if reserve is set, has room for all of them from the start). The time per key
+// stays about the same as n grows, since each key is moved about once in all of the growth.
+static void BM_map_insert_until(benchmark::State &state, bool reserve) {
+  const int n = (int) state.range(0);
+  for (auto _ : state) {
+    CMap *cm = simple_map(sizeof(int), sizeof(int));
+    if (reserve) cmap_reserve(cm, (unsigned int) n);
+    for (int i = 0; i < n; i++)
+      cmap_insert(cm, &i, &i);
+    benchmark::DoNotOptimize(cmap_count(cm));
+    cmap_dispose(cm);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_CAPTURE(BM_map_insert_until, grow, false)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_CAPTURE(BM_map_insert_until, reserved, true)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// Lookup of keys that are in (hit) or not in (miss) a table of 2^16 entries, filled to the
+// given percentage of its capacity. The table is allowed to fill that far without growing.
+static void BM_map_lookup(benchmark::State &state, bool hit) {
+  const unsigned int capacity = 1 << 16;
+  const int n = (int) (capacity * state.range(0) / 100);
+  CMap *cm = cmap_create(sizeof(int), sizeof(int), roberts_hash, NULL, NULL, NULL, capacity);
+  cmap_set_load_factors(cm, 0.95f, 0);
+  for (int i = 0; i < n; i++)
+    cmap_insert(cm, &i, &i);
+
+  int key = 0;
+  for (auto _ : state) {
+    int k = hit ? key : n + key;
+    benchmark::DoNotOptimize(cmap_lookup(cm, &k));
+    if (++key == n) key = 0;
+  }
+  cmap_dispose(cm);
+}
+BENCHMARK_CAPTURE(BM_map_lookup, hit, true)->Arg(50)->Arg(75)->Arg(90);
+BENCHMARK_CAPTURE(BM_map_lookup, miss, false)->Arg(50)->Arg(75)->Arg(90);
+
 
 #endif //LISP_CMAP_BENCH_HPP
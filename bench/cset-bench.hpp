@@ -0,0 +1,192 @@
+#ifndef LISP_CSET_BENCH_HPP
+#define LISP_CSET_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+
+#include <cset.h>
+#include <ops.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+// Set benchmarks, on sets of n distinct ints in random order. Each is run against std::set too,
+// a balanced binary tree with a node per element, for reference.
+static std::vector<int> shuffled_ints(int n) {
+  std::vector<int> ints((size_t) n);
+  for (int i = 0; i < n; i++)
+    ints[i] = i;
+  std::shuffle(ints.begin(), ints.end(), std::mt19937(0));
+  return ints;
+}
+
+static CSet *set_of(const std::vector<int> &ints) {
+  CSet *set = new_set(sizeof(int), cmp_int, NULL);
+  for (int i : ints)
+    set_insert(set, &i);
+  return set;
+}
+
+static void BM_set_insert(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  for (auto _ : state) {
+    CSet *set = set_of(ints);
+    benchmark::DoNotOptimize(set_size(set));
+    set_dispose(set);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_set_insert)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_set_lookup(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  CSet *set = set_of(ints);
+  std::shuffle(ints.begin(), ints.end(), std::mt19937(1));
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set_lookup(set, &ints[i]));
+    if (++i == ints.size()) i = 0;
+  }
+  set_dispose(set);
+}
+BENCHMARK(BM_set_lookup)->RangeMultiplier(10)->Range(1000, 1000000);
+
+static void BM_set_rank(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  CSet *set = set_of(ints);
+  std::shuffle(ints.begin(), ints.end(), std::mt19937(1));
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set_rank(set, &ints[i]));
+    if (++i == ints.size()) i = 0;
+  }
+  set_dispose(set);
+}
+BENCHMARK(BM_set_rank)->RangeMultiplier(10)->Range(1000, 1000000);
+
+static void BM_set_remove(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    CSet *set = set_of(ints);
+    state.ResumeTiming();
+    for (int i : ints)
+      set_remove(set, &i);
+    set_dispose(set);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_set_remove)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Building a set from sorted elements, all at once or by inserting them one at a time
+static void BM_set_build(benchmark::State &state, bool bulk) {
+  const int n = (int) state.range(0);
+  std::vector<int> sorted((size_t) n);
+  for (int i = 0; i < n; i++)
+    sorted[i] = i;
+
+  CSet *set = new_set(sizeof(int), cmp_int, NULL);
+  for (auto _ : state) {
+    if (bulk) {
+      set_build(set, sorted.data(), n);
+    } else {
+      set_clear(set);
+      for (int i : sorted)
+        set_insert(set, &i);
+    }
+    benchmark::DoNotOptimize(set_size(set));
+  }
+  set_dispose(set);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_CAPTURE(BM_set_build, bulk, true)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_set_build, inserts, false)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_set_select(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  CSet *set = set_of(ints);
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set_select(set, ints[i]));
+    if (++i == ints.size()) i = 0;
+  }
+  set_dispose(set);
+}
+BENCHMARK(BM_set_select)->Arg(1000000);
+
+// The 1000 elements ranked from a random rank in a set of 1M, by iterating from the first of them
+// or by selecting each one
+static void BM_set_rank_range(benchmark::State &state, bool iterate) {
+  const int n = 1000000;
+  const int length = 1000;
+  auto ints = shuffled_ints(n);
+  CSet *set = set_of(ints);
+
+  size_t i = 0;
+  for (auto _ : state) {
+    int start = ints[i] % (n - length);
+    if (iterate) {
+      CSetIterator it;
+      void *e = set_iter_at(set, start, &it);
+      for (int k = 1; k < length; k++)
+        e = set_iter_next(&it);
+      benchmark::DoNotOptimize(e);
+    } else {
+      for (int k = 0; k < length; k++)
+        benchmark::DoNotOptimize(set_select(set, start + k));
+    }
+    if (++i == ints.size()) i = 0;
+  }
+  set_dispose(set);
+  state.SetItemsProcessed(state.iterations() * length);
+}
+BENCHMARK_CAPTURE(BM_set_rank_range, iterate, true);
+BENCHMARK_CAPTURE(BM_set_rank_range, select, false);
+
+static bool count_visit(const void *, void *context) {
+  ++*static_cast<int *>(context);
+  return true;
+}
+
+// Visiting every element of a set
+static void BM_set_range(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  CSet *set = set_of(ints);
+  for (auto _ : state) {
+    int count = 0;
+    set_range(set, NULL, NULL, count_visit, &count);
+    benchmark::DoNotOptimize(count);
+  }
+  set_dispose(set);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_set_range)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_std_set_insert(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  for (auto _ : state) {
+    std::set<int> set(ints.begin(), ints.end());
+    benchmark::DoNotOptimize(set.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_std_set_insert)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_std_set_lookup(benchmark::State &state) {
+  auto ints = shuffled_ints((int) state.range(0));
+  std::set<int> set(ints.begin(), ints.end());
+  std::shuffle(ints.begin(), ints.end(), std::mt19937(1));
+
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.find(ints[i]));
+    if (++i == ints.size()) i = 0;
+  }
+}
+BENCHMARK(BM_std_set_lookup)->Arg(1000000);
+
+#endif //LISP_CSET_BENCH_HPP
@@ -0,0 +1,63 @@
+#ifndef LISP_ENV_BENCH_HPP
+#define LISP_ENV_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+// Defines the global variables g0, g1, ... g{n-1} in the interpreter's environment
+static void define_globals(LispInterpreter *interpreter, int n) {
+  for (int i = 0; i < n; i++) {
+    std::string expr = "(set 'g" + std::to_string(i) + " " + std::to_string(i) + ")";
+    free(interpret_expression(interpreter, expr.c_str()));
+  }
+}
+
+// Lookup of the first global variable that was defined, with
+// an increasing number of global variables defined after it
+static void BM_global_lookup(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  define_globals(&interpreter, (int) state.range(0));
+
+  obj *key = PARSE("g0", &interpreter);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(lookup(key, &interpreter));
+
+  dispose_recursive(key);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_global_lookup)->RangeMultiplier(10)->Range(10, 10000);
+
+// Lookup of a primitive, which are defined before any other global variable
+static void BM_primitive_lookup(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  define_globals(&interpreter, (int) state.range(0));
+
+  obj *key = PARSE("cons", &interpreter);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(lookup(key, &interpreter));
+
+  dispose_recursive(key);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_primitive_lookup)->RangeMultiplier(10)->Range(10, 10000);
+
+// Evaluation of an expression referencing global variables
+static void BM_eval_globals(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  define_globals(&interpreter, (int) state.range(0));
+
+  obj *expr = PARSE("(+ g0 g1)", &interpreter);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(eval(expr, &interpreter));
+    collect_garbage(&interpreter.gc, interpreter.env);
+  }
+
+  dispose_recursive(expr);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_eval_globals)->RangeMultiplier(10)->Range(10, 10000);
+
+#endif //LISP_ENV_BENCH_HPP
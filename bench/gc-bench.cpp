@@ -0,0 +1,11 @@
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <interpreter.h>
+#include <garbage-collector.h>
+#include <list.h>
+}
+
+#include <gc-bench.hpp>
+
+BENCHMARK_MAIN();
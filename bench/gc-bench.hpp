@@ -0,0 +1,183 @@
+#ifndef LISP_GC_BENCH_HPP
+#define LISP_GC_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Upper bound in microseconds of the pauses counted in a bucket of the pause histogram
+static double bucket_limit(int bucket) {
+  return (double) (1L << bucket);
+}
+
+// Smallest pause (as a histogram bucket limit) that a fraction of all pauses are within
+static double pause_percentile(const GCPauseStats &pauses, double fraction) {
+  long total = 0;
+  for (int count : pauses.histogram) total += count;
+  if (total == 0) return 0;
+
+  long seen = 0;
+  for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+    seen += pauses.histogram[i];
+    if (seen >= fraction * total) return bucket_limit(i);
+  }
+  return bucket_limit(GC_PAUSE_BUCKETS - 1);
+}
+
+// Reports the collections done per iteration, and the distribution of their pause
+// times, both as percentile counters and as a histogram in the label
+static void report_pauses(benchmark::State &state, const GCPauseStats &pauses) {
+  state.counters["minor"] = benchmark::Counter(pauses.minor_collections, benchmark::Counter::kAvgIterations);
+  state.counters["major"] = benchmark::Counter(pauses.major_collections, benchmark::Counter::kAvgIterations);
+  state.counters["p50_us"] = pause_percentile(pauses, 0.5);
+  state.counters["p99_us"] = pause_percentile(pauses, 0.99);
+  state.counters["max_us"] = pause_percentile(pauses, 1.0);
+
+  std::string histogram;
+  for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+    if (pauses.histogram[i] == 0) continue;
+    histogram += "<" + std::to_string(1L << i) + "us:" + std::to_string(pauses.histogram[i]) + " ";
+  }
+  state.SetLabel(histogram);
+}
+
+// Evaluates an expression that allocates many temporaries in a new interpreter
+// each iteration, accumulating the garbage collection pauses made during evaluation
+static void BM_gc_pauses(benchmark::State &state, const char *definition, const char *expression) {
+  GCPauseStats pauses = {};
+  for (auto _ : state) {
+    LispInterpreter interpreter;
+    interpreter_init(&interpreter);
+    free(interpret_expression(&interpreter, definition));
+    free(interpret_expression(&interpreter, expression));
+
+    pauses.minor_collections += interpreter.gc.pauses.minor_collections;
+    pauses.major_collections += interpreter.gc.pauses.major_collections;
+    for (int i = 0; i < GC_PAUSE_BUCKETS; i++)
+      pauses.histogram[i] += interpreter.gc.pauses.histogram[i];
+    interpreter_dispose(&interpreter);
+  }
+  report_pauses(state, pauses);
+}
+BENCHMARK_CAPTURE(BM_gc_pauses, fib,
+                  "(set 'fib (lambda (n) (cond ((< n 2) n) (t (+ (fib (- n 1)) (fib (- n 2)))))))",
+                  "(fib 18)")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_gc_pauses, repeat,
+                  "(set 'repeat (lambda (item n) (cond ((= n 0) '()) (t (cons item (repeat item (- n 1)))))))",
+                  "(repeat '(a b c) 3000)")->Unit(benchmark::kMillisecond);
+
+// Builds a list of integers with a cell for each of the given number of objects
+static obj *build_list(long num_objects, GarbageCollector *gc) {
+  obj *list = NULL;
+  for (long i = 0; i < num_objects; i++) {
+    list = new_list_set(new_int((int) i), list, gc);
+    gc_add(gc, list);
+  }
+  return list;
+}
+
+// Builds a balanced binary tree of cells (each cell's CAR and CDR are subtrees)
+// with the given number of objects
+static obj *build_tree(long num_objects, GarbageCollector *gc) {
+  if (num_objects <= 0) return NULL;
+  long left = (num_objects - 1) / 2;
+  obj *tree = new_list_set(build_tree(left, gc), build_tree(num_objects - 1 - left, gc), gc);
+  gc_add(gc, tree);
+  return tree;
+}
+
+// Major collections of a heap in which every object is live, reporting the rate
+// at which objects are marked and the largest size that the mark stack reached
+static void BM_mark(benchmark::State &state, obj *(*build)(long, GarbageCollector *)) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  long num_objects = state.range(0);
+  obj *heap = build(num_objects, &interpreter.gc);
+  gc_push_root(&interpreter.gc, &heap);
+
+  for (auto _ : state)
+    collect_garbage(&interpreter.gc, interpreter.env);
+
+  state.SetItemsProcessed(state.iterations() * num_objects);
+  state.counters["stack_high_water"] = interpreter.gc.mark_stack.high_water;
+  gc_pop_roots(&interpreter.gc, 1);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_mark, list, build_list)
+  ->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_mark, tree, build_tree)
+  ->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMillisecond);
+
+// Kilobytes of memory that this process has written to since it was forked, read
+// without allocating so that reading it does not itself write to the heap
+static long private_dirty_kb() {
+  int fd = open("/proc/self/smaps_rollup", O_RDONLY);
+  if (fd < 0) return -1;
+  char buffer[4096];
+  ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+  if (size <= 0) return -1;
+  buffer[size] = '\0';
+  const char *field = strstr(buffer, "Private_Dirty:");
+  return field == nullptr ? -1 : strtol(field + strlen("Private_Dirty:"), nullptr, 10);
+}
+
+// Major collections of a heap in which every object is live, each done in a forked
+// child so that the pages the collection writes to are the ones the child copies.
+// Reports the collection time, and the pages touched per collection against the
+// number of pages in the arena.
+static void BM_collect_pages(benchmark::State &state, obj *(*build)(long, GarbageCollector *)) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  obj *heap = build(state.range(0), &interpreter.gc);
+  gc_push_root(&interpreter.gc, &heap);
+  collect_garbage(&interpreter.gc, interpreter.env); // promote the heap to the old generation
+
+  long pages_touched = 0;
+  for (auto _ : state) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      state.SkipWithError("pipe failed");
+      break;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      long before = private_dirty_kb();
+      auto start = std::chrono::steady_clock::now();
+      collect_garbage(&interpreter.gc, interpreter.env);
+      auto end = std::chrono::steady_clock::now();
+      long result[2] = { (long) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                         (private_dirty_kb() - before) * 1024 / 4096 };
+      ssize_t written = write(fds[1], result, sizeof(result));
+      _exit(written == sizeof(result) ? 0 : 1);
+    }
+    long result[2] = {0, 0};
+    ssize_t size = read(fds[0], result, sizeof(result));
+    close(fds[0]);
+    close(fds[1]);
+    waitpid(pid, nullptr, 0);
+    if (size != sizeof(result)) {
+      state.SkipWithError("collection in child failed");
+      break;
+    }
+    state.SetIterationTime((double) result[0] / 1e9);
+    pages_touched += result[1];
+  }
+
+  CArenaStats stats;
+  gc_stats(&interpreter.gc, &stats);
+  state.counters["pages_touched"] = benchmark::Counter(pages_touched, benchmark::Counter::kAvgIterations);
+  state.counters["heap_pages"] = stats.allocated_bytes / 4096;
+  gc_pop_roots(&interpreter.gc, 1);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_collect_pages, list, build_list)
+  ->RangeMultiplier(16)->Range(1 << 16, 1 << 22)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_collect_pages, tree, build_tree)
+  ->RangeMultiplier(16)->Range(1 << 16, 1 << 22)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+#endif // LISP_GC_BENCH_HPP
@@ -0,0 +1,51 @@
+#ifndef LISP_HASH_BENCH_HPP
+#define LISP_HASH_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+
+#include <hash.h>
+
+#include <vector>
+
+// Hashing a key of each size, repeatedly, by each of the hash functions that CMap may use
+static void BM_hash(benchmark::State &state, CMapHashFn hash) {
+  const size_t keysize = (size_t) state.range(0);
+  std::vector<unsigned char> key(keysize);
+  for (size_t i = 0; i < keysize; i++)
+    key[i] = (unsigned char) (i * 31 + 7);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(key.data());
+    benchmark::DoNotOptimize(hash(key.data(), keysize));
+  }
+  state.SetBytesProcessed(state.iterations() * keysize);
+}
+BENCHMARK_CAPTURE(BM_hash, roberts, roberts_hash)->Arg(4)->Arg(8)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK_CAPTURE(BM_hash, murmur, murmur_hash)->Arg(4)->Arg(8)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK_CAPTURE(BM_hash, fast, fast_hash)->Arg(4)->Arg(8)->RangeMultiplier(4)->Range(16, 4096);
+
+// Hashing an array of 1024 keys of a given size, by hash64_batch or by calling hash64 on each
+static void BM_hash_batch(benchmark::State &state, bool batch) {
+  const size_t keysize = (size_t) state.range(0);
+  const size_t count = 1024;
+  std::vector<unsigned char> keys(keysize * count);
+  for (size_t i = 0; i < keys.size(); i++)
+    keys[i] = (unsigned char) (i * 31 + 7);
+  std::vector<uint64_t> hashes(count);
+
+  for (auto _ : state) {
+    if (batch) {
+      hash64_batch(keys.data(), keysize, count, 0, hashes.data());
+    } else {
+      for (size_t i = 0; i < count; i++)
+        hashes[i] = hash64(&keys[i * keysize], keysize, 0);
+    }
+    benchmark::DoNotOptimize(hashes.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK_CAPTURE(BM_hash_batch, batch, true)->Arg(4)->Arg(8)->Arg(16);
+BENCHMARK_CAPTURE(BM_hash_batch, single, false)->Arg(4)->Arg(8)->Arg(16);
+
+#endif //LISP_HASH_BENCH_HPP
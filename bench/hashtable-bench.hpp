@@ -0,0 +1,42 @@
+#ifndef LISP_HASHTABLE_BENCH_HPP
+#define LISP_HASHTABLE_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+// Counting of the occurrences of each word in a text of ten times as many words as there are
+// distinct words, in a hash table or in an association list of (word count) pairs. The hash
+// table is updated in place, and the association list is copied up to the word being counted.
+static void BM_eval_word_count(benchmark::State &state, bool hashtable) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+
+  std::string words;
+  unsigned int seed = 1;
+  for (int64_t i = 0; i < 10 * state.range(0); i++) {
+    seed = seed * 1103515245 + 12345;
+    words += " w" + std::to_string((seed >> 16) % state.range(0));
+  }
+  free(interpret_expression(&interpreter, ("(set 'words '(" + words + "))").c_str()));
+  free(interpret_expression(&interpreter,
+                            "(set 'count-hash (lambda (ws h)"
+                            "(cond ((eq ws '()) h)"
+                            "(t (count-hash (cdr ws) (hash-set! h (car ws) (+ 1 (hash-ref h (car ws) 0))))))))"));
+  free(interpret_expression(&interpreter,
+                            "(set 'increment (lambda (al w)"
+                            "(cond ((eq al '()) (cons (cons w (cons 1 '())) '()))"
+                            "((eq (car (car al)) w) (cons (cons w (cons (+ 1 (car (cdr (car al)))) '())) (cdr al)))"
+                            "(t (cons (car al) (increment (cdr al) w))))))"));
+  free(interpret_expression(&interpreter,
+                            "(set 'count-alist (lambda (ws al)"
+                            "(cond ((eq ws '()) al)"
+                            "(t (count-alist (cdr ws) (increment al (car ws)))))))"));
+
+  const char *e = hashtable ? "(hash-count (count-hash words (make-hash-table)))" : "(count-alist words '())";
+  eval_repeatedly(state, &interpreter, e);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_eval_word_count, hashtable, true)->RangeMultiplier(10)->Range(10, 1000);
+BENCHMARK_CAPTURE(BM_eval_word_count, alist, false)->RangeMultiplier(10)->Range(10, 1000);
+
+#endif // LISP_HASHTABLE_BENCH_HPP
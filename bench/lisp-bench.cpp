@@ -0,0 +1,19 @@
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <interpreter.h>
+#include <environment.h>
+#include <evaluator.h>
+#include <parser.h>
+#include <list.h>
+#include <bignum.h>
+}
+
+#include <env-bench.hpp>
+#include <program-bench.hpp>
+#include <math-bench.hpp>
+#include <vector-bench.hpp>
+#include <hashtable-bench.hpp>
+#include <vm-bench.hpp>
+
+BENCHMARK_MAIN();
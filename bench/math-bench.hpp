@@ -0,0 +1,110 @@
+#ifndef LISP_MATH_BENCH_HPP
+#define LISP_MATH_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <alloc-count.h>
+
+// Evaluates an expression repeatedly, collecting garbage after each evaluation
+// as the interpreter does after each top-level expression
+static void eval_repeatedly(benchmark::State &state, LispInterpreter *interpreter, const char *e) {
+  obj *expr = PARSE(e, interpreter);
+
+  size_t allocations = allocation_count();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(eval(expr, interpreter));
+    collect_garbage(&interpreter->gc, interpreter->env);
+  }
+  double allocs = (double) (allocation_count() - allocations);
+  state.counters["allocs"] = benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+
+  dispose_recursive(expr);
+}
+
+// A single addition of two integers
+static void BM_eval_add(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  eval_repeatedly(state, &interpreter, "(+ 1 2)");
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_eval_add);
+
+// Nested arithmetic over integers and floats
+static void BM_eval_arithmetic(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  eval_repeatedly(state, &interpreter, "(* (+ 1 2) (- (/ 9.0 2) (% 7 3)))");
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_eval_arithmetic);
+
+// A single application of a math primitive to many integers, floats or both
+static void BM_eval_variadic(benchmark::State &state, const char *e) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  eval_repeatedly(state, &interpreter, e);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_eval_variadic, int_sum, "(+ 1 2 3 4 5 6 7 8)");
+BENCHMARK_CAPTURE(BM_eval_variadic, float_sum, "(+ 1.5 2.5 3.5 4.5 5.5 6.5 7.5 8.5)");
+BENCHMARK_CAPTURE(BM_eval_variadic, mixed_sum, "(+ 1 2 3 4 5.5 6 7 8)");
+BENCHMARK_CAPTURE(BM_eval_variadic, nested_int_sum, "(+ 1 (+ 2 (+ 3 (+ 4 (+ 5 (+ 6 (+ 7 8)))))))");
+BENCHMARK_CAPTURE(BM_eval_variadic, int_max, "(max 1 8 2 7 3 6 4 5)");
+BENCHMARK_CAPTURE(BM_eval_variadic, chained_compare, "(< 1 2 3 4 5 6 7 8)");
+
+// A loop (compiled, when the virtual machine is enabled) applying an arithmetic expression
+// of its counter n at each of 1000 steps
+static void BM_eval_arithmetic_loop(benchmark::State &state, const char *step) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  std::string loop = std::string("(set 'loop (lambda (n acc) (cond ((= n 0) acc) (t (loop (- n 1) ")
+                     + step + ")))))";
+  free(interpret_expression(&interpreter, loop.c_str()));
+  eval_repeatedly(state, &interpreter, "(loop 1000 0)");
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_eval_arithmetic_loop, int, "(+ acc n n 1 (* n 2))");
+BENCHMARK_CAPTURE(BM_eval_arithmetic_loop, float, "(+ acc 0.5 1.5 (* 2.5 0.5))");
+BENCHMARK_CAPTURE(BM_eval_arithmetic_loop, mixed, "(+ acc n 0.5 (* n 2))");
+BENCHMARK_CAPTURE(BM_eval_arithmetic_loop, clamp, "(max 0 (min (+ acc n) 100000))");
+
+// Recursive factorial, as defined in test/test.lisp
+static void BM_eval_factorial(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  free(interpret_expression(&interpreter,
+                            "(set 'factorial (lambda (x) (cond ((= x 0) 1) (t (* x (factorial (- x 1)))))))"));
+  std::string e = "(factorial " + std::to_string(state.range(0)) + ")";
+  eval_repeatedly(state, &interpreter, e.c_str());
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_eval_factorial)->Arg(5)->Arg(10)->Arg(20)->Arg(1000);
+
+// Makes a bignum with the given number of (pseudo-random) decimal digits
+static Bignum *make_bignum(int num_digits, unsigned int seed) {
+  std::string digits(num_digits, '0');
+  for (char &d : digits) {
+    seed = seed * 1103515245 + 12345;
+    d = (char) ('0' + (seed >> 16) % 10);
+  }
+  digits[0] = '1';
+  return bignum_parse(digits.c_str());
+}
+
+// Multiplication of two bignums with the given number of decimal digits each, which is
+// schoolbook multiplication below about 300 digits and Karatsuba's algorithm above
+static void BM_bignum_mul(benchmark::State &state) {
+  Bignum *x = make_bignum((int) state.range(0), 1);
+  Bignum *y = make_bignum((int) state.range(0), 2);
+  for (auto _ : state) {
+    Bignum *product = bignum_mul(x, y);
+    benchmark::DoNotOptimize(product);
+    bignum_free(product);
+  }
+  state.SetItemsProcessed(state.iterations());
+  bignum_free(x);
+  bignum_free(y);
+}
+BENCHMARK(BM_bignum_mul)->Arg(20)->Arg(100)->Arg(300)->Arg(1000)->Arg(10000)->Arg(100000);
+
+#endif // LISP_MATH_BENCH_HPP
@@ -0,0 +1,77 @@
+#ifndef LISP_PROGRAM_BENCH_HPP
+#define LISP_PROGRAM_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <alloc-count.h>
+#include <fstream>
+#include <string>
+
+// Reads a lisp source file from the repository, dropping the ';' comments
+// since these are not understood by the parser
+static std::string read_program(const std::string &file_name) {
+  std::ifstream in(std::string(LISP_SOURCE_DIR) + "/" + file_name);
+  std::string program, line;
+  while (std::getline(in, line))
+    program += line.substr(0, line.find(';')) + "\n";
+  return program;
+}
+
+// Parses the next top-level expression of a program, advancing past it
+static obj *parse_next(const char **program, LispInterpreter *interpreter) {
+  size_t num_parsed;
+  obj *o = parse_expression(*program, &num_parsed, &interpreter->symbols, &interpreter->gc);
+  *program += num_parsed;
+  return o;
+}
+
+// Reports the mean number of heap allocations made per iteration
+static void count_allocations(benchmark::State &state, size_t allocations_before) {
+  double allocations = (double) (allocation_count() - allocations_before);
+  state.counters["allocs"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+// Parsing of every expression in the bootstrap library
+static void BM_parse_bootstrap(benchmark::State &state) {
+  std::string program = read_program("lispcode/bootstrap.lisp");
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+
+  size_t allocations = allocation_count();
+  for (auto _ : state) {
+    const char *e = program.c_str();
+    while (!empty_expression(e)) {
+      obj *o = parse_next(&e, &interpreter);
+      benchmark::DoNotOptimize(o);
+      dispose_recursive(o);
+    }
+  }
+  count_allocations(state, allocations);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_parse_bootstrap);
+
+// Parsing and evaluation of every expression in a program in a new interpreter,
+// as done by interpret_program
+static void BM_interpret_program(benchmark::State &state, const char *file_name) {
+  std::string program = read_program(file_name);
+
+  size_t allocations = allocation_count();
+  for (auto _ : state) {
+    LispInterpreter interpreter;
+    interpreter_init(&interpreter);
+    const char *e = program.c_str();
+    while (!empty_expression(e)) {
+      obj *o = parse_next(&e, &interpreter);
+      if (o == NULL) continue;
+      benchmark::DoNotOptimize(eval(o, &interpreter));
+      collect_garbage(&interpreter.gc, interpreter.env);
+      dispose_recursive(o);
+    }
+    interpreter_dispose(&interpreter);
+  }
+  count_allocations(state, allocations);
+}
+BENCHMARK_CAPTURE(BM_interpret_program, test, "test/test.lisp");
+BENCHMARK_CAPTURE(BM_interpret_program, Y_combinator, "lispcode/YC.lisp");
+
+#endif // LISP_PROGRAM_BENCH_HPP
@@ -0,0 +1,29 @@
+#ifndef LISP_VECTOR_BENCH_HPP
+#define LISP_VECTOR_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+// Access to the last element of a table of n rows, held in a vector or in a list (through
+// ith, as defined in test/test.lisp). Neither allocates, so garbage is not collected after
+// each evaluation, which would mark the whole table.
+static void BM_eval_table_lookup(benchmark::State &state, bool vector) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  std::string n = std::to_string(state.range(0));
+  free(interpret_expression(&interpreter, "(set 'ith (lambda (x i) (cond ((= i 0) (car x)) (t (ith (cdr x) (- i 1))))))"));
+  free(interpret_expression(&interpreter, ("(set 'rows (make-vector " + n + " '(a b c)))").c_str()));
+  free(interpret_expression(&interpreter, "(set 'list (vector->list rows))"));
+
+  std::string last = std::to_string(state.range(0) - 1);
+  std::string e = vector ? "(vector-ref rows " + last + ")" : "(ith list " + last + ")";
+  obj *expr = PARSE(e.c_str(), &interpreter);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(eval(expr, &interpreter));
+  dispose_recursive(expr);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_eval_table_lookup, vector, true)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_CAPTURE(BM_eval_table_lookup, list, false)->RangeMultiplier(10)->Range(10, 100000);
+
+#endif // LISP_VECTOR_BENCH_HPP
@@ -0,0 +1,118 @@
+#ifndef LISP_VM_BENCH_HPP
+#define LISP_VM_BENCH_HPP
+
+#include <benchmark/benchmark.h>
+#include <program-bench.hpp>
+#include <env-bench.hpp>
+
+// Evaluates every expression of a program but the last, which is returned (to be disposed of)
+static obj *load_program(const char *file_name, LispInterpreter *interpreter) {
+  std::string program = read_program(file_name);
+  const char *e = program.c_str();
+  obj *last = NULL;
+  while (!empty_expression(e)) {
+    obj *o = parse_next(&e, interpreter);
+    if (o == NULL) continue;
+    if (last != NULL) {
+      eval(last, interpreter);
+      collect_garbage(&interpreter->gc, interpreter->env);
+      dispose_recursive(last);
+    }
+    last = o;
+  }
+  return last;
+}
+
+// Evaluation of the expressions in a program, with compiled closures either run by the VM or
+// tree-walked. The definitions are evaluated once, and the last expression in every iteration.
+static void BM_run_compiled(benchmark::State &state, const char *file_name, bool use_vm) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  interpreter.vm.enabled = use_vm;
+  obj *last = load_program(file_name, &interpreter);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(eval(last, &interpreter));
+    collect_garbage(&interpreter.gc, interpreter.env);
+  }
+  dispose_recursive(last);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_run_compiled, fib_vm, "lispcode/fib.lisp", true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, fib_tree_walked, "lispcode/fib.lisp", false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, tak_vm, "lispcode/tak.lisp", true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, tak_tree_walked, "lispcode/tak.lisp", false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, factorial_vm, "lispcode/factorial.lisp", true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, factorial_tree_walked, "lispcode/factorial.lisp", false)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, Y_combinator_vm, "lispcode/YC.lisp", true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_run_compiled, Y_combinator_tree_walked, "lispcode/YC.lisp", false)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_run_compiled, partial_vm, "lispcode/partial.lisp", true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, partial_tree_walked, "lispcode/partial.lisp", false)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, fold_vm, "lispcode/fold.lisp", true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_run_compiled, fold_tree_walked, "lispcode/fold.lisp", false)->Unit(benchmark::kMillisecond);
+
+// Creation and application of closures nested three deep, each capturing variables from the
+// ones that enclose it, with an increasing number of global variables defined
+static void BM_nested_closures(benchmark::State &state, bool use_vm) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  interpreter.vm.enabled = use_vm;
+  define_globals(&interpreter, (int) state.range(0));
+  obj *last = load_program("lispcode/closures.lisp", &interpreter);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(eval(last, &interpreter));
+    collect_garbage(&interpreter.gc, interpreter.env);
+  }
+  dispose_recursive(last);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_nested_closures, vm, true)->RangeMultiplier(100)->Range(10, 10000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_nested_closures, tree_walked, false)->RangeMultiplier(100)->Range(10, 10000)
+    ->Unit(benchmark::kMillisecond);
+
+// Calls per second of a loop calling a three-argument closure, with closures either run by the
+// VM or tree-walked. Each of the 100000 iterations of the loop makes two calls.
+static void BM_calls(benchmark::State &state, bool use_vm) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  interpreter.vm.enabled = use_vm;
+  obj *last = load_program("lispcode/calls.lisp", &interpreter);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(eval(last, &interpreter));
+    collect_garbage(&interpreter.gc, interpreter.env);
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * 100000);
+  dispose_recursive(last);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK_CAPTURE(BM_calls, vm, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_calls, tree_walked, false)->Unit(benchmark::kMillisecond);
+
+// Tree-walked calls of a loop whose closure captures a list, with an increasing length of the list.
+// Each of the 1000 iterations of the loop makes one call.
+static void BM_captured_calls(benchmark::State &state) {
+  LispInterpreter interpreter;
+  interpreter_init(&interpreter);
+  interpreter.vm.enabled = false;
+  std::string expr = "(set 'big '(";
+  for (int i = 0; i < state.range(0); i++) expr += std::to_string(i) + " ";
+  free(interpret_expression(&interpreter, (expr + "))").c_str()));
+  obj *last = load_program("lispcode/captured.lisp", &interpreter);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(eval(last, &interpreter));
+    collect_garbage(&interpreter.gc, interpreter.env);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+  dispose_recursive(last);
+  interpreter_dispose(&interpreter);
+}
+BENCHMARK(BM_captured_calls)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+#endif // LISP_VM_BENCH_HPP
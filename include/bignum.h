@@ -0,0 +1,153 @@
+/*
+ * File: bignum.h
+ * --------------
+ * Presents the interface of arbitrary-precision integers (bignums), which integers that don't
+ * fit in a fixnum are promoted to (see lisp-objects.h and math-lib.h).
+ *
+ * A bignum is a sign and a magnitude: a vector of 32-bit digits, least significant first, with
+ * no leading zero digits (so zero has no digits, and is never negative). Bignums are immutable
+ * once made: every operation returns a new bignum in dynamically allocated memory, which is
+ * freed with bignum_free, or by the garbage collector once it belongs to a bignum object.
+ * Multiplication is schoolbook for small operands and Karatsuba's algorithm for large ones,
+ * and division is Knuth's algorithm D.
+ */
+
+#ifndef _LISP_BIGNUM_H_INCLUDED
+#define _LISP_BIGNUM_H_INCLUDED
+
+#include "garbage-collector.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint32_t bigdigit;
+
+/**
+ * @struct Bignum
+ * @brief An arbitrary-precision integer. The digits are stored in the same block of memory as
+ * this header, which is recorded with the garbage collector once it belongs to an object.
+ */
+struct Bignum {
+  GCBlock block;        // Header of the memory block (unlinked until it belongs to an object)
+  bool negative;        // Whether the integer is less than zero
+  int size;             // Number of digits
+  bigdigit digits[];    // Digits of the magnitude, least significant first
+};
+
+/**
+ * Function: bignum_from_int
+ * -------------------------
+ * Makes a bignum with the value of a 64-bit integer
+ * @param value: The value of the bignum
+ * @return: A new bignum
+ */
+Bignum *bignum_from_int(int64_t value);
+
+/**
+ * Function: bignum_parse
+ * ----------------------
+ * Makes a bignum from its decimal representation
+ * @param str: Decimal digits, optionally preceded by a sign
+ * @return: A new bignum, or NULL if the string is not an integer in decimal
+ */
+Bignum *bignum_parse(const char *str);
+
+/**
+ * Function: bignum_copy
+ * ---------------------
+ * Makes a copy of a bignum
+ * @param x: The bignum to copy
+ * @return: A new bignum with the same value
+ */
+Bignum *bignum_copy(const Bignum *x);
+
+/**
+ * Function: bignum_free
+ * ---------------------
+ * Frees a bignum, whether or not it has been recorded with a garbage collector
+ * @param x: The bignum to free, may be NULL
+ */
+void bignum_free(Bignum *x);
+
+/**
+ * Function: bignum_add
+ * --------------------
+ * Adds two bignums
+ * @param x: The first bignum
+ * @param y: The second bignum
+ * @return: A new bignum holding x + y
+ */
+Bignum *bignum_add(const Bignum *x, const Bignum *y);
+
+/**
+ * Function: bignum_sub
+ * --------------------
+ * Subtracts one bignum from another
+ * @param x: The bignum to subtract from
+ * @param y: The bignum to subtract
+ * @return: A new bignum holding x - y
+ */
+Bignum *bignum_sub(const Bignum *x, const Bignum *y);
+
+/**
+ * Function: bignum_mul
+ * --------------------
+ * Multiplies two bignums, with Karatsuba's algorithm once both have enough digits
+ * @param x: The first bignum
+ * @param y: The second bignum
+ * @return: A new bignum holding x * y
+ */
+Bignum *bignum_mul(const Bignum *x, const Bignum *y);
+
+/**
+ * Function: bignum_divmod
+ * -----------------------
+ * Divides one bignum by another, truncating the quotient toward zero as C does, such that
+ * the remainder has the sign of the dividend
+ * @param x: The dividend
+ * @param y: The divisor
+ * @param quotient: Location to write a new bignum holding the quotient to, may be NULL
+ * @param remainder: Location to write a new bignum holding the remainder to, may be NULL
+ * @return: True if the division was done, false if the divisor is zero
+ */
+bool bignum_divmod(const Bignum *x, const Bignum *y, Bignum **quotient, Bignum **remainder);
+
+/**
+ * Function: bignum_compare
+ * ------------------------
+ * Compares the values of two bignums
+ * @param x: The first bignum
+ * @param y: The second bignum
+ * @return: A negative number if x < y, zero if they are equal, or a positive number if x > y
+ */
+int bignum_compare(const Bignum *x, const Bignum *y);
+
+/**
+ * Function: bignum_to_int
+ * -----------------------
+ * Gets the value of a bignum as a 64-bit integer, if it fits in one
+ * @param x: The bignum
+ * @param value: Location to write the value to
+ * @return: True if the value fits in 64 bits and was written, false otherwise
+ */
+bool bignum_to_int(const Bignum *x, int64_t *value);
+
+/**
+ * Function: bignum_to_double
+ * --------------------------
+ * Gets the nearest double to the value of a bignum
+ * @param x: The bignum
+ * @return: The value of the bignum as a double, which is infinite if the bignum is too large
+ */
+double bignum_to_double(const Bignum *x);
+
+/**
+ * Function: bignum_to_string
+ * --------------------------
+ * Makes the decimal representation of a bignum
+ * @param x: The bignum
+ * @return: The decimal digits of the bignum, preceded by '-' if it is negative, in dynamically allocated memory
+ */
+char *bignum_to_string(const Bignum *x);
+
+#endif // _LISP_BIGNUM_H_INCLUDED
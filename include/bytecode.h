@@ -0,0 +1,99 @@
+/*
+ * File: bytecode.h
+ * ----------------
+ * Presents the instruction set of the bytecode that closure bodies are compiled to,
+ * along with the state of the virtual machine that runs it (see compiler.h and vm.h).
+ *
+ * The virtual machine is a stack machine. Each call to a compiled closure has a frame on
+ * the value stack holding the closure itself, followed by the values of its arguments,
+ * followed by the temporary values of the expression being evaluated. Instructions are
+ * sequences of 16-bit units: an opcode followed by its operands. Jump targets are
+ * absolute offsets into the code.
+ */
+
+#ifndef _LISP_BYTECODE_H_INCLUDED
+#define _LISP_BYTECODE_H_INCLUDED
+
+#include "lisp-objects.h"
+#include "garbage-collector.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Largest number of units of code (and constants) that a compiled closure may have
+#define BYTECODE_MAX_LENGTH UINT16_MAX
+
+typedef enum opcode {
+  OP_CONST,                 // k: push constant k
+  OP_ARG,                   // i: push the value of argument i
+  OP_GLOBAL,                // k: push the value of the global variable named by constant k (cached in k + 1)
+  OP_JUMP,                  // t: jump to t
+  OP_JUMP_IF_NIL,           // t: pop a value, jumping to t if it is the empty list
+  OP_JUMP_UNLESS_COMPARE,   // op t: pop two numbers, jumping to t unless comparison op holds
+  OP_JUMP_UNLESS_EQ,        // t: pop two values, jumping to t unless they are eq
+  OP_ADD,                   // pop two numbers and push their sum
+  OP_SUB,                   // pop two numbers and push their difference
+  OP_MUL,                   // pop two numbers and push their product
+  OP_MATH,                  // op: pop two numbers and push the result of math operation op
+  OP_EQ,                    // pop two values and push whether they are eq
+  OP_ATOM,                  // pop a value and push whether it is an atom
+  OP_CAR,                   // pop a list and push its head
+  OP_CDR,                   // pop a list and push its tail
+  OP_CONS,                  // pop a value and a list and push the value prepended to the list
+  OP_NIL,                   // push a new empty list
+  OP_LAMBDA,                // k n captures...: push a closure made from lambda arguments k, capturing n values
+  OP_CALL,                  // n: pop a function and n arguments and push the result of applying it
+  OP_TAIL_CALL,             // n: pop a function and n arguments and return the result of applying it
+  OP_RETURN,                // return the top value from the current call
+  NUM_OPCODES
+} opcode;
+
+// Where a value captured by OP_LAMBDA is found. Each capture is three units: one of these,
+// the location of the value, and the constant naming the variable.
+typedef enum capture {
+  CAPTURE_ARGUMENT,         // i: the value of argument i
+  CAPTURE_CONSTANT,         // k: constant k, a value captured by the enclosing closure
+  CAPTURE_GLOBAL            // k: the value of the global variable, cached in constant k
+} capture;
+
+/**
+ * @struct Bytecode
+ * @brief The compiled body of a closure. The constants and the code are stored
+ * in the same block of memory as this header, which is owned by the closure.
+ */
+struct Bytecode {
+  GCBlock block;          // Header of the memory block, recorded with the garbage collector
+  int nargs;              // Number of arguments of the closure
+  int max_stack;          // Most values that a call ever has on the stack, including its arguments
+  int num_constants;      // Number of constants
+  obj **constants;        // Objects referenced by the code: quoted data, captured values and names
+  int length;             // Number of units of code
+  uint16_t *code;         // Instructions
+};
+
+/**
+ * @struct VMFrame
+ * @brief A call to a compiled closure in progress
+ */
+typedef struct VMFrame {
+  const Bytecode *code;   // Code of the closure being called
+  const uint16_t *pc;     // Next instruction (only up to date for frames that are not running)
+  obj **base;             // Arguments of the call on the value stack, preceded by the closure
+  const obj *env;         // Environment of the tree-walker when the call was made
+} VMFrame;
+
+/**
+ * @struct VM
+ * @brief State of the bytecode virtual machine of an interpreter
+ */
+typedef struct VM {
+  obj **stack;            // Value stack, allocated on first use
+  obj **stack_end;        // One past the end of the value stack
+  VMFrame *frames;        // Calls in progress, allocated on first use
+  int num_frames;         // Number of calls in progress
+  obj *quote;             // The quote primitive, for quoting values passed to other functions
+  obj *t;                 // The truth atom
+  bool enabled;           // Whether compiled closures are run by the VM rather than tree-walked
+} VM;
+
+#endif // _LISP_BYTECODE_H_INCLUDED
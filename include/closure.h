@@ -12,23 +12,73 @@
 /**
  * Function: closure_partial_application
  * -------------------------------------
- * Partially applies the arguments
- * @param closure: The closure to partially apply arguments to
- * @param args: The (unevaluated) argument list to apply to the closure
- * @return: A newly allocated closure with arguments bound
+ * Partially applies a closure to some of its arguments, making a partial application that holds
+ * the values of the arguments rather than a copy of the closure with the arguments bound
+ * @param function: The closure, or partial application of a closure, to apply the arguments to
+ * @param args: The (unevaluated) argument list, shorter than the remaining parameters of the function
+ * @param interpreter: The interpreter to evaluate the arguments in
+ * @return: A new partial application of the closure, with the values of all of the arguments
+ * applied to it so far
  */
-obj *closure_partial_application(const obj *closure, const obj *args, LispInterpreter *interpreter);
+obj *closure_partial_application(const obj *function, const obj *args, LispInterpreter *interpreter);
+
+/**
+ * Function: applied_closure
+ * -------------------------
+ * Finds the closure that a function applies: a closure itself, or the closure that a partial
+ * application was made from
+ * @param function: A closure or partial application
+ * @return: The closure, or NULL if the function is neither a closure nor a partial application
+ */
+const obj *applied_closure(const obj *function);
+
+/**
+ * Function: remaining_params
+ * --------------------------
+ * Gets the number of parameters of a closure, or partial application of a closure, that have yet
+ * to be applied
+ * @param function: A closure or partial application
+ * @return: The number of arguments that a full application of the function takes
+ */
+int remaining_params(const obj *function);
+
+/**
+ * Function: closure_hides
+ * -----------------------
+ * Determines whether a call to a closure may replace a call to another in the environment. This
+ * is when the frame of the first would hide every binding of the other's frame: it binds each of
+ * the other's parameters, and each of the other's captured variables is either bound by it too,
+ * or has the same value as the variable that is found by looking it up with the other's frame gone.
+ * @param closure: The closure being called
+ * @param replaced: The closure whose call would be replaced
+ * @param interpreter: The interpreter, in which lookups see the environment beneath the frame of replaced
+ * @return: True if dropping the frame of replaced would not change the value of any name
+ */
+bool closure_hides(const obj *closure, const obj *replaced, LispInterpreter *interpreter);
+
+/**
+ * Function: partial_values
+ * ------------------------
+ * Copies the values of the arguments applied so far by a partial application, in the order of
+ * the closure's parameters
+ * @param partial: A partial application, or a closure (which has no values applied)
+ * @param values: Where to copy the values to
+ * @return: A pointer just past the last value copied
+ */
+obj **partial_values(const obj *partial, obj **values);
 
 /**
  * Function: new_closure_set
  * -------------------------
- * Create a new closure with initialization of fields. The passed objects will not be copied.
+ * Create a new closure with initialization of fields, compiling its procedure to bytecode
+ * if possible (see compiler.h). The passed objects will not be copied.
  * @param params: Parameters to the closure (will not be copied)
  * @param procedure: Procedure of the closure (will not be copied)
  * @param captured: Captured argument list of the closure (will not be copied)
+ * @param gc: Garbage collector to allocate the closure from
  * @return: A new closure object with the specified parameters, procedure, and captured vars list.
  */
-obj *new_closure_set(obj *params, obj *procedure, obj *captured);
+obj *new_closure_set(obj *params, obj *procedure, obj *captured, GarbageCollector *gc);
 
 /**
  * Function: copy_closure_recursive
@@ -36,9 +86,21 @@ obj *new_closure_set(obj *params, obj *procedure, obj *captured);
  * Make a deep copy of a closure by recursively copying it's parameters, procedure,
  * and captured fields.
  * @param closure: The closure to make a copy of
+ * @param gc: Garbage collector to allocate the copy from
  * @return: A completely newly allocated closure identical to the passed one
  */
-obj* copy_closure_recursive(const obj* closure);
+obj* copy_closure_recursive(const obj* closure, GarbageCollector *gc);
+
+/**
+ * Function: copy_partial_recursive
+ * --------------------------------
+ * Make a deep copy of a partial application by recursively copying the function it applies and
+ * the values applied to it
+ * @param partial: The partial application to make a copy of
+ * @param gc: Garbage collector to allocate the copy from
+ * @return: A completely newly allocated partial application identical to the passed one
+ */
+obj *copy_partial_recursive(const obj *partial, GarbageCollector *gc);
 
 /**
  * Function: associate
@@ -0,0 +1,44 @@
+/*
+ * File: compiler.h
+ * ----------------
+ * Presents the interface of the compiler from closure bodies to bytecode (see bytecode.h).
+ *
+ * A closure is compiled once, when it is created. Variables are resolved at compile time:
+ * parameters become argument slots, captured variables become constants, and any other name
+ * is looked up in the global environment when the code runs (rather than in the dynamic
+ * environment of the caller, as the tree-walking evaluator does). The variables that a lambda
+ * expression in the body would capture are resolved in the same way, when the enclosing closure
+ * is compiled. Captured primitives that are applied directly are compiled to instructions rather
+ * than calls: quote to a constant, cond to jumps, and the list and arithmetic primitives to their
+ * own instructions (arithmetic on more than two numbers to one instruction for each number after
+ * the first).
+ *
+ * Closures whose bodies can't be compiled, such as those that use set, env or macros, or that
+ * pass the wrong number of arguments to a primitive, are left to the tree-walking evaluator.
+ */
+
+#ifndef _LISP_COMPILER_H_INCLUDED
+#define _LISP_COMPILER_H_INCLUDED
+
+#include "bytecode.h"
+
+/**
+ * Function: compile_closure
+ * -------------------------
+ * Compiles the procedure of a closure to bytecode. The code references objects in the
+ * closure's procedure and captured variables, so is only valid for as long as the closure is.
+ * @param closure: The closure to compile, whose parameters, procedure and captured variables are set
+ * @param gc: Garbage collector to record the compiled code with
+ * @return: The compiled code, to be freed with free_bytecode, or NULL if the closure can't be compiled
+ */
+Bytecode *compile_closure(const obj *closure, GarbageCollector *gc);
+
+/**
+ * Function: free_bytecode
+ * -----------------------
+ * Frees the compiled code of a closure
+ * @param code: The compiled code to free, may be NULL
+ */
+void free_bytecode(Bytecode *code);
+
+#endif // _LISP_COMPILER_H_INCLUDED
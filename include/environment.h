@@ -13,51 +13,116 @@
  * Function: init_env
  * ------------------
  * Initializes the default lisp environment
+ * @param symbols: Symbol table to intern the names of the primitives in
+ * @param gc: Garbage collector to allocate the environment from
  * @return: Pointer to lisp environment object
  */
-obj* init_env();
+obj* init_env(SymbolTable *symbols, GarbageCollector *gc);
 
 /**
  * Function: make_environment
  * --------------------------
- * Make an environment from an array of primitive names and an array of corresponding primitive functions
- * @param primitive_names: Array of primitive names
- * @param primitive_list: Array of corresponding primitive functions
- * @return: An environment object made form pairing the names with the primitive functions
+ * Make an environment from a table of primitive declarations
+ * @param primitives: Array of primitive declarations, ending with one whose name is NULL
+ * @param symbols: Symbol table to intern the primitive names in
+ * @param gc: Garbage collector to allocate the environment from
+ * @return: An environment object made form pairing the names with the primitives
  */
-obj* create_environment(atom_t const *primitive_names, primitive_t const *primitive_list);
+obj* create_environment(const primitive_def *primitives, SymbolTable *symbols, GarbageCollector *gc);
+
+/**
+ * Function: index_environment
+ * ---------------------------
+ * Makes the interpreter's environment its global environment and builds the hash
+ * index of its key-value pairs. Lookups of global variables go through this index
+ * rather than walking the environment list.
+ * @param interpreter: Interpreter whose environment should be indexed
+ * @return: True if the index was built successfully, false otherwise
+ */
+bool index_environment(LispInterpreter *interpreter);
+
+/**
+ * Function: define_global
+ * -----------------------
+ * Adds a new key-value pair to the global environment and to the global index. The
+ * pair is spliced in just after the head of the global environment so that the local
+ * frames that are chained onto the global environment do not need re-linking.
+ * @param pair: The key-value pair to add (will not be copied)
+ * @param interpreter: The interpreter to define the global variable in
+ * @return: True if the pair was added, false otherwise
+ */
+bool define_global(obj *pair, LispInterpreter *interpreter);
 
 /**
  * Function: lookup
  * ----------------
  * Looks up an object in an environment, returning the value that is associated with that object
  * @param o: A lisp object that is of the atom type
- * @param env: An environment to lookup the atom in
+ * @param interpreter: Interpreter whose environment to lookup the atom in
  * @return: The lisp object that was associated with the object in the environment
  */
-obj* lookup(const obj* o, const obj* env);
+obj* lookup(const obj* o, const LispInterpreter *interpreter);
 
 /**
  * Function: lookup_entry
  * ----------------------
- * Looks up an object in an environment, returning a pointer to the place in the environment
- * that points to the value that is equal to
+ * Looks up a key in the interpreter's environment, first searching the local frames that
+ * precede the global environment, and then the global index. Returns a pointer to the
+ * place in the environment that holds the value (see lookup_set_entry to replace the value).
+ * @param key: A lisp object that is of the atom type
+ * @param interpreter: Interpreter whose environment to lookup the atom in
+ * @param holder: Where to store the object that holds the value (the second cell of a key-value
+ * pair, or an activation frame). May be NULL.
+ * @return: A pointer to the obj* inside the environment holding the value, or NULL if the key was not found
+ */
+obj** lookup_entry(const obj* key, const LispInterpreter *interpreter, obj **holder);
+
+/**
+ * Function: lookup_set_entry
+ * --------------------------
+ * Looks up a key in the interpreter's environment, just as lookup_entry does, for the purpose of
+ * replacing its value. Captured variables of a call to a closure are shared with the closure, so a
+ * captured variable is first copied into the call's own captured variables if it is still shared.
  * @param key: A lisp object that is of the atom type
- * @param env: An environment to lookup the atom in
- * @return: A pointer to obj* inside the environment that
+ * @param interpreter: Interpreter whose environment to lookup the atom in
+ * @param holder: Where to store the object that holds the value, to be passed to gc_write_barrier
+ * once the value is replaced. May be NULL.
+ * @return: A pointer to the obj* inside the environment holding the value, or NULL if the key was not found
+ */
+obj** lookup_set_entry(const obj* key, LispInterpreter *interpreter, obj **holder);
+
+/**
+ * Function: lookup_global
+ * -----------------------
+ * Looks up a key in the hash index of the global environment only, ignoring any local frames
+ * @param key: The atom to search for in the global environment
+ * @param interpreter: The interpreter containing the global environment
+ * @return: The key-value pair from the global environment with a matching key, if one was found else NULL
  */
-obj** lookup_entry(const obj* key, const obj* env);
+obj *lookup_global(const obj *key, const LispInterpreter *interpreter);
 
 /**
  * Function: lookup_pair
  * ---------------------
- * Looks up a key in an environment, returning the key-value pair if it is found
+ * Looks up a key in an environment list, returning the key-value pair if it is found.
+ * This walks the entire list and does not make use of the global index.
  * @param key: The key to search for in the environment
  * @param env: The environment to search for the key in
  * @return: The key-value pair from the environment with a matching key, if one was found else NULL
  */
 obj* lookup_pair(const obj* key, const obj* env);
 
+/**
+ * Function: environment_list
+ * --------------------------
+ * Makes a view of the interpreter's environment as a list of key-value pairs only, with the
+ * captured variables and a pair for each argument of each activation frame of the local environment
+ * @param interpreter: The interpreter whose environment to list
+ * @return: The environment as a list of key-value pairs. The global environment and the pairs
+ * of the local environment are shared rather than copied.
+ */
+obj *environment_list(LispInterpreter *interpreter);
+
 /**
  * Function: make_pair
  * -------------------
@@ -66,9 +131,10 @@ obj* lookup_pair(const obj* key, const obj* env);
  * @param key: A name to associate with a value (will be copied)
  * @param value: The value to associate with a name (will be copied)
  * @param copy: If true, copy the key and value, and if false, make the pair using the provided key and pair pointers
+ * @param gc: Garbage collector to allocate the pair from
  * @return: A list of length two where the first element is the copy of the name and the second element
  * is a copy of the value.
  */
-obj *make_pair(obj *key, obj *value, bool copy);
+obj *make_pair(obj *key, obj *value, bool copy, GarbageCollector *gc);
 
 #endif // _ENVIRONMENT_H_INCLUDED
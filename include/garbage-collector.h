@@ -18,6 +18,36 @@
  * created during evaluation, can be freed at the end leaving only the parsed
  * data structure code, and the environment.
  *
+ * All lisp objects other than atoms are allocated from a slab allocator (CArena) owned by
+ * the garbage collector, so that objects of the same size are packed together in pages
+ * and freed objects are recycled without going through malloc and free. Since the arena
+ * belongs to a single interpreter, interpreters running in different threads never
+ * contend for the allocator.
+ *
+ * Garbage is also collected during evaluation, once the number of objects allocated
+ * since the last collection passes a threshold, so that a long running expression does
+ * not accumulate all of its temporary objects until it returns. These collections happen
+ * only at the start of the evaluation of an application in eval, where every object in
+ * use is reachable from a root: the environment, the expression being evaluated, or a
+ * C variable that has been registered on the root stack with gc_push_root. Any object
+ * allocated during evaluation that is held in a C variable across a call to eval must
+ * therefore be pushed onto the root stack for the duration of that call. The bytecode VM
+ * also collects at the start of each call to a compiled closure, and every value on its
+ * value stack, between stack and stack_top, is a root.
+ *
+ * Collections during evaluation are generational. Objects allocated since the last
+ * collection are young (the nursery), and those that survive a collection are promoted
+ * to the old generation. A minor collection, done each time the nursery fills up, marks
+ * only young objects: marking stops at old objects, which keep their marks until the next
+ * major collection. Old objects that are modified to reference other objects must be
+ * passed to gc_write_barrier so that a minor collection also marks through them. A major
+ * collection, which collects both generations, is done once the old generation has grown
+ * to twice its size after the previous major collection, and by collect_garbage.
+ *
+ * Marks are not kept in the objects but in the arena's side bitmaps (see carena.h), so
+ * marking writes only to the bitmaps, and a major collection unmarks every object with a
+ * single memset rather than by writing to each old object.
+ *
  * Note that garbage should be collected only AFTER the result of the evaluation has been
  * fully processed (e.g. serialized and printed) to ensure that no objects are destroyed
  * that are contained within the final result of the evaluation.
@@ -28,11 +58,56 @@
 
 #include "lisp-objects.h"
 #include <cvector.h>
+#include <carena.h>
+
+
+#define GC_PAUSE_BUCKETS 24
+
+/**
+ * @struct GCPauseStats
+ * @brief Counts of the collections done by a garbage collector, and how long they took
+ */
+typedef struct GCPauseStats {
+  int minor_collections;                  // Collections of only the young generation
+  int major_collections;                  // Collections of both generations
+  int histogram[GC_PAUSE_BUCKETS];        // Bucket 0: pauses under 1us, bucket i: [2^(i-1), 2^i) us
+} GCPauseStats;
+
+/**
+ * @struct MarkStack
+ * @brief Stack of the objects found during marking whose references are yet to be marked
+ */
+typedef struct MarkStack {
+  obj **objects;          // Objects waiting to be visited
+  int size;               // Number of objects on the stack
+  int capacity;           // Number of objects that the stack has room for
+  int high_water;         // Largest size that the stack has reached
+} MarkStack;
 
+/**
+ * @struct GCBlock
+ * @brief Header of a block of malloc'd memory that belongs to an object in the arena (such as the
+ * compiled code of a closure). Blocks are linked into a list so that any not freed along with their
+ * object are freed when the garbage collector is disposed of.
+ */
+typedef struct GCBlock {
+  struct GCBlock *prev;   // Previous block in the garbage collector's list
+  struct GCBlock *next;   // Next block in the garbage collector's list
+} GCBlock;
 
-typedef struct GarbageCollector {
-  CVector allocated;
-} GarbageCollector;
+struct GarbageCollector {
+  CVector allocated;      // Young objects: allocated during evaluation since the last collection
+  CVector tenured;        // Old objects: allocated during evaluation and survived a collection
+  CVector remembered;     // Old objects that have been modified since the last collection
+  CVector roots;          // Root stack: addresses of C variables referencing objects in use
+  obj **stack;            // Bottom of the bytecode VM's value stack, whose values are all roots
+  obj **stack_top;        // One past the top value of the VM's value stack
+  GCBlock blocks;         // Sentinel of the circular list of blocks owned by objects
+  int tenured_threshold;  // Number of old objects at which to do a major collection
+  MarkStack mark_stack;   // Objects to visit during marking, kept between collections
+  GCPauseStats pauses;    // Collection counts and pause times
+  CArena arena;           // Memory that all lisp objects (other than atoms) are allocated from
+};
 
 /**
  * Function: gc_new
@@ -52,6 +127,27 @@ GarbageCollector *new_gc();
  */
 bool gc_init(GarbageCollector *gc);
 
+/**
+ * Function: gc_allocate
+ * ---------------------
+ * Allocates memory for a lisp object from the garbage collector's arena. The
+ * memory is released with dispose (or when the garbage collector is disposed of).
+ * @param gc: The garbage collector to allocate memory from
+ * @param size: The size of the object in bytes
+ * @return: Pointer to memory for the object, or NULL if allocation failed
+ */
+void *gc_allocate(GarbageCollector *gc, size_t size);
+
+/**
+ * Function: gc_stats
+ * ------------------
+ * Gets statistics about the memory used for lisp objects, including the number
+ * of bytes allocated from the system, the number of live objects and the fragmentation.
+ * @param gc: The garbage collector to get memory statistics for
+ * @param stats: Location to write the statistics to
+ */
+void gc_stats(const GarbageCollector *gc, CArenaStats *stats);
+
 /**
  *  Function: gc_add
  * -----------------
@@ -67,7 +163,8 @@ void gc_add(GarbageCollector *gc, const obj *o);
  * --------------------------
  * Add an object to the list of objects that need to be freed at the end
  * of expression evaluation, including all of the objects that is references
- * in a recursive manner (the entire object tree).
+ * in a recursive manner (the entire object tree). Vectors and hash tables, which are recorded
+ * when they are made and shared rather than copied, are not added again.
  * @param root: The root object to add to the list
  */
 void gc_add_recursive(GarbageCollector *gc, obj *root);
@@ -75,18 +172,80 @@ void gc_add_recursive(GarbageCollector *gc, obj *root);
 /**
  * Function: collect_garbage
  * -------------------------
- * Frees all of the allocated lisp objects in the allocated list. Suggested usage is to
+ * Does a major collection, freeing all of the allocated lisp objects in both generations that
+ * are not reachable from the environment or from the root stack. Suggested usage is to
  * call this function after each call to repl_eval, after the object returned from
  * eval has been completely processed (e.g. copied into environment, serialized, etc...).
  */
 void collect_garbage(GarbageCollector *gc, obj *env);
 
+/**
+ * Function: gc_write_barrier
+ * --------------------------
+ * Records that an object has been modified to reference another object. This must be
+ * called whenever a field of an existing list, closure, frame, vector or hash table is overwritten, since the
+ * object may be old and the newly referenced object young.
+ * @param gc: The garbage collector
+ * @param o: The object that was modified
+ */
+void gc_write_barrier(GarbageCollector *gc, obj *o);
+
+/**
+ * Function: gc_add_block
+ * ----------------------
+ * Records a block of malloc'd memory owned by an object, so that it is freed when the garbage
+ * collector is disposed of if it has not been freed (with gc_free_block) before then
+ * @param gc: The garbage collector to record the block in
+ * @param block: Header at the start of the block
+ */
+void gc_add_block(GarbageCollector *gc, GCBlock *block);
+
+/**
+ * Function: gc_free_block
+ * -----------------------
+ * Frees a block recorded with gc_add_block, removing it from the garbage collector's list
+ * @param block: Header at the start of the block to free, may be NULL
+ */
+void gc_free_block(GCBlock *block);
+
+/**
+ * Function: gc_push_root
+ * ----------------------
+ * Registers a C variable as a root, so that the object it references (at the time
+ * of any collection) and everything reachable from that object is not collected.
+ * Roots must be popped in the reverse order that they were pushed.
+ * @param gc: The garbage collector to register the root with
+ * @param rootp: Address of the variable referencing an object (which may be NULL)
+ */
+void gc_push_root(GarbageCollector *gc, obj **rootp);
+
+/**
+ * Function: gc_pop_roots
+ * ----------------------
+ * Removes the most recently pushed roots from the root stack
+ * @param gc: The garbage collector to remove roots from
+ * @param count: The number of roots to remove
+ */
+void gc_pop_roots(GarbageCollector *gc, int count);
+
+/**
+ * Function: maybe_collect_garbage
+ * -------------------------------
+ * Does a minor collection if the nursery is full, or a major collection instead if the
+ * old generation has also grown enough since the last major collection.
+ * This may be called during evaluation, provided that every object in use is reachable
+ * from the environment or from the root stack.
+ * @param gc: The garbage collector
+ * @param env: The current environment
+ */
+void maybe_collect_garbage(GarbageCollector *gc, obj *env);
+
 /**
  * Function: gc_dispose
  * --------------------
- * Disposes of the CVector of allocated objects. Call this method after
- * all calls to eval are completed to free the memory used to store the
- * CVector of allocated objects.
+ * Disposes of the CVector of allocated objects along with the arena. Call this method
+ * after all calls to eval are completed. This frees every object that was allocated
+ * from the garbage collector, including those in the environment.
  */
 void gc_dispose(GarbageCollector *gc);
 
@@ -0,0 +1,39 @@
+/*
+ * File: hashtable-lib.h
+ * ---------------------
+ * Presents the interface of the hash table library: the primitives that make, query, modify
+ * and iterate over hash tables (see lisp-objects.h)
+ *
+ * Keys are compared as equal does: numbers by value, atoms by identity (they are interned) and
+ * lists structurally. Vectors, hash tables and partial applications are keys by identity.
+ */
+
+#ifndef _LISP_HASHTABLE_LIB_H_INCLUDED
+#define _LISP_HASHTABLE_LIB_H_INCLUDED
+
+#include "interpreter.h"
+#include "garbage-collector.h"
+#include "primitives.h"
+
+#include <stdint.h>
+
+/**
+ * Function: get_hashtable_library
+ * -------------------------------
+ * Get the hash table library environment
+ * @param symbols: Symbol table to intern the names of the hash table primitives in
+ * @param gc: Garbage collector to allocate the environment from
+ * @return: The hash table library environment
+ */
+obj* get_hashtable_library(SymbolTable *symbols, GarbageCollector *gc);
+
+/**
+ * Function: hash_object
+ * ---------------------
+ * Hashes a Lisp value, such that keys that are equal (as hash tables compare them) have equal hashes
+ * @param o: The value to hash, may be NULL
+ * @return: The hash of the value
+ */
+uint64_t hash_object(const obj *o);
+
+#endif // _LISP_HASHTABLE_LIB_H_INCLUDED
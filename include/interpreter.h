@@ -9,14 +9,36 @@
 
 #include "parser.h"
 #include "garbage-collector.h"
+#include "symbol-table.h"
+#include "bytecode.h"
+#include <cmap.h>
+#include <cvector.h>
 #include <stdio.h>
 
+/**
+ * @struct FreeVariableCache
+ * @brief The names that the body of each lambda expression evaluated by the lambda primitive
+ * may capture, so that each body is searched for them once rather than every time a closure is
+ * made from it. Bodies are keyed by address, so the cache is emptied whenever the garbage
+ * collector may have freed one (see lambda in primitives.c).
+ */
+typedef struct {
+  CMap *bodies;                         // Range of names in names, for each body
+  CVector names;                        // Names of every body in the cache
+  int collections;                      // Collections done by the garbage collector when filled
+} FreeVariableCache;
+
 /**
  * @struct Lisp interpreter object
  */
 typedef struct {
+  SymbolTable symbols;                  // Interned atoms
   obj* env;                             // Interpreter environment
+  obj* global_env;                      // Head of the global environment (tail of env)
+  CMap *global_index;                   // Hash index of the global environment's pairs
   GarbageCollector gc;                     // Memory Manager
+  VM vm;                                // Virtual machine that runs compiled closures
+  FreeVariableCache free_variables;     // Names that lambda bodies may capture
 } LispInterpreter;
 
 /**
@@ -8,18 +8,28 @@
 #define _LISP_OBJECTS_H_INCLUDED
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <cmap.h>
 
-// The different types of lists
+// The different types of objects in the heap (most numbers are immediates, see below)
 enum type {
   atom_obj,             // Atom object
   list_obj,             // List object
   primitive_obj,        // Primitive function object
   closure_obj,          // Closure/procedure object
-  int_obj,              // Integer object
-  float_obj             // Floating point number object
+  frame_obj,            // Activation frame of a closure
+  partial_obj,          // Closure applied to only some of its arguments
+  float_obj,            // Float that can't be an immediate
+  bignum_obj,           // Integer too large to be a fixnum
+  vector_obj,           // Vector of objects with constant time indexing
+  hashtable_obj         // Hash table from objects to objects
 };
 
 typedef const char* atom_t;
+typedef struct GarbageCollector GarbageCollector;
+typedef struct Bytecode Bytecode;
+typedef struct Bignum Bignum;
+typedef struct primitive_def primitive_def;
 
 /**
  * @struct obj
@@ -33,12 +43,14 @@ typedef const char* atom_t;
  * the actual contents of the object. For example, in the
  * case of an atom object, this will be a C-string, and
  * in the case of a List, the flexible array member will contain
- * two pointers to car and cdr, respectively.
+ * two pointers to car and cdr, respectively. The type is kept
+ * in a single byte, and the contents start at the next
+ * pointer-aligned offset. Objects carry no mark for the garbage
+ * collector, which keeps its marks in the arena's side bitmaps.
  */
 typedef struct {
-  enum type objtype;    // what type of object
-  bool reachable;       // is trash (for GC)
-  char data[];          // the actual object's data
+  uint8_t objtype;      // what type of object (an enum type)
+  void *data[];         // the actual object's data
 } obj;
 
 typedef struct {
@@ -50,14 +62,94 @@ typedef struct {
   obj* parameters;
   obj* procedure;
   obj* captured;
+  Bytecode *code;       // compiled procedure, or NULL if it could not be compiled
   int nargs;
 } closure_t;
 
+/*
+ * The arguments of a call to a tree-walked closure are held in a frame: a single object with
+ * the value of each argument in a vector, in the order of the closure's parameters. The frame
+ * is an element of the environment list in place of the closure's captured variables and a
+ * key-value pair for each parameter (see environment.h). The captured variables are shared
+ * with the closure until one of them is set during the call. Frames are never values, so
+ * they are neither copied nor printed.
+ */
+typedef struct {
+  const obj *closure;   // the closure being applied, whose parameters name the values
+  obj *captured;        // the closure's captured variables, as seen by this call
+  obj *values[];        // value of each argument
+} frame_t;
+
+/*
+ * Applying a closure to fewer arguments than it has parameters makes a partial application: a
+ * single object holding the closure (or the partial application it was applied to) and the values
+ * of the arguments applied to it, in the order of the parameters. Nothing of the closure itself
+ * is copied, and applying the partial application to its remaining arguments calls the closure
+ * with the applied values followed by the new ones.
+ */
+#define PARTIAL_MAX_VALUES 5    // Most values in one partial application (to fit the arena's largest size class)
+
+typedef struct {
+  obj *function;        // the closure, or a partial application of it, that was applied
+  int nvalues;          // number of values applied by this object
+  int nargs;            // number of parameters that remain to be applied
+  obj *values[];        // value of each argument applied by this object
+} partial_t;
+
+/*
+ * A vector's elements are stored contiguously in a block of memory apart from the object (which
+ * must fit in the arena), recorded with the garbage collector and freed along with the object.
+ * A hash table is an object that owns a CMap from key to value (both obj*), whose keys are
+ * compared structurally (see hashtable-lib.h).
+ *
+ * Unlike lists, vectors and hash tables can be modified (they are mutable), so they are shared
+ * rather than copied: copying one (as set does to the value it stores) gives the same object,
+ * and each is recorded with the garbage collector when it is made. A value stored in either is
+ * copied, as set copies the value that it stores in the environment.
+ */
+#define VECTOR_MAX_LENGTH (1 << 28) // Most elements in a vector
+
+typedef struct {
+  obj **items;          // the elements, following the header of their block
+  int length;           // number of elements
+} vector_t;
+
+/*
+ * Numbers are mostly immediate values: rather than pointing to an object in the heap, the
+ * object reference itself holds the number. Heap objects are always at least 4-byte aligned
+ * so the two low bits of a real reference are zero, and these bits are used to tag the
+ * immediates, leaving the upper 62 bits for the value. Immediates have no header, so anything
+ * that reads the fields of an object must first check that it is not an immediate.
+ *
+ * Integers between FIXNUM_MIN and FIXNUM_MAX are immediates (fixnums), and any other integer is
+ * a bignum object (see bignum.h). Floats are doubles. A double is an immediate if its exponent
+ * is in the middle 512 of the 2048 possible exponents (magnitudes from about 1e-77 to 1e77),
+ * or it is zero: the 62 bits hold the sign, the 52 bits of the mantissa and 9 bits of the
+ * exponent, with the exponent 0 reserved for zero. Any other double (very large or very small,
+ * infinite or not a number) is a float object.
+ */
+#if UINTPTR_MAX < UINT64_MAX
+#error "Immediate numbers require 64-bit object references"
+#endif
+
+#define IMMEDIATE_TAG_MASK  ((uintptr_t) 0x3)
+#define INT_TAG             ((uintptr_t) 0x1)
+#define FLOAT_TAG           ((uintptr_t) 0x2)
+#define IMMEDIATE_SHIFT     2
+
+#define FIXNUM_MAX          (((int64_t) 1 << 61) - 1)
+#define FIXNUM_MIN          (-((int64_t) 1 << 61))
+
 #define CONTENTS(o)   ((o)->data)
 #define ATOM(o)       ((atom_t)   CONTENTS(o))
 #define LIST(o)       ((list_t *) CONTENTS(o))
-#define PRIMITIVE(o)  ((primitive_t *) CONTENTS(o))
+#define PRIMITIVE(o)  (*(const primitive_def **) CONTENTS(o))
 #define CLOSURE(o)    ((closure_t *)   CONTENTS(o))
+#define FRAME(o)      ((frame_t *)     CONTENTS(o))
+#define PARTIAL(o)    ((partial_t *)   CONTENTS(o))
+#define BIGNUM(o)     ((Bignum *)      CONTENTS(o)[0])
+#define VECTOR(o)     ((vector_t *)    CONTENTS(o))
+#define HASHTABLE(o)  (*(CMap **)      CONTENTS(o))
 
 // Useful for extracting elements from the lisp object
 #define CAR(o) LIST(o)->car
@@ -66,11 +158,22 @@ typedef struct {
 #define PROCEDURE(o)  CLOSURE(o)->procedure
 #define CAPTURED(o)   CLOSURE(o)->captured
 #define NARGS(o)      CLOSURE(o)->nargs
+#define CODE(o)       CLOSURE(o)->code
+#define FRAME_CLOSURE(o) FRAME(o)->closure
+#define FRAME_CAPTURED(o) FRAME(o)->captured
+#define FRAME_VALUES(o)  FRAME(o)->values
+#define PARTIAL_FUNCTION(o) PARTIAL(o)->function
+#define PARTIAL_NVALUES(o)  PARTIAL(o)->nvalues
+#define PARTIAL_NARGS(o)    PARTIAL(o)->nargs
+#define PARTIAL_VALUES(o)   PARTIAL(o)->values
+#define VECTOR_ITEMS(o)     VECTOR(o)->items
+#define VECTOR_LENGTH(o)    VECTOR(o)->length
 
 /**
  * Function: new_atom
  * ------------------
- * Create a new atom object
+ * Create a new atom object. Atoms should be created by interning them in a symbol
+ * table rather than by calling this directly, since atoms are compared by pointer.
  * @param name: The name to store in the atom object
  * @return: The new atom object wrapping the raw atom
  */
@@ -80,45 +183,115 @@ obj* new_atom(atom_t name);
  * Function: new_list
  * ------------------
  * Returns a list object in dynamically allocated memory
+ * @param gc: Garbage collector to allocate the object from
  * @return: A pointer to a new list object in dynamically allocated memory
  */
-obj* new_list();
+obj* new_list(GarbageCollector *gc);
 
 /**
  * Function: new_closure
  * ---------------------
  * Creates a new closure object
+ * @param gc: Garbage collector to allocate the object from
  * @return: A newly created closure object
  */
-obj* new_closure();
+obj* new_closure(GarbageCollector *gc);
+
+/**
+ * Function: new_frame
+ * -------------------
+ * Creates a new activation frame for a call to a closure, with room for the value of each
+ * of its arguments. The values are initially NULL.
+ * @param closure: The closure being called
+ * @param gc: Garbage collector to allocate the frame from
+ * @return: A newly created frame object, or NULL if the closure has too many parameters for
+ * a frame to be allocated from the garbage collector's arena
+ */
+obj* new_frame(const obj *closure, GarbageCollector *gc);
+
+/**
+ * Function: new_partial
+ * ---------------------
+ * Creates a new partial application of a function, with room for the values of some number
+ * of arguments. The values are initially NULL.
+ * @param function: The closure, or partial application of a closure, being applied
+ * @param nvalues: The number of arguments being applied
+ * @param gc: Garbage collector to allocate the partial application from
+ * @return: A newly created partial application, or NULL if there are too many values for it
+ * to be allocated from the garbage collector's arena (see PARTIAL_MAX_VALUES)
+ */
+obj* new_partial(obj *function, int nvalues, GarbageCollector *gc);
+
+/**
+ * Function: new_vector
+ * --------------------
+ * Creates a new vector, with its elements in a block of memory recorded with the garbage
+ * collector. The elements are initially NULL.
+ * @param length: The number of elements, between zero and VECTOR_MAX_LENGTH
+ * @param gc: Garbage collector to allocate the vector from
+ * @return: A newly created vector object
+ */
+obj* new_vector(int length, GarbageCollector *gc);
+
+/**
+ * Function: new_hashtable
+ * -----------------------
+ * Creates a hash table object, which takes ownership of a CMap
+ * @param map: The map from key to value (both obj*) that the hash table holds
+ * @param gc: Garbage collector to allocate the object from
+ * @return: The new hash table object
+ */
+obj* new_hashtable(CMap *map, GarbageCollector *gc);
 
 /**
  * Function: new_int
  * -----------------
- * Creates a new integer object wrapping a raw integer value.
- * Note: This object will not be automatically added to the "allocated" list
+ * Creates a fixnum: an integer object wrapping a raw integer value. The integer is an immediate
+ * stored in the object reference itself, so nothing is allocated and nothing must be freed.
+ * @param value: The integer value to wrap in an object, between FIXNUM_MIN and FIXNUM_MAX
+ * @return: The immediate object holding the integer value
+ */
+obj* new_int(int64_t value);
+
+/**
+ * Function: new_integer
+ * ---------------------
+ * Creates an integer object for any 64-bit integer: a fixnum if the value is in range,
+ * and otherwise a new bignum object
  * @param value: The integer value to wrap in an object
- * @return: The object wrapping a copy of the integer value in dynamically allocated memory
+ * @param gc: Garbage collector to allocate a bignum object from
+ * @return: The object holding the integer value
  */
-obj* new_int(int value);
+obj* new_integer(int64_t value, GarbageCollector *gc);
 
 /**
  * Function: new_float
  * -------------------
- * Creates a new float object wrapping a raw integer value.
- * Note: This object will not be automatically added to the "allocated" list
+ * Creates a float object wrapping a raw floating point value. Most floats are immediates
+ * stored in the object reference itself, and the others are allocated as float objects.
  * @param value: The float value to wrap in an object
- * @return: The object wrapping a copy of the floating point value
+ * @param gc: Garbage collector to allocate a float object from
+ * @return: The object holding the floating point value
+ */
+obj* new_float(double value, GarbageCollector *gc);
+
+/**
+ * Function: new_bignum
+ * --------------------
+ * Creates a bignum object, which takes ownership of a bignum
+ * @param value: The bignum, not yet owned by any object
+ * @param gc: Garbage collector to allocate the object from, and to record the bignum with
+ * @return: The new bignum object
  */
-obj* new_float(float value);
+obj* new_bignum(Bignum *value, GarbageCollector *gc);
 
 /**
  * Function: copy_atom
  * -------------------
- * Copy an object that is an atom by dynamically allocating space for an identical object, and then
- * copying the contents of the atom over into the new object.
+ * Copy an object that is an atom. Since atoms are interned there is only ever one atom
+ * object for each name, so this returns the very same object.
  * @param o: The object (of type atom) to copy
- * @return: A pointer to a copy of the object in dynamically allocated space
+ * @return: The atom object itself
  */
 obj* copy_atom(const obj* o);
 
@@ -127,20 +300,42 @@ obj* copy_atom(const obj* o);
  * -------------------
  * Copy a list object NOT recursively
  * @param o: The list object to copy
+ * @param gc: Garbage collector to allocate the object from
  * @return: A copy of the list in dynamically allocated memory
  */
-obj* copy_list(const obj *o);
+obj* copy_list(const obj *o, GarbageCollector *gc);
+
+/**
+ * Function: copy_number
+ * ---------------------
+ * Copies a number. Immediates are returned as they are, and float and bignum objects are copied.
+ * @param o: The number to copy
+ * @param gc: Garbage collector to allocate the copy from
+ * @return: A number with the same value
+ */
+obj* copy_number(const obj *o, GarbageCollector *gc);
 
 /**
  * Function: compare
  * -----------------
- * Compares two lisp objects in a non-recursive way
+ * Compares two lisp objects in a non-recursive way. Atoms and lists are compared by
+ * identity, except that any two empty lists are the same. Integers are the same if they
+ * have the same value, as are floats.
  * @param a: The first lisp object
  * @param b: The second lisp object
  * @return: True if both objects are the same, false otherwise
  */
 bool compare(const obj* a, const obj* b);
 
+/**
+ * Function: is_immediate
+ * ----------------------
+ * Determines if an object is an immediate (a number stored in the reference itself)
+ * @param o: The object to check
+ * @return: True if the object is an immediate, false if it is NULL or a heap object
+ */
+bool is_immediate(const obj* o);
+
 /**
  * Function: is_atom
  * -----------------
@@ -177,21 +372,76 @@ bool is_list(const obj* o);
  */
 bool is_closure(const obj* o);
 
+/**
+ * Function: is_frame
+ * ------------------
+ * Determines if an object is an activation frame
+ * @param o: The object to check whether it is a frame
+ * @return: True if the object type is a frame, false otherwise
+ */
+bool is_frame(const obj* o);
+
+/**
+ * Function: is_partial
+ * --------------------
+ * Determines if an object is a partial application of a closure
+ * @param o: The object to check whether it is a partial application
+ * @return: True if the object type is a partial application, false otherwise
+ */
+bool is_partial(const obj* o);
+
+/**
+ * Function: is_vector
+ * -------------------
+ * Determines if an object is a vector
+ * @param o: The object to check whether it is a vector
+ * @return: True if the object type is a vector, false otherwise
+ */
+bool is_vector(const obj* o);
+
+/**
+ * Function: is_hashtable
+ * ----------------------
+ * Determines if an object is a hash table
+ * @param o: The object to check whether it is a hash table
+ * @return: True if the object type is a hash table, false otherwise
+ */
+bool is_hashtable(const obj* o);
+
+/**
+ * Function: is_mutable
+ * --------------------
+ * Determines if an object can be modified by Lisp code (a vector or hash table), such that
+ * it is shared rather than copied
+ * @param o: The object to check
+ * @return: True if the object is a vector or hash table, false otherwise
+ */
+bool is_mutable(const obj* o);
+
 /**
  * Function: is_int
  * ----------------
- * Determines if an object is of the integer type
- * @param o: The object to check whether it is an integer
- * @return: True if the object type is an integer, false otherwise
+ * Determines if an object is a fixnum (an immediate integer)
+ * @param o: The object to check whether it is a fixnum
+ * @return: True if the object is a fixnum, false otherwise (including for bignums)
  */
 bool is_int(const obj* o);
 
+/**
+ * Function: is_bignum
+ * -------------------
+ * Determines if an object is a bignum
+ * @param o: The object to check whether it is a bignum
+ * @return: True if the object type is a bignum, false otherwise
+ */
+bool is_bignum(const obj* o);
+
 /**
  * Function: is_float
  * ------------------
  * Determines if an object is of the float type
  * @param o: The object to check whether it is a float
- * @return: True if the object type is a float, false otherwise
+ * @return: True if the object is a float, whether immediate or not, false otherwise
  */
 bool is_float(const obj* o);
 
@@ -200,7 +450,7 @@ bool is_float(const obj* o);
  * -------------------
  * Determines if an object is a number type
  * @param o: The object to check whether it is a number
- * @return: True if the object type is a int or float, false otherwise
+ * @return: True if the object is a fixnum, bignum or float, false otherwise
  */
 bool is_number(const obj* o);
 
@@ -217,24 +467,26 @@ bool is_t(const obj* o);
  * Function: get_int
  * -----------------
  * Get the integer value from an object wrapping a number
- * @param o: The object that is wrapping the integer or the float
+ * @param o: The object that is wrapping the fixnum or the float
  * @return: A copy of the value stored in the object as an integer
  */
-int get_int(const obj* o);
+int64_t get_int(const obj* o);
 
 /**
  * Function: get_float
  * -------------------
  * Get the floating point value from an object wrapping a number
- * @param o: The object wrapping the integer or floating point value
+ * @param o: The object wrapping the integer (fixnum or bignum) or floating point value
  * @return: A copy of the value stored in the object as a floating point
  */
-float get_float(const obj* o);
+double get_float(const obj* o);
 
 /**
  * Function: dispose
  * -----------------
- * Free the dynamically allocated memory used to store the lisp object.
+ * Return the memory used to store the lisp object to the arena it was allocated from, along
+ * with the compiled code of a closure, the digits of a bignum, the elements of a vector or the map of a hash table. Atoms are owned by the symbol table that interned
+ * them, and immediates have no memory to free, so neither are freed by this function.
  * @param o: Pointer to the lisp object to dispose of
  */
 void dispose(obj* o);
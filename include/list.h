@@ -23,24 +23,28 @@
  * Creates a new list and sets the value of car and cdr
  * @param car: The value to set in the car of the new list
  * @param cdr: The value to set in the cdr of the new list
+ * @param gc: Garbage collector to allocate the list from
  * @return: The new list with the specified values set
  */
-obj* new_list_set(const obj *car, const obj *cdr);
+obj* new_list_set(const obj *car, const obj *cdr, GarbageCollector *gc);
 
 /**
  * Function: copy_recursive
  * ------------------------
- * Copies an object, returning a new one, leaving the old one untouched
+ * Copies an object, returning a new one, leaving the old one untouched. Atoms, vectors and
+ * hash tables are not copied, and the copy refers to the same ones.
  * @param o: An object to copy
+ * @param gc: Garbage collector to allocate the copy from
  * @return: A copy of the object
  */
-obj* copy_recursive(const obj *o);
+obj* copy_recursive(const obj *o, GarbageCollector *gc);
 
 /**
  * Function: dispose_recursive
  * ---------------------------
  * Free the allocated memory used to store this lisp object, recursing
- * on any child lisp objects in the case that the object is of the list type.
+ * on any child lisp objects in the case that the object is of the list type. Vectors and
+ * hash tables are shared, so are left for the garbage collector to free.
  * @param o: Pointer to the lisp object to dispose of recursively
  */
 void dispose_recursive(obj *o);
@@ -89,9 +93,10 @@ obj* sublist(const obj* o, int i);
  * Prepends one list to another at their top levels
  * @param list1: The list to prepend to list2
  * @param list2: The list to append to list1
+ * @param gc: Garbage collector to notify of the modification to the end of list1
  * @return: The first list, now with it's end pointing to the start of list2
  */
-obj* join_lists(obj *list1, obj *list2);
+obj* join_lists(obj *list1, obj *list2, GarbageCollector *gc);
 
 /**
  * Function: split_lists
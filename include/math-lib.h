@@ -10,118 +10,205 @@
 #include "interpreter.h"
 #include "list.h"
 #include "garbage-collector.h"
+#include "primitives.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The operations of the math primitives, in the order that the primitives are defined
+typedef enum math_op {
+  math_add, math_sub, math_mul, math_divide, math_mod, math_min, math_max,
+  math_equal, math_gt, math_gte, math_lt, math_lte
+} math_op;
+
+/**
+ * Functions: add_overflows, sub_overflows, mul_overflows
+ * ------------------------------------------------------
+ * Checked arithmetic on 64-bit integers
+ * @param x: The first operand
+ * @param y: The second operand
+ * @param result: Location to write the result to, if it fits in 64 bits
+ * @return: True if the result does not fit in 64 bits (and was not written), false otherwise
+ */
+static inline bool add_overflows(int64_t x, int64_t y, int64_t *result) {
+  if ((y > 0 && x > INT64_MAX - y) || (y < 0 && x < INT64_MIN - y)) return true;
+  *result = x + y;
+  return false;
+}
+
+static inline bool sub_overflows(int64_t x, int64_t y, int64_t *result) {
+  if ((y < 0 && x > INT64_MAX + y) || (y > 0 && x < INT64_MIN + y)) return true;
+  *result = x - y;
+  return false;
+}
+
+static inline bool mul_overflows(int64_t x, int64_t y, int64_t *result) {
+#if defined(__GNUC__)
+  int64_t product;
+  if (__builtin_mul_overflow(x, y, &product)) return true;
+  *result = product;
+  return false;
+#else
+  if (x > 0 ? (y > 0 ? x > INT64_MAX / y : y < INT64_MIN / x)
+            : (y > 0 ? x < INT64_MIN / y : x != 0 && y < INT64_MAX / x)) return true;
+  *result = x * y;
+  return false;
+#endif
+}
 
 /**
  * Function: get_math_library
  * --------------------------
  * Get the math library environment
+ * @param symbols: Symbol table to intern the names of the math primitives in
+ * @param gc: Garbage collector to allocate the environment from
  * @return: The math library environment
  */
-obj* get_math_library();
+obj* get_math_library(SymbolTable *symbols, GarbageCollector *gc);
+
+/**
+ * Function: math_apply
+ * --------------------
+ * Applies a math operation to the values of its two arguments. Arithmetic on two integers
+ * gives an integer, which is promoted to a bignum if it overflows a fixnum, and on any float
+ * gives a float. Comparisons give the truth atom or nil. A result that isn't an immediate is
+ * recorded with the interpreter's garbage collector.
+ * @param op: The operation to apply
+ * @param first: The value of the first argument
+ * @param second: The value of the second argument
+ * @param interpreter: Interpreter to allocate the result in
+ * @return: The result of the operation, or NULL if either argument is not a number (or an integer is divided by zero)
+ */
+obj *math_apply(math_op op, const obj *first, const obj *second, LispInterpreter *interpreter);
+
+/**
+ * Function: math_primitive_op
+ * ---------------------------
+ * Determines which math operation a primitive applies
+ * @param primitive: The declaration of the primitive
+ * @param op: Location to write the operation to
+ * @return: True if the primitive is a math primitive, false otherwise
+ */
+bool math_primitive_op(const primitive_def *primitive, math_op *op);
 
 /**
  * Primitive: add
  * ---------------
- * Primitive function for adding two numbers
- * @param args: The unevaluated arguments to add
- * @param envp: The environment to evaluate the addition
+ * Primitive function for adding numbers
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to add
  * @return: A newly allocated number/float object containing the result of the addition
  */
-obj *add(const obj *args, LispInterpreter *interpreter);
+obj *add(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: sub
  * -------------------
- * Primitive function for subtracting two numbers
- * @param o: The unevaluated arguments to subtract
- * @param env: The environment to evaluate the subtraction
+ * Primitive function for subtracting numbers from the first
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to subtract
  * @return: A newly allocated number/float object containing the result of the subtraction
  */
-obj *sub(const obj *o, LispInterpreter *interpreter);
+obj *sub(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: mul
  * -------------------
- * Primitive function for multiplying two numbers
- * @param o: The unevaluated arguments to multiply
- * @param env: The environment to evaluate the multiplication
+ * Primitive function for multiplying numbers
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to multiply
  * @return: A newly allocated number/float object containing the result of the multiplication
  */
-obj *mul(const obj *o, LispInterpreter *interpreter);
+obj *mul(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: divide
  * -----------------
- * Primitive function for dividing two numbers
- * @param o: The unevaluated arguments to divide
- * @param env: The environment to evaluate the division
+ * Primitive function for dividing the first number by the others
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to divide
  * @return: A newly allocated number/float object containing the result of the division
  */
-obj *divide(const obj *o, LispInterpreter *interpreter);
+obj *divide(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: mod
  * --------------
  * Primitive function for taking modulus of two numbers
- * @param o: The unevaluated arguments to use to take the modulus
- * @param env: The environment to evaluate the modulus
+ * @param argc: The number of arguments (two)
+ * @param argv: The values of the numbers to use to take the modulus
  * @return: A newly allocated number/float object containing the result of the modulus
  */
-obj *mod(const obj *o, LispInterpreter *interpreter);
+obj *mod(int argc, obj **argv, LispInterpreter *interpreter);
+
+/**
+ * Primitive: min
+ * --------------
+ * Primitive function for the smallest of some numbers
+ * @param argc: The number of arguments (one or more)
+ * @param argv: The values of the numbers
+ * @return: The smallest number, a float if any of the numbers is a float
+ */
+obj *min(int argc, obj **argv, LispInterpreter *interpreter);
+
+/**
+ * Primitive: max
+ * --------------
+ * Primitive function for the largest of some numbers
+ * @param argc: The number of arguments (one or more)
+ * @param argv: The values of the numbers
+ * @return: The largest number, a float if any of the numbers is a float
+ */
+obj *max(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: equal
  * ----------------
  *  Test Equality
- * @param o
- * @param env
- * @param gc
- * @return
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to compare
+ * @return: The truth atom if the comparison holds between each adjacent pair, otherwise nil
  */
-obj *equal(const obj *o, LispInterpreter *interpreter);
+obj *equal(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: gt
  * -------------
  * Greater than
- * @param o
- * @param env
- * @param gc
- * @return
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to compare
+ * @return: The truth atom if the comparison holds between each adjacent pair, otherwise nil
  */
-obj *gt(const obj *o, LispInterpreter *interpreter);
+obj *gt(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: gte
  * --------------
  * Greater than or equals
- * @param o
- * @param env
- * @param gc
- * @return
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to compare
+ * @return: The truth atom if the comparison holds between each adjacent pair, otherwise nil
  */
-obj *gte(const obj *o, LispInterpreter *interpreter);
+obj *gte(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: lt
  * -------------
  * Less than
- * @param o
- * @param env
- * @param gc
- * @return
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to compare
+ * @return: The truth atom if the comparison holds between each adjacent pair, otherwise nil
  */
-obj *lt(const obj *o, LispInterpreter *interpreter);
+obj *lt(int argc, obj **argv, LispInterpreter *interpreter);
 
 /**
  * Primitive: lte
  * --------------
  * Less than or equal to
- * @param o
- * @param env
- * @param gc
- * @return
+ * @param argc: The number of arguments (two or more)
+ * @param argv: The values of the numbers to compare
+ * @return: The truth atom if the comparison holds between each adjacent pair, otherwise nil
  */
-obj *lte(const obj *o, LispInterpreter *interpreter);
+obj *lte(int argc, obj **argv, LispInterpreter *interpreter);
 
 #endif // _LISP_MATH_H_INCLUDED
@@ -8,11 +8,12 @@
 #define _PARSER_H_INCLUDED
 
 #include "lisp-objects.h"
+#include "symbol-table.h"
 #include <stdlib.h>
 
 // The string representation of nil/empty list/false
 #define NIL_STR "nil"
-#define PARSE(e) parse_expression(e, NULL)
+#define PARSE(e, interpreter) parse_expression(e, NULL, &(interpreter)->symbols, &(interpreter)->gc)
 
 typedef char* expression;
 typedef const char* const_expression;
@@ -23,9 +24,11 @@ typedef const char* const_expression;
  * Parses a lisp expression that represents either a lisp atom or list
  * @param e: A balanced, valid lisp expression
  * @param num_parsed_p: A pointer to a place where the number of parsed characters may be written. Must be valid
+ * @param symbols: Symbol table to intern the parsed atoms in
+ * @param gc: Garbage collector to allocate the parsed lists from
  * @return: Pointer to a lisp data structure object representing that the lisp expression represents
  */
-obj* parse_expression(const_expression e, size_t *num_parsed_p);
+obj* parse_expression(const_expression e, size_t *num_parsed_p, SymbolTable *symbols, GarbageCollector *gc);
 
 /**
  * Function: unparse
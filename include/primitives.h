@@ -17,56 +17,139 @@
 /**
  * Primitive Definition Macro
  * --------------------------
- * Define a new primitive lisp procedure.
+ * Define a new primitive lisp procedure that is a special form, which is applied to its
+ * unevaluated arguments and checks their number itself.
  *
  * @param name: The name of the primitive function
  * @param args: Lisp object containing the list of arguments to the primitive
- * @param envp: Pointer to the environment reference in which to evaluate the primitive
- * by applying it to the argument list passed in args
- * @param mm: Memory manager reference to store dynamically allocated lisp objects
- * that were created during the application of the primitive
+ * @param interpreter: The interpreter in which to evaluate the primitive
  * @return: A new lisp object which is the result of applying
  */
 #define def_primitive(name) obj *name(const obj *args UNUSED, LispInterpreter *interpreter UNUSED)
 
+/**
+ * Function Definition Macro
+ * -------------------------
+ * Define a new primitive lisp procedure that is applied to the values of its arguments. The
+ * number of arguments has already been checked against the primitive's declared arity.
+ *
+ * @param name: The name of the primitive function
+ * @param argc: The number of arguments
+ * @param argv: The values of the arguments
+ * @param interpreter: The interpreter in which to evaluate the primitive
+ * @return: A new lisp object which is the result of applying
+ */
+#define def_function(name) obj *name(int argc UNUSED, obj **argv UNUSED, LispInterpreter *interpreter UNUSED)
+
 // function type definitions
 typedef obj*(*primitive_t)(const obj*, LispInterpreter *);
+typedef obj*(*function_t)(int, obj**, LispInterpreter *);
+
+#define VARIADIC (-1) // Maximum number of arguments of a primitive that takes any number of them
+
+/**
+ * @struct primitive_def
+ * @brief The declaration of a primitive in the table of a library of primitives. Primitive
+ * objects refer to their declaration, which lives as long as the program.
+ */
+struct primitive_def {
+  atom_t name;            // Name that the primitive is bound to in the default environment
+  primitive_t special;    // Applied to the unevaluated arguments if a special form, otherwise NULL
+  function_t function;    // Applied to the values of the arguments if not a special form
+  int min_args;           // Fewest arguments that the function takes
+  int max_args;           // Most arguments that the function takes, or VARIADIC
+};
 
 /**
  * Function: get_primitive_env
  * ---------------------------
  * Get the library of primitive operations
+ * @param symbols: Symbol table to intern the names of the primitives in
+ * @param gc: Garbage collector to allocate the environment from
  * @return: An environment constructed with the primitive operations
  */
-obj *get_primitive_library();
+obj *get_primitive_library(SymbolTable *symbols, GarbageCollector *gc);
 
 /**
  * Function: new_primitive
  * -----------------------
  * Create a new primitive lisp object.
- * @param primitive: The primitive to wrap in an object
- * @return; The new primitive object wrapping the raw primitive instruction pointer
+ * @param primitive: The declaration of the primitive to wrap in an object
+ * @param gc: Garbage collector to allocate the object from
+ * @return; The new primitive object referring to the primitive's declaration
+ */
+obj *new_primitive(const primitive_def *primitive, GarbageCollector *gc);
+
+/**
+ * Function: check_arity
+ * ---------------------
+ * Checks that a primitive that is not a special form takes a number of arguments, logging an
+ * error if it doesn't
+ * @param primitive: The declaration of the primitive
+ * @param nargs: The number of arguments it is being applied to
+ * @return: True if the primitive takes that many arguments, false otherwise
+ */
+bool check_arity(const primitive_def *primitive, int nargs);
+
+/**
+ * Function: free_variable_cache_init
+ * ----------------------------------
+ * Initializes an empty cache of the names that lambda bodies may capture
+ * @param cache: The cache to initialize
+ * @return: True if the cache was initialized, false if memory could not be allocated
+ */
+bool free_variable_cache_init(FreeVariableCache *cache);
+
+/**
+ * Function: free_variable_cache_dispose
+ * -------------------------------------
+ * Frees the memory used by a cache of the names that lambda bodies may capture
+ * @param cache: The cache to dispose of
+ */
+void free_variable_cache_dispose(FreeVariableCache *cache);
+
+/**
+ * Function: cond_expression
+ * -------------------------
+ * Evaluates the predicates of the clauses of a cond in order, finding the expression whose
+ * value is the value of the cond, without evaluating it. This lets eval evaluate the
+ * expression in tail position, rather than nesting a call to eval within the cond primitive.
+ * @param args: The (predicate expression) clauses of the cond
+ * @param interpreter: The interpreter to evaluate the predicates in
+ * @return: The expression of the first clause whose predicate is not the empty list, a new
+ * empty list if there is no such clause, or NULL if an error occurred
+ */
+const obj *cond_expression(const obj *args, LispInterpreter *interpreter);
+
+/**
+ * Function: is_cond
+ * -----------------
+ * Determines if an object is the cond primitive
+ * @param o: The object to check
+ * @return: True if the object is a primitive object wrapping cond, false otherwise
  */
-obj *new_primitive(primitive_t primitive);
+bool is_cond(const obj *o);
 
 /**
  * Function: t
  * -----------
  * Get the truth atom. This is defined to be a lisp object of type atom with
- * the contents being the C-string "t". This object will be in dynamically allocated
- * memory and must be freed
- * @return: A pointer to a new truth atom in dynamically allocated memory
+ * the contents being the C-string "t". This is the interned atom, which is
+ * owned by the interpreter's symbol table and must not be freed
+ * @param interpreter: The interpreter whose truth atom to get
+ * @return: A pointer to the truth atom
  */
-obj *t(GarbageCollector *mm);
+obj *t(LispInterpreter *interpreter);
 
 /**
  * Function: nil
  * ---------------
  * Get an empty list. This is defined to be a lisp object of type lisp with
  * NULL for both car and cdr. This object will be in newly dynamically allocated
- * memory and must be freed
+ * memory that is managed by the interpreter's garbage collector
+ * @param interpreter: The interpreter to allocate the empty list in
  * @return: A pointer to the a new empty list in dynamically allocated memory
  */
-obj *nil(GarbageCollector *mm);
+obj *nil(LispInterpreter *interpreter);
 
 #endif // _LISP_PRIMITIVES_H_INCLUDED
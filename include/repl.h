@@ -16,9 +16,11 @@
  * a lisp program, or running the interactive prompt
  * @param lispProgramPath: The path to the lisp program
  * @param env: Environment to run the program in
+ * @param use_vm: If false, compiled closures are tree-walked rather than run by the bytecode VM
  * @return: Exit status
  */
 int
-run_lisp(const char *bootstrap_path, const char *program_file, bool run_repl, const char *history_file, bool verbose);
+run_lisp(const char *bootstrap_path, const char *program_file, bool run_repl, const char *history_file,
+         bool use_vm, bool verbose);
 
 #endif //_RUN_LISP_H_INCLUDED
@@ -0,0 +1,62 @@
+/*
+ * File: symbol-table.h
+ * --------------------
+ * Presents the interface of the table of interned symbols. Every atom object
+ * is created through this table so that there is exactly one atom object for
+ * each distinct name. Atoms may then be compared by pointer rather than by
+ * comparing their names, and may be shared freely between the parsed code,
+ * the environment and closures. The atom objects are owned by the symbol table,
+ * and are freed only when the table is disposed of.
+ */
+
+#ifndef _SYMBOL_TABLE_H_INCLUDED
+#define _SYMBOL_TABLE_H_INCLUDED
+
+#include "lisp-objects.h"
+#include <cmap.h>
+#include <cvector.h>
+
+typedef struct SymbolTable {
+  CMap *index;          // Map from symbol name to atom object
+  CVector symbols;      // Every interned atom, in order of creation
+} SymbolTable;
+
+/**
+ * Function: symbol_table_init
+ * ---------------------------
+ * Initializes an empty symbol table
+ * @param symbols: The symbol table to initialize
+ * @return: True if the table was initialized successfully, false otherwise
+ */
+bool symbol_table_init(SymbolTable *symbols);
+
+/**
+ * Function: intern
+ * ----------------
+ * Gets the unique atom object with the given name, creating it if this is
+ * the first time that the name has been interned.
+ * @param symbols: The symbol table to intern the name in
+ * @param name: The name of the symbol (will be copied)
+ * @return: The atom object for that name, owned by the symbol table, or NULL on failure
+ */
+obj *intern(SymbolTable *symbols, atom_t name);
+
+/**
+ * Function: symbol_count
+ * ----------------------
+ * Gets the number of distinct symbols that have been interned
+ * @param symbols: The symbol table
+ * @return: The number of atom objects in the table
+ */
+int symbol_count(const SymbolTable *symbols);
+
+/**
+ * Function: symbol_table_dispose
+ * ------------------------------
+ * Frees every interned atom along with the table itself. No atom from
+ * this table may be used after this call.
+ * @param symbols: The symbol table to dispose of
+ */
+void symbol_table_dispose(SymbolTable *symbols);
+
+#endif // _SYMBOL_TABLE_H_INCLUDED
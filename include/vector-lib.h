@@ -0,0 +1,25 @@
+/*
+ * File: vector-lib.h
+ * ------------------
+ * Presents the interface of the vector library: the primitives that make, index and convert
+ * vectors (see lisp-objects.h)
+ */
+
+#ifndef _LISP_VECTOR_LIB_H_INCLUDED
+#define _LISP_VECTOR_LIB_H_INCLUDED
+
+#include "interpreter.h"
+#include "garbage-collector.h"
+#include "primitives.h"
+
+/**
+ * Function: get_vector_library
+ * ----------------------------
+ * Get the vector library environment
+ * @param symbols: Symbol table to intern the names of the vector primitives in
+ * @param gc: Garbage collector to allocate the environment from
+ * @return: The vector library environment
+ */
+obj* get_vector_library(SymbolTable *symbols, GarbageCollector *gc);
+
+#endif // _LISP_VECTOR_LIB_H_INCLUDED
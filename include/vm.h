@@ -0,0 +1,65 @@
+/*
+ * File: vm.h
+ * ----------
+ * Presents the interface of the virtual machine that runs the bytecode of compiled
+ * closures (see bytecode.h). Calls between compiled closures, including the calls that complete
+ * partial applications of them, are made within the VM's dispatch loop, on the VM's own value
+ * stack, rather than by recursing through eval and apply. Primitives passed as values that
+ * aren't special forms are passed the values of their arguments on the stack. Anything else that
+ * is called from compiled code, such as a closure that could not be compiled or a call that only
+ * partially applies a closure, is called through apply with its arguments quoted. Every value
+ * on the VM's stack is a garbage collection root, so the stack also holds the arguments of
+ * primitives applied by the tree-walking evaluator (see vm_apply_primitive).
+ */
+
+#ifndef _LISP_VM_H_INCLUDED
+#define _LISP_VM_H_INCLUDED
+
+#include "bytecode.h"
+#include "interpreter.h"
+
+/**
+ * Function: vm_init
+ * -----------------
+ * Initializes the VM of an interpreter, enabled. Call this once the environment has been created.
+ * @param interpreter: The interpreter whose VM to initialize
+ * @return: True if the VM was initialized, false otherwise
+ */
+bool vm_init(LispInterpreter *interpreter);
+
+/**
+ * Function: vm_apply
+ * ------------------
+ * Applies a compiled closure, or a partial application of one, to a list of arguments, evaluating
+ * the arguments in the current environment and then running the closure's code with the values
+ * already applied followed by the values of the arguments
+ * @param function: A closure with compiled code, or a partial application of one, taking as many
+ * more parameters as there are arguments
+ * @param args: The (unevaluated) argument list
+ * @param interpreter: The interpreter to run the closure in
+ * @return: The result of the application, or NULL if an error occurred
+ */
+obj *vm_apply(const obj *function, const obj *args, LispInterpreter *interpreter);
+
+/**
+ * Function: vm_apply_primitive
+ * ----------------------------
+ * Applies a primitive that is not a special form to a list of arguments, after checking their
+ * number against the primitive's arity. The arguments are evaluated onto the VM's value stack,
+ * where they are garbage collection roots, and the primitive is passed them there.
+ * @param primitive: The declaration of the primitive
+ * @param args: The (unevaluated) argument list
+ * @param interpreter: The interpreter to evaluate the arguments in
+ * @return: The result of the application, or NULL if an error occurred
+ */
+obj *vm_apply_primitive(const primitive_def *primitive, const obj *args, LispInterpreter *interpreter);
+
+/**
+ * Function: vm_dispose
+ * --------------------
+ * Frees the stacks of a VM. Call this before the interpreter's garbage collector is disposed of.
+ * @param vm: The VM to dispose of
+ */
+void vm_dispose(VM *vm);
+
+#endif // _LISP_VM_H_INCLUDED
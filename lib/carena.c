@@ -0,0 +1,196 @@
+/**
+ * @file carena.c
+ * @brief Implementation of the CArena size-class slab allocator.
+ * @details Each page begins with a header recording its size class, and pages are
+ * aligned to their size, so the page (and therefore the size class) that an object
+ * belongs to is found by masking off the low bits of the object's address. The page
+ * header also records the page's number, which locates its mark bitmap within the
+ * arena's bitmaps, and the bit for an object is given by its offset within the page.
+ */
+
+#include "carena.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+// When built with AddressSanitizer, unallocated objects are poisoned so that use
+// of an object after it was freed is still reported, despite the arena recycling it
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define POISON(p, size)   ASAN_POISON_MEMORY_REGION(p, size)
+#define UNPOISON(p, size) ASAN_UNPOISON_MEMORY_REGION(p, size)
+#else
+#define POISON(p, size)   ((void) (p), (void) (size))
+#define UNPOISON(p, size) ((void) (p), (void) (size))
+#endif
+
+struct CArenaPage {
+  CArenaPage *next;               // Next page of the same size class
+  CArenaSizeClass *size_class;    // Size class that this page's objects belong to
+  CArena *arena;                  // Arena holding the page's mark bitmap
+  size_t index;                   // Page number, the index of the page's mark bitmap
+};
+
+// Objects start after the page header, rounded up to the granule
+#define PAGE_HEADER_SIZE (((sizeof(CArenaPage) + CARENA_GRANULE - 1) / CARENA_GRANULE) * CARENA_GRANULE)
+
+// Static function declarations
+static inline CArenaPage *page_of(const void *p);
+static inline unsigned char *mark_byte(const void *p, unsigned char *bit);
+static bool add_page(CArena *arena, CArenaSizeClass *sc);
+
+bool carena_init(CArena *arena) {
+  assert(arena != NULL);
+  memset(arena, 0, sizeof(CArena));
+  for (int i = 0; i < CARENA_NUM_SIZE_CLASSES; i++)
+    arena->classes[i].object_size = (size_t) (i + 1) * CARENA_GRANULE;
+  return true;
+}
+
+void *carena_alloc(CArena *arena, size_t size) {
+  assert(arena != NULL);
+  assert(size <= CARENA_MAX_SIZE);
+  if (size == 0) size = 1;
+
+  CArenaSizeClass *sc = &arena->classes[(size - 1) / CARENA_GRANULE];
+
+  void *p = sc->free_list;
+  if (p != NULL) {
+    UNPOISON(p, sc->object_size);
+    sc->free_list = *(void **) p;
+  } else {
+    if ((size_t) (sc->bump_end - sc->bump) < sc->object_size && !add_page(arena, sc)) return NULL;
+    p = sc->bump;
+    sc->bump += sc->object_size;
+    UNPOISON(p, sc->object_size);
+  }
+  sc->live++;
+  return p;
+}
+
+void carena_free(void *p) {
+  if (p == NULL) return;
+  CArenaSizeClass *sc = page_of(p)->size_class;
+  assert(sc->live > 0);
+
+  unsigned char bit;
+  unsigned char *byte = mark_byte(p, &bit);
+  *byte &= (unsigned char) ~bit; // so that the object is unmarked when it is allocated again
+
+  *(void **) p = sc->free_list;
+  sc->free_list = p;
+  sc->live--;
+  POISON(p, sc->object_size);
+}
+
+bool carena_mark(void *p) {
+  assert(p != NULL);
+  unsigned char bit;
+  unsigned char *byte = mark_byte(p, &bit);
+  if (*byte & bit) return false;
+  *byte |= bit;
+  return true;
+}
+
+bool carena_is_marked(const void *p) {
+  assert(p != NULL);
+  unsigned char bit;
+  unsigned char *byte = mark_byte(p, &bit);
+  return (*byte & bit) != 0;
+}
+
+void carena_clear_marks(CArena *arena) {
+  assert(arena != NULL);
+  if (arena->num_pages > 0)
+    memset(arena->marks, 0, arena->num_pages * CARENA_MARK_BYTES);
+}
+
+void carena_stats(const CArena *arena, CArenaStats *stats) {
+  assert(arena != NULL);
+  assert(stats != NULL);
+  memset(stats, 0, sizeof(CArenaStats));
+
+  for (int i = 0; i < CARENA_NUM_SIZE_CLASSES; i++) {
+    const CArenaSizeClass *sc = &arena->classes[i];
+    stats->num_pages += sc->num_pages;
+    stats->live_objects += sc->live;
+    stats->live_bytes += sc->live * sc->object_size;
+  }
+  stats->allocated_bytes = stats->num_pages * CARENA_PAGE_SIZE;
+  if (stats->allocated_bytes > 0)
+    stats->fragmentation = 1.0 - (double) stats->live_bytes / (double) stats->allocated_bytes;
+}
+
+void carena_dispose(CArena *arena) {
+  assert(arena != NULL);
+  for (int i = 0; i < CARENA_NUM_SIZE_CLASSES; i++) {
+    CArenaPage *page = arena->classes[i].pages;
+    while (page != NULL) {
+      CArenaPage *next = page->next;
+      UNPOISON(page, CARENA_PAGE_SIZE);
+      free(page);
+      page = next;
+    }
+  }
+  free(arena->marks);
+  carena_init(arena);
+}
+
+/**
+ * @brief Get the page that an object was allocated in
+ * @param p Pointer to an object allocated from an arena
+ * @return The page containing the object
+ */
+static inline CArenaPage *page_of(const void *p) {
+  return (CArenaPage *) ((uintptr_t) p & ~((uintptr_t) CARENA_PAGE_SIZE - 1));
+}
+
+/**
+ * @brief Get the byte of the mark bitmap holding the mark bit of an object
+ * @param p Pointer to an object allocated from an arena
+ * @param bit Location to write the mask of the object's bit within the byte
+ * @return The byte of the mark bitmap containing the object's bit
+ */
+static inline unsigned char *mark_byte(const void *p, unsigned char *bit) {
+  const CArenaPage *page = page_of(p);
+  size_t granule = ((uintptr_t) p & (CARENA_PAGE_SIZE - 1)) / CARENA_GRANULE;
+  *bit = (unsigned char) (1u << (granule % 8));
+  return page->arena->marks + page->index * CARENA_MARK_BYTES + granule / 8;
+}
+
+/**
+ * @brief Allocate a new page for a size class, making it the page that
+ * new objects are carved out of.
+ * @param arena The arena that the size class belongs to
+ * @param sc The size class to add a page to
+ * @return True if the page was added, false if allocation failed
+ */
+static bool add_page(CArena *arena, CArenaSizeClass *sc) {
+  if (arena->num_pages == arena->marks_capacity) {
+    size_t capacity = arena->marks_capacity == 0 ? 16 : 2 * arena->marks_capacity;
+    unsigned char *marks = realloc(arena->marks, capacity * CARENA_MARK_BYTES);
+    if (marks == NULL) return false;
+    arena->marks = marks;
+    arena->marks_capacity = capacity;
+  }
+
+  void *memory;
+  if (posix_memalign(&memory, CARENA_PAGE_SIZE, CARENA_PAGE_SIZE) != 0) return false;
+
+  CArenaPage *page = memory;
+  page->arena = arena;
+  page->index = arena->num_pages++;
+  memset(arena->marks + page->index * CARENA_MARK_BYTES, 0, CARENA_MARK_BYTES);
+  page->size_class = sc;
+  page->next = sc->pages;
+  sc->pages = page;
+  sc->num_pages++;
+
+  size_t num_objects = (CARENA_PAGE_SIZE - PAGE_HEADER_SIZE) / sc->object_size;
+  sc->bump = (char *) page + PAGE_HEADER_SIZE;
+  sc->bump_end = sc->bump + num_objects * sc->object_size;
+  POISON(sc->bump, CARENA_PAGE_SIZE - PAGE_HEADER_SIZE);
+  return true;
+}
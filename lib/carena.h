@@ -0,0 +1,130 @@
+/**
+ * @file carena.h
+ * @brief Defines the interface for the CArena type.
+ * @details A CArena is a size-class slab allocator for small, fixed-size objects.
+ * Objects are carved out of large pages, with each page holding objects of a single
+ * size class, so that objects of the same size are packed contiguously in memory.
+ * Freed objects are recycled through a free list per size class, and all pages are
+ * returned to the system at once when the arena is disposed of. Each object also has a
+ * mark bit, for use by a garbage collector. The mark bits are kept in a bitmap to the side
+ * of the pages rather than in the objects, so that marking and clearing the marks writes
+ * only to the bitmap, and all marks are cleared with a single memset. An arena is not
+ * thread safe: each thread (or interpreter) should own its own arena, which is what
+ * lets it avoid the locking done by the general-purpose allocator.
+ */
+
+#ifndef _CARENA_H
+#define _CARENA_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdbool>
+extern "C" {
+#else
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#endif
+
+#define CARENA_PAGE_SIZE        (16 * 1024)     // Bytes per page, pages are aligned to this size
+#define CARENA_GRANULE          8               // Difference in size between neighbouring size classes
+#define CARENA_NUM_SIZE_CLASSES 8               // Number of size classes
+#define CARENA_MAX_SIZE         (CARENA_GRANULE * CARENA_NUM_SIZE_CLASSES)
+#define CARENA_MARK_BYTES       (CARENA_PAGE_SIZE / CARENA_GRANULE / 8) // Mark bitmap bytes per page
+
+typedef struct CArenaPage CArenaPage;
+
+/**
+ * @struct CArenaSizeClass
+ * @brief The pages and free objects for all objects of a single size
+ */
+typedef struct CArenaSizeClass {
+  size_t object_size;     // Size of each object in this size class
+  void *free_list;        // Freed objects, linked through their first word
+  CArenaPage *pages;      // All pages of this size class, newest first
+  char *bump;             // Next never-used object in the newest page
+  char *bump_end;         // End of the objects in the newest page
+  size_t num_pages;       // Number of pages in this size class
+  size_t live;            // Number of allocated objects not yet freed
+} CArenaSizeClass;
+
+typedef struct CArena {
+  CArenaSizeClass classes[CARENA_NUM_SIZE_CLASSES];
+  unsigned char *marks;   // Mark bitmaps of all pages, one bit per granule, indexed by page number
+  size_t num_pages;       // Number of pages in all size classes
+  size_t marks_capacity;  // Number of pages that the mark bitmaps have room for
+} CArena;
+
+/**
+ * @struct CArenaStats
+ * @brief Summary of the memory used by an arena
+ */
+typedef struct CArenaStats {
+  size_t num_pages;         // Number of pages obtained from the system
+  size_t allocated_bytes;   // Total size of all pages
+  size_t live_objects;      // Number of objects allocated and not yet freed
+  size_t live_bytes;        // Total size of the live objects
+  double fragmentation;     // Fraction of the allocated bytes not used by live objects
+} CArenaStats;
+
+/**
+ * @brief Initialize an empty arena. No pages are allocated until the first allocation.
+ * Pages refer back to the arena, so it must not be moved once objects have been allocated.
+ * @param arena The arena to initialize
+ * @return True if the arena was initialized, false otherwise
+ */
+bool carena_init(CArena *arena);
+
+/**
+ * @brief Allocate an object from an arena
+ * @param arena The arena to allocate the object from
+ * @param size The size of the object, which must be no more than CARENA_MAX_SIZE
+ * @return Pointer to the new object, aligned to CARENA_GRANULE, or NULL if allocation failed
+ */
+void *carena_alloc(CArena *arena, size_t size);
+
+/**
+ * @brief Return an object to the arena that it was allocated from
+ * @param p Pointer to an object returned by carena_alloc, may be NULL
+ */
+void carena_free(void *p);
+
+/**
+ * @brief Set the mark bit of an object. Objects are unmarked when they are allocated.
+ * @param p Pointer to an object returned by carena_alloc
+ * @return True if the object was not already marked, false otherwise
+ */
+bool carena_mark(void *p);
+
+/**
+ * @brief Determine if an object is marked
+ * @param p Pointer to an object returned by carena_alloc
+ * @return True if the object's mark bit is set, false otherwise
+ */
+bool carena_is_marked(const void *p);
+
+/**
+ * @brief Clear the mark bits of every object in an arena
+ * @param arena The arena to clear the marks of
+ */
+void carena_clear_marks(CArena *arena);
+
+/**
+ * @brief Get a summary of the memory used by an arena
+ * @param arena The arena to summarize
+ * @param stats Location to write the summary to
+ */
+void carena_stats(const CArena *arena, CArenaStats *stats);
+
+/**
+ * @brief Free all of the pages of an arena, along with every object in them
+ * @param arena The arena to dispose of
+ */
+void carena_dispose(CArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CARENA_H
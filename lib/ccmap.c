@@ -0,0 +1,175 @@
+/**
+ * @file ccmap.c
+ * @brief Defines the implementation of the concurrent hash table, as a fixed number of
+ * shards that each hold a CMap and a reader-writer lock.
+ */
+
+#include "ccmap.h"
+#include "cmap.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+// number of shards (enough that threads seldom contend for one), and of the hash bits that pick one
+#define SHARD_BITS 6
+#define NUM_SHARDS (1 << SHARD_BITS)
+
+// bytes in a cache line, which separate the locks of neighbouring shards
+#define CACHE_LINE 64
+
+/**
+ * @struct shard
+ * @brief A part of the concurrent hash table, with its own lock
+ */
+struct shard {
+  pthread_rwlock_t lock;        // taken for reading by lookups and for writing by updates
+  CMap *map;                    // the keys of this shard and their values
+  char padding[CACHE_LINE];     // so that taking one shard's lock doesn't slow down its neighbours
+};
+
+/**
+ * @struct CConcurrentMapImplementation
+ * @brief Definition of the concurrent hash table implementation
+ */
+struct CConcurrentMapImplementation {
+  CMapHashFn hash;              // hash function callback, which also picks a key's shard
+  size_t key_size;              // The size of each key
+  size_t value_size;            // The size of each value
+  CleanupFn cleanupValue;       // Callback for value disposal, when a value is replaced
+  struct shard shards[NUM_SHARDS];
+};
+
+// static function declarations
+static struct shard *shard_of(CConcurrentMap *ccm, const void *key);
+
+CConcurrentMap *ccmap_create(size_t key_size, size_t value_size,
+                             CMapHashFn hash, CmpFn cmp,
+                             CleanupFn cleanupKey, CleanupFn cleanupValue,
+                             unsigned int capacity_hint) {
+  if (key_size <= 0 || value_size <= 0) return NULL;
+
+  CConcurrentMap *ccm = malloc(sizeof(CConcurrentMap));
+  if (ccm == NULL) return NULL;
+
+  ccm->hash = hash == NULL ? fast_hash : hash;
+  ccm->key_size = key_size;
+  ccm->value_size = value_size;
+  ccm->cleanupValue = cleanupValue;
+
+  // Each shard starts with room for its part of the expected keys
+  unsigned int shard_capacity = capacity_hint / NUM_SHARDS;
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *s = &ccm->shards[i];
+    s->map = cmap_create(key_size, value_size, ccm->hash, cmp, cleanupKey, cleanupValue, 0);
+    bool ok = s->map != NULL && cmap_reserve(s->map, shard_capacity);
+    if (ok && pthread_rwlock_init(&s->lock, NULL) == 0) continue;
+
+    // undo the shards made so far
+    if (s->map != NULL) cmap_dispose(s->map);
+    while (i-- > 0) {
+      pthread_rwlock_destroy(&ccm->shards[i].lock);
+      cmap_dispose(ccm->shards[i].map);
+    }
+    free(ccm);
+    return NULL;
+  }
+  return ccm;
+}
+
+void ccmap_dispose(CConcurrentMap *ccm) {
+  assert(ccm != NULL);
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    pthread_rwlock_destroy(&ccm->shards[i].lock);
+    cmap_dispose(ccm->shards[i].map);
+  }
+  free(ccm);
+}
+
+unsigned int ccmap_count(CConcurrentMap *ccm) {
+  assert(ccm != NULL);
+  unsigned int count = 0;
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *s = &ccm->shards[i];
+    pthread_rwlock_rdlock(&s->lock);
+    count += cmap_count(s->map);
+    pthread_rwlock_unlock(&s->lock);
+  }
+  return count;
+}
+
+bool ccmap_insert(CConcurrentMap *ccm, const void *key, const void *value) {
+  assert(ccm != NULL);
+  assert(key != NULL);
+  assert(value != NULL);
+
+  struct shard *s = shard_of(ccm, key);
+  pthread_rwlock_wrlock(&s->lock);
+
+  bool inserted = true;
+  void *existing = cmap_lookup(s->map, key);
+  if (existing != NULL) {
+    if (ccm->cleanupValue != NULL) ccm->cleanupValue(existing);
+    memcpy(existing, value, ccm->value_size);
+  } else {
+    inserted = cmap_insert(s->map, key, value) != NULL;
+  }
+
+  pthread_rwlock_unlock(&s->lock);
+  return inserted;
+}
+
+bool ccmap_lookup(CConcurrentMap *ccm, const void *key, void *value) {
+  assert(ccm != NULL);
+  assert(key != NULL);
+
+  struct shard *s = shard_of(ccm, key);
+  pthread_rwlock_rdlock(&s->lock);
+
+  const void *found = cmap_lookup(s->map, key);
+  if (found != NULL && value != NULL)
+    memcpy(value, found, ccm->value_size);
+
+  pthread_rwlock_unlock(&s->lock);
+  return found != NULL;
+}
+
+bool ccmap_remove(CConcurrentMap *ccm, const void *key) {
+  assert(ccm != NULL);
+  assert(key != NULL);
+
+  struct shard *s = shard_of(ccm, key);
+  pthread_rwlock_wrlock(&s->lock);
+
+  unsigned int count = cmap_count(s->map);
+  cmap_remove(s->map, key);
+  bool removed = cmap_count(s->map) < count;
+
+  pthread_rwlock_unlock(&s->lock);
+  return removed;
+}
+
+void ccmap_clear(CConcurrentMap *ccm) {
+  assert(ccm != NULL);
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *s = &ccm->shards[i];
+    pthread_rwlock_wrlock(&s->lock);
+    cmap_clear(s->map);
+    pthread_rwlock_unlock(&s->lock);
+  }
+}
+
+/**
+ * @brief Finds the shard that a key belongs to. The hash is mixed (by Fibonacci hashing)
+ * before its high bits pick the shard, since the shard's CMap picks entries with the low bits
+ * and keeps the high bits as well, which would otherwise be the same for all of a shard's keys.
+ * @param ccm The concurrent hash table
+ * @param key The key to find the shard of
+ * @return The shard that holds the key, if the table has it
+ */
+static struct shard *shard_of(CConcurrentMap *ccm, const void *key) {
+  uint32_t hash = (uint32_t) ccm->hash(key, ccm->key_size) * UINT32_C(2654435769);
+  return &ccm->shards[hash >> (32 - SHARD_BITS)];
+}
@@ -0,0 +1,102 @@
+/**
+ * @file ccmap.h
+ * @brief Defines the interface for the CConcurrentMap type: a hash table that may be used
+ * by many threads at once.
+ * @details The map is split into shards, each a CMap guarded by its own reader-writer lock,
+ * and each key belongs to the shard picked by its hash. Lookups take only the read lock of
+ * their shard, so they run in parallel with each other, and updates of keys in different
+ * shards run in parallel too. Since a shard may be changed as soon as its lock is released,
+ * values are copied out of the map rather than returned by pointer.
+ * Keys, values and callbacks are as for cmap_create (see cmap.h). The callbacks may be called
+ * from any thread, while the lock of a shard is held.
+ */
+
+#ifndef _CCMAP_H
+#define _CCMAP_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdbool>
+extern "C" {
+#else
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#endif
+
+#include <hash.h>
+#include <ops.h>
+
+typedef struct CConcurrentMapImplementation CConcurrentMap;
+
+/**
+ * Create a concurrent hash table in a dynamically allocated region of memory.
+ * @param key_size size of all keys stored in the table
+ * @param value_size size of all values stored in the table
+ * @param hash Hash function used to hash keys, or NULL for fast_hash
+ * @param cmp Comparison function between keys, may be NULL
+ * @param cleanupKey Cleanup function for keys, may be NULL
+ * @param cleanupValue Cleanup function for values for, may be NULL
+ * @param capacity_hint number of keys that the table is expected to hold, or 0
+ * @return Pointer to a concurrent hash table in dynamically allocated memory, or NULL
+ */
+CConcurrentMap *ccmap_create(size_t key_size, size_t value_size,
+                             CMapHashFn hash, CmpFn cmp,
+                             CleanupFn cleanupKey, CleanupFn cleanupValue,
+                             unsigned int capacity_hint);
+
+/**
+ * Dispose of a concurrent hash table created by ccmap_create, which no other thread may be using
+ * @param ccm Pointer to the concurrent hash table
+ */
+void ccmap_dispose(CConcurrentMap *ccm);
+
+/**
+ * The number of key value pairs stored in the table. The shards are counted one at a time,
+ * so if other threads are changing the table the result is only an approximation: it need
+ * not be a number of pairs that the table ever held.
+ * @param ccm Pointer to the concurrent hash table
+ * @return Number of elements stored in the table
+ */
+unsigned int ccmap_count(CConcurrentMap *ccm);
+
+/**
+ * @brief Inserts a key-value pair into the table, or if the key is already in the table,
+ * replaces its value (cleaning up the old one). In that case the table keeps the key it
+ * had, and the key passed in remains the caller's.
+ * @param ccm The concurrent hash table to insert into
+ * @param key The key to insert
+ * @param value The value to insert
+ * @return true if the pair was inserted or the value replaced, false if there isn't memory
+ */
+bool ccmap_insert(CConcurrentMap *ccm, const void *key, const void *value);
+
+/**
+ * @brief Looks up a key in the table, copying its value out
+ * @param ccm The concurrent hash table to look up the key in
+ * @param key The key to look up
+ * @param value Location to copy the key's value to, if it is found, may be NULL
+ * @return true if the key is in the table, false otherwise
+ */
+bool ccmap_lookup(CConcurrentMap *ccm, const void *key, void *value);
+
+/**
+ * @brief Removes a key-value pair from the table
+ * @param ccm The concurrent hash table to remove the key from
+ * @param key The key to remove
+ * @return true if the key was in the table, false otherwise
+ */
+bool ccmap_remove(CConcurrentMap *ccm, const void *key);
+
+/**
+ * @brief Removes all of the elements from the table, one shard at a time
+ * @param ccm The concurrent hash table to remove all the elements from
+ */
+void ccmap_clear(CConcurrentMap *ccm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CCMAP_H
@@ -1,8 +1,12 @@
 /**
  * @file cmap.c
  * @brief Defines the implementation of a HashTable in C.
- * This implementation uses an open-addressing scheme.
- * There are future plans to use robin-hood scheme.
+ * This implementation uses an open-addressing scheme in the style of a Swiss table: beside
+ * the array of key-value pairs is an array of control bytes, one per entry, that says whether
+ * the entry is empty, deleted (a tombstone), or full, in which case it holds 7 bits of the
+ * hash of the key. Probing scans the control bytes of a group of 16 consecutive entries at
+ * once (with SSE2 where it is available), and only compares the keys of the entries whose
+ * bits match, so a probe touches the keys and values only when it is likely to find the key.
  */
 
 #include "cmap.h"
@@ -15,9 +19,24 @@
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 
-// a suggested value to use when given capacity_hint is 0
-#define DEFAULT_CAPACITY 1024
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// a suggested value to use when given capacity_hint is 0 (and the least capacity)
+#define DEFAULT_CAPACITY 16
+
+// the fraction of entries that may be used before the table grows, by default
+#define DEFAULT_MAX_LOAD 0.875
+
+// number of control bytes that are scanned at once
+#define GROUP_WIDTH 16
+
+// control bytes of entries that are not full, which (only) have the high bit set
+#define CTRL_EMPTY   ((uint8_t) 0x80)
+#define CTRL_DELETED ((uint8_t) 0xFE)
 
 /**
  * @struct CMapImplementation
@@ -25,9 +44,15 @@
  */
 struct CMapImplementation {
   void *entries;                // Pointer to key-value pair array
-  void *end;                    // End of buckets array
-  unsigned int capacity;        // maximum number of values that can be stored
+  uint8_t *ctrl;                // Control byte of each entry, followed by a copy of the first group's
+  unsigned int capacity;        // number of entries in the array (a power of two)
   unsigned int size;            // The number of elements stored in the hash table
+  unsigned int deleted;         // The number of deleted entries (tombstones)
+
+  float max_load;               // fraction of entries in use above which the table grows
+  float min_load;               // fraction of entries in use below which the table shrinks
+  unsigned int grow_at;         // number of elements (and tombstones) above which the table grows
+  unsigned int shrink_at;       // number of elements below which the table shrinks
 
   size_t key_size;              // The size of each key
   size_t value_size;            // The size of each value
@@ -38,40 +63,28 @@ struct CMapImplementation {
   CmpFn cmp;                // key comparison function
 };
 
-/**
- * @struct entry
- * Stores metadata about a single key-value pair
- */
-struct entry {
-  unsigned int hash;        // hash of key
-  uint8_t status;           // status bits
-  char kv[];                // Key/value pair
-};
-
-// Macros/functions for setting entry status bits
-#define FREE_MASK ((uint8_t) 1)
-
-// read the "free bit" from the status bits in the entry
-static inline bool is_free(const struct entry* e) {
-  return (bool) (e->status & FREE_MASK);
-}
-
-// set the "free bit" in the status bits in the entry
-static inline void set_free(struct entry *e, bool free) {
-  if (free) e->status |= FREE_MASK;
-  else e->status &= ~FREE_MASK;
-}
+// A bit mask with a bit for each entry of a group whose control byte matched
+typedef unsigned int group_mask;
 
 // static function declarations
-static inline struct entry *entry_of(const void *key);
 static inline size_t entry_size(const CMap *cm);
-static inline struct entry *get_entry(const CMap *cm, unsigned int index);
-static struct entry *lookup_key(const CMap *cm, const void *key);
-static inline void *value_of(const CMap *cm, const struct entry *entry);
-static inline void *key_of(const struct entry *entry);
-static inline void move(CMap *cm, struct entry *entry1, struct entry *entry2);
-static void erase(CMap *cm, struct entry *e);
-static void delete(CMap *cm, unsigned int start, unsigned int stop);
+static inline void *get_entry(const CMap *cm, unsigned int index);
+static inline unsigned int index_of(const CMap *cm, const void *key);
+static inline void *value_of(const CMap *cm, const void *entry);
+static inline unsigned int mask(const CMap *cm);
+static inline uint8_t fragment(unsigned int hash);
+static inline bool is_full(uint8_t ctrl);
+static inline void set_ctrl(CMap *cm, unsigned int index, uint8_t ctrl);
+static inline group_mask match_byte(const uint8_t *group, uint8_t ctrl);
+static inline group_mask match_empty(const uint8_t *group);
+static inline group_mask match_free(const uint8_t *group);
+static inline int trailing_zeros(group_mask bits);
+static inline int leading_zeros(group_mask bits);
+static unsigned int find_free(const CMap *cm, unsigned int hash);
+static bool allocate_entries(CMap *cm, unsigned int capacity);
+static bool rehash(CMap *cm, unsigned int capacity);
+static void set_thresholds(CMap *cm);
+static void erase(CMap *cm, unsigned int index);
 static int lookup_index(const CMap *cm, const void *key);
 static int compare(const CMap *cm, const void *keyA, const void *keyB);
 
@@ -89,24 +102,18 @@ CMap *cmap_create(size_t key_size, size_t value_size,
   cm->size = 0;
   cm->cleanupKey = cleanupKey;
   cm->cleanupValue = cleanupValue;
-  cm->hash = hash == NULL ? roberts_hash : hash;
+  cm->hash = hash == NULL ? fast_hash : hash;
   cm->cmp = cmp;
+  cm->max_load = DEFAULT_MAX_LOAD;
+  cm->min_load = 0;
 
-  // Allocate array for key-value entries
-  cm->capacity = capacity > 0 ? capacity : DEFAULT_CAPACITY;
-  cm->entries = malloc(cm->capacity * entry_size(cm));
-  if (cm->entries == NULL) {
+  // Round the capacity up to a power of two, so that a hash is reduced to an index with a mask
+  unsigned int pow2 = DEFAULT_CAPACITY;
+  while (pow2 < capacity && pow2 <= UINT_MAX / 2) pow2 *= 2;
+  if (!allocate_entries(cm, pow2)) {
     free(cm); // wouldn't wanna leak memory while running out of it eh?
     return NULL;
   }
-
-  // Set all the entries to free
-  for (unsigned int i = 0; i < cm->capacity; ++i) {
-    struct entry *e = get_entry(cm, i);
-    assert(e != NULL);
-    set_free(e, true);
-  }
-
   return cm;
 }
 
@@ -114,6 +121,7 @@ void cmap_dispose(CMap* cm) {
   assert(cm != NULL);
   cmap_clear(cm);
   free(cm->entries);
+  free(cm->ctrl);
   free(cm);
 }
 
@@ -122,33 +130,57 @@ unsigned int cmap_count(const CMap* cm) {
   return cm->size;
 }
 
+unsigned int cmap_capacity(const CMap* cm) {
+  assert(cm != NULL);
+  return cm->capacity;
+}
+
+bool cmap_set_load_factors(CMap *cm, float max_load, float min_load) {
+  assert(cm != NULL);
+  if (!(max_load > 0 && max_load <= 1)) return false;
+  if (!(min_load >= 0 && min_load < max_load / 2)) return false; // or it would shrink right after growing
+  cm->max_load = max_load;
+  cm->min_load = min_load;
+  set_thresholds(cm);
+  return cmap_reserve(cm, cm->size);
+}
+
+bool cmap_reserve(CMap *cm, unsigned int count) {
+  assert(cm != NULL);
+  unsigned int capacity = cm->capacity;
+  while (count > capacity * cm->max_load || count >= capacity) {
+    if (capacity > UINT_MAX / 2) return false;
+    capacity *= 2;
+  }
+  return capacity == cm->capacity || rehash(cm, capacity);
+}
+
 void *cmap_insert(CMap *cm, const void *key, const void *value) {
   assert(cm != NULL);
   assert(key != NULL);
   assert(value != NULL);
 
-  // there is no vacancy
-  if (cm->size == cm->capacity)
-    return NULL;
-
-  unsigned int hash = cm->hash(key, cm->key_size) % cm->capacity;
-
-  // Locate a free entry (guaranteed to exist)
-  struct entry *entry = NULL;
-  for (unsigned int i = 0; i < cm->capacity; ++i) {
-    entry = get_entry(cm, (hash + i) % cm->capacity);
-    if (is_free(entry)) break;
+  // Grow the table if it would be too full, so that probe sequences stay short. If it is only
+  // too full of tombstones, rebuild it at the same capacity instead.
+  if (cm->size + cm->deleted + 1 > cm->grow_at) {
+    unsigned int capacity = cm->capacity;
+    if (cm->size + 1 > cm->grow_at) {
+      if (capacity > UINT_MAX / 2) return NULL;
+      capacity *= 2;
+    }
+    if (!rehash(cm, capacity)) return NULL;
   }
 
-  assert(entry != NULL);
+  unsigned int hash = cm->hash(key, cm->key_size);
+  unsigned int index = find_free(cm, hash);
+  if (cm->ctrl[index] == CTRL_DELETED) cm->deleted--;
+  set_ctrl(cm, index, fragment(hash));
 
   // Fill the entry with the key-value pair
-  memcpy(key_of(entry), key, cm->key_size);
+  void *entry = get_entry(cm, index);
+  memcpy(entry, key, cm->key_size);
   memcpy(value_of(cm, entry), value, cm->value_size);
 
-  set_free(entry, false);
-  entry->hash = hash;
-
   cm->size++;
   return entry;
 }
@@ -156,42 +188,49 @@ void *cmap_insert(CMap *cm, const void *key, const void *value) {
 void *cmap_lookup(const CMap *cm, const void *key) {
   assert(cm != NULL);
   assert(key != NULL);
+  if (cm->size == 0) return NULL;
 
-  struct entry *entry = lookup_key(cm, key);
-  if (entry == NULL) return NULL;
-  return value_of(cm, entry);
+  int index = lookup_index(cm, key);
+  if (index < 0) return NULL;
+  return value_of(cm, get_entry(cm, (unsigned int) index));
 }
 
 void cmap_remove(CMap *cm, const void *key) {
   assert(cm != NULL);
   assert(key != NULL);
 
-  int start = lookup_index(cm, key);
-  if (start < 0) return;
-  struct entry *e = get_entry(cm, start);
-  assert(e != NULL);
-
-  erase(cm, e);
-  delete(cm, start, e->hash % cm->capacity);
+  int index = lookup_index(cm, key);
+  if (index < 0) return;
+  erase(cm, (unsigned int) index);
+
+  // An entry may be made empty again (rather than deleted) if no probe sequence could have
+  // passed over it: that is, if every group of entries containing it also has an empty entry,
+  // since a probe stops at the first group that has one. Otherwise it becomes a tombstone.
+  unsigned int before = (index - GROUP_WIDTH) & mask(cm);
+  group_mask empty_before = match_empty(&cm->ctrl[before]);
+  group_mask empty_after = match_empty(&cm->ctrl[index]);
+  bool passed_over = leading_zeros(empty_before) + trailing_zeros(empty_after) >= GROUP_WIDTH;
+  if (passed_over) cm->deleted++;
+  set_ctrl(cm, (unsigned int) index, passed_over ? CTRL_DELETED : CTRL_EMPTY);
   cm->size--;
+
+  // shrink the table once enough has been removed from it, if that was asked for
+  if (cm->size < cm->shrink_at && cm->capacity > DEFAULT_CAPACITY)
+    rehash(cm, cm->capacity / 2); // keeps the larger table if there isn't memory for another
 }
 
 void cmap_clear(CMap *cm) {
   assert(cm != NULL);
 
   unsigned int num_cleared = 0;
-  for (unsigned int i = 0; i < cm->capacity; ++i) {
-    struct entry *e = get_entry(cm, i);
-    assert(e != NULL);
-    if (is_free(e)) continue;
-
-    erase(cm, e);
+  for (unsigned int i = 0; i < cm->capacity && num_cleared < cm->size; ++i) {
+    if (!is_full(cm->ctrl[i])) continue;
+    erase(cm, i);
     num_cleared++;
-
-    // If we've deleted them all, stop and save a bit of searching
-    if (num_cleared == cm->size) break;
   }
+  memset(cm->ctrl, CTRL_EMPTY, cm->capacity + GROUP_WIDTH);
   cm->size = 0;
+  cm->deleted = 0;
 }
 
 const void *get_value(const CMap *cm, const void *key) {
@@ -206,10 +245,8 @@ const void *cmap_first(const CMap *cm) {
   if (cm == NULL) return NULL;
   if (cm->size == 0) return NULL;
 
-  for (unsigned int i = 0; i < cm->capacity; ++i) {
-    struct entry *e = get_entry(cm, i);
-    if (!is_free(e)) return key_of(e);
-  }
+  for (unsigned int i = 0; i < cm->capacity; ++i)
+    if (is_full(cm->ctrl[i])) return get_entry(cm, i);
   return NULL;
 }
 
@@ -217,133 +254,241 @@ const void *cmap_next(const CMap *cm, const void *prevkey) {
   assert(cm != NULL);
   assert(prevkey != NULL);
 
-  const struct entry *e = entry_of(prevkey);
-  while (e != cm->end) {
-    e = (struct entry *) ((char *) e + entry_size(cm));
-    if (!is_free(e)) return key_of(e);
-  }
+  for (unsigned int i = index_of(cm, prevkey) + 1; i < cm->capacity; ++i)
+    if (is_full(cm->ctrl[i])) return get_entry(cm, i);
   return NULL;
 }
 
-// Gives the entry for a given key
-static inline struct entry *entry_of(const void *key) {
-  assert(key != NULL);
-  return (struct entry *) ((char *) key - offsetof(struct entry, kv));
-}
-
 static inline size_t entry_size(const CMap *cm) {
   assert(cm != NULL);
-  return sizeof(struct entry) + cm->key_size + cm->value_size;
+  return cm->key_size + cm->value_size;
 }
 
-static inline struct entry *get_entry(const CMap *cm, unsigned int index) {
+// Gives the entry (key-value pair) at an index, which starts with the key
+static inline void *get_entry(const CMap *cm, unsigned int index) {
   assert(cm != NULL);
   assert(index < cm->capacity);
-  void *entry = (char *) cm->entries + index * entry_size(cm);
-  return (struct entry *) entry;
+  return (char *) cm->entries + index * entry_size(cm);
 }
 
-/**
- * @breif Finds the entry for this key
- * @param cm The CMap to lookup the key in
- * @param key the key to lookup in the CMap
- * @return pointer to the hash table entry that contains the key and value
- * if the key exists in the hash table, else NULL
- */
-static struct entry *lookup_key(const CMap *cm, const void *key) {
+// Gives the index of the entry for a given key
+static inline unsigned int index_of(const CMap *cm, const void *key) {
   assert(cm != NULL);
   assert(key != NULL);
-  if (cm->size == 0) return NULL;
+  return (unsigned int) (((const char *) key - (const char *) cm->entries) / entry_size(cm));
+}
+
+static inline void *value_of(const CMap *cm, const void *entry) {
+  assert(cm != NULL);
+  assert(entry != NULL);
+  return (char *) entry + cm->key_size;
+}
+
+// Gives the mask that reduces a hash (or an index past the end) to an index in the table
+static inline unsigned int mask(const CMap *cm) {
+  return cm->capacity - 1;
+}
 
-  unsigned int hash = cm->hash(key, cm->key_size) % cm->capacity;
-  for (unsigned int i = 0; i < cm->capacity; ++i) {
-    struct entry *e = get_entry(cm, (hash + i) % cm->capacity);
-    if (is_free(e)) return NULL;
+// Gives the 7 bits of a hash that are kept in the control byte of a full entry. These are the
+// high bits, since the low bits pick the entry where probing starts.
+static inline uint8_t fragment(unsigned int hash) {
+  return (uint8_t) (hash >> (sizeof(unsigned int) * CHAR_BIT - 7));
+}
+
+static inline bool is_full(uint8_t ctrl) {
+  return (ctrl & 0x80) == 0;
+}
 
-    // use cached hash value to do an easy/cache-friendly comparison
-    if (e->hash != hash) continue;
+// Sets the control byte of an entry, and its copy past the end if it is in the first group,
+// so that a group that wraps around the end of the table may be read contiguously
+static inline void set_ctrl(CMap *cm, unsigned int index, uint8_t ctrl) {
+  cm->ctrl[index] = ctrl;
+  if (index < GROUP_WIDTH) cm->ctrl[cm->capacity + index] = ctrl;
+}
+
+#if defined(__SSE2__)
+
+// Finds the entries of a group whose control bytes are a given value
+static inline group_mask match_byte(const uint8_t *group, uint8_t ctrl) {
+  __m128i bytes = _mm_loadu_si128((const __m128i *) group);
+  return (group_mask) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char) ctrl)));
+}
+
+// Finds the entries of a group that are empty or deleted (which have the high bit set)
+static inline group_mask match_free(const uint8_t *group) {
+  return (group_mask) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+}
+
+#else
+
+static inline group_mask match_byte(const uint8_t *group, uint8_t ctrl) {
+  group_mask bits = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++)
+    bits |= (group_mask) (group[i] == ctrl) << i;
+  return bits;
+}
+
+static inline group_mask match_free(const uint8_t *group) {
+  group_mask bits = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++)
+    bits |= (group_mask) !is_full(group[i]) << i;
+  return bits;
+}
+
+#endif
+
+// Finds the entries of a group that are empty
+static inline group_mask match_empty(const uint8_t *group) {
+  return match_byte(group, CTRL_EMPTY);
+}
+
+// Counts the entries at the start of a group before the first matching one
+static inline int trailing_zeros(group_mask bits) {
+  if (bits == 0) return GROUP_WIDTH;
+#if defined(__GNUC__)
+  return __builtin_ctz(bits);
+#else
+  int n = 0;
+  for (; (bits & 1) == 0; bits >>= 1) n++;
+  return n;
+#endif
+}
+
+// Counts the entries at the end of a group after the last matching one
+static inline int leading_zeros(group_mask bits) {
+  int n = 0;
+  for (group_mask bit = 1u << (GROUP_WIDTH - 1); n < GROUP_WIDTH && (bits & bit) == 0; bit >>= 1) n++;
+  return n;
+}
 
-    // only dereference to compare full keys if you have to
-    if (compare(cm, &e->kv, key) == 0)
-      return e;
+/**
+ * @brief Finds the first entry that is empty or deleted in the probe sequence of a hash.
+ * The probe sequence visits groups at triangular offsets from the entry that the hash picks,
+ * which reaches every group since the capacity is a power of two.
+ * @param cm The CMap to look in
+ * @param hash The hash of the key to find an entry for
+ * @return Index of the entry (which exists, since the table is never full)
+ */
+static unsigned int find_free(const CMap *cm, unsigned int hash) {
+  unsigned int index = hash & mask(cm);
+  for (unsigned int step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+    group_mask free_bits = match_free(&cm->ctrl[index]);
+    if (free_bits != 0) return (index + trailing_zeros(free_bits)) & mask(cm);
+    index = (index + step) & mask(cm);
   }
-  return NULL; // Went all the way around
 }
 
-static inline void *value_of(const CMap *cm, const struct entry *entry) {
+/**
+ * @brief Allocates an array of free entries for the table, and sets the thresholds for its size
+ * @param cm The CMap to allocate entries for
+ * @param capacity Number of entries to allocate (a power of two, at least a group)
+ * @return true if the entries were allocated, false otherwise
+ */
+static bool allocate_entries(CMap *cm, unsigned int capacity) {
   assert(cm != NULL);
-  assert(entry != NULL);
-  return (char *) &entry->kv + cm->key_size;
+  assert(capacity >= GROUP_WIDTH && (capacity & (capacity - 1)) == 0);
+
+  void *entries = malloc(capacity * entry_size(cm));
+  uint8_t *ctrl = malloc(capacity + GROUP_WIDTH);
+  if (entries == NULL || ctrl == NULL) {
+    free(entries);
+    free(ctrl);
+    return false;
+  }
+
+  memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+  cm->entries = entries;
+  cm->ctrl = ctrl;
+  cm->capacity = capacity;
+  cm->deleted = 0;
+  set_thresholds(cm);
+  return true;
 }
 
-static inline void *key_of(const struct entry *entry) {
-  assert(entry != NULL);
-  return (void *) (&entry->kv);
+/**
+ * @brief Moves every entry of the table into new arrays of entries and control bytes, which
+ * leaves behind the tombstones. Keys are hashed again, but not compared.
+ * @param cm The CMap to rehash
+ * @param capacity Number of entries in the new array (a power of two, more than the table's size)
+ * @return true if the table was rehashed, false if the new arrays could not be allocated,
+ * in which case the table is unchanged
+ */
+static bool rehash(CMap *cm, unsigned int capacity) {
+  assert(cm != NULL);
+  assert(capacity > cm->size);
+
+  void *old_entries = cm->entries;
+  uint8_t *old_ctrl = cm->ctrl;
+  unsigned int old_capacity = cm->capacity;
+  unsigned int old_deleted = cm->deleted;
+  if (!allocate_entries(cm, capacity)) {
+    cm->deleted = old_deleted;
+    return false;
+  }
+
+  for (unsigned int i = 0; i < old_capacity; ++i) {
+    if (!is_full(old_ctrl[i])) continue;
+    const void *entry = (char *) old_entries + i * entry_size(cm);
+    unsigned int hash = cm->hash(entry, cm->key_size);
+    unsigned int index = find_free(cm, hash);
+    set_ctrl(cm, index, fragment(hash));
+    memcpy(get_entry(cm, index), entry, entry_size(cm));
+  }
+  free(old_entries);
+  free(old_ctrl);
+  return true;
 }
 
-static inline void move(CMap *cm, struct entry *entry1, struct entry *entry2) {
+// Sets the number of elements above which the table grows, and below which it shrinks.
+// At least one entry is always empty, which is where unsuccessful lookups stop.
+static void set_thresholds(CMap *cm) {
   assert(cm != NULL);
-  assert(entry1 != NULL);
-  assert(entry2 != NULL);
-  memcpy(entry1, entry2, entry_size(cm));
+  cm->grow_at = (unsigned int) (cm->max_load * cm->capacity);
+  if (cm->grow_at > cm->capacity - 1) cm->grow_at = cm->capacity - 1;
+  cm->shrink_at = (unsigned int) (cm->min_load * cm->capacity);
 }
 
-static void erase(CMap *cm, struct entry *e) {
+// Cleans up the key and value of a full entry (but leaves its control byte to the caller)
+static void erase(CMap *cm, unsigned int index) {
   assert(cm != NULL);
-  assert(e != NULL);
+  void *entry = get_entry(cm, index);
 
   if (cm->cleanupKey != NULL)
-    cm->cleanupKey(key_of(e));
+    cm->cleanupKey(entry);
 
   if (cm->cleanupValue != NULL)
-    cm->cleanupValue(value_of(cm, e));
-
-  set_free(e, true);
-}
-
-static void delete(CMap *cm, unsigned int start, unsigned int stop) {
-  assert(cm != NULL);
-  while (true) {
-    // the entry to delete
-    struct entry *entry = get_entry(cm, start);
-
-    unsigned int j = start;
-    for (unsigned int i = 0; i < cm->capacity; ++i) {
-      j = (j + 1) % cm->capacity;
-      if (j == stop) return;
-
-      struct entry *next = get_entry(cm, j);
-      if (is_free(next)) return; // reached the end
-
-      // Found one that can replace
-      if ((next->hash) % cm->capacity >= start) {
-        move(cm, entry, next);
-        set_free(next, true);
-        break;
-      }
-    }
-    start = j;
-  }
+    cm->cleanupValue(value_of(cm, entry));
 }
 
+/**
+ * @brief Finds the index of the entry for this key
+ * @param cm The CMap to lookup the key in
+ * @param key the key to lookup in the CMap
+ * @return the index of the entry that contains the key, if the key exists in the
+ * hash table, else -1
+ */
 static int lookup_index(const CMap *cm, const void *key) {
   assert(cm != NULL);
   assert(key != NULL);
 
-  unsigned int hash = cm->hash(key, cm->key_size) % cm->capacity;
+  unsigned int hash = cm->hash(key, cm->key_size);
+  uint8_t bits = fragment(hash);
 
-  for (unsigned int i = 0; i < cm->capacity; ++i) {
-    struct entry *e = get_entry(cm, (hash + i) % cm->capacity);
-    if (e == NULL || is_free(e)) return -1;
+  unsigned int index = hash & mask(cm);
+  for (unsigned int step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+    const uint8_t *group = &cm->ctrl[index];
 
-    // Use cached hash value to do an easy/cache-friendly comparison
-    if (e->hash != hash) continue;
+    // Only dereference to compare full keys in entries whose hash bits match
+    for (group_mask matches = match_byte(group, bits); matches != 0; matches &= matches - 1) {
+      unsigned int i = (index + trailing_zeros(matches)) & mask(cm);
+      if (compare(cm, get_entry(cm, i), key) == 0)
+        return (int) i;
+    }
 
-    // Only dereference to compare full keys if you have to
-    if (compare(cm, &e->kv, key) == 0)
-      return (hash + i) % cm->capacity;
+    // The key would have been put in the first group of its probe sequence with an empty entry
+    if (match_empty(group) != 0) return -1;
+    index = (index + step) & mask(cm);
   }
-  return -1;
 }
 
 static int compare(const CMap *cm, const void *keyA, const void *keyB) {
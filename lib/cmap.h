@@ -21,19 +21,23 @@ extern "C" {
 #include <ops.h>
 
 // macro for defining map of simple types that need no cleanup (i.e. int -> int)
-#define simple_map(key_size, value_size) cmap_create(key_size, value_size, roberts_hash, NULL, NULL, NULL, 0)
+#define simple_map(key_size, value_size) cmap_create(key_size, value_size, fast_hash, NULL, NULL, NULL, 0)
 
 typedef struct CMapImplementation CMap;
 
 /**
  * Create a HashTable in a dynamically allocated region of memory.
+ * The table grows (doubling its capacity) whenever inserting into it would take it over its
+ * maximum load factor, which is 0.875 unless it is set with cmap_set_load_factors.
  * @param key_size size of all keys stored in HashTable
  * @param value_size size of all values stored in the HashTable
- * @param hash Hash function used to hash keys, may be NULL
+ * @param hash Hash function used to hash keys, or NULL for fast_hash. Its low bits pick a key's
+ * entry, since the capacity is a power of two, so they should be well distributed.
  * @param cmp Comparison function between keys, may be NULL
  * @param cleanupKey Cleanup function for keys, may be NULL
  * @param cleanupValue Cleanup function for values for, may be NULL
- * @param capacity number of values that maybe stored in table
+ * @param capacity_hint initial number of entries in the table, rounded up to a power of two
+ * (and at least 16), or 0 for the default
  * @return Pointer to a hash table in dynamically allocated memory
  */
 CMap *cmap_create(size_t key_size, size_t value_size,
@@ -54,6 +58,35 @@ void cmap_dispose(CMap *cm);
  */
 unsigned int cmap_count(const CMap *cm);
 
+/**
+ * The number of entries in the table, which is a power of two. The table grows
+ * before the number of key value pairs reaches its capacity.
+ * @param cm Pointer to hash table
+ * @return Number of entries in the hash table
+ */
+unsigned int cmap_capacity(const CMap *cm);
+
+/**
+ * @brief Sets the load factors of the table: the fraction of its entries that may be used before
+ * it grows, and the fraction below which it shrinks (halving its capacity) when a key is removed
+ * @param cm Pointer to hash table
+ * @param max_load Maximum load factor, more than 0 and at most 1 (0.875 by default)
+ * @param min_load Minimum load factor, less than half of the maximum, or 0 (the default)
+ * for the table never to shrink
+ * @return true if the load factors were set, false if they are out of range or the table
+ * could not grow to the new maximum load factor
+ */
+bool cmap_set_load_factors(CMap *cm, float max_load, float min_load);
+
+/**
+ * @brief Grows the table (if need be) so that it holds the given number of key value pairs
+ * without growing again
+ * @param cm Pointer to hash table
+ * @param count Number of key value pairs to make room for
+ * @return true if the table has room for that many pairs, false on allocation failure
+ */
+bool cmap_reserve(CMap *cm, unsigned int count);
+
 /**
  * @breif Inserts a key-value pair into the hash table
  * @param cm The CMap to insert a value into
@@ -61,7 +94,11 @@ unsigned int cmap_count(const CMap *cm);
  * @param keysize The size of the key to insert
  * @param value The value to insert
  * @param valuesize The size of the value to insert
- * @return Pointer to the inserted key, if successfully inserted, othersie NULL.
+ * @note Growing the table moves its entries, so pointers to keys and values that were
+ * returned before the insertion are no longer valid (and the same goes for removal, if the
+ * table has a minimum load factor).
+ * @return Pointer to the inserted key, if successfully inserted, othersie NULL (when there
+ * isn't memory for the table to grow).
  */
 void *cmap_insert(CMap *cm, const void *key, const void *value);
 
@@ -1,100 +1,159 @@
 /**
  * @file cset.c
+ * @brief Implementation of an ordered set as a B-tree.
+ * Each node holds many elements contiguously, in order, so that a search reads a few wide nodes
+ * rather than following a pointer per element. An internal node with n elements has n + 1 children,
+ * the i'th of which holds the elements between the node's (i - 1)'th and i'th elements. Beside its
+ * children, an internal node keeps the number of elements in each child's subtree, which gives the
+ * rank of an element from the nodes on the path to it.
  *
+ * Every node but the root holds between `min_degree - 1` and `2 * min_degree - 1` elements, and
+ * every leaf is at the same depth. Insertion splits full nodes on the way down, and removal makes
+ * sure that a node has more than the least number of elements before it descends into it, so that
+ * neither has to go back up the tree to fix it.
  */
 
 #include <cset.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
-#define max(a, b) ((a) > (b) ? (a) : (b))
+// number of bytes of elements that each node holds (about), which sets the number of elements in a node
+#define NODE_BYTES 256
 
 enum Direction { left = 0, right = 1 };
 
 struct CSetImplementation {
   struct Node *root;
+  int size;                 // number of elements in the set
   size_t data_size;
+  int min_degree;           // the least number of children of an internal node other than the root
+  int max_elements;         // the most elements in a node, 2 * min_degree - 1
+  size_t children_offset;   // offset of the children in the data of an internal node
   CmpFn cmp;
   CleanupFn cleanup;
+  uint64_t removed[];       // holds the element being removed (data_size bytes)
 };
 
 struct Node {
-  struct Node *left;
-  struct Node *right;
-  int height;
-  int nright;
-  int nleft;
-  uint8_t data[];
+  int num;                  // number of elements in the node
+  int leaf;                 // whether the node is a leaf, which has no children
+  uint64_t data[];          // elements, then (if internal) children and the sizes of their subtrees
 };
 
 // static function declarations
-static struct Node *new_node(const void *data, size_t data_size);
-static const struct Node *lookup(const CSet *set, const struct Node *node, const void *data);
-static inline void update_height(struct Node *node);
-static inline struct Node *child(const struct Node *node, enum Direction dir);
-static struct Node *insert_at(CSet *set, struct Node *node, const void *data);
-static struct Node *remove_at(CSet *set, struct Node *node, const void *data, struct Node **removed);
-static struct Node *balance(struct Node *node);
-static struct Node *rotate(struct Node *root, enum Direction dir);
-static inline void dispose_node(const CSet *set, struct Node *node, bool recursive);
-static struct Node *remove_node(CSet *set, struct Node *node);
-static struct Node *extrema(struct Node *node, enum Direction dir);
-static inline void assign_child(struct Node *node, struct Node *new_child, enum Direction dir);
-static int get_balance(const struct Node * node);
-static inline struct Node **child_ref(const struct Node *node, enum Direction dir);
-static inline void update_count(struct Node *node, enum Direction dir);
-static inline int num_ancestors(const struct Node *node, enum Direction dir);
-static inline int get_size(const struct Node *node);
-static inline enum Direction opposite(enum Direction dir);
-static inline enum Direction get_direction(int comparison);
+static struct Node *new_node(const CSet *set, bool leaf);
+static inline void *element(const CSet *set, const struct Node *node, int i);
+static inline struct Node **children(const CSet *set, const struct Node *node);
+static inline int *counts(const CSet *set, const struct Node *node);
+static inline int subtree_size(const CSet *set, const struct Node *node);
+static inline void move_elements(const CSet *set, struct Node *dst, int i, const struct Node *src, int j, int n);
+static inline void move_children(const CSet *set, struct Node *dst, int i, const struct Node *src, int j, int n);
+static int lower_bound(const CSet *set, const struct Node *node, const void *data, bool *found);
+static bool split_child(CSet *set, struct Node *node, int i);
+static bool insert_nonfull(CSet *set, struct Node *node, const void *data);
+static bool remove_at(CSet *set, struct Node *node, const void *data, void *removed);
+static void remove_extreme(CSet *set, struct Node *node, enum Direction dir, void *removed);
+static int fill_child(CSet *set, struct Node *node, int i);
+static void borrow(CSet *set, struct Node *node, int i, enum Direction dir);
+static void merge_children(CSet *set, struct Node *node, int i);
+static void seek_end(CSetIterator *it);
+static void *seek(const CSet *set, const void *data, bool after, CSetIterator *it);
+static int64_t max_slots(const CSet *set, int height);
+static struct Node *build(CSet *set, int height, int count, bool root, const char **next, const char *end);
+static const char *next_distinct(const CSet *set, const char *element, const char *end);
+static void dispose_node(const CSet *set, struct Node *node, bool cleanup);
 
 CSet *new_set(size_t data_size, CmpFn cmp, CleanupFn cleanup) {
   assert(cmp != NULL);
-  CSet *set = malloc(sizeof(CSet));
+  assert(data_size > 0);
+  CSet *set = malloc(sizeof(CSet) + data_size);
   if (set == NULL) return NULL;
   set->root = NULL;
+  set->size = 0;
   set->data_size = data_size;
   set->cmp = cmp;
   set->cleanup = cleanup;
+
+  set->min_degree = (int) (NODE_BYTES / data_size + 1) / 2;
+  if (set->min_degree < 2) set->min_degree = 2;
+  set->max_elements = 2 * set->min_degree - 1;
+
+  // the children of an internal node come after its elements, aligned for pointers
+  size_t elements_size = set->max_elements * data_size;
+  set->children_offset = (elements_size + sizeof(struct Node *) - 1) / sizeof(struct Node *) * sizeof(struct Node *);
   return set;
 }
 
 int set_size(const CSet *set) {
   assert(set != NULL);
-  return get_size(set->root);
+  return set->size;
 }
 
 void set_insert(CSet *set, const void *data) {
   assert(set != NULL);
   assert(data != NULL);
-  set->root = insert_at(set, set->root, data);
+
+  if (set->root == NULL) {
+    set->root = new_node(set, true);
+    if (set->root == NULL) return; // allocation failure
+  }
+
+  // A full root is split under a new root, which is the only way that the tree grows taller
+  if (set->root->num == set->max_elements) {
+    struct Node *root = new_node(set, false);
+    if (root == NULL) return;
+    children(set, root)[0] = set->root;
+    counts(set, root)[0] = set->size;
+    if (!split_child(set, root, 0)) {
+      free(root);
+      return;
+    }
+    set->root = root;
+  }
+
+  if (insert_nonfull(set, set->root, data))
+    set->size++;
 }
 
 void *set_lookup(const CSet *set, const void *data) {
   assert(set != NULL);
   assert(data != NULL);
-  const struct Node *node = lookup(set, set->root, data);
-  if (node == NULL) return NULL;
-  return (void *) node->data;
+
+  const struct Node *node = set->root;
+  while (node != NULL) {
+    bool found;
+    int i = lower_bound(set, node, data, &found);
+    if (found) return element(set, node, i);
+    if (node->leaf) return NULL;
+    node = children(set, node)[i];
+  }
+  return NULL;
 }
 
 int set_rank(CSet *set, const void *data) {
   assert(set != NULL);
   assert(data != NULL);
 
-  struct Node *node = set->root;
+  const struct Node *node = set->root;
   int rank = 0;
-  while (true) {
-    if (node == NULL) return CSET_ERROR;
-    int comparison = set->cmp(node->data, data);
-    if (comparison == 0) return rank + node->nleft;
-    if (comparison < 0) {
-      rank += 1 + node->nleft;
-      node = node->right;
-    } else
-      node = node->left;
+  while (node != NULL) {
+    bool found;
+    int i = lower_bound(set, node, data, &found);
+
+    // the elements before the i'th, and (if found) the subtree just before it, are all less
+    rank += i;
+    if (!node->leaf) {
+      const int *sizes = counts(set, node);
+      for (int j = 0; j < i; j++)
+        rank += sizes[j];
+      if (found) rank += sizes[i];
+    }
+    if (found) return rank;
+    if (node->leaf) break;
+    node = children(set, node)[i];
   }
   return CSET_ERROR;
 }
@@ -102,215 +161,546 @@ int set_rank(CSet *set, const void *data) {
 void set_remove(CSet *set, const void *data) {
   assert(set != NULL);
   assert(data != NULL);
-  struct Node *removed;
-  set->root = remove_at(set, set->root, data, &removed);
-  if (removed != NULL)
-    dispose_node(set, removed, false);
-}
+  if (set->root == NULL) return;
 
-void set_clear(CSet *set) {
-  assert(set != NULL);
-  dispose_node(set, set->root, true);
-  set->root = NULL;
-}
+  bool removed = remove_at(set, set->root, data, set->removed);
 
-void set_dispose(CSet *set) {
-  assert(set != NULL);
-  set_clear(set);
-  free(set);
+  // The root is left empty when its only two children were merged, which makes the tree shorter
+  struct Node *root = set->root;
+  if (root->num == 0) {
+    set->root = root->leaf ? NULL : children(set, root)[0];
+    free(root);
+  }
+
+  if (!removed) return;
+  set->size--;
+  if (set->cleanup != NULL)
+    set->cleanup(set->removed);
 }
 
-static struct Node *new_node(const void *data, size_t data_size) {
-  assert(data != NULL);
-  struct Node *node = malloc(sizeof(struct Node) + data_size);
-  if (node == NULL) return NULL; // allocation failure
-  node->left = NULL;
-  node->right = NULL;
-  node->height = 0;
-  node->nleft = 0;
-  node->nright = 0;
-  memcpy(node->data, data, data_size);
-  return node;
+void *set_select(const CSet *set, int k) {
+  CSetIterator it;
+  return set_iter_at(set, k, &it);
 }
 
-static const struct Node *lookup(const CSet *set, const struct Node *node, const void *data) {
+void *set_iter_at(const CSet *set, int k, CSetIterator *it) {
   assert(set != NULL);
-  assert(data != NULL);
-  while (true) {
+  assert(it != NULL);
+  it->set = set;
+  it->depth = 0;
+  if (k < 0 || k >= set->size) return NULL;
 
-    if (node == NULL) return NULL;
-    int cmp = set->cmp(node->data, data);
-    if (cmp == 0) return node;
-    enum Direction dir = get_direction(cmp);
+  // Skip over the subtrees and elements of each node on the way down that come before the k'th
+  const struct Node *node = set->root;
+  while (true) {
+    it->path[it->depth] = node;
+    if (node->leaf) {
+      it->index[it->depth++] = k;
+      return element(set, node, k);
+    }
 
-    node = child(node, dir);
+    const int *sizes = counts(set, node);
+    int i = 0;
+    while (k > sizes[i]) {
+      k -= sizes[i] + 1;
+      i++;
+    }
+    it->index[it->depth++] = i;
+    if (k == sizes[i]) return element(set, node, i);
+    node = children(set, node)[i];
   }
 }
 
-static struct Node *insert_at(CSet *set, struct Node *node, const void *data) {
+void *set_lower_bound(const CSet *set, const void *data, CSetIterator *it) {
   assert(set != NULL);
-  if (node == NULL)
-    return new_node(data, set->data_size);
+  assert(data != NULL);
+  assert(it != NULL);
+  return seek(set, data, false, it);
+}
 
-  int comparison = set->cmp(node->data, data);
-  if (comparison == 0) return node; // already there!
+void *set_upper_bound(const CSet *set, const void *data, CSetIterator *it) {
+  assert(set != NULL);
+  assert(data != NULL);
+  assert(it != NULL);
+  return seek(set, data, true, it);
+}
+
+void *set_iter_get(const CSetIterator *it) {
+  assert(it != NULL);
+  if (it->depth == 0) return NULL;
+  return element(it->set, it->path[it->depth - 1], it->index[it->depth - 1]);
+}
 
-  enum Direction dir = get_direction(comparison);
-  struct Node *new_child = insert_at(set, child(node, dir), data);
-  if (new_child == NULL) return NULL; // insertion failure
+void *set_iter_next(CSetIterator *it) {
+  assert(it != NULL);
+  if (it->depth == 0) return NULL;
+  const CSet *set = it->set;
+  int top = it->depth - 1;
+  const struct Node *node = it->path[top];
+
+  if (node->leaf) {
+    it->index[top]++;
+    seek_end(it);
+    return set_iter_get(it);
+  }
 
-  assign_child(node, new_child, dir);
-  return balance(node);
+  // The next element is the least one in the subtree just after this one
+  int i = ++it->index[top];
+  do {
+    node = children(set, node)[i];
+    i = 0;
+    it->path[it->depth] = node;
+    it->index[it->depth++] = 0;
+  } while (!node->leaf);
+  return element(set, node, 0);
 }
 
-static struct Node *remove_at(CSet *set, struct Node *node, const void *data, struct Node **removed) {
+int set_range(const CSet *set, const void *low, const void *high, SetVisitFn visit, void *context) {
   assert(set != NULL);
-  assert(data != NULL);
-  if (node == NULL) {
-    if (removed != NULL) *removed = NULL;
-    return NULL; // not found in set
+  assert(visit != NULL);
+  CSetIterator it;
+  void *e = low == NULL ? set_iter_at(set, 0, &it) : set_lower_bound(set, low, &it);
+
+  int num_visited = 0;
+  for (; e != NULL; e = set_iter_next(&it)) {
+    if (high != NULL && set->cmp(e, high) >= 0) break;
+    num_visited++;
+    if (!visit(e, context)) break;
   }
+  return num_visited;
+}
 
-  int comparison = set->cmp(node->data, data);
-  if (comparison == 0) {
-    if (removed != NULL) *removed = node;
-    return remove_node(set, node);
-  }
+bool set_build(CSet *set, const void *sorted, int count) {
+  assert(set != NULL);
+  assert(sorted != NULL || count == 0);
+  set_clear(set);
 
-  enum Direction dir = get_direction(comparison);
-  struct Node *new_child = remove_at(set, child(node, dir), data, removed);
-  assign_child(node, new_child, dir);
-  return balance(node);
+  const char *end = (const char *) sorted + count * set->data_size;
+  int num_distinct = 0;
+  for (const char *e = sorted; e != end; e = next_distinct(set, e, end))
+    num_distinct++;
+  if (num_distinct == 0) return true;
+
+  // The least height of a tree that holds them all
+  int height = 0;
+  while (max_slots(set, height) < (int64_t) num_distinct + 1) height++;
+
+  const char *next = sorted;
+  set->root = build(set, height, num_distinct, true, &next, end);
+  if (set->root == NULL) return false;
+  set->size = num_distinct;
+  return true;
 }
 
-static struct Node *remove_node(CSet *set, struct Node *node) {
+void set_clear(CSet *set) {
   assert(set != NULL);
-  assert(node != NULL);
-
-  if (node->left == NULL) return node->right;
-  if (node->right == NULL) return node->left;
+  dispose_node(set, set->root, true);
+  set->root = NULL;
+  set->size = 0;
+}
 
-  // take the highest node in the left sub-tree and make that the new root of this subtree
-  struct Node *next = extrema(node->left, right);
+void set_dispose(CSet *set) {
+  assert(set != NULL);
+  set_clear(set);
+  free(set);
+}
 
-  struct Node *new_root;
-  struct Node *new_left = remove_at(set, node->left, next->data, &new_root);
+static struct Node *new_node(const CSet *set, bool leaf) {
+  assert(set != NULL);
+  size_t size = sizeof(struct Node);
+  if (leaf) size += set->max_elements * set->data_size;
+  else size += set->children_offset + (set->max_elements + 1) * (sizeof(struct Node *) + sizeof(int));
 
-  assign_child(new_root, node->right, right);
-  assign_child(new_root, new_left, left);
+  struct Node *node = malloc(size);
+  if (node == NULL) return NULL; // allocation failure
+  node->num = 0;
+  node->leaf = leaf;
+  return node;
+}
 
-  return balance(new_root);
+static inline void *element(const CSet *set, const struct Node *node, int i) {
+  return (char *) node->data + i * set->data_size;
 }
 
-static struct Node *balance(struct Node *node) {
-  assert(node != NULL);
+static inline struct Node **children(const CSet *set, const struct Node *node) {
+  assert(!node->leaf);
+  return (struct Node **) ((char *) node->data + set->children_offset);
+}
 
-  while (true) {
+// The number of elements in the subtree of each of the children of an internal node
+static inline int *counts(const CSet *set, const struct Node *node) {
+  return (int *) (children(set, node) + set->max_elements + 1);
+}
 
-    int bal = get_balance(node); // left height minus right height
-    if (bal >= -1 && bal <= 1) return node;
+static inline int subtree_size(const CSet *set, const struct Node *node) {
+  int size = node->num;
+  if (!node->leaf) {
+    const int *sizes = counts(set, node);
+    for (int i = 0; i <= node->num; i++)
+      size += sizes[i];
+  }
+  return size;
+}
 
-    enum Direction dir = bal > 1 ? left : right;
+// Copies n elements of a node, starting at j, into another node (or the same one) starting at i
+static inline void move_elements(const CSet *set, struct Node *dst, int i, const struct Node *src, int j, int n) {
+  memmove(element(set, dst, i), element(set, src, j), n * set->data_size);
+}
 
-    struct Node **childp = child_ref(node, dir);
-    int sub_bal = get_balance(*childp);
+// Copies n children of an internal node, and the sizes of their subtrees, like move_elements
+static inline void move_children(const CSet *set, struct Node *dst, int i, const struct Node *src, int j, int n) {
+  memmove(children(set, dst) + i, children(set, src) + j, n * sizeof(struct Node *));
+  memmove(counts(set, dst) + i, counts(set, src) + j, n * sizeof(int));
+}
 
-    if (dir == left) {
-      if (sub_bal <= -1)
-        *childp = rotate(*childp, dir);
-    } else {
-      if (sub_bal >= 1)
-        *childp = rotate(*childp, dir);
+/**
+ * @brief Finds where an element belongs in a node, by binary search of its elements
+ * @param set The set that the node belongs to
+ * @param node The node to search
+ * @param data The element to look for
+ * @param found Set to whether the node contains an element equivalent to `data`
+ * @return The index of the first element of the node that is not less than `data`, which is also
+ * the index of the child whose subtree `data` would be in
+ */
+static int lower_bound(const CSet *set, const struct Node *node, const void *data, bool *found) {
+  int lo = 0;
+  int hi = node->num;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    int comparison = set->cmp(element(set, node, mid), data);
+    if (comparison == 0) {
+      *found = true;
+      return mid;
     }
-    node = rotate(node, opposite(dir));
+    if (comparison < 0) lo = mid + 1;
+    else hi = mid;
   }
+  *found = false;
+  return lo;
 }
 
-static int get_balance(const struct Node * node) {
-  if (node == NULL) return 0;
-  int l = node->left == NULL ? -1 : node->left->height;
-  int r = node->right == NULL ? -1 : node->right->height;
-  return l - r;
+/**
+ * @brief Splits the full i'th child of a node in two around its middle element, which moves up
+ * into the node between the two halves
+ * @param set The set that the node belongs to
+ * @param node An internal node that is not full
+ * @param i The index of the child to split
+ * @return true if the child was split, false if a new node could not be allocated
+ */
+static bool split_child(CSet *set, struct Node *node, int i) {
+  struct Node *child = children(set, node)[i];
+  int t = set->min_degree;
+  assert(child->num == set->max_elements);
+
+  struct Node *sibling = new_node(set, child->leaf);
+  if (sibling == NULL) return false;
+  sibling->num = t - 1;
+  move_elements(set, sibling, 0, child, t, t - 1);
+  if (!child->leaf) move_children(set, sibling, 0, child, t, t);
+  child->num = t - 1;
+
+  // make room in the node for the middle element and the new child just after it
+  move_elements(set, node, i + 1, node, i, node->num - i);
+  move_children(set, node, i + 2, node, i + 1, node->num - i);
+  move_elements(set, node, i, child, t - 1, 1);
+  children(set, node)[i + 1] = sibling;
+  node->num++;
+
+  int sibling_size = subtree_size(set, sibling);
+  counts(set, node)[i + 1] = sibling_size;
+  counts(set, node)[i] -= sibling_size + 1;
+  return true;
 }
 
-static struct Node *rotate(struct Node *root, enum Direction dir) {
-  assert(root != NULL);
+// Inserts an element into the subtree of a node that is not full, returning whether it was inserted
+static bool insert_nonfull(CSet *set, struct Node *node, const void *data) {
+  bool found;
+  int i = lower_bound(set, node, data, &found);
+  if (found) return false; // already there!
+
+  if (node->leaf) {
+    move_elements(set, node, i + 1, node, i, node->num - i);
+    memcpy(element(set, node, i), data, set->data_size);
+    node->num++;
+    return true;
+  }
 
-  struct Node *new_root = child(root, opposite(dir));
-  if (new_root == NULL) return root; // nothing to rotate onto
+  // Split a full child before descending into it, so that it has room for the element
+  if (children(set, node)[i]->num == set->max_elements) {
+    if (!split_child(set, node, i)) return false; // insertion failure
+    int comparison = set->cmp(element(set, node, i), data);
+    if (comparison == 0) return false;
+    if (comparison < 0) i++;
+  }
 
-  struct Node *transplant = child(child(root, opposite(dir)), dir);
-  assign_child(root, transplant, opposite(dir));
-  assign_child(new_root, root, dir);
-  return new_root;
+  if (!insert_nonfull(set, children(set, node)[i], data)) return false;
+  counts(set, node)[i]++;
+  return true;
 }
 
-static inline void dispose_node(const CSet *set, struct Node *node, bool recursive) {
-  assert(set != NULL);
-  if (node == NULL) return;
-  if (recursive) {
-    dispose_node(set, node->left, recursive);
-    dispose_node(set, node->right, recursive);
+/**
+ * @brief Removes an element from the subtree of a node
+ * @param set The set that the node belongs to
+ * @param node The root of the subtree, which has at least `min_degree` elements unless it is the root
+ * @param data The element to remove
+ * @param removed Where to move the removed element to
+ * @return true if an element equivalent to `data` was removed, false if there was none
+ */
+static bool remove_at(CSet *set, struct Node *node, const void *data, void *removed) {
+  bool found;
+  int i = lower_bound(set, node, data, &found);
+
+  if (node->leaf) {
+    if (!found) return false; // not found in set
+    memcpy(removed, element(set, node, i), set->data_size);
+    move_elements(set, node, i, node, i + 1, node->num - i - 1);
+    node->num--;
+    return true;
   }
 
-  if (set->cleanup != NULL)
-    set->cleanup(&node->data);
-  free(node);
+  if (found) {
+    // Replace the element with the greatest element before it, or the least one after it, from
+    // whichever child may give one up. If neither can, merge them and remove it from the merged child.
+    struct Node **kids = children(set, node);
+    memcpy(removed, element(set, node, i), set->data_size);
+    if (kids[i]->num >= set->min_degree) {
+      remove_extreme(set, kids[i], right, element(set, node, i));
+      counts(set, node)[i]--;
+    } else if (kids[i + 1]->num >= set->min_degree) {
+      remove_extreme(set, kids[i + 1], left, element(set, node, i));
+      counts(set, node)[i + 1]--;
+    } else {
+      merge_children(set, node, i);
+      remove_at(set, kids[i], data, removed);
+      counts(set, node)[i]--;
+    }
+    return true;
+  }
+
+  i = fill_child(set, node, i);
+  if (!remove_at(set, children(set, node)[i], data, removed)) return false;
+  counts(set, node)[i]--;
+  return true;
 }
 
-static inline void assign_child(struct Node *node, struct Node *new_child, enum Direction dir) {
-  assert(node != NULL);
-  *child_ref(node, dir) = new_child;
-  update_count(node, dir);
-  update_height(node);
+// Removes the least (left) or greatest (right) element from the subtree of a node, which has
+// at least `min_degree` elements
+static void remove_extreme(CSet *set, struct Node *node, enum Direction dir, void *removed) {
+  while (!node->leaf) {
+    int i = fill_child(set, node, dir == left ? 0 : node->num);
+    counts(set, node)[i]--;
+    node = children(set, node)[i];
+  }
+
+  int i = dir == left ? 0 : node->num - 1;
+  memcpy(removed, element(set, node, i), set->data_size);
+  move_elements(set, node, i, node, i + 1, node->num - i - 1);
+  node->num--;
 }
 
-static inline struct Node *child(const struct Node *node, enum Direction dir) {
-  assert(node != NULL);
-  return *child_ref(node, dir);
+/**
+ * @brief Makes sure that the i'th child of a node has more than the least number of elements,
+ * so that one may be removed from it, by borrowing an element through the node from one of the
+ * child's siblings, or else by merging the child with a sibling
+ * @param set The set that the node belongs to
+ * @param node An internal node with at least `min_degree` elements, or the root
+ * @param i The index of the child
+ * @return The index of the child afterwards, which is one less if it was merged into its left sibling
+ */
+static int fill_child(CSet *set, struct Node *node, int i) {
+  struct Node **kids = children(set, node);
+  if (kids[i]->num >= set->min_degree) return i;
+
+  if (i > 0 && kids[i - 1]->num >= set->min_degree) {
+    borrow(set, node, i, left);
+  } else if (i < node->num && kids[i + 1]->num >= set->min_degree) {
+    borrow(set, node, i, right);
+  } else if (i < node->num) {
+    merge_children(set, node, i);
+  } else {
+    merge_children(set, node, i - 1);
+    return i - 1;
+  }
+  return i;
 }
 
-static inline struct Node **child_ref(const struct Node *node, enum Direction dir) {
-  assert(node != NULL);
-  return (struct Node **) (dir == left ? &node->left : &node->right);
+// Rotates an element (and a subtree) into the i'th child of a node from its sibling in a direction
+static void borrow(CSet *set, struct Node *node, int i, enum Direction dir) {
+  struct Node **kids = children(set, node);
+  struct Node *child = kids[i];
+  int moved = 1;
+
+  if (dir == left) {
+    struct Node *sibling = kids[i - 1];
+    move_elements(set, child, 1, child, 0, child->num);
+    move_elements(set, child, 0, node, i - 1, 1);
+    move_elements(set, node, i - 1, sibling, sibling->num - 1, 1);
+    if (!child->leaf) {
+      move_children(set, child, 1, child, 0, child->num + 1);
+      move_children(set, child, 0, sibling, sibling->num, 1);
+      moved += counts(set, child)[0];
+    }
+    sibling->num--;
+    child->num++;
+    counts(set, node)[i - 1] -= moved;
+  } else {
+    struct Node *sibling = kids[i + 1];
+    move_elements(set, child, child->num, node, i, 1);
+    move_elements(set, node, i, sibling, 0, 1);
+    move_elements(set, sibling, 0, sibling, 1, sibling->num - 1);
+    if (!child->leaf) {
+      move_children(set, child, child->num + 1, sibling, 0, 1);
+      move_children(set, sibling, 0, sibling, 1, sibling->num);
+      moved += counts(set, child)[child->num + 1];
+    }
+    sibling->num--;
+    child->num++;
+    counts(set, node)[i + 1] -= moved;
+  }
+  counts(set, node)[i] += moved;
 }
 
-static inline void update_height(struct Node *node) {
-  if (node == NULL) return;
-  int left_height = node->left == NULL ? -1 : node->left->height;
-  int right_height = node->right == NULL ? -1 : node->right->height;
-  node->height = 1 + max(left_height, right_height);
+// Merges the (i + 1)'th child of a node, and the element between them, into the i'th child
+static void merge_children(CSet *set, struct Node *node, int i) {
+  struct Node **kids = children(set, node);
+  struct Node *child = kids[i];
+  struct Node *sibling = kids[i + 1];
+  assert(child->num + sibling->num < set->max_elements);
+
+  move_elements(set, child, child->num, node, i, 1);
+  move_elements(set, child, child->num + 1, sibling, 0, sibling->num);
+  if (!child->leaf) move_children(set, child, child->num + 1, sibling, 0, sibling->num + 1);
+  child->num += 1 + sibling->num;
+  counts(set, node)[i] += 1 + counts(set, node)[i + 1];
+
+  move_elements(set, node, i, node, i + 1, node->num - i - 1);
+  move_children(set, node, i + 1, node, i + 2, node->num - i - 1);
+  node->num--;
+  free(sibling);
 }
 
-static struct Node *extrema(struct Node *node, enum Direction dir) {
-  while (true) {
-    if (node == NULL) return NULL;
-    if (child(node, dir) == NULL) return node;
-    node = child(node, dir);
+// Moves an iterator whose position is past the end of the node it is in up to the next element
+// in one of the nodes above, or to the end if there is none
+static void seek_end(CSetIterator *it) {
+  while (it->depth > 0) {
+    const struct Node *node = it->path[it->depth - 1];
+    if (it->index[it->depth - 1] < node->num) return;
+    it->depth--;
   }
 }
 
-static inline void update_count(struct Node *node, enum Direction dir) {
-  assert(node != NULL);
-  int count = get_size(child(node, dir));
-  if (dir == left) node->nleft = count;
-  else node->nright = count;
+/**
+ * @brief Positions an iterator at the first element of a set which is not less than (or if
+ * `after` is set, which is greater than) an object
+ * @return The element, or NULL if there is none
+ */
+static void *seek(const CSet *set, const void *data, bool after, CSetIterator *it) {
+  it->set = set;
+  it->depth = 0;
+
+  const struct Node *node = set->root;
+  while (node != NULL) {
+    bool found;
+    int i = lower_bound(set, node, data, &found);
+    if (found && !after) {
+      it->path[it->depth] = node;
+      it->index[it->depth++] = i;
+      return element(set, node, i);
+    }
+
+    // Past an equivalent element, everything in the subtree after it is greater
+    if (found) i++;
+    it->path[it->depth] = node;
+    it->index[it->depth++] = i;
+    if (node->leaf) break;
+    node = children(set, node)[i];
+  }
+  seek_end(it);
+  return set_iter_get(it);
 }
 
-static inline int num_ancestors(const struct Node *node, enum Direction dir) {
-  assert(node != NULL);
-  return dir == left ? node->nleft : node->nright;
+// The number of elements in a full tree of a given height (which is zero for a leaf), plus one,
+// or more than any set holds if that would overflow
+static int64_t max_slots(const CSet *set, int height) {
+  int64_t slots = 2 * set->min_degree;
+  for (int h = 0; h < height && slots <= INT32_MAX; h++)
+    slots *= 2 * set->min_degree;
+  return slots;
 }
 
-static inline int get_size(const struct Node *node) {
-  if (node == NULL) return 0;
-  return 1 + num_ancestors(node, left) + num_ancestors(node, right);
+/**
+ * @brief Builds a subtree from the next elements of a sorted array.
+ * Every node gets as few children as it may have, out of between min_degree (or 2, for the root)
+ * and twice that, and the elements are shared out as evenly as they can be between the children.
+ * For the number of elements (plus one) in a subtree of height h is between min_degree^(h + 1)
+ * and (2 * min_degree)^(h + 1), and this keeps it so for each subtree below.
+ * @param set The set to build the subtree for
+ * @param height The height of the subtree
+ * @param count The number of (distinct) elements that the subtree is to hold
+ * @param root Whether the subtree is the whole tree
+ * @param next The next element of the array, which is advanced past each element that is used
+ * @param end The end of the array
+ * @return The root of the subtree, or NULL on allocation failure
+ */
+static struct Node *build(CSet *set, int height, int count, bool root, const char **next, const char *end) {
+  struct Node *node = new_node(set, height == 0);
+  if (node == NULL) return NULL;
+
+  if (height == 0) {
+    assert(count <= set->max_elements);
+    for (; node->num < count; node->num++) {
+      memcpy(element(set, node, node->num), *next, set->data_size);
+      *next = next_distinct(set, *next, end);
+    }
+    return node;
+  }
+
+  int64_t child_slots = max_slots(set, height - 1);
+  int min_children = root ? 2 : set->min_degree;
+  int num_children = (int) ((count + child_slots) / child_slots); // the least that hold them all
+  if (num_children < min_children) num_children = min_children;
+
+  // Each child, and the element after it, gets an even share of the slots
+  int slots = count + 1;
+  for (int i = 0; i < num_children; i++) {
+    int share = slots / num_children + (i < slots % num_children);
+    struct Node *child = build(set, height - 1, share - 1, false, next, end);
+    if (child == NULL) {
+      node->num = i - 1;
+      if (i > 0) dispose_node(set, node, false);
+      else free(node);
+      return NULL;
+    }
+    children(set, node)[i] = child;
+    counts(set, node)[i] = share - 1;
+    if (i < num_children - 1) {
+      memcpy(element(set, node, i), *next, set->data_size);
+      *next = next_distinct(set, *next, end);
+    }
+  }
+  node->num = num_children - 1;
+  return node;
 }
 
-static inline enum Direction opposite(enum Direction dir) {
-  return dir == left ? right : left;
+// Skips past an element of a sorted array and any that are equivalent to it
+static const char *next_distinct(const CSet *set, const char *element, const char *end) {
+  const char *next = element + set->data_size;
+  while (next != end && set->cmp(next, element) == 0)
+    next += set->data_size;
+  return next;
 }
 
-static inline enum Direction get_direction(int comparison) {
-  return comparison > 0 ? left : right;
+static void dispose_node(const CSet *set, struct Node *node, bool cleanup) {
+  assert(set != NULL);
+  if (node == NULL) return;
+  if (!node->leaf) {
+    for (int i = 0; i <= node->num; i++)
+      dispose_node(set, children(set, node)[i], cleanup);
+  }
+
+  if (cleanup && set->cleanup != NULL) {
+    for (int i = 0; i < node->num; i++)
+      set->cleanup(element(set, node, i));
+  }
+  free(node);
 }
@@ -2,8 +2,9 @@
  * @file cset.h
  * @brief Ordered set providing O(log n) time operations
  * @details This ordered set provides logarithmic time insertion, deletion, and
- * lookup as well as ranking operation. This implementation uses an AVL tree
- * to organize elements so as to provide these runtime guarantees.
+ * lookup as well as ranking operation. This implementation uses a B-tree, whose
+ * nodes each hold many elements contiguously, to organize elements so as to provide
+ * these runtime guarantees.
  * All elements contained within the set are distinct. Insertion of an element
  * into a set which contains an equivalent element will result in no operation.
  * @author Jon Deaton
@@ -28,8 +29,30 @@ extern "C" {
 
 #define CSET_ERROR (-1)
 
+// the most nodes on the path from the root of a set to an element
+#define CSET_MAX_DEPTH 32
+
 typedef struct CSetImplementation CSet;
 
+/**
+ * Position of an element within a set, from which the elements after it may be visited in order.
+ * @note Any change to the set invalidates its iterators.
+ */
+typedef struct CSetIterator {
+  const CSet *set;
+  int depth;                              // number of nodes on the path to the element, 0 at the end
+  const void *path[CSET_MAX_DEPTH];       // nodes from the root to the one holding the element
+  int index[CSET_MAX_DEPTH];              // position of the element (or of the path) in each node
+} CSetIterator;
+
+/**
+ * Function called on each element visited by `set_range`
+ * @param element Pointer to an element within the set
+ * @param context The context given to `set_range`
+ * @return true to go on to the next element, false to stop
+ */
+typedef bool (*SetVisitFn)(const void *element, void *context);
+
 /**
  * Creates a new set for storing objects of size `data_size` that are compared
  * by function `cmp` and disposed of with function `cleanup`
@@ -42,9 +65,10 @@ CSet *new_set(size_t data_size, CmpFn cmp, CleanupFn cleanup);
 
 /**
  * Insert a single element into the set.
- * @note Calling this function will not invalidate any pointers to elements previously
- * returned by `set_lookup`. If an element that is equivalent to `data` already exists
- * within the set this function will have no effect.
+ * @note Elements are moved within the set as it changes, so calling this function
+ * invalidates any pointers to elements previously returned by `set_lookup`. If an
+ * element that is equivalent to `data` already exists within the set this function
+ * will have no effect.
  * @param set The set to insert an element into
  * @param data Pointer to object of size `data_size` to copy and store
  * in the set data structure.
@@ -57,7 +81,8 @@ void set_insert(CSet *set, const void *data);
  * @param data Pointer to an object of size `data_size`. Will try to find an object
  * within the set equivalent to `data` in the strict order induced by `cmp`.
  * @return Pointer to an object within the set equivalent to `data` if such
- * an object exists in the set, otherwise NULL.
+ * an object exists in the set, otherwise NULL. The pointer is valid until the
+ * set is next changed.
  */
 void *set_lookup(const CSet *set, const void *data);
 
@@ -70,6 +95,86 @@ void *set_lookup(const CSet *set, const void *data);
  */
 int set_rank(CSet *set, const void *data);
 
+/**
+ * Find the element of a given rank, the inverse of `set_rank`.
+ * @param set The set to select an element from
+ * @param k The zero-indexed rank of the element
+ * @return Pointer to the element within the set which is greater than exactly `k`
+ * other elements, or NULL if `k` is not less than the size of the set
+ */
+void *set_select(const CSet *set, int k);
+
+/**
+ * Position an iterator at the element of a given rank.
+ * @param set The set to iterate over
+ * @param k The zero-indexed rank of the element to start at
+ * @param it The iterator to position
+ * @return Pointer to the element of rank `k`, or NULL (and `it` is at the end) if
+ * there is none
+ */
+void *set_iter_at(const CSet *set, int k, CSetIterator *it);
+
+/**
+ * Position an iterator at the least element which is not less than `data`.
+ * @param set The set to iterate over
+ * @param data Pointer to an object of size `data_size` to compare elements with
+ * @param it The iterator to position
+ * @return Pointer to the element, or NULL (and `it` is at the end) if every
+ * element is less than `data`
+ */
+void *set_lower_bound(const CSet *set, const void *data, CSetIterator *it);
+
+/**
+ * Position an iterator at the least element which is greater than `data`.
+ * @param set The set to iterate over
+ * @param data Pointer to an object of size `data_size` to compare elements with
+ * @param it The iterator to position
+ * @return Pointer to the element, or NULL (and `it` is at the end) if no
+ * element is greater than `data`
+ */
+void *set_upper_bound(const CSet *set, const void *data, CSetIterator *it);
+
+/**
+ * Get the element that an iterator is at.
+ * @param it The iterator
+ * @return Pointer to the element within the set, or NULL if `it` is at the end
+ */
+void *set_iter_get(const CSetIterator *it);
+
+/**
+ * Advance an iterator to the next element in order.
+ * @note Time complexity is amortized O(1).
+ * @param it The iterator to advance
+ * @return Pointer to the next element, or NULL if there is none, in which case
+ * `it` is at the end (where it stays)
+ */
+void *set_iter_next(CSetIterator *it);
+
+/**
+ * Visit, in order, each element of the set within a range.
+ * @param set The set whose elements to visit
+ * @param low The least element of the range (inclusive), or NULL to start at the least element
+ * @param high The end of the range (exclusive), or NULL to go on to the greatest element
+ * @param visit Function to call on each element, which may stop the visit by returning false
+ * @param context Passed on to `visit`
+ * @return The number of elements that were visited
+ */
+int set_range(const CSet *set, const void *low, const void *high, SetVisitFn visit, void *context);
+
+/**
+ * Replace the contents of the set with the elements of a sorted array.
+ * @note Time complexity is O(n), rather than the O(n log n) of inserting
+ * the elements one at a time. The elements already in the set are removed first,
+ * as by `set_clear`.
+ * @param set The set to build
+ * @param sorted Array of `count` objects of size `data_size`, in increasing order
+ * by `cmp`. Equivalent elements are stored only once.
+ * @param count The number of objects in `sorted`
+ * @return true if the set was built, false on allocation failure, in which case
+ * the set is empty
+ */
+bool set_build(CSet *set, const void *sorted, int count);
+
 /**
  * Get the size of the set.
  * @param set The set to find the size of
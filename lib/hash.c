@@ -1,7 +1,24 @@
+#include "hash.h"
 #include "stdlib.h"
 #include "string.h"
 #include <murmur3.h>
 
+// the constants of wyhash, which are odd, with half of their bits and of each of their bytes set
+static const uint64_t secret[4] = {
+  0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+// static function declarations
+static inline void multiply(uint64_t *a, uint64_t *b);
+static inline uint64_t mix(uint64_t a, uint64_t b);
+static inline uint64_t read64(const unsigned char *p);
+static inline uint64_t read32(const unsigned char *p);
+static inline uint64_t seed_state(uint64_t seed);
+static inline uint64_t finish(uint64_t a, uint64_t b, size_t keysize, uint64_t state);
+static inline uint64_t hash_bytes(const unsigned char *p, size_t keysize, uint64_t state);
+static inline uint64_t hash_int32(const unsigned char *p, uint64_t state);
+static inline uint64_t hash_int64(const unsigned char *p, uint64_t state);
+
 
 unsigned int roberts_hash(const void *key, size_t keysize) {
   const unsigned long MULTIPLIER = 2630849305L;
@@ -56,3 +73,129 @@ unsigned int loose_loose(unsigned char *str) {
 
   return hash;
 }
+
+uint64_t hash64(const void *key, size_t keysize, uint64_t seed) {
+  const unsigned char *p = key;
+  uint64_t state = seed_state(seed);
+  if (keysize == 4) return hash_int32(p, state);
+  if (keysize == 8) return hash_int64(p, state);
+  return hash_bytes(p, keysize, state);
+}
+
+void hash64_batch(const void *keys, size_t keysize, size_t count, uint64_t seed, uint64_t *hashes) {
+  const unsigned char *p = keys;
+  uint64_t state = seed_state(seed);
+  if (keysize == 4) {
+    for (size_t i = 0; i < count; i++)
+      hashes[i] = hash_int32(p + 4 * i, state);
+  } else if (keysize == 8) {
+    for (size_t i = 0; i < count; i++)
+      hashes[i] = hash_int64(p + 8 * i, state);
+  } else {
+    for (size_t i = 0; i < count; i++)
+      hashes[i] = hash_bytes(p + keysize * i, keysize, state);
+  }
+}
+
+unsigned int fast_hash(const void *key, size_t keysize) {
+  uint64_t hash = hash64(key, keysize, 0);
+  return (unsigned int) (hash ^ (hash >> 32));
+}
+
+// Sets a and b to the low and high halves of their 128-bit product
+static inline void multiply(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ unsigned __int128 product = (unsigned __int128) *a * *b;
+  *a = (uint64_t) product;
+  *b = (uint64_t) (product >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t carry = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  carry += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+  multiply(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t read32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t seed_state(uint64_t seed) {
+  return seed ^ mix(seed ^ secret[0], secret[1]);
+}
+
+static inline uint64_t finish(uint64_t a, uint64_t b, size_t keysize, uint64_t state) {
+  a ^= secret[1];
+  b ^= state;
+  multiply(&a, &b);
+  return mix(a ^ secret[0] ^ keysize, b ^ secret[1]);
+}
+
+// hash_bytes for a key of 4 bytes, which it reads as both of the two overlapping halves
+static inline uint64_t hash_int32(const unsigned char *p, uint64_t state) {
+  uint64_t v = read32(p);
+  return finish(v << 32 | v, v << 32 | v, 4, state);
+}
+
+// hash_bytes for a key of 8 bytes
+static inline uint64_t hash_int64(const unsigned char *p, uint64_t state) {
+  uint64_t lo = read32(p), hi = read32(p + 4);
+  return finish(lo << 32 | hi, hi << 32 | lo, 8, state);
+}
+
+static inline uint64_t hash_bytes(const unsigned char *p, size_t keysize, uint64_t state) {
+  uint64_t a, b;
+  if (keysize <= 16) {
+    if (keysize >= 4) {
+      // two (possibly overlapping) pairs of 4 bytes, from the start and from the end
+      size_t middle = (keysize >> 3) << 2;
+      a = read32(p) << 32 | read32(p + middle);
+      b = read32(p + keysize - 4) << 32 | read32(p + keysize - 4 - middle);
+    } else if (keysize > 0) {
+      a = (uint64_t) p[0] << 16 | (uint64_t) p[keysize >> 1] << 8 | p[keysize - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+    return finish(a, b, keysize, state);
+  }
+
+  // Long keys are mixed 48 bytes at a time in three independent lanes, then 16 at a time
+  size_t i = keysize;
+  if (i > 48) {
+    uint64_t lane1 = state, lane2 = state;
+    do {
+      state = mix(read64(p) ^ secret[1], read64(p + 8) ^ state);
+      lane1 = mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ lane1);
+      lane2 = mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ lane2);
+      p += 48;
+      i -= 48;
+    } while (i > 48);
+    state ^= lane1 ^ lane2;
+  }
+  while (i > 16) {
+    state = mix(read64(p) ^ secret[1], read64(p + 8) ^ state);
+    p += 16;
+    i -= 16;
+  }
+  a = read64(p + i - 16);
+  b = read64(p + i - 8);
+  return finish(a, b, keysize, state);
+}
@@ -1,6 +1,15 @@
 #ifndef _hashtable_hash_h
 #define _hashtable_hash_h
 
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
 typedef unsigned int (*CMapHashFn)(const void *key, size_t keysize);
 
 unsigned int roberts_hash(const void *key, size_t keysize);
@@ -10,4 +19,36 @@ unsigned int djb2_hash(unsigned char *str);
 unsigned int sdbm(unsigned char *str);
 unsigned int loose_loose(unsigned char *str);
 
+/**
+ * 64-bit hash of a key, in the style of wyhash: the key is read 8 or 16 bytes at a time, and
+ * each step mixes them with a single 64 x 64 -> 128 bit multiplication. Keys of 4 and 8 bytes
+ * (ints and pointers) take a path with no branches on the key's size.
+ * @param key Pointer to the key to hash
+ * @param keysize Number of bytes in the key
+ * @param seed Seed which picks one of a family of hash functions
+ * @return The hash of the key
+ */
+uint64_t hash64(const void *key, size_t keysize, uint64_t seed);
+
+/**
+ * Hashes an array of keys in one call, which amortizes the work that depends only on the seed and
+ * the size of the keys, and lets the hashes of independent keys be computed in parallel.
+ * @param keys Array of `count` keys, each of `keysize` bytes
+ * @param keysize Number of bytes in each key
+ * @param count Number of keys to hash
+ * @param seed Seed of the hash function
+ * @param hashes Array of `count` hashes to fill in, the i'th with hash64(key i, keysize, seed)
+ */
+void hash64_batch(const void *keys, size_t keysize, size_t count, uint64_t seed, uint64_t *hashes);
+
+/**
+ * hash64 (with a seed of 0) folded to the size of a CMapHashFn hash, for use in CMap.
+ * This is CMap's default hash function.
+ */
+unsigned int fast_hash(const void *key, size_t keysize);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // _hashtable_hash_h
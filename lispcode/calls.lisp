@@ -0,0 +1,3 @@
+(set 'first (lambda (x y z) x))
+(set 'loop (lambda (n) (cond ((= n 0) 0) (t (loop (- (first n 1 2) 1))))))
+(loop 100000)
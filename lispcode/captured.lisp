@@ -0,0 +1,2 @@
+(set 'loop (lambda (n) (cond ((= n 0) (car big)) (t (loop (- n 1))))))
+(loop 1000)
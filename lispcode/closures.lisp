@@ -0,0 +1,3 @@
+(set 'nest (lambda (a) (lambda (b) (lambda (c) (+ a (+ b c))))))
+(set 'run (lambda (n acc) (cond ((= n 0) acc) (t (run (- n 1) (((nest n) acc) 1))))))
+(run 1000 0)
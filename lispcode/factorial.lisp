@@ -0,0 +1,14 @@
+(set 'factorial
+     (lambda (n)
+       (cond
+         ((= n 0) 1)
+         (t       (* n (factorial (- n 1)))))))
+
+(set 'repeat
+     (lambda (n)
+       (cond
+         ((= n 0) (factorial 12))
+         (t       (cond ((= (factorial 12) 479001600) (repeat (- n 1)))
+                        (t                           nil))))))
+
+(repeat 1000)
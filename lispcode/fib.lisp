@@ -0,0 +1,7 @@
+(set 'fib
+     (lambda (n)
+       (cond
+         ((< n 2) n)
+         (t       (+ (fib (- n 1)) (fib (- n 2)))))))
+
+(fib 20)
@@ -0,0 +1,2 @@
+(set 'fold (lambda (f acc n) (cond ((= n 0) acc) (t (fold f (f acc n) (- n 1))))))
+(fold + 0 10000)
@@ -0,0 +1,3 @@
+(set 'add3 (lambda (a b c) (+ a (+ b c))))
+(set 'run (lambda (n acc) (cond ((= n 0) acc) (t (run (- n 1) (((add3 n) acc) 1))))))
+(run 1000 0)
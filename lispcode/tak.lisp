@@ -0,0 +1,9 @@
+(set 'tak
+     (lambda (x y z)
+       (cond
+         ((< y x) (tak (tak (- x 1) y z)
+                       (tak (- y 1) z x)
+                       (tak (- z 1) x y)))
+         (t       z))))
+
+(tak 18 12 6)
@@ -0,0 +1,533 @@
+/*
+ * File: bignum.c
+ * --------------
+ * Presents the implementation of arbitrary-precision integers
+ */
+
+#include <bignum.h>
+#include <stack-trace.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+// Fewest digits that both factors must have for them to be multiplied with Karatsuba's algorithm
+#define KARATSUBA_THRESHOLD 32
+
+// Largest power of ten that fits in a digit, by which decimal digits are converted nine at a time
+#define DECIMAL_BASE 1000000000u
+#define DECIMAL_BASE_DIGITS 9
+
+#define DIGIT_BITS 32
+
+// Static function declarations
+static Bignum *allocate_bignum(int size);
+static Bignum *normalize(Bignum *x);
+static Bignum *add_signed(const Bignum *x, const Bignum *y, bool y_negative);
+static int compare_digits(const bigdigit *x, int nx, const bigdigit *y, int ny);
+static bigdigit add_digits(bigdigit *r, int nr, const bigdigit *x, int nx);
+static bigdigit sub_digits(bigdigit *r, int nr, const bigdigit *x, int nx);
+static void mul_add_digit(bigdigit *x, int n, bigdigit m, bigdigit a);
+static void mul_digits(bigdigit *r, const bigdigit *x, int nx, const bigdigit *y, int ny);
+static void mul_schoolbook(bigdigit *r, const bigdigit *x, int nx, const bigdigit *y, int ny);
+static void mul_karatsuba(bigdigit *r, const bigdigit *x, int nx, const bigdigit *y, int ny);
+static bigdigit divide_digit(bigdigit *q, const bigdigit *x, int n, bigdigit d);
+static void divide_digits(bigdigit *q, bigdigit *r, const bigdigit *u, int m, const bigdigit *v, int n);
+
+Bignum *bignum_from_int(int64_t value) {
+  uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+  Bignum *x = allocate_bignum(2);
+  x->negative = value < 0;
+  x->digits[0] = (bigdigit) magnitude;
+  x->digits[1] = (bigdigit) (magnitude >> DIGIT_BITS);
+  return normalize(x);
+}
+
+Bignum *bignum_parse(const char *str) {
+  assert(str != NULL);
+  bool negative = *str == '-';
+  if (*str == '-' || *str == '+') str++;
+
+  int length = (int) strlen(str);
+  if (length == 0) return NULL;
+  for (int i = 0; i < length; i++)
+    if (str[i] < '0' || str[i] > '9') return NULL;
+
+  // Each digit holds more than nine decimal digits
+  Bignum *x = allocate_bignum(length / DECIMAL_BASE_DIGITS + 1);
+  int chunk = length % DECIMAL_BASE_DIGITS == 0 ? DECIMAL_BASE_DIGITS : length % DECIMAL_BASE_DIGITS;
+  for (int i = 0; i < length; i += chunk, chunk = DECIMAL_BASE_DIGITS) {
+    bigdigit value = 0, scale = 1;
+    for (int j = i; j < i + chunk; j++) {
+      value = 10 * value + (bigdigit) (str[j] - '0');
+      scale *= 10;
+    }
+    mul_add_digit(x->digits, x->size, scale, value);
+  }
+  x->negative = negative;
+  return normalize(x);
+}
+
+Bignum *bignum_copy(const Bignum *x) {
+  assert(x != NULL);
+  Bignum *copy = allocate_bignum(x->size);
+  copy->negative = x->negative;
+  memcpy(copy->digits, x->digits, x->size * sizeof(bigdigit));
+  return copy;
+}
+
+void bignum_free(Bignum *x) {
+  if (x == NULL) return;
+  if (x->block.prev != NULL) gc_free_block(&x->block);
+  else free(x);
+}
+
+Bignum *bignum_add(const Bignum *x, const Bignum *y) {
+  return add_signed(x, y, y->negative);
+}
+
+Bignum *bignum_sub(const Bignum *x, const Bignum *y) {
+  return add_signed(x, y, y->size > 0 && !y->negative);
+}
+
+Bignum *bignum_mul(const Bignum *x, const Bignum *y) {
+  assert(x != NULL && y != NULL);
+  if (x->size == 0 || y->size == 0) return allocate_bignum(0);
+
+  Bignum *product = allocate_bignum(x->size + y->size);
+  mul_digits(product->digits, x->digits, x->size, y->digits, y->size);
+  product->negative = x->negative != y->negative;
+  return normalize(product);
+}
+
+bool bignum_divmod(const Bignum *x, const Bignum *y, Bignum **quotient, Bignum **remainder) {
+  assert(x != NULL && y != NULL);
+  if (y->size == 0) return false;
+
+  Bignum *q, *r;
+  if (compare_digits(x->digits, x->size, y->digits, y->size) < 0) {
+    q = allocate_bignum(0);
+    r = bignum_copy(x);
+  } else {
+    q = allocate_bignum(x->size - y->size + 1);
+    r = allocate_bignum(y->size);
+    if (y->size == 1) r->digits[0] = divide_digit(q->digits, x->digits, x->size, y->digits[0]);
+    else divide_digits(q->digits, r->digits, x->digits, x->size, y->digits, y->size);
+    q->negative = x->negative != y->negative;
+    r->negative = x->negative;
+    normalize(q);
+    normalize(r);
+  }
+
+  if (quotient != NULL) *quotient = q;
+  else bignum_free(q);
+  if (remainder != NULL) *remainder = r;
+  else bignum_free(r);
+  return true;
+}
+
+int bignum_compare(const Bignum *x, const Bignum *y) {
+  assert(x != NULL && y != NULL);
+  if (x->negative != y->negative) return x->negative ? -1 : 1;
+  int order = compare_digits(x->digits, x->size, y->digits, y->size);
+  return x->negative ? -order : order;
+}
+
+bool bignum_to_int(const Bignum *x, int64_t *value) {
+  assert(x != NULL);
+  if (x->size > 2) return false;
+
+  uint64_t magnitude = 0;
+  for (int i = x->size - 1; i >= 0; i--)
+    magnitude = (magnitude << DIGIT_BITS) | x->digits[i];
+
+  if (!x->negative) {
+    if (magnitude > (uint64_t) INT64_MAX) return false;
+    *value = (int64_t) magnitude;
+  } else {
+    if (magnitude > (uint64_t) INT64_MAX + 1) return false;
+    *value = -(int64_t) (magnitude - 1) - 1;
+  }
+  return true;
+}
+
+double bignum_to_double(const Bignum *x) {
+  assert(x != NULL);
+  double value = 0;
+  for (int i = x->size - 1; i >= 0; i--)
+    value = value * 4294967296.0 + x->digits[i];
+  return x->negative ? -value : value;
+}
+
+char *bignum_to_string(const Bignum *x) {
+  assert(x != NULL);
+
+  // Split the magnitude into chunks of nine decimal digits, least significant first
+  int size = x->size;
+  bigdigit *magnitude = malloc((size + 1) * sizeof(bigdigit));
+  bigdigit *chunks = malloc((2 * size + 1) * sizeof(bigdigit)); // each digit is less than two chunks
+  MALLOC_CHECK(magnitude);
+  MALLOC_CHECK(chunks);
+  memcpy(magnitude, x->digits, size * sizeof(bigdigit));
+
+  int num_chunks = 0;
+  do {
+    chunks[num_chunks++] = divide_digit(magnitude, magnitude, size, DECIMAL_BASE);
+    while (size > 0 && magnitude[size - 1] == 0) size--;
+  } while (size > 0);
+
+  char *str = malloc(num_chunks * DECIMAL_BASE_DIGITS + 2);
+  MALLOC_CHECK(str);
+  char *end = str;
+  if (x->negative) *end++ = '-';
+  end += sprintf(end, "%u", (unsigned) chunks[num_chunks - 1]);
+  for (int i = num_chunks - 2; i >= 0; i--)
+    end += sprintf(end, "%09u", (unsigned) chunks[i]);
+
+  free(magnitude);
+  free(chunks);
+  return str;
+}
+
+/**
+ * Function: allocate_bignum
+ * -------------------------
+ * Allocates a bignum, not recorded with any garbage collector, with all of its digits zero
+ * @param size: The number of digits
+ * @return: The new bignum
+ */
+static Bignum *allocate_bignum(int size) {
+  Bignum *x = malloc(sizeof(Bignum) + size * sizeof(bigdigit));
+  MALLOC_CHECK(x);
+  x->block.prev = x->block.next = NULL;
+  x->negative = false;
+  x->size = size;
+  memset(x->digits, 0, size * sizeof(bigdigit));
+  return x;
+}
+
+/**
+ * Function: normalize
+ * -------------------
+ * Drops the leading zero digits of a bignum, making it positive if it is zero
+ * @param x: The bignum
+ * @return: The same bignum
+ */
+static Bignum *normalize(Bignum *x) {
+  while (x->size > 0 && x->digits[x->size - 1] == 0) x->size--;
+  if (x->size == 0) x->negative = false;
+  return x;
+}
+
+/**
+ * Function: add_signed
+ * --------------------
+ * Adds one bignum to another, or to its negation
+ * @param x: The first bignum
+ * @param y: The second bignum
+ * @param y_negative: The sign to give the second bignum
+ * @return: A new bignum holding the sum
+ */
+static Bignum *add_signed(const Bignum *x, const Bignum *y, bool y_negative) {
+  assert(x != NULL && y != NULL);
+  const Bignum *larger = x, *smaller = y;
+  bool larger_negative = x->negative;
+  if (compare_digits(x->digits, x->size, y->digits, y->size) < 0) {
+    larger = y;
+    smaller = x;
+    larger_negative = y_negative;
+  }
+
+  Bignum *sum = allocate_bignum(larger->size + 1);
+  memcpy(sum->digits, larger->digits, larger->size * sizeof(bigdigit));
+  if (x->negative == y_negative) add_digits(sum->digits, sum->size, smaller->digits, smaller->size);
+  else sub_digits(sum->digits, sum->size, smaller->digits, smaller->size);
+  sum->negative = larger_negative;
+  return normalize(sum);
+}
+
+/**
+ * Function: compare_digits
+ * ------------------------
+ * Compares two magnitudes without leading zero digits
+ * @param x: Digits of the first magnitude
+ * @param nx: Number of digits of the first magnitude
+ * @param y: Digits of the second magnitude
+ * @param ny: Number of digits of the second magnitude
+ * @return: A negative number, zero or a positive number as x is less than, equal to or greater than y
+ */
+static int compare_digits(const bigdigit *x, int nx, const bigdigit *y, int ny) {
+  if (nx != ny) return nx < ny ? -1 : 1;
+  for (int i = nx - 1; i >= 0; i--)
+    if (x[i] != y[i]) return x[i] < y[i] ? -1 : 1;
+  return 0;
+}
+
+/**
+ * Function: add_digits
+ * --------------------
+ * Adds a magnitude to another, in place
+ * @param r: Digits of the magnitude to add to
+ * @param nr: Number of digits of r, at least nx
+ * @param x: Digits of the magnitude to add
+ * @param nx: Number of digits of x
+ * @return: The carry out of the most significant digit of r
+ */
+static bigdigit add_digits(bigdigit *r, int nr, const bigdigit *x, int nx) {
+  uint64_t carry = 0;
+  int i = 0;
+  for (; i < nx; i++) {
+    uint64_t t = (uint64_t) r[i] + x[i] + carry;
+    r[i] = (bigdigit) t;
+    carry = t >> DIGIT_BITS;
+  }
+  for (; carry != 0 && i < nr; i++) {
+    uint64_t t = (uint64_t) r[i] + carry;
+    r[i] = (bigdigit) t;
+    carry = t >> DIGIT_BITS;
+  }
+  return (bigdigit) carry;
+}
+
+/**
+ * Function: sub_digits
+ * --------------------
+ * Subtracts a magnitude from another, in place
+ * @param r: Digits of the magnitude to subtract from
+ * @param nr: Number of digits of r, at least nx
+ * @param x: Digits of the magnitude to subtract
+ * @param nx: Number of digits of x
+ * @return: The borrow out of the most significant digit of r, which is zero if r was at least x
+ */
+static bigdigit sub_digits(bigdigit *r, int nr, const bigdigit *x, int nx) {
+  uint64_t borrow = 0;
+  int i = 0;
+  for (; i < nx; i++) {
+    uint64_t t = (uint64_t) r[i] - x[i] - borrow;
+    r[i] = (bigdigit) t;
+    borrow = (t >> DIGIT_BITS) & 1;
+  }
+  for (; borrow != 0 && i < nr; i++) {
+    uint64_t t = (uint64_t) r[i] - borrow;
+    r[i] = (bigdigit) t;
+    borrow = (t >> DIGIT_BITS) & 1;
+  }
+  return (bigdigit) borrow;
+}
+
+/**
+ * Function: mul_add_digit
+ * -----------------------
+ * Multiplies a magnitude by a digit and adds another digit to it, in place
+ * @param x: Digits of the magnitude, with room for the result
+ * @param n: Number of digits of x
+ * @param m: The digit to multiply by
+ * @param a: The digit to add
+ */
+static void mul_add_digit(bigdigit *x, int n, bigdigit m, bigdigit a) {
+  uint64_t carry = a;
+  for (int i = 0; i < n; i++) {
+    uint64_t t = (uint64_t) x[i] * m + carry;
+    x[i] = (bigdigit) t;
+    carry = t >> DIGIT_BITS;
+  }
+  assert(carry == 0);
+}
+
+/**
+ * Function: mul_digits
+ * --------------------
+ * Multiplies two magnitudes, choosing the algorithm by the sizes of the factors. Factors of
+ * very different sizes are multiplied a piece of the larger factor at a time, each piece the
+ * size of the smaller factor, so that Karatsuba's algorithm always splits balanced factors.
+ * @param r: Location to write the nx + ny digits of the product to
+ * @param x: Digits of the first factor
+ * @param nx: Number of digits of the first factor
+ * @param y: Digits of the second factor
+ * @param ny: Number of digits of the second factor
+ */
+static void mul_digits(bigdigit *r, const bigdigit *x, int nx, const bigdigit *y, int ny) {
+  if (nx < ny) {
+    const bigdigit *t = x;
+    x = y;
+    y = t;
+    int n = nx;
+    nx = ny;
+    ny = n;
+  }
+
+  if (ny < KARATSUBA_THRESHOLD) {
+    mul_schoolbook(r, x, nx, y, ny);
+  } else if (nx < 2 * ny) {
+    mul_karatsuba(r, x, nx, y, ny);
+  } else {
+    memset(r, 0, (nx + ny) * sizeof(bigdigit));
+    bigdigit *piece = malloc(2 * ny * sizeof(bigdigit));
+    MALLOC_CHECK(piece);
+    for (int i = 0; i < nx; i += ny) {
+      int n = nx - i < ny ? nx - i : ny;
+      mul_digits(piece, x + i, n, y, ny);
+      add_digits(r + i, nx + ny - i, piece, n + ny);
+    }
+    free(piece);
+  }
+}
+
+/**
+ * Function: mul_schoolbook
+ * ------------------------
+ * Multiplies two magnitudes digit by digit, in time proportional to nx * ny
+ * @param r: Location to write the nx + ny digits of the product to
+ * @param x: Digits of the first factor
+ * @param nx: Number of digits of the first factor
+ * @param y: Digits of the second factor
+ * @param ny: Number of digits of the second factor
+ */
+static void mul_schoolbook(bigdigit *r, const bigdigit *x, int nx, const bigdigit *y, int ny) {
+  memset(r, 0, (nx + ny) * sizeof(bigdigit));
+  for (int i = 0; i < nx; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < ny; j++) {
+      uint64_t t = (uint64_t) x[i] * y[j] + r[i + j] + carry;
+      r[i + j] = (bigdigit) t;
+      carry = t >> DIGIT_BITS;
+    }
+    r[i + ny] = (bigdigit) carry;
+  }
+}
+
+/**
+ * Function: mul_karatsuba
+ * -----------------------
+ * Multiplies two magnitudes of similar sizes with Karatsuba's algorithm. Splitting each factor
+ * into halves, x = x1 B^m + x0 and y = y1 B^m + y0, the product is z2 B^2m + z1 B^m + z0 where
+ * z2 = x1 y1, z0 = x0 y0 and z1 = (x0 + x1)(y0 + y1) - z2 - z0: three half-sized products
+ * rather than four, for time proportional to n^1.585.
+ * @param r: Location to write the nx + ny digits of the product to
+ * @param x: Digits of the first factor
+ * @param nx: Number of digits of the first factor
+ * @param y: Digits of the second factor
+ * @param ny: Number of digits of the second factor, such that ny <= nx < 2 * ny
+ */
+static void mul_karatsuba(bigdigit *r, const bigdigit *x, int nx, const bigdigit *y, int ny) {
+  int m = nx / 2; // less than ny, so that y1 has at least one digit
+  int n = nx + ny;
+
+  // z0 and z2 go straight into the low and high parts of the product
+  mul_digits(r, x, m, y, m);
+  mul_digits(r + 2 * m, x + m, nx - m, y + m, ny - m);
+
+  int lx = nx - m + 1;
+  int ly = (ny - m > m ? ny - m : m) + 1;
+  bigdigit *sx = calloc(2 * (lx + ly), sizeof(bigdigit));
+  MALLOC_CHECK(sx);
+  bigdigit *sy = sx + lx, *z1 = sy + ly;
+
+  memcpy(sx, x + m, (nx - m) * sizeof(bigdigit));
+  add_digits(sx, lx, x, m);
+  memcpy(sy, y, m * sizeof(bigdigit));
+  add_digits(sy, ly, y + m, ny - m);
+
+  mul_digits(z1, sx, lx, sy, ly);
+  sub_digits(z1, lx + ly, r, 2 * m);
+  sub_digits(z1, lx + ly, r + 2 * m, n - 2 * m);
+
+  int nz1 = lx + ly;
+  while (nz1 > 0 && z1[nz1 - 1] == 0) nz1--;
+  assert(nz1 <= n - m);
+  add_digits(r + m, n - m, z1, nz1);
+  free(sx);
+}
+
+/**
+ * Function: divide_digit
+ * ----------------------
+ * Divides a magnitude by a single digit
+ * @param q: Location to write the n digits of the quotient to, which may be x
+ * @param x: Digits of the dividend
+ * @param n: Number of digits of the dividend
+ * @param d: The divisor, which is not zero
+ * @return: The remainder
+ */
+static bigdigit divide_digit(bigdigit *q, const bigdigit *x, int n, bigdigit d) {
+  uint64_t remainder = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    uint64_t t = (remainder << DIGIT_BITS) | x[i];
+    q[i] = (bigdigit) (t / d);
+    remainder = t % d;
+  }
+  return (bigdigit) remainder;
+}
+
+/**
+ * Function: divide_digits
+ * -----------------------
+ * Divides one magnitude by another of at least two digits, with Knuth's algorithm D (as in
+ * Hacker's Delight). Both are first shifted left until the divisor's top digit has its high
+ * bit set, so that each digit of the quotient estimated from the top two digits of what
+ * remains of the dividend is at most two too large.
+ * @param q: Location to write the m - n + 1 digits of the quotient to
+ * @param r: Location to write the n digits of the remainder to
+ * @param u: Digits of the dividend
+ * @param m: Number of digits of the dividend, at least n
+ * @param v: Digits of the divisor, without leading zeros
+ * @param n: Number of digits of the divisor, at least two
+ */
+static void divide_digits(bigdigit *q, bigdigit *r, const bigdigit *u, int m, const bigdigit *v, int n) {
+  const uint64_t base = (uint64_t) 1 << DIGIT_BITS;
+
+  int s = 0;
+  for (bigdigit top = v[n - 1]; (top & 0x80000000u) == 0; top <<= 1) s++;
+
+  bigdigit *vn = malloc((n + m + 1) * sizeof(bigdigit));
+  MALLOC_CHECK(vn);
+  bigdigit *un = vn + n;
+  for (int i = n - 1; i > 0; i--)
+    vn[i] = (bigdigit) (((uint64_t) v[i] << s) | ((uint64_t) v[i - 1] >> (DIGIT_BITS - s)));
+  vn[0] = v[0] << s;
+  un[m] = (bigdigit) ((uint64_t) u[m - 1] >> (DIGIT_BITS - s));
+  for (int i = m - 1; i > 0; i--)
+    un[i] = (bigdigit) (((uint64_t) u[i] << s) | ((uint64_t) u[i - 1] >> (DIGIT_BITS - s)));
+  un[0] = u[0] << s;
+
+  for (int j = m - n; j >= 0; j--) {
+    // Estimate the next digit of the quotient, correcting it if it's too large
+    uint64_t top = ((uint64_t) un[j + n] << DIGIT_BITS) | un[j + n - 1];
+    uint64_t qhat = top / vn[n - 1];
+    uint64_t rhat = top % vn[n - 1];
+    while (qhat >= base || qhat * vn[n - 2] > ((rhat << DIGIT_BITS) | un[j + n - 2])) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat >= base) break;
+    }
+
+    // Multiply and subtract
+    int64_t k = 0, t;
+    for (int i = 0; i < n; i++) {
+      uint64_t p = qhat * vn[i];
+      t = (int64_t) un[i + j] - k - (int64_t) (p & 0xFFFFFFFFu);
+      un[i + j] = (bigdigit) t;
+      k = (int64_t) (p >> DIGIT_BITS) - (t >> DIGIT_BITS);
+    }
+    t = (int64_t) un[j + n] - k;
+    un[j + n] = (bigdigit) t;
+
+    // The estimate was one too large: add the divisor back
+    q[j] = (bigdigit) qhat;
+    if (t < 0) {
+      q[j]--;
+      uint64_t carry = 0;
+      for (int i = 0; i < n; i++) {
+        uint64_t sum = (uint64_t) un[i + j] + vn[i] + carry;
+        un[i + j] = (bigdigit) sum;
+        carry = sum >> DIGIT_BITS;
+      }
+      un[j + n] += (bigdigit) carry;
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+    r[i] = (bigdigit) ((un[i] >> s) | ((uint64_t) un[i + 1] << (DIGIT_BITS - s)));
+  free(vn);
+}
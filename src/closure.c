@@ -11,61 +11,134 @@
 #include <environment.h>
 #include <evaluator.h>
 #include <stack-trace.h>
+#include <compiler.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <interpreter.h>
 
 // Static function declarations
+static bool binds_name(const obj *closure, const obj *name);
 
-obj *closure_partial_application(const obj *closure, const obj *args, LispInterpreter *interpreter) {
-  if (closure == NULL) return NULL;
-
+obj *closure_partial_application(const obj *function, const obj *args, LispInterpreter *interpreter) {
+  if (function == NULL) return NULL;
+  GarbageCollector *gc = &interpreter->gc;
   int nargs = list_length(args);
 
-  obj *params = copy_recursive(sublist(PARAMETERS(closure), nargs));
-  gc_add_recursive(&interpreter->gc, params);
+  // The values already applied are merged into the new partial application if they fit
+  obj *applied = (obj*) function;
+  int merged = 0;
+  if (is_partial(function) && PARTIAL_NVALUES(function) + nargs <= PARTIAL_MAX_VALUES) {
+    applied = PARTIAL_FUNCTION(function);
+    merged = PARTIAL_NVALUES(function);
+  }
+
+  // Any more values than fit in one partial application are applied to it in turn
+  obj *partial = NULL;
+  gc_push_root(gc, &partial); // keep alive while evaluating the arguments
+  do {
+    int n = nargs < PARTIAL_MAX_VALUES - merged ? nargs : PARTIAL_MAX_VALUES - merged;
+    partial = new_partial(applied, merged + n, gc);
+    gc_add(gc, partial);
+    if (merged > 0) memcpy(PARTIAL_VALUES(partial), PARTIAL_VALUES(function), merged * sizeof(obj*));
+    for (int i = merged; i < merged + n; i++, args = CDR(args)) {
+      PARTIAL_VALUES(partial)[i] = eval(CAR(args), interpreter);
+      gc_write_barrier(gc, partial); // a collection while evaluating may have promoted it
+    }
+    applied = partial;
+    merged = 0;
+    nargs -= n;
+  } while (nargs > 0);
+  gc_pop_roots(gc, 1);
+  return partial;
+}
+
+const obj *applied_closure(const obj *function) {
+  while (is_partial(function)) function = PARTIAL_FUNCTION(function);
+  return is_closure(function) ? function : NULL;
+}
 
-  obj *procedure = copy_recursive(PROCEDURE(closure));
-  gc_add_recursive(&interpreter->gc, procedure);
+int remaining_params(const obj *function) {
+  return is_partial(function) ? PARTIAL_NARGS(function) : NARGS(function);
+}
 
-  obj *capt_copy = copy_recursive(CAPTURED(closure));
-  gc_add_recursive(&interpreter->gc, capt_copy);
+bool closure_hides(const obj *closure, const obj *replaced, LispInterpreter *interpreter) {
+  if (closure == replaced) return true;
 
-  obj *new_bindings = associate(PARAMETERS(closure), args, interpreter);
+  const obj *params = PARAMETERS(replaced);
+  for (int i = 0; i < NARGS(replaced); i++, params = CDR(params))
+    if (!binds_name(closure, CAR(params))) return false;
 
-  obj* captured = join_lists(new_bindings, capt_copy);
+  for (const obj *captured = CAPTURED(replaced); captured != NULL; captured = CDR(captured)) {
+    const obj *pair = CAR(captured);
+    if (pair == NULL || binds_name(closure, CAR(pair))) continue;
+    if (lookup(CAR(pair), interpreter) != CAR(CDR(pair))) return false;
+  }
+  return true;
+}
 
-  obj* new_closure = new_closure_set(params, procedure, captured);
-  gc_add(&interpreter->gc, new_closure);
-  return new_closure;
+obj **partial_values(const obj *partial, obj **values) {
+  if (!is_partial(partial)) return values;
+  values = partial_values(PARTIAL_FUNCTION(partial), values);
+  memcpy(values, PARTIAL_VALUES(partial), PARTIAL_NVALUES(partial) * sizeof(obj*));
+  return values + PARTIAL_NVALUES(partial);
 }
 
-obj *new_closure_set(obj *params, obj *procedure, obj *captured) {
-  obj* o = new_closure();
+obj *new_closure_set(obj *params, obj *procedure, obj *captured, GarbageCollector *gc) {
+  obj* o = new_closure(gc);
   PARAMETERS(o) = params;
   PROCEDURE(o)  = procedure;
   CAPTURED(o)   = captured;
   NARGS(o)      = is_nil(params) ? 0 : list_length(params);
+  CODE(o)       = compile_closure(o, gc);
   return o;
 }
 
-obj* copy_closure_recursive(const obj* closure) {
-  obj *params = copy_recursive(PARAMETERS(closure));
-  obj *proc = copy_recursive(PROCEDURE(closure));
-  obj *capt = copy_recursive(CAPTURED(closure));
-  return new_closure_set(params, proc, capt);
+obj* copy_closure_recursive(const obj* closure, GarbageCollector *gc) {
+  obj *params = copy_recursive(PARAMETERS(closure), gc);
+  obj *proc = copy_recursive(PROCEDURE(closure), gc);
+  obj *capt = copy_recursive(CAPTURED(closure), gc);
+  return new_closure_set(params, proc, capt, gc);
+}
+
+obj *copy_partial_recursive(const obj *partial, GarbageCollector *gc) {
+  obj *function = copy_recursive(PARTIAL_FUNCTION(partial), gc);
+  obj *copy = new_partial(function, PARTIAL_NVALUES(partial), gc);
+  for (int i = 0; i < PARTIAL_NVALUES(partial); i++)
+    PARTIAL_VALUES(copy)[i] = copy_recursive(PARTIAL_VALUES(partial)[i], gc);
+  return copy;
 }
 
 obj *associate(obj *names, const obj *args, LispInterpreter *interpreter) {
   if (!is_list(names) || !is_list(args)) return NULL;
 
   obj *value = eval(CAR(args), interpreter);
-  obj *pair = make_pair(CAR(names), value, true);
+  obj *pair = make_pair(CAR(names), value, true, &interpreter->gc);
   gc_add(&interpreter->gc, pair);
   gc_add(&interpreter->gc, CDR(pair));
 
+  gc_push_root(&interpreter->gc, &pair); // keep alive while evaluating the other arguments
   obj* cdr = associate(CDR(names), CDR(args), interpreter);
-  obj *nested_pair = new_list_set(pair, cdr);
+  gc_pop_roots(&interpreter->gc, 1);
+  obj *nested_pair = new_list_set(pair, cdr, &interpreter->gc);
   gc_add(&interpreter->gc, nested_pair);
   return nested_pair;
 }
+
+/**
+ * Function: binds_name
+ * --------------------
+ * Determines whether the frame of a closure binds a name, as a parameter or a captured variable
+ * @param closure: The closure to check the bindings of
+ * @param name: The (interned) atom to look for
+ * @return: True if the closure has a parameter or captured variable with the name
+ */
+static bool binds_name(const obj *closure, const obj *name) {
+  const obj *params = PARAMETERS(closure);
+  for (int i = 0; i < NARGS(closure); i++, params = CDR(params))
+    if (CAR(params) == name) return true;
+
+  for (const obj *captured = CAPTURED(closure); captured != NULL; captured = CDR(captured))
+    if (CAR(captured) != NULL && CAR(CAR(captured)) == name) return true;
+  return false;
+}
@@ -0,0 +1,520 @@
+/*
+ * File: compiler.c
+ * ----------------
+ * Presents the implementation of the compiler from closure bodies to bytecode
+ */
+
+#include <compiler.h>
+#include <primitives.h>
+#include <math-lib.h>
+#include <list.h>
+#include <environment.h>
+#include <stack-trace.h>
+#include <cvector.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * @struct Compiler
+ * @brief State of the compilation of a single closure
+ */
+typedef struct Compiler {
+  const obj *closure;     // The closure being compiled
+  CVector code;           // Units of code emitted so far
+  CVector constants;      // Constants referenced by the code so far
+  int depth;              // Number of values on the stack at the current point in the code
+  int max_depth;          // Largest depth reached
+  bool ok;                // False once something was found that can't be compiled
+} Compiler;
+
+// Static function declarations
+static void compile_expression(Compiler *c, const obj *expr, bool tail);
+static void compile_atom(Compiler *c, const obj *atom);
+static void compile_application(Compiler *c, const obj *expr, bool tail);
+static bool compile_primitive(Compiler *c, const obj *primitive, const obj *args, bool tail);
+static void compile_cond(Compiler *c, const obj *clauses, bool tail);
+static void compile_lambda(Compiler *c, const obj *args);
+static bool valid_parameters(const obj *params);
+static void find_captures(const obj *params, const obj *expr, CVector *names);
+static void compile_predicate(Compiler *c, const obj *predicate, int *jump);
+static void compile_arguments(Compiler *c, const obj *args);
+static const obj *captured_primitive(const Compiler *c, const obj *oper);
+static int parameter_index(const Compiler *c, const obj *atom);
+static void emit(Compiler *c, int unit);
+static void emit_push(Compiler *c, opcode op, int operand);
+static void patch(Compiler *c, int at);
+static int add_constant(Compiler *c, const obj *constant);
+static void adjust_depth(Compiler *c, int delta);
+
+Bytecode *compile_closure(const obj *closure, GarbageCollector *gc) {
+  assert(closure != NULL);
+  if (PROCEDURE(closure) == NULL) return NULL;
+
+  Compiler c;
+  c.closure = closure;
+  c.depth = c.max_depth = NARGS(closure);
+  c.ok = true;
+  if (!cvec_init(&c.code, sizeof(uint16_t), 64, NULL)) return NULL;
+  if (!cvec_init(&c.constants, sizeof(obj*), 8, NULL)) {
+    cvec_dispose(&c.code);
+    return NULL;
+  }
+
+  compile_expression(&c, PROCEDURE(closure), true);
+  emit(&c, OP_RETURN);
+
+  Bytecode *code = NULL;
+  if (c.ok) {
+    int length = cvec_count(&c.code);
+    int num_constants = cvec_count(&c.constants);
+    size_t size = sizeof(Bytecode) + num_constants * sizeof(obj*) + length * sizeof(uint16_t);
+    code = malloc(size);
+    MALLOC_CHECK(code);
+    code->nargs = NARGS(closure);
+    code->max_stack = c.max_depth;
+    code->num_constants = num_constants;
+    code->constants = (obj **) (code + 1);
+    code->length = length;
+    code->code = (uint16_t *) (code->constants + num_constants);
+    if (num_constants > 0) memcpy(code->constants, cvec_nth(&c.constants, 0), num_constants * sizeof(obj*));
+    memcpy(code->code, cvec_nth(&c.code, 0), length * sizeof(uint16_t));
+    gc_add_block(gc, &code->block);
+  }
+
+  cvec_dispose(&c.code);
+  cvec_dispose(&c.constants);
+  return code;
+}
+
+void free_bytecode(Bytecode *code) {
+  if (code == NULL) return;
+  gc_free_block(&code->block);
+}
+
+/**
+ * Function: compile_expression
+ * ----------------------------
+ * Emits code that pushes the value of an expression
+ * @param c: The compiler
+ * @param expr: The expression to compile
+ * @param tail: Whether the expression is in tail position, such that its value is returned
+ */
+static void compile_expression(Compiler *c, const obj *expr, bool tail) {
+  if (expr == NULL) {
+    c->ok = false;
+    return;
+  }
+  if (is_atom(expr)) compile_atom(c, expr);
+  else if (is_list(expr) && !is_nil(expr)) compile_application(c, expr, tail);
+  else emit_push(c, OP_CONST, add_constant(c, expr)); // numbers and the empty list evaluate to themselves
+}
+
+/**
+ * Function: compile_atom
+ * ----------------------
+ * Emits code that pushes the value of a variable. Captured variables are looked up before
+ * parameters, in the same order as the environment that the tree-walking evaluator builds.
+ * @param c: The compiler
+ * @param atom: The name of the variable
+ */
+static void compile_atom(Compiler *c, const obj *atom) {
+  if (is_t(atom)) {
+    emit_push(c, OP_CONST, add_constant(c, atom));
+    return;
+  }
+
+  obj *pair = lookup_pair(atom, CAPTURED(c->closure));
+  if (pair != NULL) {
+    emit_push(c, OP_CONST, add_constant(c, CAR(CDR(pair))));
+    return;
+  }
+
+  int index = parameter_index(c, atom);
+  if (index >= 0) {
+    emit_push(c, OP_ARG, index);
+    return;
+  }
+
+  int k = add_constant(c, atom);
+  add_constant(c, NULL); // cache of the global variable's key-value pair
+  emit_push(c, OP_GLOBAL, k);
+}
+
+/**
+ * Function: compile_application
+ * -----------------------------
+ * Emits code that pushes the result of applying an operator to arguments, with
+ * captured primitives being compiled to instructions where possible. Calls in
+ * tail position replace the current call rather than returning to it.
+ * @param c: The compiler
+ * @param expr: Non-empty list of the operator followed by the arguments
+ * @param tail: Whether the application is in tail position
+ */
+static void compile_application(Compiler *c, const obj *expr, bool tail) {
+  const obj *oper = CAR(expr);
+  const obj *args = CDR(expr);
+
+  const obj *primitive = captured_primitive(c, oper);
+  if (primitive != NULL && compile_primitive(c, primitive, args, tail)) return;
+
+  compile_expression(c, oper, false);
+  compile_arguments(c, args);
+  int nargs = list_length(args);
+  emit(c, tail ? OP_TAIL_CALL : OP_CALL);
+  emit(c, nargs);
+  adjust_depth(c, -nargs);
+}
+
+/**
+ * Function: compile_primitive
+ * ---------------------------
+ * Emits the instructions for a direct application of a primitive
+ * @param c: The compiler
+ * @param primitive: The primitive object being applied
+ * @param args: The (unevaluated) arguments of the application
+ * @param tail: Whether the application is in tail position
+ * @return: True if code was emitted, false if the application should be compiled as a call instead
+ */
+static bool compile_primitive(Compiler *c, const obj *primitive, const obj *args, bool tail) {
+  int nargs = list_length(args);
+
+  math_op op;
+  if (math_primitive_op(PRIMITIVE(primitive), &op)) {
+    const primitive_def *def = PRIMITIVE(primitive);
+    if (nargs < def->min_args || (def->max_args != VARIADIC && nargs > def->max_args)) return c->ok = false;
+    if (nargs < 2 || (op >= math_equal && nargs > 2)) return false; // as are chained comparisons
+
+    // Arithmetic on more than two arguments is applied to each in turn, from left to right
+    compile_expression(c, CAR(args), false);
+    FOR_LIST(CDR(args), arg) {
+      compile_expression(c, arg, false);
+      if (op == math_add) emit(c, OP_ADD);
+      else if (op == math_sub) emit(c, OP_SUB);
+      else if (op == math_mul) emit(c, OP_MUL);
+      else {
+        emit(c, OP_MATH);
+        emit(c, op);
+      }
+      adjust_depth(c, -1);
+    }
+    return true;
+  }
+
+  atom_t name = PRIMITIVE(primitive)->name;
+
+  if (strcmp(name, "quote") == 0) {
+    if (nargs != 1) return c->ok = false;
+    emit_push(c, OP_CONST, add_constant(c, CAR(args)));
+  } else if (strcmp(name, "cond") == 0) {
+    compile_cond(c, args, tail);
+  } else if (strcmp(name, "lambda") == 0) {
+    if (nargs != 2 || !valid_parameters(CAR(args))) return c->ok = false; // left for lambda to report
+    compile_lambda(c, args);
+  } else if (strcmp(name, "car") == 0 || strcmp(name, "cdr") == 0 || strcmp(name, "atom") == 0) {
+    if (nargs != 1) return c->ok = false;
+    compile_arguments(c, args);
+    emit(c, name[0] == 'a' ? OP_ATOM : name[1] == 'a' ? OP_CAR : OP_CDR);
+  } else if (strcmp(name, "cons") == 0 || strcmp(name, "eq") == 0) {
+    if (nargs != 2) return c->ok = false;
+    compile_arguments(c, args);
+    emit(c, name[0] == 'c' ? OP_CONS : OP_EQ);
+    adjust_depth(c, -1);
+  } else {
+    return c->ok = false; // set, env and defmacro depend on the environment that they are evaluated in
+  }
+  return true;
+}
+
+/**
+ * Function: compile_cond
+ * ----------------------
+ * Emits the code for a cond as a chain of conditional jumps. Each predicate that does not
+ * hold jumps over its expression to the next clause, and each expression jumps to the end
+ * once evaluated. The value is the empty list if no predicate holds.
+ * @param c: The compiler
+ * @param clauses: The list of (predicate expression) clauses
+ * @param tail: Whether the cond is in tail position, and therefore so are its expressions
+ */
+static void compile_cond(Compiler *c, const obj *clauses, bool tail) {
+  CVector ends; // locations of the jumps to the end of the cond
+  if (!cvec_init(&ends, sizeof(int), 8, NULL)) {
+    c->ok = false;
+    return;
+  }
+
+  int depth = c->depth;
+  bool exhaustive = false; // whether some predicate always holds
+  FOR_LIST(clauses, clause) {
+    if (!is_list(clause) || is_nil(clause) || list_length(clause) != 2) {
+      c->ok = false; // left for cond to report
+      break;
+    }
+
+    int next;
+    compile_predicate(c, CAR(clause), &next);
+    compile_expression(c, CAR(CDR(clause)), tail);
+    if (next < 0) {
+      exhaustive = true;
+      break;
+    }
+
+    emit(c, OP_JUMP);
+    int end = cvec_count(&c->code);
+    emit(c, 0);
+    cvec_append(&ends, &end);
+    patch(c, next);
+    c->depth = depth;
+  }
+
+  if (!exhaustive) {
+    emit(c, OP_NIL);
+    adjust_depth(c, 1);
+  }
+
+  void *el;
+  for_vector(&ends, el)
+    patch(c, *(int *) el);
+  cvec_dispose(&ends);
+}
+
+/**
+ * Function: compile_lambda
+ * ------------------------
+ * Emits the code that creates a closure from a lambda expression. The lambda primitive would
+ * look up every name in the body of the lambda, in the environment, each time that the closure
+ * is created. Here they are resolved once instead, to the address that each captured value
+ * will be found at: an argument of the enclosing call, a value captured by the enclosing
+ * closure, or a global variable.
+ * @param c: The compiler
+ * @param args: The arguments of the lambda expression: the parameters and the body
+ */
+static void compile_lambda(Compiler *c, const obj *args) {
+  CVector names;
+  if (!cvec_init(&names, sizeof(obj*), 8, NULL)) {
+    c->ok = false;
+    return;
+  }
+  find_captures(CAR(args), CAR(CDR(args)), &names);
+
+  emit(c, OP_LAMBDA);
+  emit(c, add_constant(c, args));
+  emit(c, cvec_count(&names));
+
+  void *el;
+  for_vector(&names, el) {
+    const obj *atom = *(obj **) el;
+    int index;
+    obj *pair = lookup_pair(atom, CAPTURED(c->closure));
+    if (pair != NULL) {
+      emit(c, CAPTURE_CONSTANT);
+      emit(c, add_constant(c, CAR(CDR(pair))));
+    } else if ((index = parameter_index(c, atom)) >= 0) {
+      emit(c, CAPTURE_ARGUMENT);
+      emit(c, index);
+    } else {
+      emit(c, CAPTURE_GLOBAL);
+      emit(c, add_constant(c, NULL)); // cache of the global variable's key-value pair
+    }
+    emit(c, add_constant(c, atom));
+  }
+  adjust_depth(c, 1);
+  cvec_dispose(&names);
+}
+
+/**
+ * Function: valid_parameters
+ * --------------------------
+ * Determines if the parameters of a lambda expression are ones that the lambda primitive accepts
+ * @param params: The parameters of the lambda expression
+ * @return: True if the parameters are a list of atoms other than the truth atom, false otherwise
+ */
+static bool valid_parameters(const obj *params) {
+  if (!is_list(params)) return false;
+  FOR_LIST(params, var) {
+    if (var == NULL) continue;
+    if (is_t(var) || !is_atom(var)) return false;
+  }
+  return true;
+}
+
+/**
+ * Function: find_captures
+ * -----------------------
+ * Finds the names that a lambda would capture: each distinct atom in its body that isn't
+ * one of its parameters, in the order that the lambda primitive would find them
+ * @param params: Parameters of the lambda
+ * @param expr: Body of the lambda, or a part of it
+ * @param names: Vector of the names found so far, to append the names found in expr to
+ */
+static void find_captures(const obj *params, const obj *expr, CVector *names) {
+  if (expr == NULL) return;
+  if (is_atom(expr)) {
+    if (list_contains(params, expr)) return;
+    void *el;
+    for_vector(names, el)
+      if (*(obj **) el == expr) return; // atoms are interned
+    cvec_append(names, &expr);
+  } else if (is_list(expr)) {
+    find_captures(params, CAR(expr), names);
+    find_captures(params, CDR(expr), names);
+  }
+}
+
+/**
+ * Function: compile_predicate
+ * ---------------------------
+ * Emits the code that tests the predicate of a cond clause, jumping to a location yet to be
+ * patched if it does not hold. Numeric comparisons and eq are fused with the jump, so that
+ * they don't have to produce the truth atom or a new empty list only to test it.
+ * @param c: The compiler
+ * @param predicate: The predicate expression
+ * @param jump: Location to write the location of the jump's target to, or -1 if the predicate
+ * always holds and there is no jump
+ */
+static void compile_predicate(Compiler *c, const obj *predicate, int *jump) {
+  if (is_t(predicate)) {
+    *jump = -1;
+    return;
+  }
+
+  const obj *primitive = NULL;
+  if (is_list(predicate) && !is_nil(predicate) && list_length(CDR(predicate)) == 2)
+    primitive = captured_primitive(c, CAR(predicate));
+
+  math_op op;
+  if (primitive != NULL && math_primitive_op(PRIMITIVE(primitive), &op) && op >= math_equal) {
+    compile_arguments(c, CDR(predicate));
+    emit(c, OP_JUMP_UNLESS_COMPARE);
+    emit(c, op);
+    adjust_depth(c, -2);
+  } else if (primitive != NULL && strcmp(PRIMITIVE(primitive)->name, "eq") == 0) {
+    compile_arguments(c, CDR(predicate));
+    emit(c, OP_JUMP_UNLESS_EQ);
+    adjust_depth(c, -2);
+  } else {
+    compile_expression(c, predicate, false);
+    emit(c, OP_JUMP_IF_NIL);
+    adjust_depth(c, -1);
+  }
+  *jump = cvec_count(&c->code);
+  emit(c, 0);
+}
+
+/**
+ * Function: compile_arguments
+ * ---------------------------
+ * Emits code that pushes the value of each argument in a list, in order
+ * @param c: The compiler
+ * @param args: List of argument expressions
+ */
+static void compile_arguments(Compiler *c, const obj *args) {
+  FOR_LIST(args, arg)
+    compile_expression(c, arg, false);
+}
+
+/**
+ * Function: captured_primitive
+ * ----------------------------
+ * Determines if an operator is the name of a captured primitive, such that the application
+ * of the operator can be compiled to instructions
+ * @param c: The compiler
+ * @param oper: The operator of an application
+ * @return: The captured primitive object, or NULL if the operator is anything else
+ */
+static const obj *captured_primitive(const Compiler *c, const obj *oper) {
+  if (!is_atom(oper)) return NULL;
+  obj *pair = lookup_pair(oper, CAPTURED(c->closure));
+  if (pair == NULL) return NULL;
+  obj *value = CAR(CDR(pair));
+  return is_primitive(value) ? value : NULL;
+}
+
+/**
+ * Function: parameter_index
+ * -------------------------
+ * Finds the position of a name in the parameters of the closure being compiled
+ * @param c: The compiler
+ * @param atom: The name to look for
+ * @return: The index of the first parameter with that name, or -1 if there is none
+ */
+static int parameter_index(const Compiler *c, const obj *atom) {
+  const obj *params = PARAMETERS(c->closure);
+  for (int i = 0; i < NARGS(c->closure); i++, params = CDR(params))
+    if (CAR(params) == atom) return i; // atoms are interned
+  return -1;
+}
+
+/**
+ * Function: emit
+ * --------------
+ * Appends a unit of code, failing the compilation if the code gets too long
+ * @param c: The compiler
+ * @param unit: The opcode or operand to append
+ */
+static void emit(Compiler *c, int unit) {
+  if (unit > BYTECODE_MAX_LENGTH || cvec_count(&c->code) >= BYTECODE_MAX_LENGTH) {
+    c->ok = false;
+    return;
+  }
+  uint16_t u = (uint16_t) unit;
+  cvec_append(&c->code, &u);
+}
+
+/**
+ * Function: emit_push
+ * -------------------
+ * Appends an instruction with a single operand that pushes a value
+ * @param c: The compiler
+ * @param op: The opcode of the instruction
+ * @param operand: The operand of the instruction
+ */
+static void emit_push(Compiler *c, opcode op, int operand) {
+  emit(c, op);
+  emit(c, operand);
+  adjust_depth(c, 1);
+}
+
+/**
+ * Function: patch
+ * ---------------
+ * Sets the target of a jump to the current end of the code
+ * @param c: The compiler
+ * @param at: Location of the jump's target operand
+ */
+static void patch(Compiler *c, int at) {
+  if (!c->ok) return;
+  uint16_t target = (uint16_t) cvec_count(&c->code);
+  cvec_replace(&c->code, &target, at);
+}
+
+/**
+ * Function: add_constant
+ * ----------------------
+ * Adds an object to the constants of the code
+ * @param c: The compiler
+ * @param constant: The object to add
+ * @return: The index of the constant
+ */
+static int add_constant(Compiler *c, const obj *constant) {
+  int k = cvec_count(&c->constants);
+  if (k >= BYTECODE_MAX_LENGTH) {
+    c->ok = false;
+    return 0;
+  }
+  cvec_append(&c->constants, &constant);
+  return k;
+}
+
+/**
+ * Function: adjust_depth
+ * ----------------------
+ * Records the change in the number of values on the stack made by the code just emitted
+ * @param c: The compiler
+ * @param delta: The number of values pushed, or minus the number popped
+ */
+static void adjust_depth(Compiler *c, int delta) {
+  c->depth += delta;
+  if (c->depth > c->max_depth) c->max_depth = c->depth;
+}
@@ -8,49 +8,127 @@
 #include <lisp-objects.h>
 #include <list.h>
 #include <math-lib.h>
+#include <vector-lib.h>
+#include <hashtable-lib.h>
 #include <parser.h>
 #include <string.h>
+#include <assert.h>
 
 // Static function declarations
 static bool pair_matches_key(const obj *pair, const obj *key);
+static obj **find_entry(const obj *key, const LispInterpreter *interpreter, obj **holder, GarbageCollector *gc);
+static obj **argument_entry(const obj *frame, const obj *key);
+static obj **vm_argument_entry(const VMFrame *frame, const obj *key, bool captured, obj **pair);
+static obj *unshare_captured(obj *frame, obj *pair, GarbageCollector *gc);
+static CMap *new_global_index(const obj *global_env);
 
-obj* init_env() {
-  obj* prim_env = get_primitive_library();
-  obj* math_env = get_math_library();
-  obj* env = join_lists(math_env, prim_env);
+obj* init_env(SymbolTable *symbols, GarbageCollector *gc) {
+  obj* prim_env = get_primitive_library(symbols, gc);
+  obj* math_env = get_math_library(symbols, gc);
+  obj* vector_env = get_vector_library(symbols, gc);
+  obj* hashtable_env = get_hashtable_library(symbols, gc);
+  obj* env = join_lists(math_env, join_lists(vector_env, join_lists(hashtable_env, prim_env, gc), gc), gc);
   return env;
 }
 
-obj* create_environment(atom_t const *primitive_names, primitive_t const *primitive_list) {
-  if (primitive_names[0] == NULL || primitive_list[0] == NULL) return NULL;
+obj* create_environment(const primitive_def *primitives, SymbolTable *symbols, GarbageCollector *gc) {
+  if (primitives->name == NULL) return NULL;
 
-  obj* key = new_atom(primitive_names[0]);
-  obj* value = new_primitive(primitive_list[0]);
-  obj* pair = make_pair(key, value, false);
+  obj* key = intern(symbols, primitives->name);
+  obj* value = new_primitive(primitives, gc);
+  obj* pair = make_pair(key, value, false, gc);
 
-  obj* cdr = create_environment(primitive_names + 1, primitive_list + 1);
-  return new_list_set(pair, cdr);
+  obj* cdr = create_environment(primitives + 1, symbols, gc);
+  return new_list_set(pair, cdr, gc);
 }
 
-obj *make_pair(obj *key, obj *value, bool copy) {
+obj *make_pair(obj *key, obj *value, bool copy, GarbageCollector *gc) {
   if (copy) {
-    obj *second = new_list_set(value, NULL);
-    return new_list_set(key, second);
+    obj *second = new_list_set(value, NULL, gc);
+    return new_list_set(key, second, gc);
   } else {
-    obj* second = new_list_set(value, NULL);
-    return new_list_set(key, second);
+    obj* second = new_list_set(value, NULL, gc);
+    return new_list_set(key, second, gc);
   }
 }
 
-obj* lookup(const obj* o, const obj* env) {
-  obj** entry = lookup_entry(o, env);
+bool index_environment(LispInterpreter *interpreter) {
+  assert(interpreter != NULL);
+  interpreter->global_env = interpreter->env;
+  interpreter->global_index = new_global_index(interpreter->global_env);
+  return interpreter->global_index != NULL;
+}
+
+bool define_global(obj *pair, LispInterpreter *interpreter) {
+  assert(pair != NULL);
+  assert(interpreter != NULL);
+  assert(interpreter->global_env != NULL);
+
+  obj *head = interpreter->global_env;
+  obj *link = new_list_set(pair, CDR(head), &interpreter->gc);
+  if (link == NULL) return false;
+
+  obj *symbol = CAR(pair);
+  if (cmap_insert(interpreter->global_index, &symbol, &pair) == NULL) {
+    dispose(link);
+    return false;
+  }
+  CDR(head) = link;
+  gc_write_barrier(&interpreter->gc, head); // the value may be younger than the environment
+  return true;
+}
+
+obj* lookup(const obj* o, const LispInterpreter *interpreter) {
+  obj** entry = lookup_entry(o, interpreter, NULL);
   return entry ? *entry : NULL;
 }
 
-obj** lookup_entry(const obj* key, const obj* env) {
-  obj* pair = lookup_pair(key, env);
-  if (pair == NULL) return NULL;
-  return & CAR(CDR(pair));
+obj** lookup_entry(const obj* key, const LispInterpreter *interpreter, obj **holder) {
+  return find_entry(key, interpreter, holder, NULL);
+}
+
+obj** lookup_set_entry(const obj* key, LispInterpreter *interpreter, obj **holder) {
+  return find_entry(key, interpreter, holder, &interpreter->gc);
+}
+
+obj *lookup_global(const obj *key, const LispInterpreter *interpreter) {
+  if (interpreter->global_index == NULL) return NULL;
+  obj **pairp = cmap_lookup(interpreter->global_index, &key);
+  return pairp == NULL ? NULL : *pairp;
+}
+
+obj *environment_list(LispInterpreter *interpreter) {
+  obj *list = NULL;
+  obj **tail = &list;
+  const obj *env = interpreter->env;
+  for (; env != NULL && env != interpreter->global_env; env = CDR(env)) {
+    obj *binding = CAR(env);
+    if (!is_frame(binding)) {
+      *tail = new_list_set(binding, NULL, &interpreter->gc);
+      gc_add(&interpreter->gc, *tail);
+      tail = &CDR(*tail);
+      continue;
+    }
+
+    FOR_LIST(FRAME_CAPTURED(binding), pair) {
+      if (pair == NULL) continue;
+      *tail = new_list_set(pair, NULL, &interpreter->gc);
+      gc_add(&interpreter->gc, *tail);
+      tail = &CDR(*tail);
+    }
+    const obj *closure = FRAME_CLOSURE(binding);
+    const obj *params = PARAMETERS(closure);
+    for (int i = 0; i < NARGS(closure); i++, params = CDR(params)) {
+      obj *pair = make_pair(CAR(params), FRAME_VALUES(binding)[i], false, &interpreter->gc);
+      *tail = new_list_set(pair, NULL, &interpreter->gc);
+      gc_add(&interpreter->gc, CDR(pair));
+      gc_add(&interpreter->gc, pair);
+      gc_add(&interpreter->gc, *tail);
+      tail = &CDR(*tail);
+    }
+  }
+  *tail = (obj*) env;
+  return list;
 }
 
 obj* lookup_pair(const obj* key, const obj* env) {
@@ -71,6 +149,156 @@ obj* lookup_pair(const obj* key, const obj* env) {
  * @return: True if the key in the pair is equal to the specified key
  */
 static bool pair_matches_key(const obj *pair, const obj *key) {
-  obj* pair_key = ith(pair, 0);
-  return compare(pair_key, key);
+  return CAR(pair) == key; // keys are interned atoms
+}
+
+/**
+ * Function: find_entry
+ * --------------------
+ * Looks up a key in the interpreter's environment: in each local frame of the environment
+ * (searching the captured variables of an activation frame before its arguments), and then
+ * in the global index
+ * @param key: The key to search for in the environment
+ * @param interpreter: Interpreter whose environment to search for the key in
+ * @param holder: Where to store the object that holds the value, may be NULL
+ * @param gc: If not NULL, a captured variable that is found is first copied (from this garbage
+ * collector) if it is shared with the closure that captured it, so that its value may be replaced
+ * @return: A pointer to the obj* inside the environment holding the value, or NULL if the key was not found
+ */
+static obj **find_entry(const obj *key, const LispInterpreter *interpreter, obj **holder, GarbageCollector *gc) {
+  if (key == NULL || !is_atom(key)) return NULL;
+
+  // Local frames are chained onto the head of the global environment. The arguments of calls
+  // to compiled closures are on the VM's stack instead: each call is searched after the frames
+  // made since it began, and before the frames that it was made in.
+  obj* pair = NULL;
+  const obj* env = interpreter->env;
+  const VM *vm = &interpreter->vm;
+  for (int i = vm->num_frames; i >= 0 && pair == NULL; i--) {
+    const obj *below = i > 0 ? vm->frames[i - 1].env : interpreter->global_env;
+    for (; env != NULL && env != below && env != interpreter->global_env; env = CDR(env)) {
+      obj* binding = CAR(env);
+      if (!is_frame(binding)) {
+        if (pair_matches_key(binding, key)) {
+          pair = binding;
+          break;
+        }
+        continue;
+      }
+
+      if ((pair = lookup_pair(key, FRAME_CAPTURED(binding))) != NULL) {
+        if (gc != NULL) pair = unshare_captured(binding, pair, gc);
+        break;
+      }
+      obj** value = argument_entry(binding, key);
+      if (value != NULL) {
+        if (holder != NULL) *holder = binding;
+        return value;
+      }
+    }
+    if (pair != NULL || i == 0) break;
+
+    obj **value = vm_argument_entry(&vm->frames[i - 1], key, gc == NULL, &pair);
+    if (value != NULL) {
+      if (holder != NULL) *holder = NULL; // the stack is a root, so needs no write barrier
+      return value;
+    }
+  }
+
+  if (pair == NULL && (pair = lookup_global(key, interpreter)) == NULL) return NULL;
+  if (holder != NULL) *holder = CDR(pair);
+  return & CAR(CDR(pair));
+}
+
+/**
+ * Function: vm_argument_entry
+ * ---------------------------
+ * Finds a variable bound by a call to a compiled closure that is in progress
+ * @param frame: The VM's frame of the call
+ * @param key: The name of the variable (an interned atom)
+ * @param captured: Whether to look at the closure's captured variables as well as its arguments.
+ * These are shared by every call to the closure, so they are only read, and never set, through a call.
+ * @param pair: Set to the captured key-value pair if the variable is a captured variable
+ * @return: A pointer to the value of the argument with that name on the stack, or NULL if it is
+ * not an argument (pair is set if it is a captured variable)
+ */
+static obj **vm_argument_entry(const VMFrame *frame, const obj *key, bool captured, obj **pair) {
+  const obj *closure = frame->base[-1];
+  const obj *params = PARAMETERS(closure);
+  for (int i = 0; i < NARGS(closure); i++, params = CDR(params))
+    if (CAR(params) == key) return &frame->base[i];
+  if (captured) *pair = lookup_pair(key, CAPTURED(closure));
+  return NULL;
+}
+
+/**
+ * Function: argument_entry
+ * ------------------------
+ * Finds the value of the argument with a given name in an activation frame
+ * @param frame: The frame to look for the argument in
+ * @param key: The name of the argument (an interned atom)
+ * @return: A pointer to the value of the first argument with that name, or NULL if there is none
+ */
+static obj **argument_entry(const obj *frame, const obj *key) {
+  const obj *closure = FRAME_CLOSURE(frame);
+  const obj *params = PARAMETERS(closure);
+  for (int i = 0; i < NARGS(closure); i++, params = CDR(params))
+    if (CAR(params) == key) return &FRAME_VALUES(frame)[i];
+  return NULL;
+}
+
+/**
+ * Function: unshare_captured
+ * --------------------------
+ * Makes a captured variable of an activation frame private to the frame (copy on write), if
+ * it is still shared with the closure. The frame gets its own list of captured variables, in
+ * which the variable's key-value pair is replaced by a new one. The other pairs are still shared.
+ * @param frame: The activation frame
+ * @param pair: The first pair in the frame's captured variables with the variable's key
+ * @param gc: Garbage collector to allocate the new list and pair from
+ * @return: The pair holding the variable that is private to the frame
+ */
+static obj *unshare_captured(obj *frame, obj *pair, GarbageCollector *gc) {
+  const obj *key = CAR(pair);
+  if (lookup_pair(key, CAPTURED(FRAME_CLOSURE(frame))) != pair) return pair; // already private
+
+  obj *private_pair = make_pair(CAR(pair), CAR(CDR(pair)), false, gc);
+  gc_add(gc, CDR(private_pair));
+  gc_add(gc, private_pair);
+
+  obj *captured = NULL;
+  obj **tail = &captured;
+  FOR_LIST(FRAME_CAPTURED(frame), captured_pair) {
+    *tail = new_list_set(captured_pair == pair ? private_pair : captured_pair, NULL, gc);
+    gc_add(gc, *tail);
+    tail = &CDR(*tail);
+  }
+  FRAME_CAPTURED(frame) = captured;
+  gc_write_barrier(gc, frame);
+  return private_pair;
+}
+
+/**
+ * Function: new_global_index
+ * --------------------------
+ * Creates a hash index from variable (interned atom) to key-value pair for each pair in a global environment
+ * @param global_env: The global environment to index
+ * @return: A new index of the global environment, or NULL on allocation failure
+ */
+static CMap *new_global_index(const obj *global_env) {
+  CMap *index = cmap_create(sizeof(obj*), sizeof(obj*), fast_hash, NULL, NULL, NULL, 0);
+  if (index == NULL) return NULL;
+  if (!cmap_reserve(index, (unsigned int) list_length(global_env))) {
+    cmap_dispose(index);
+    return NULL;
+  }
+
+  FOR_LIST(global_env, pair) {
+    obj *symbol = CAR(pair);
+    if (cmap_insert(index, &symbol, &pair) == NULL) {
+      cmap_dispose(index);
+      return NULL;
+    }
+  }
+  return index;
 }
@@ -9,71 +9,139 @@
 #include <environment.h>
 #include <stack-trace.h>
 #include <string.h>
+#include <stdlib.h>
 #include <lisp-objects.h>
 #include <closure.h>
 #include <garbage-collector.h>
 #include <interpreter.h>
+#include <primitives.h>
+#include <vm.h>
 
 // Static function declarations
-static obj *bind(obj *params, const obj *args, LispInterpreter *interpreter);
+static obj *closure_environment(const obj *function, const obj *args, obj *env, LispInterpreter *interpreter);
+static obj *bind_applied_values(const obj *function, GarbageCollector *gc);
 
 obj *eval(const obj *o, LispInterpreter *interpreter) {
-  if (o == NULL) return NULL;
-
-  // Atom type means its just a literal that needs to be looked up
-  if (is_atom(o)) {
-    if (is_t(o)) return (obj*) o;
-    obj* value = lookup(o, interpreter->env);
-    if (value == NULL) {
-      LOG_ERROR("Variable: \"%s\" not found in environment", ATOM(o));
-      return NULL;
+  // Closures and conds applied in tail position are evaluated by this loop rather than by
+  // recursion, so that the C stack does not grow with each iteration of a recursive loop.
+  // Variables are scoped dynamically, so the frame of a tail-called closure is built onto its
+  // caller's environment. The caller's frame is dropped only when doing so can't change the value
+  // of any name (as when a closure calls itself), so that tail recursion runs in constant memory.
+  obj *env = interpreter->env;      // environment that eval was called in, restored on return
+  obj *closure = NULL;              // closure whose body is being evaluated in tail position
+  obj *callee = NULL;               // closure (or partial application) that is about to replace it
+  obj *frame_env = NULL;            // environment that the body of closure is being evaluated in
+  obj *frame_base = NULL;           // environment that the frame of closure was built onto
+  bool tail_called = false;         // whether the roots above have been pushed
+  obj *result = NULL;
+
+  while (o != NULL) {
+    // Atom type means its just a literal that needs to be looked up
+    if (is_atom(o)) {
+      if (is_t(o)) result = (obj*) o;
+      else if ((result = lookup(o, interpreter)) == NULL)
+        LOG_ERROR("Variable: \"%s\" not found in environment", ATOM(o));
+      break;
     }
-    return value;
-  }
 
-  // Numbers, primitives and closures evaluate to themselves
-  if (is_number(o) || is_primitive(o) || is_closure(o)) return (obj*) o;
+    // Numbers, primitives, closures, partial applications, vectors and hash tables evaluate to themselves
+    if (is_number(o) || is_primitive(o) || is_closure(o) || is_partial(o) || is_mutable(o)) {
+      result = (obj*) o;
+      break;
+    }
 
-  // List type means its a operator being applied to operands which means evaluate
-  // the operator (return a procedure or a primitive) to which we call apply on the arguments
-  if (is_list(o)) {
-    if (is_nil(o)) return (obj*) o;                     // Empty list evaluates to itself
+    // List type means its a operator being applied to operands which means evaluate
+    // the operator (return a procedure or a primitive) to which we call apply on the arguments
+    if (!is_list(o)) {
+      LOG_ERROR("Object of unknown type");
+      break;
+    }
+    if (is_nil(o)) {                                    // Empty list evaluates to itself
+      result = (obj*) o;
+      break;
+    }
+
+    // Safe point: everything in use is reachable from the environment or the root stack
+    maybe_collect_garbage(&interpreter->gc, interpreter->env);
 
     obj* oper = eval(CAR(o), interpreter);
-    return apply(oper, CDR(o), interpreter);
+    const obj *args = CDR(o);
+
+    if (is_cond(oper)) {
+      o = cond_expression(args, interpreter);
+      continue;
+    }
+
+    const obj *applied = applied_closure(oper);
+    bool compiled = applied != NULL && CODE(applied) != NULL && interpreter->vm.enabled;
+    if (applied == NULL || compiled || list_length(args) != remaining_params(oper)) {
+      result = apply(oper, args, interpreter);
+      break;
+    }
+
+    // Tail call: evaluate the body of the closure in place of the current expression
+    if (!tail_called) {
+      gc_push_root(&interpreter->gc, &env);
+      gc_push_root(&interpreter->gc, &closure);
+      gc_push_root(&interpreter->gc, &callee);
+      gc_push_root(&interpreter->gc, &frame_env);
+      gc_push_root(&interpreter->gc, &frame_base);
+      tail_called = true;
+    }
+    callee = oper;
+    bool replaces_frame = false;
+    if (closure != NULL && interpreter->env == frame_env) {
+      interpreter->env = frame_base; // what would be found with the caller's frame dropped
+      replaces_frame = closure_hides(applied, closure, interpreter);
+      interpreter->env = frame_env;
+    }
+    if (!replaces_frame) frame_base = interpreter->env;
+    interpreter->env = frame_env = closure_environment(callee, args, frame_base, interpreter);
+    closure = (obj*) applied;
+    o = PROCEDURE(closure);
   }
-  LOG_ERROR("Object of unknown type");
-  return NULL;
+
+  if (tail_called) {
+    interpreter->env = env;
+    gc_pop_roots(&interpreter->gc, 5);
+  }
+  return result;
 }
 
 obj *apply(const obj *oper, const obj *args, LispInterpreter *interpreter) {
   if (oper == NULL) return NULL;
 
   if (is_primitive(oper)) {
-    primitive_t f = *PRIMITIVE(oper);
-    return f(args, interpreter);
+    const primitive_def *primitive = PRIMITIVE(oper);
+    if (primitive->special != NULL) return primitive->special(args, interpreter);
+    return vm_apply_primitive(primitive, args, interpreter);
   }
 
-  if (is_closure(oper)) {
-    if (!CHECK_NARGS_MAX(args, NARGS(oper))) return NULL;
+  const obj *closure = applied_closure(oper);
+  if (closure != NULL) {
+    int nargs = remaining_params(oper);
+    if (!CHECK_NARGS_MAX(args, nargs)) return NULL;
 
-    // Partial closure application
-    if (list_length(args) < NARGS(oper))
-      return closure_partial_application(oper, args, interpreter);
+    // Compiled closures are run by the VM when applied to all of their arguments
+    if (CODE(closure) != NULL && interpreter->vm.enabled && list_length(args) == nargs)
+      return vm_apply(oper, args, interpreter);
 
-    // The result of a closure application is the evaluation of the body of the closure in an environment
-    // containing the captured variables from the closure, along with the values of the arguments
-    // bound to the parameters of the closure.
+    // The closure may be a temporary object, so it must be kept alive until it returns
+    gc_push_root(&interpreter->gc, (obj **) &oper);
 
-    obj* tmp_env = bind(PARAMETERS(oper), args, interpreter); // Bind the parameters to the arguments
-    obj* capture_copy = copy_recursive(CAPTURED(oper));
-    gc_add_recursive(&interpreter->gc, capture_copy);
-    obj* new_env = join_lists(capture_copy, tmp_env); // Prepend the captured list to the environment
+    // Partial closure application
+    if (list_length(args) < nargs) {
+      obj* partial = closure_partial_application(oper, args, interpreter);
+      gc_pop_roots(&interpreter->gc, 1);
+      return partial;
+    }
 
     obj* old_env = interpreter->env; // gotta keep one around in case points is modified in eval
-    interpreter->env = new_env;
-    obj* result = eval(PROCEDURE(oper), interpreter); // Evaluate body in prepended environment
+    gc_push_root(&interpreter->gc, &old_env);
+    interpreter->env = closure_environment(oper, args, old_env, interpreter);
+    obj* result = eval(PROCEDURE(closure), interpreter); // Evaluate body in prepended environment
     interpreter->env = old_env;
+    gc_pop_roots(&interpreter->gc, 2);
 
     return result;
   }
@@ -87,15 +155,75 @@ obj *apply(const obj *oper, const obj *args, LispInterpreter *interpreter) {
 }
 
 /**
- * Function: bind
- * --------------
- * binds a list of arguments to parameters and prepends them on to an environment
- * @param params: List of parameters
- * @param args: List of arguments to bind to the parameters
- * @param envp: Environment to prepend the bound arguments to
- * @return: Environment now with bound arguments appended
+ * Function: closure_environment
+ * -----------------------------
+ * Creates the environment that the body of a closure is evaluated in: an activation frame
+ * holding the closure's captured variables (shared with the closure) and the values of the
+ * arguments, prepended onto an environment. The arguments are evaluated in the current environment,
+ * after the values already applied if the function is a partial application.
+ * @param function: The closure, or partial application of a closure, being applied to all of its arguments
+ * @param args: List of (unevaluated) arguments to bind to the remaining parameters
+ * @param env: Environment to prepend the bindings to
+ * @param interpreter: The interpreter to evaluate the arguments in
+ * @return: Environment now with the captured variables and bound arguments prepended
  */
-static obj *bind(obj *params, const obj *args, LispInterpreter *interpreter) {
-  obj* frame = associate(params, args, interpreter);
-  return join_lists(frame, interpreter->env);
+static obj *closure_environment(const obj *function, const obj *args, obj *env, LispInterpreter *interpreter) {
+  GarbageCollector *gc = &interpreter->gc;
+  const obj *closure = applied_closure(function);
+  obj* frame = new_frame(closure, gc);
+  if (frame == NULL) {
+    // Too many parameters for a frame: bind them, and a copy of the captured variables, in a list
+    obj* remaining = sublist(PARAMETERS(closure), NARGS(closure) - remaining_params(function));
+    obj* pairs = associate(remaining, args, interpreter);
+    pairs = join_lists(bind_applied_values(function, gc), pairs, gc);
+    obj* capture_copy = copy_recursive(CAPTURED(closure), gc);
+    gc_add_recursive(gc, capture_copy);
+    return join_lists(capture_copy, join_lists(pairs, env, gc), gc);
+  }
+
+  gc_add(gc, frame);
+  gc_push_root(gc, &frame); // keep alive while evaluating the arguments
+  obj** value = partial_values(function, FRAME_VALUES(frame));
+  FOR_LIST(args, arg) {
+    if (arg == NULL) break; // no arguments
+    *value++ = eval(arg, interpreter);
+    gc_write_barrier(gc, frame); // a collection while evaluating may have promoted the frame
+  }
+  gc_pop_roots(gc, 1);
+
+  obj* bound = new_list_set(frame, env, gc);
+  gc_add(gc, bound);
+  return bound;
+}
+
+/**
+ * Function: bind_applied_values
+ * -----------------------------
+ * Binds the values applied by a partial application to the parameters that they were applied to
+ * @param function: A closure, or partial application of a closure
+ * @param gc: Garbage collector to allocate the bindings from
+ * @return: A list of key-value pairs, one for each value applied, or NULL if there are none
+ */
+static obj *bind_applied_values(const obj *function, GarbageCollector *gc) {
+  const obj *closure = applied_closure(function);
+  int num_values = NARGS(closure) - remaining_params(function);
+  if (num_values == 0) return NULL;
+
+  obj **values = malloc(num_values * sizeof(obj*));
+  MALLOC_CHECK(values);
+  partial_values(function, values);
+
+  obj *pairs = NULL;
+  obj **tail = &pairs;
+  const obj *params = PARAMETERS(closure);
+  for (int i = 0; i < num_values; i++, params = CDR(params)) {
+    obj *pair = make_pair(CAR(params), values[i], false, gc);
+    gc_add(gc, pair);
+    gc_add(gc, CDR(pair));
+    *tail = new_list_set(pair, NULL, gc);
+    gc_add(gc, *tail);
+    tail = &CDR(*tail);
+  }
+  free(values);
+  return pairs;
 }
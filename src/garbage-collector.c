@@ -8,10 +8,39 @@
 #include <lisp-objects.h>
 #include <garbage-collector.h>
 #include <interpreter.h>
+#include <stack-trace.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <time.h>
 
+// Number of young objects at which a minor collection is done during evaluation
+#define GC_NURSERY_SIZE 4096
+
+// Minimum number of old objects at which a major collection is done during evaluation
+#define GC_MIN_TENURED_THRESHOLD 16384
+
+// Number of objects popped from the mark stack ahead of being visited, so that they can be prefetched
+#define GC_PREFETCH_DISTANCE 8
+
+#if defined(__GNUC__)
+#define PREFETCH(p) __builtin_prefetch(p, 1)
+#else
+#define PREFETCH(p) ((void) (p))
+#endif
+
+// Static function declarations
+static void collect_young(GarbageCollector *gc, obj *env);
+static void mark_roots(GarbageCollector *gc, obj *env);
+static void mark(MarkStack *stack);
+static void visit(MarkStack *stack, obj *o);
+static void push_children(MarkStack *stack, const obj *o);
+static void push_entries(MarkStack *stack, const CMap *map);
+static inline void mark_stack_push(MarkStack *stack, obj *o);
+static inline bool is_heap_object(const obj *o);
+static void promote_survivors(GarbageCollector *gc);
+static void record_pause(GarbageCollector *gc, const struct timespec *start);
 static void obj_cleanup(obj** op);
 
 GarbageCollector *new_gc() {
@@ -28,68 +57,382 @@ GarbageCollector *new_gc() {
 bool gc_init(GarbageCollector *gc) {
   size_t elemsz = sizeof(obj*);
   CleanupFn cleanup_fn = (CleanupFn) &obj_cleanup;
-  return cvec_init(&gc->allocated, elemsz, 0, cleanup_fn);
+  if (!carena_init(&gc->arena)) return false;
+  memset(&gc->pauses, 0, sizeof(gc->pauses));
+  memset(&gc->mark_stack, 0, sizeof(gc->mark_stack));
+  gc->tenured_threshold = GC_MIN_TENURED_THRESHOLD;
+  gc->stack = gc->stack_top = NULL;
+  gc->blocks.prev = gc->blocks.next = &gc->blocks;
+
+  // Young objects are disposed of (or promoted) one at a time, so need no cleanup function
+  if (!cvec_init(&gc->roots, sizeof(obj**), 0, NULL)) return false;
+  if (!cvec_init(&gc->allocated, elemsz, GC_NURSERY_SIZE, NULL)) {
+    cvec_dispose(&gc->roots);
+    return false;
+  }
+  if (!cvec_init(&gc->remembered, elemsz, 0, NULL)) {
+    cvec_dispose(&gc->roots);
+    cvec_dispose(&gc->allocated);
+    return false;
+  }
+  if (!cvec_init(&gc->tenured, elemsz, 0, cleanup_fn)) {
+    cvec_dispose(&gc->roots);
+    cvec_dispose(&gc->allocated);
+    cvec_dispose(&gc->remembered);
+    return false;
+  }
+  return true;
+}
+
+void *gc_allocate(GarbageCollector *gc, size_t size) {
+  assert(gc != NULL);
+  return carena_alloc(&gc->arena, size);
+}
+
+void gc_stats(const GarbageCollector *gc, CArenaStats *stats) {
+  assert(gc != NULL);
+  carena_stats(&gc->arena, stats);
 }
 
 void gc_add(GarbageCollector *gc, const obj *o) {
+  if (is_immediate(o) || is_atom(o)) return; // nothing to free, or owned by the symbol table
   cvec_append(&gc->allocated, &o);
 }
 
 void gc_add_recursive(GarbageCollector *gc, obj *root) {
-  if (root == NULL) return;
-  root->reachable = true;
-  if (is_list(root)) {
-    gc_add_recursive(gc, CAR(root));
-    gc_add_recursive(gc, CDR(root));
-  } else if (is_closure(root)) {
-    gc_add_recursive(gc, PARAMETERS(root));
-    gc_add_recursive(gc, PROCEDURE(root));
-    gc_add_recursive(gc, CAPTURED(root));
+  // The mark stack is only in use during collections, so it is borrowed to walk the tree
+  MarkStack *stack = &gc->mark_stack;
+  mark_stack_push(stack, root);
+  while (stack->size > 0) {
+    obj *o = stack->objects[--stack->size];
+    for (; o != NULL && !is_immediate(o) && !is_atom(o) && !is_mutable(o); o = is_list(o) ? CDR(o) : NULL) {
+      gc_add(gc, o);
+      if (is_list(o)) mark_stack_push(stack, CAR(o)); // the CDR is followed by this loop
+      else push_children(stack, o);
+    }
   }
-  gc_add(gc, root);
 }
 
+void gc_write_barrier(GarbageCollector *gc, obj *o) {
+  assert(gc != NULL);
+  if (o == NULL || is_immediate(o) || is_atom(o)) return;
+  if (!carena_is_marked(o)) return; // young objects are always scanned by the next collection
 
-static void mark_recursive(obj *o) {
-  if (o == NULL) return;
-  if (o->reachable) return;    // already seen
-  o->reachable = true;
-  if (is_list(o)) {
-    mark_recursive(CAR(o));
-    mark_recursive(CDR(o));
-  } else if (is_closure(o)) {
-    mark_recursive(PARAMETERS(o));
-    mark_recursive(CAPTURED(o));
-    mark_recursive(PROCEDURE(o));
-  }
+  // A vector written to in a loop would otherwise be remembered (and scanned) once per write
+  int count = cvec_count(&gc->remembered);
+  if (count > 0 && *(obj **) cvec_nth(&gc->remembered, count - 1) == o) return;
+  cvec_append(&gc->remembered, &o);
+}
+
+void gc_add_block(GarbageCollector *gc, GCBlock *block) {
+  assert(gc != NULL);
+  assert(block != NULL);
+  block->prev = &gc->blocks;
+  block->next = gc->blocks.next;
+  gc->blocks.next->prev = block;
+  gc->blocks.next = block;
+}
+
+void gc_free_block(GCBlock *block) {
+  if (block == NULL) return;
+  block->prev->next = block->next;
+  block->next->prev = block->prev;
+  free(block);
+}
+
+void gc_push_root(GarbageCollector *gc, obj **rootp) {
+  assert(gc != NULL);
+  assert(rootp != NULL);
+  cvec_append(&gc->roots, &rootp);
+}
+
+void gc_pop_roots(GarbageCollector *gc, int count) {
+  assert(gc != NULL);
+  assert(count <= cvec_count(&gc->roots));
+  for (int i = 0; i < count; i++)
+    cvec_remove(&gc->roots, cvec_count(&gc->roots) - 1);
 }
 
 static bool is_reachable(const void *objp) {
   assert(objp != NULL);
   obj *o = *(obj **) objp;
   assert(o != NULL);
-  return o->reachable;
+  return carena_is_marked(o);
 }
 
 void collect_garbage(GarbageCollector *gc, obj* env) {
   assert(gc != NULL);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
 
-  // reset all the flags to not reached
-  void *el;
-  for_vector(&gc->allocated, el) {
-    obj *o = *(obj **) el;
-    if (o == NULL) continue;
-    o->reachable = false;
-  }
+  // Unmark everything, which touches only the mark bitmaps rather than every old object.
+  // Untracked objects (the parsed code and the environment) are unmarked as well, and are
+  // marked again as they are reached.
+  carena_clear_marks(&gc->arena);
+
+  // mark and sweep both generations
+  mark_roots(gc, env);
+  cvec_clear(&gc->remembered);
+  promote_survivors(gc);
+  cvec_filter(&gc->tenured, is_reachable);
+
+  // Let the old generation grow in proportion to the live objects before collecting it again
+  int survivors = cvec_count(&gc->tenured);
+  gc->tenured_threshold = 2 * survivors > GC_MIN_TENURED_THRESHOLD ? 2 * survivors : GC_MIN_TENURED_THRESHOLD;
 
-  // mark and sweep
-  mark_recursive(env);
-  cvec_filter(&gc->allocated, is_reachable);
+  gc->pauses.major_collections++;
+  record_pause(gc, &start);
+}
+
+void maybe_collect_garbage(GarbageCollector *gc, obj *env) {
+  assert(gc != NULL);
+  if (cvec_count(&gc->allocated) < GC_NURSERY_SIZE) return;
+  if (cvec_count(&gc->tenured) >= gc->tenured_threshold)
+    collect_garbage(gc, env);
+  else
+    collect_young(gc, env);
 }
 
 void gc_dispose(GarbageCollector *gc) {
   assert(gc != NULL);
+  void *el;
+  for_vector(&gc->allocated, el)
+    dispose(*(obj **) el); // young objects, such as hash tables, may own memory of their own
   cvec_dispose(&gc->allocated);
+  cvec_dispose(&gc->tenured);
+  cvec_dispose(&gc->remembered);
+  cvec_dispose(&gc->roots);
+  free(gc->mark_stack.objects);
+  while (gc->blocks.next != &gc->blocks)
+    gc_free_block(gc->blocks.next); // owned by objects that were not disposed of individually
+  carena_dispose(&gc->arena);
+}
+
+/**
+ * Function: collect_young
+ * -----------------------
+ * Does a minor collection: frees the young objects that are not reachable, and promotes
+ * the rest to the old generation. Old objects are assumed to be reachable, so marking stops
+ * at them, and the only old objects scanned are those in the remembered set. The cost is
+ * therefore proportional to the number of young objects rather than to the size of the heap.
+ * @param gc: The garbage collector
+ * @param env: The current environment
+ */
+static void collect_young(GarbageCollector *gc, obj *env) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  void *el;
+  for_vector(&gc->remembered, el)
+    push_children(&gc->mark_stack, *(obj **) el);
+  cvec_clear(&gc->remembered);
+  mark_roots(gc, env);
+  promote_survivors(gc);
+
+  gc->pauses.minor_collections++;
+  record_pause(gc, &start);
+}
+
+/**
+ * Function: mark_roots
+ * --------------------
+ * Marks every object that is reachable from the environment, from the root stack,
+ * from the VM's value stack, or from the objects already on the mark stack
+ * @param gc: The garbage collector
+ * @param env: The current environment
+ */
+static void mark_roots(GarbageCollector *gc, obj *env) {
+  mark_stack_push(&gc->mark_stack, env);
+  void *el;
+  for_vector(&gc->roots, el) {
+    obj **rootp = *(obj ***) el;
+    mark_stack_push(&gc->mark_stack, *rootp);
+  }
+  for (obj **value = gc->stack; value < gc->stack_top; value++)
+    mark_stack_push(&gc->mark_stack, *value);
+  mark(&gc->mark_stack);
+}
+
+/**
+ * Function: mark
+ * --------------
+ * Marks every object reachable from the objects on the mark stack, leaving the stack
+ * empty. Objects popped from the stack pass through a small queue before they are
+ * visited, so that they can be prefetched while the objects ahead of them are visited.
+ * @param stack: The mark stack
+ */
+static void mark(MarkStack *stack) {
+  obj *queue[GC_PREFETCH_DISTANCE];
+  unsigned int head = 0, tail = 0; // the queue holds the objects at [head, tail) modulo its size
+
+  while (stack->size > 0 || head != tail) {
+    while (tail - head < GC_PREFETCH_DISTANCE && stack->size > 0) {
+      obj *o = stack->objects[--stack->size];
+      PREFETCH(o);
+      queue[tail++ % GC_PREFETCH_DISTANCE] = o;
+    }
+    visit(stack, queue[head++ % GC_PREFETCH_DISTANCE]);
+    if (stack->size > stack->high_water) stack->high_water = stack->size;
+  }
+}
+
+/**
+ * Function: visit
+ * ---------------
+ * Marks an object along with the chain of CDRs (or closure bodies, or the closures of
+ * frames, or the functions of partial applications) that follows it, pushing the other
+ * references of each object onto the mark stack. Following the chain directly means that a
+ * long list takes no space on the mark stack. Atoms are not allocated from the arena and are never freed by the collector, so
+ * are not marked.
+ * @param stack: The mark stack
+ * @param o: The object to mark
+ */
+static void visit(MarkStack *stack, obj *o) {
+  while (is_heap_object(o) && o->objtype != atom_obj && carena_mark(o)) {
+    if (o->objtype == list_obj) {
+      obj *next = CDR(o);
+      PREFETCH(next);
+      mark_stack_push(stack, CAR(o));
+      o = next;
+    } else if (o->objtype == closure_obj) {
+      mark_stack_push(stack, PARAMETERS(o));
+      mark_stack_push(stack, CAPTURED(o));
+      o = PROCEDURE(o);
+    } else if (o->objtype == frame_obj) {
+      const obj *closure = FRAME_CLOSURE(o);
+      mark_stack_push(stack, FRAME_CAPTURED(o));
+      for (int i = 0; i < NARGS(closure); i++)
+        mark_stack_push(stack, FRAME_VALUES(o)[i]);
+      o = (obj*) closure;
+    } else if (o->objtype == partial_obj) {
+      for (int i = 0; i < PARTIAL_NVALUES(o); i++)
+        mark_stack_push(stack, PARTIAL_VALUES(o)[i]);
+      o = PARTIAL_FUNCTION(o);
+    } else if (o->objtype == vector_obj) {
+      for (int i = 0; i < VECTOR_LENGTH(o); i++)
+        mark_stack_push(stack, VECTOR_ITEMS(o)[i]);
+      return;
+    } else if (o->objtype == hashtable_obj) {
+      push_entries(stack, HASHTABLE(o));
+      return;
+    } else return;
+  }
+}
+
+/**
+ * Function: push_children
+ * -----------------------
+ * Pushes the objects referenced by an object onto the mark stack
+ * @param stack: The mark stack
+ * @param o: The object whose references to push
+ */
+static void push_children(MarkStack *stack, const obj *o) {
+  if (is_list(o)) {
+    mark_stack_push(stack, CAR(o));
+    mark_stack_push(stack, CDR(o));
+  } else if (is_closure(o)) {
+    mark_stack_push(stack, PARAMETERS(o));
+    mark_stack_push(stack, CAPTURED(o));
+    mark_stack_push(stack, PROCEDURE(o));
+  } else if (is_frame(o)) {
+    const obj *closure = FRAME_CLOSURE(o);
+    mark_stack_push(stack, (obj*) closure);
+    mark_stack_push(stack, FRAME_CAPTURED(o));
+    for (int i = 0; i < NARGS(closure); i++)
+      mark_stack_push(stack, FRAME_VALUES(o)[i]);
+  } else if (is_partial(o)) {
+    mark_stack_push(stack, PARTIAL_FUNCTION(o));
+    for (int i = 0; i < PARTIAL_NVALUES(o); i++)
+      mark_stack_push(stack, PARTIAL_VALUES(o)[i]);
+  } else if (is_vector(o)) {
+    for (int i = 0; i < VECTOR_LENGTH(o); i++)
+      mark_stack_push(stack, VECTOR_ITEMS(o)[i]);
+  } else if (is_hashtable(o)) {
+    push_entries(stack, HASHTABLE(o));
+  }
+}
+
+/**
+ * Function: push_entries
+ * ----------------------
+ * Pushes the key and value of each entry of a hash table's map onto the mark stack
+ * @param stack: The mark stack
+ * @param map: The map of the hash table
+ */
+static void push_entries(MarkStack *stack, const CMap *map) {
+  for (const void *key = cmap_first(map); key != NULL; key = cmap_next(map, key)) {
+    mark_stack_push(stack, *(obj **) key);
+    mark_stack_push(stack, *(obj **) get_value(map, key));
+  }
+}
+
+/**
+ * Function: mark_stack_push
+ * -------------------------
+ * Pushes an object onto the mark stack, growing the stack if it is full. Immediates and
+ * NULL are not pushed. The object itself is not read, so that it can be prefetched when
+ * it is popped rather than missing the cache now.
+ * @param stack: The mark stack
+ * @param o: The object to push
+ */
+static inline void mark_stack_push(MarkStack *stack, obj *o) {
+  if (!is_heap_object(o)) return;
+  if (stack->size == stack->capacity) {
+    stack->capacity = stack->capacity == 0 ? 256 : 2 * stack->capacity;
+    stack->objects = realloc(stack->objects, stack->capacity * sizeof(obj*));
+    MALLOC_CHECK(stack->objects);
+  }
+  stack->objects[stack->size++] = o;
+}
+
+/**
+ * Function: is_heap_object
+ * ------------------------
+ * Determines if an object reference points to an object in the heap (rather than being
+ * NULL or an immediate), without the function call of is_immediate, for the marking loop
+ * @param o: The object reference
+ * @return: True if the reference points to an object in the heap
+ */
+static inline bool is_heap_object(const obj *o) {
+  return o != NULL && ((uintptr_t) o & IMMEDIATE_TAG_MASK) == 0;
+}
+
+/**
+ * Function: promote_survivors
+ * ---------------------------
+ * Frees the young objects that were not marked, and moves the marked ones into
+ * the old generation, leaving the nursery empty. Promoted objects stay marked, which
+ * is what stops minor collections from marking through them.
+ * @param gc: The garbage collector
+ */
+static void promote_survivors(GarbageCollector *gc) {
+  void *el;
+  for_vector(&gc->allocated, el) {
+    obj *o = *(obj **) el;
+    if (carena_is_marked(o)) cvec_append(&gc->tenured, &o);
+    else dispose(o);
+  }
+  cvec_clear(&gc->allocated);
+}
+
+/**
+ * Function: record_pause
+ * ----------------------
+ * Adds the time since the start of a collection to the histogram of pause times
+ * @param gc: The garbage collector
+ * @param start: The time at which the collection started
+ */
+static void record_pause(GarbageCollector *gc, const struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  long micros = (end.tv_sec - start->tv_sec) * 1000000L + (end.tv_nsec - start->tv_nsec) / 1000L;
+
+  int bucket = 0;
+  while (micros > 0 && bucket < GC_PAUSE_BUCKETS - 1) {
+    micros >>= 1;
+    bucket++;
+  }
+  gc->pauses.histogram[bucket]++;
 }
 
 /**
@@ -0,0 +1,312 @@
+/*
+ * File: hashtable-lib.c
+ * ---------------------
+ * Presents the implementation of the hash table library
+ */
+
+#include <hashtable-lib.h>
+#include <environment.h>
+#include <list.h>
+#include <bignum.h>
+#include <stack-trace.h>
+#include <string.h>
+
+// forward declarations of primitives
+static def_function(make_hash_table);
+static def_function(hash_ref);
+static def_function(hash_set);
+static def_function(hash_remove);
+static def_function(hash_count);
+static def_function(hash_to_list);
+static def_function(hash_keys);
+
+static const primitive_def hashtable_primitives[] = {
+  { "make-hash-table", NULL, &make_hash_table, 0, 1 },
+  { "hash-ref",        NULL, &hash_ref,        2, 3 },
+  { "hash-set!",       NULL, &hash_set,        3, 3 },
+  { "hash-remove!",    NULL, &hash_remove,     2, 2 },
+  { "hash-count",      NULL, &hash_count,      1, 1 },
+  { "hash->list",      NULL, &hash_to_list,    1, 1 },
+  { "hash-keys",       NULL, &hash_keys,       1, 1 },
+  { NULL,              NULL, NULL,             0, 0 }
+};
+
+// Static function declarations
+static uint64_t mix(uint64_t h);
+static unsigned int key_hash(const void *keyp, size_t keysize);
+static int key_compare(const void *keyA, const void *keyB);
+static bool keys_equal(const obj *a, const obj *b);
+static obj *store_value(const obj *value, GarbageCollector *gc);
+
+obj* get_hashtable_library(SymbolTable *symbols, GarbageCollector *gc) {
+  return create_environment(hashtable_primitives, symbols, gc);
+}
+
+uint64_t hash_object(const obj *o) {
+  if (o == NULL) return 0;
+  if (is_float(o)) {
+    double value = get_float(o);
+    if (value == 0) value = 0; // -0.0 is equal to 0.0
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return mix(bits);
+  }
+  if (is_immediate(o)) return mix((uintptr_t) o); // equal fixnums have equal encodings
+
+  if (is_bignum(o)) {
+    const Bignum *b = BIGNUM(o);
+    uint64_t h = b->negative;
+    for (int i = 0; i < b->size; i++)
+      h = mix(h ^ b->digits[i]);
+    return h;
+  }
+
+  // Lists are hashed by their elements, along the list so that long lists don't use the C stack
+  if (is_list(o)) {
+    uint64_t h = list_obj;
+    for (; o != NULL; o = CDR(o)) {
+      if (!is_list(o)) return mix(h ^ hash_object(o)); // dotted list
+      if (CAR(o) == NULL && CDR(o) == NULL) break;     // empty list
+      h = mix(h ^ hash_object(CAR(o)));
+    }
+    return h;
+  }
+
+  if (is_primitive(o)) return mix((uintptr_t) PRIMITIVE(o));
+  if (is_closure(o)) return mix((uintptr_t) PROCEDURE(o)); // equal closures have the same procedure
+  return mix((uintptr_t) o); // atoms are interned, and the rest are keys by identity
+}
+
+/**
+ * Primitive: make-hash-table
+ * --------------------------
+ * Usage: (make-hash-table) or (make-hash-table n)
+ *
+ * Makes an empty hash table, with room for n entries (if given) before it must grow
+ */
+static def_function(make_hash_table) {
+  obj *size = argc == 1 ? argv[0] : new_int(0);
+  if (!is_int(size) || get_int(size) < 0 || get_int(size) > VECTOR_MAX_LENGTH) {
+    LOG_ERROR("Size is not an integer between 0 and %d", VECTOR_MAX_LENGTH);
+    return NULL;
+  }
+
+  CMap *map = cmap_create(sizeof(obj*), sizeof(obj*), key_hash, key_compare, NULL, NULL, 0);
+  MALLOC_CHECK(map);
+  if (!cmap_reserve(map, (unsigned int) get_int(size))) {
+    cmap_dispose(map);
+    LOG_ERROR("Out of memory");
+    return NULL;
+  }
+  obj *table = new_hashtable(map, &interpreter->gc);
+  gc_add(&interpreter->gc, table);
+  return table;
+}
+
+/**
+ * Primitive: hash-ref
+ * -------------------
+ * Usage: (hash-ref h key) or (hash-ref h key default)
+ *
+ * Gets the value associated with key in h, or if there is none, the value of default
+ * if it is given and otherwise the empty list
+ */
+static def_function(hash_ref) {
+  obj *table = argv[0];
+  if (!is_hashtable(table)) {
+    LOG_ERROR("First argument is not a hash table");
+    return NULL;
+  }
+  obj **value = cmap_lookup(HASHTABLE(table), &argv[1]);
+  if (value != NULL) return *value;
+  return argc == 3 ? argv[2] : nil(interpreter);
+}
+
+/**
+ * Primitive: hash-set!
+ * --------------------
+ * Usage: (hash-set! h key x)
+ *
+ * Associates (a copy of) the value of x with key in h, replacing any value that key had, and
+ * returns h. The hash table is modified in place, and the change is seen through every reference to it.
+ */
+static def_function(hash_set) {
+  obj *table = argv[0];
+  if (!is_hashtable(table)) {
+    LOG_ERROR("First argument is not a hash table");
+    return NULL;
+  }
+
+  obj *value = store_value(argv[2], &interpreter->gc);
+  obj **entry = cmap_lookup(HASHTABLE(table), &argv[1]);
+  if (entry != NULL) {
+    *entry = value;
+  } else {
+    obj *key = store_value(argv[1], &interpreter->gc);
+    if (cmap_insert(HASHTABLE(table), &key, &value) == NULL) {
+      LOG_ERROR("Out of memory");
+      return NULL;
+    }
+  }
+  gc_write_barrier(&interpreter->gc, table); // the key and value may be younger than the table
+  return table;
+}
+
+/**
+ * Primitive: hash-remove!
+ * -----------------------
+ * Usage: (hash-remove! h key)
+ *
+ * Removes key (and its value) from h, if it is there, and returns h
+ */
+static def_function(hash_remove) {
+  obj *table = argv[0];
+  if (!is_hashtable(table)) {
+    LOG_ERROR("First argument is not a hash table");
+    return NULL;
+  }
+  cmap_remove(HASHTABLE(table), &argv[1]);
+  return table;
+}
+
+/**
+ * Primitive: hash-count
+ * ---------------------
+ * Usage: (hash-count h)
+ *
+ * Gets the number of keys in h
+ */
+static def_function(hash_count) {
+  obj *table = argv[0];
+  if (!is_hashtable(table)) {
+    LOG_ERROR("Argument is not a hash table");
+    return NULL;
+  }
+  return new_int(cmap_count(HASHTABLE(table)));
+}
+
+/**
+ * Primitive: hash->list
+ * ---------------------
+ * Usage: (hash->list h)
+ *
+ * Makes a list of the entries of h, each a list of a key and its value, in no particular order
+ */
+static def_function(hash_to_list) {
+  obj *table = argv[0];
+  if (!is_hashtable(table)) {
+    LOG_ERROR("Argument is not a hash table");
+    return NULL;
+  }
+
+  const CMap *map = HASHTABLE(table);
+  obj *list = NULL;
+  for (const void *key = cmap_first(map); key != NULL; key = cmap_next(map, key)) {
+    obj *pair = make_pair(*(obj **) key, *(obj **) get_value(map, key), false, &interpreter->gc);
+    gc_add(&interpreter->gc, CDR(pair));
+    gc_add(&interpreter->gc, pair);
+    list = new_list_set(pair, list, &interpreter->gc);
+    gc_add(&interpreter->gc, list);
+  }
+  return list == NULL ? nil(interpreter) : list;
+}
+
+/**
+ * Primitive: hash-keys
+ * --------------------
+ * Usage: (hash-keys h)
+ *
+ * Makes a list of the keys of h, in no particular order
+ */
+static def_function(hash_keys) {
+  obj *table = argv[0];
+  if (!is_hashtable(table)) {
+    LOG_ERROR("Argument is not a hash table");
+    return NULL;
+  }
+
+  const CMap *map = HASHTABLE(table);
+  obj *list = NULL;
+  for (const void *key = cmap_first(map); key != NULL; key = cmap_next(map, key)) {
+    list = new_list_set(*(obj **) key, list, &interpreter->gc);
+    gc_add(&interpreter->gc, list);
+  }
+  return list == NULL ? nil(interpreter) : list;
+}
+
+/**
+ * Function: mix
+ * -------------
+ * Mixes the bits of a 64-bit value (the finalizer of MurmurHash3), so that values that differ
+ * in only a few bits (such as nearby integers and addresses) have very different hashes
+ * @param h: The value to mix
+ * @return: The mixed value
+ */
+static uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * Function: key_hash
+ * ------------------
+ * The hash function of a hash table's map, whose keys are obj*
+ * @param keyp: Pointer to the key
+ * @param keysize: Size of the key (unused)
+ * @return: The hash of the key
+ */
+static unsigned int key_hash(const void *keyp, size_t keysize) {
+  (void) keysize;
+  uint64_t h = hash_object(*(const obj **) keyp);
+  return (unsigned int) (h ^ (h >> 32));
+}
+
+/**
+ * Function: key_compare
+ * ---------------------
+ * The comparison function of a hash table's map, whose keys are obj*
+ * @param keyA: Pointer to the first key
+ * @param keyB: Pointer to the second key
+ * @return: Zero if the keys are equal, and non-zero otherwise
+ */
+static int key_compare(const void *keyA, const void *keyB) {
+  return keys_equal(*(const obj **) keyA, *(const obj **) keyB) ? 0 : 1;
+}
+
+/**
+ * Function: keys_equal
+ * --------------------
+ * Determines whether two keys of a hash table are equal: lists are equal if their elements are
+ * (however they end, as cons ends them with the empty list), and other objects are compared as
+ * by compare (so vectors and hash tables by identity)
+ * @param a: The first key
+ * @param b: The second key
+ * @return: True if the keys are equal, false otherwise
+ */
+static bool keys_equal(const obj *a, const obj *b) {
+  for (;; a = CDR(a), b = CDR(b)) {
+    if (is_nil(a)) a = NULL;
+    if (is_nil(b)) b = NULL;
+    if (a == b || !is_list(a) || !is_list(b)) return compare(a, b);
+    if (!keys_equal(CAR(a), CAR(b))) return false;
+  }
+}
+
+/**
+ * Function: store_value
+ * ---------------------
+ * Copies a key or value to store in a hash table, as set copies a value to store in the
+ * environment, since it may be part of the expression being evaluated, which isn't collected
+ * @param value: The key or value to store
+ * @param gc: Garbage collector to allocate the copy from, and record it with
+ * @return: A copy of the key or value
+ */
+static obj *store_value(const obj *value, GarbageCollector *gc) {
+  obj *copy = copy_recursive(value, gc);
+  gc_add_recursive(gc, copy);
+  return copy;
+}
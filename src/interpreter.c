@@ -8,6 +8,8 @@
 #include <garbage-collector.h>
 #include <environment.h>
 #include <evaluator.h>
+#include <vm.h>
+#include <primitives.h>
 #include <stack-trace.h>
 #include <list.h>
 #include <assert.h>
@@ -26,7 +28,7 @@ char buff[BUFSIZE];
 #define REPROMPT "  "
 
 // Static function declarations
-static obj *read_expression(FILE *fd, bool prompt, bool *eof, bool *syntax_error);
+static obj *read_expression(FILE *fd, bool prompt, bool *eof, bool *syntax_error, LispInterpreter *interpreter);
 static expression get_expression(FILE *fd, bool prompt, bool *eof, bool *syntax_error);
 static void print_object(FILE *fd, const obj *o);
 static expression get_expression_from_prompt(bool* eof);
@@ -39,12 +41,26 @@ static void update_net_balance(char next_character, int* netp);
 bool interpreter_init(LispInterpreter *interpreter) {
   assert(interpreter != NULL);
 
-  interpreter->env = init_env();
-  if (interpreter->env == NULL) return false;
+  bool success = symbol_table_init(&interpreter->symbols);
+  if (!success) return false;
 
-  bool success = gc_init(&interpreter->gc);
+  success = gc_init(&interpreter->gc);
   if (!success) {
-    dispose_recursive(interpreter->env);
+    symbol_table_dispose(&interpreter->symbols);
+    return false;
+  }
+
+  interpreter->env = init_env(&interpreter->symbols, &interpreter->gc);
+  if (interpreter->env == NULL || !index_environment(interpreter) || !vm_init(interpreter)) {
+    gc_dispose(&interpreter->gc);
+    symbol_table_dispose(&interpreter->symbols);
+    return false;
+  }
+  if (!free_variable_cache_init(&interpreter->free_variables)) {
+    cmap_dispose(interpreter->global_index);
+    vm_dispose(&interpreter->vm);
+    gc_dispose(&interpreter->gc);
+    symbol_table_dispose(&interpreter->symbols);
     return false;
   }
   return true;
@@ -57,7 +73,7 @@ void interpret_program(LispInterpreter *interpreter, const char *program_file, b
   bool eof = false;
   bool syntax_error = false;
   while (!eof) {
-    obj* o = read_expression(fd, false, &eof, &syntax_error);
+    obj* o = read_expression(fd, false, &eof, &syntax_error, interpreter);
     if (syntax_error) {
       LOG_ERROR("Syntax error.");
       break;
@@ -77,7 +93,7 @@ void interpret_program(LispInterpreter *interpreter, const char *program_file, b
 void interpret_fd(LispInterpreter *interpreter, FILE *fd_in, FILE *fd_out, bool verbose) {
   bool eof = false;
   while (!eof) {
-    obj* o = read_expression(fd_in, true, &eof, NULL);
+    obj* o = read_expression(fd_in, true, &eof, NULL, interpreter);
     if (eof) break;
     if (o == NULL) {
       LOG_ERROR("Invalid expression");
@@ -95,22 +111,27 @@ expression interpret_expression(LispInterpreter *interpreter, const_expression e
 
   if (expr == NULL) return NULL;
 
-  obj* o = PARSE(expr);
+  obj* o = PARSE(expr, interpreter);
   if (o == NULL) {
     LOG_ERROR("Error parsing expression: %s", expr);
     return NULL;
   }
 
   gc_add_recursive(&interpreter->gc, o);
+  gc_push_root(&interpreter->gc, &o); // the expression must survive collections during its evaluation
   obj* result_obj = eval(o, interpreter);
+  gc_pop_roots(&interpreter->gc, 1);
   expression result = unparse(result_obj);
   collect_garbage(&interpreter->gc, interpreter->env); // frees the objects in result_obj that were allocated during eval
   return result;
 }
 
 void interpreter_dispose(LispInterpreter *interpreter) {
-  gc_dispose(&interpreter->gc);
-  dispose_recursive(interpreter->env);
+  cmap_dispose(interpreter->global_index);
+  free_variable_cache_dispose(&interpreter->free_variables);
+  vm_dispose(&interpreter->vm);
+  gc_dispose(&interpreter->gc); // frees the environment along with every other object
+  symbol_table_dispose(&interpreter->symbols);
 }
 
 /**
@@ -120,13 +141,14 @@ void interpreter_dispose(LispInterpreter *interpreter) {
  * and then returns the object (in dynamically allocated memory)
  * @param fd: The file descriptor to read the next expression from
  * @param prompt: If true, print prompt to standard output (for interactive prompt)
+ * @param interpreter: Interpreter to allocate the parsed expression in
  * @return: The parsed lisp object from dynamically allocated memory
  */
-static obj *read_expression(FILE *fd, bool prompt, bool *eof, bool *syntax_error) {
+static obj *read_expression(FILE *fd, bool prompt, bool *eof, bool *syntax_error, LispInterpreter *interpreter) {
   expression next_expr = get_expression(fd, prompt, eof, syntax_error);
   if (next_expr == NULL) return NULL;
   if (prompt) add_history(next_expr);
-  obj* o = PARSE(next_expr);
+  obj* o = PARSE(next_expr, interpreter);
   free(next_expr);
   return o;
 }
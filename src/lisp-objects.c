@@ -5,127 +5,250 @@
  */
 
 #include <lisp-objects.h>
+#include <garbage-collector.h>
 #include <primitives.h>
+#include <compiler.h>
+#include <bignum.h>
 #include <stack-trace.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+// Layout of a double, and the exponents of the doubles that are immediates (see lisp-objects.h)
+#define MANTISSA_BITS       52
+#define MANTISSA_MASK       (((uint64_t) 1 << MANTISSA_BITS) - 1)
+#define EXPONENT_MASK       ((uint64_t) 0x7FF)
+#define IMMEDIATE_EXPONENT_BIAS ((uint64_t) 768)  // biased exponents 769 to 1279 are stored as 1 to 511
+#define IMMEDIATE_EXPONENT_MAX  ((uint64_t) 511)
+
+// Static function declarations
+static bool is_boxed(const obj *o, enum type type);
+
 obj* new_atom(atom_t name) {
   if (name == NULL) return NULL;
   size_t name_size = strlen(name);
   obj* o = malloc(sizeof(obj) + name_size + 1);
   MALLOC_CHECK(o);
   o->objtype = atom_obj;
-  o->reachable = false;
   strcpy((char*) ATOM(o), name);
   return o;
 }
 
-obj* new_list() {
-  obj* o = malloc(sizeof(obj) + sizeof(list_t));
+obj* new_list(GarbageCollector *gc) {
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(list_t));
   MALLOC_CHECK(o);
   o->objtype = list_obj;
-  o->reachable = false;
   CAR(o) = NULL;
   CDR(o) = NULL;
   return o;
 }
 
-obj* new_closure() {
-  obj* o = malloc(sizeof(obj) + sizeof(closure_t));
+obj* new_closure(GarbageCollector *gc) {
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(closure_t));
   MALLOC_CHECK(o);
   o->objtype = closure_obj;
-  o->reachable = false;
+  CODE(o) = NULL;
+  return o;
+}
+
+obj* new_frame(const obj *closure, GarbageCollector *gc) {
+  size_t size = sizeof(obj) + sizeof(frame_t) + NARGS(closure) * sizeof(obj*);
+  if (size > CARENA_MAX_SIZE) return NULL;
+  obj* o = gc_allocate(gc, size);
+  MALLOC_CHECK(o);
+  o->objtype = frame_obj;
+  FRAME_CLOSURE(o) = closure;
+  FRAME_CAPTURED(o) = CAPTURED(closure);
+  memset(FRAME_VALUES(o), 0, NARGS(closure) * sizeof(obj*));
+  return o;
+}
+
+obj* new_partial(obj *function, int nvalues, GarbageCollector *gc) {
+  if (nvalues > PARTIAL_MAX_VALUES) return NULL;
+  size_t size = sizeof(obj) + sizeof(partial_t) + nvalues * sizeof(obj*);
+  assert(size <= CARENA_MAX_SIZE);
+  obj* o = gc_allocate(gc, size);
+  MALLOC_CHECK(o);
+  o->objtype = partial_obj;
+  PARTIAL_FUNCTION(o) = function;
+  PARTIAL_NVALUES(o) = nvalues;
+  PARTIAL_NARGS(o) = (is_partial(function) ? PARTIAL_NARGS(function) : NARGS(function)) - nvalues;
+  memset(PARTIAL_VALUES(o), 0, nvalues * sizeof(obj*));
+  return o;
+}
+
+obj* new_vector(int length, GarbageCollector *gc) {
+  assert(length >= 0 && length <= VECTOR_MAX_LENGTH);
+  GCBlock *block = malloc(sizeof(GCBlock) + length * sizeof(obj*));
+  MALLOC_CHECK(block);
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(vector_t));
+  MALLOC_CHECK(o);
+  o->objtype = vector_obj;
+  VECTOR_ITEMS(o) = (obj **) (block + 1);
+  VECTOR_LENGTH(o) = length;
+  memset(VECTOR_ITEMS(o), 0, length * sizeof(obj*));
+  gc_add_block(gc, block);
   return o;
 }
 
+obj* new_hashtable(CMap *map, GarbageCollector *gc) {
+  assert(map != NULL);
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(CMap*));
+  MALLOC_CHECK(o);
+  o->objtype = hashtable_obj;
+  HASHTABLE(o) = map;
+  return o;
+}
+
+obj* new_integer(int64_t value, GarbageCollector *gc) {
+  if (value >= FIXNUM_MIN && value <= FIXNUM_MAX) return new_int(value);
+  return new_bignum(bignum_from_int(value), gc);
+}
+
+obj* new_bignum(Bignum *value, GarbageCollector *gc) {
+  assert(value != NULL);
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(Bignum*));
+  MALLOC_CHECK(o);
+  o->objtype = bignum_obj;
+  CONTENTS(o)[0] = value;
+  gc_add_block(gc, &value->block);
+  return o;
+}
+
+obj* copy_number(const obj *o, GarbageCollector *gc) {
+  if (is_immediate(o)) return (obj*) o;
+  if (is_bignum(o)) return new_bignum(bignum_copy(BIGNUM(o)), gc);
+  return new_float(get_float(o), gc);
+}
+
 obj* copy_atom(const obj* o) {
   if (!is_atom(o)) return NULL;
-  return new_atom(ATOM(o));
+  return (obj*) o; // atoms are interned, so all copies are the same object
 }
 
-obj* copy_list(const obj *o) {
-  obj* list_copy = new_list();
+obj* copy_list(const obj *o, GarbageCollector *gc) {
+  obj* list_copy = new_list(gc);
   memcpy(LIST(list_copy), LIST(o), sizeof(list_obj));
   return list_copy;
 }
 
 bool compare(const obj* a, const obj* b) {
   if (a == NULL || b == NULL) return a == b;
+  if (is_float(a) && is_float(b)) return get_float(a) == get_float(b);
+  if (is_bignum(a) && is_bignum(b)) return bignum_compare(BIGNUM(a), BIGNUM(b)) == 0;
+  if (is_immediate(a) || is_immediate(b)) return a == b; // equal fixnums have equal encodings
   if (a->objtype != b->objtype) return false;
-  if (is_int(a)) return get_int(a) == get_int(b);
-  if (is_float(a)) return get_float(a) == get_float(b);
 
   if (is_primitive(a))
-    return *PRIMITIVE(a) == *PRIMITIVE(b);
-  if (is_list(a))
-    return memcmp(LIST(a), LIST(b), sizeof(list_t)) == 0;
+    return PRIMITIVE(a) == PRIMITIVE(b);
+  if (is_list(a)) // distinct lists may share interned atoms, so compare by identity
+    return a == b || (CAR(a) == NULL && CDR(a) == NULL && CAR(b) == NULL && CDR(b) == NULL);
   if (is_atom(a))
-    return strcmp(ATOM(a), ATOM(b)) == 0;
+    return a == b;
   if (is_closure(a))
     return memcmp(CLOSURE(a), CLOSURE(b), sizeof(closure_t)) == 0;
+  if (is_partial(a) || is_mutable(a))
+    return a == b;
   return false;
 }
 
 void dispose(obj* o) {
   assert(o != NULL);
-  free(o);
+  if (is_immediate(o)) return;
+  if (is_atom(o)) return; // owned by the symbol table
+  if (is_closure(o)) free_bytecode(CODE(o));
+  if (is_bignum(o)) bignum_free(BIGNUM(o));
+  if (is_vector(o)) gc_free_block((GCBlock *) VECTOR_ITEMS(o) - 1);
+  if (is_hashtable(o)) cmap_dispose(HASHTABLE(o));
+  carena_free(o);
 }
 
-obj* new_int(int value) {
-  obj* o = malloc(sizeof(obj) + sizeof(int));
-  MALLOC_CHECK(o);
-  o->objtype = int_obj;
-  o->reachable = false;
-  int *contents = (int*) CONTENTS(o);
-  *contents = value;
-  return o;
+obj* new_int(int64_t value) {
+  assert(value >= FIXNUM_MIN && value <= FIXNUM_MAX);
+  return (obj*) (((uintptr_t) value << IMMEDIATE_SHIFT) | INT_TAG);
 }
 
-obj* new_float(float value) {
-  obj* o = malloc(sizeof(obj) + sizeof(float));
+obj* new_float(double value, GarbageCollector *gc) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint64_t sign = bits >> 63;
+  uint64_t exponent = (bits >> MANTISSA_BITS) & EXPONENT_MASK;
+  uint64_t mantissa = bits & MANTISSA_MASK;
+
+  if (exponent == 0 && mantissa == 0) // zero, of either sign
+    return (obj*) ((uintptr_t) (sign << IMMEDIATE_SHIFT) | FLOAT_TAG);
+  if (exponent > IMMEDIATE_EXPONENT_BIAS && exponent - IMMEDIATE_EXPONENT_BIAS <= IMMEDIATE_EXPONENT_MAX) {
+    uint64_t payload = ((exponent - IMMEDIATE_EXPONENT_BIAS) << (MANTISSA_BITS + 1)) | (mantissa << 1) | sign;
+    return (obj*) ((uintptr_t) (payload << IMMEDIATE_SHIFT) | FLOAT_TAG);
+  }
+
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(double));
   MALLOC_CHECK(o);
   o->objtype = float_obj;
-  o->reachable = false;
-  float *contents = (float*) CONTENTS(o);
-  *contents = value;
+  memcpy(CONTENTS(o), &value, sizeof(value)); // the double is stored in place of the object's contents
   return o;
 }
 
+bool is_immediate(const obj* o) {
+  return ((uintptr_t) o & IMMEDIATE_TAG_MASK) != 0;
+}
+
 bool is_atom(const obj* o) {
-  if (o == NULL) return false;
+  if (o == NULL || is_immediate(o)) return false;
   return o->objtype == atom_obj;
 }
 
 bool is_primitive(const obj* o) {
-  if (o == NULL) return false;
+  if (o == NULL || is_immediate(o)) return false;
   return o->objtype == primitive_obj;
 }
 
 bool is_list(const obj* o) {
-  if (o == NULL) return false;
+  if (o == NULL || is_immediate(o)) return false;
   return o->objtype == list_obj;
 }
 
 bool is_closure(const obj* o) {
-  if (o == NULL) return false;
+  if (o == NULL || is_immediate(o)) return false;
   return o->objtype == closure_obj;
 }
 
+bool is_frame(const obj* o) {
+  if (o == NULL || is_immediate(o)) return false;
+  return o->objtype == frame_obj;
+}
+
+bool is_partial(const obj* o) {
+  if (o == NULL || is_immediate(o)) return false;
+  return o->objtype == partial_obj;
+}
+
+bool is_vector(const obj* o) {
+  return is_boxed(o, vector_obj);
+}
+
+bool is_hashtable(const obj* o) {
+  return is_boxed(o, hashtable_obj);
+}
+
+bool is_mutable(const obj* o) {
+  return is_vector(o) || is_hashtable(o);
+}
+
 bool is_int(const obj* o) {
-  if (o == NULL) return false;
-  return o->objtype == int_obj;
+  return ((uintptr_t) o & IMMEDIATE_TAG_MASK) == INT_TAG;
+}
+
+bool is_bignum(const obj* o) {
+  return is_boxed(o, bignum_obj);
 }
 
 bool is_float(const obj* o) {
-  if (o == NULL) return false;
-  return o->objtype == float_obj;
+  return ((uintptr_t) o & IMMEDIATE_TAG_MASK) == FLOAT_TAG || is_boxed(o, float_obj);
 }
 
 bool is_number(const obj* o) {
-  if (o == NULL) return false;
-  return is_float(o) || is_int(o);
+  return is_immediate(o) || is_boxed(o, float_obj) || is_boxed(o, bignum_obj);
 }
 
 bool is_t(const obj* o) {
@@ -134,17 +257,51 @@ bool is_t(const obj* o) {
   return strcmp(ATOM(o), "t") == 0 || strcmp(ATOM(o), "true") == 0;
 }
 
-float get_float(const obj* o) {
-  if (is_int(o)) return (float) get_int(o);
-  if (is_float(o)) return *(float*) CONTENTS(o);
+double get_float(const obj* o) {
+  if (is_int(o)) return (double) get_int(o);
+  if (is_bignum(o)) return bignum_to_double(BIGNUM(o));
+  if (is_boxed(o, float_obj)) {
+    double value;
+    memcpy(&value, CONTENTS(o), sizeof(value));
+    return value;
+  }
+  if (is_float(o)) {
+    uint64_t payload = (uint64_t) (uintptr_t) o >> IMMEDIATE_SHIFT;
+    uint64_t sign = payload & 1;
+    uint64_t mantissa = (payload >> 1) & MANTISSA_MASK;
+    uint64_t exponent = payload >> (MANTISSA_BITS + 1);
+    if (exponent != 0) exponent += IMMEDIATE_EXPONENT_BIAS; // otherwise zero
+
+    uint64_t bits = (sign << 63) | (exponent << MANTISSA_BITS) | mantissa;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
 
   LOG_ERROR("Object is not a number");
   return 0;
 }
 
-int get_int(const obj* o) {
-  if (is_float(o)) return (int) get_float(o);
-  if (is_int(o)) return *(int*) CONTENTS(o);
-  LOG_ERROR("Object is not a number");
+int64_t get_int(const obj* o) {
+  if (is_float(o)) return (int64_t) get_float(o);
+  if (is_int(o)) {
+    // Sign-extend the 62-bit value
+    uint64_t value = (uint64_t) (uintptr_t) o >> IMMEDIATE_SHIFT;
+    uint64_t sign = (uint64_t) 1 << 61;
+    return (int64_t) ((value ^ sign) - sign);
+  }
+  LOG_ERROR("Object is not a fixnum or float");
   return 0;
 }
+
+/**
+ * Function: is_boxed
+ * ------------------
+ * Determines if an object is a heap object of a given type
+ * @param o: The object to check
+ * @param type: The type to check for
+ * @return: True if the object is neither NULL nor an immediate and has the type, false otherwise
+ */
+static bool is_boxed(const obj *o, enum type type) {
+  return o != NULL && !is_immediate(o) && o->objtype == type;
+}
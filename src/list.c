@@ -10,44 +10,51 @@
 #include <lisp-objects.h>
 #include <closure.h>
 #include <primitives.h>
+#include <garbage-collector.h>
 
 #include <stdlib.h>
 #include <string.h>
 
 // Static function declarations
-static obj* copy_list_recursive(const obj *o);
-static obj* copy_primitive(const obj* o);
+static obj* copy_list_recursive(const obj *o, GarbageCollector *gc);
+static obj* copy_primitive(const obj* o, GarbageCollector *gc);
 
-obj* new_list_set(const obj *car, const obj *cdr) {
-  obj* list = new_list();
+obj* new_list_set(const obj *car, const obj *cdr, GarbageCollector *gc) {
+  obj* list = new_list(gc);
   CAR(list) = (obj *) car;
   CDR(list) = (obj *) cdr;
   return list;
 }
 
 // Copy an object recursively
-obj* copy_recursive(const obj *o) {
+obj* copy_recursive(const obj *o, GarbageCollector *gc) {
   if (!o) return NULL;
 
   // Different kind of copying for each object type
   if (is_atom(o))       return copy_atom(o);
-  if (is_primitive(o))  return copy_primitive(o);
-  if (is_list(o))       return copy_list_recursive(o);
-  if (is_int(o))        return new_int(get_int(o));
-  if (is_float(o))      return new_float(get_float(o));
-  if (is_closure(o))    return copy_closure_recursive(o);
+  if (is_primitive(o))  return copy_primitive(o, gc);
+  if (is_list(o))       return copy_list_recursive(o, gc);
+  if (is_number(o))     return copy_number(o, gc);
+  if (is_closure(o))    return copy_closure_recursive(o, gc);
+  if (is_partial(o))    return copy_partial_recursive(o, gc);
+  if (is_mutable(o))    return (obj*) o; // vectors and hash tables are shared rather than copied
   return NULL;
 }
 
 void dispose_recursive(obj *o) {
   if (o == NULL) return;
-  if (is_list(o)) { // Recursive disposal of lists and closures
+  if (is_mutable(o)) return; // shared, and left to the garbage collector
+  if (is_list(o)) { // Recursive disposal of lists, closures and partial applications
     dispose_recursive(CAR(o));
     dispose_recursive(CDR(o));
   } else if (is_closure(o)) {
     dispose_recursive(PARAMETERS(o));
     dispose_recursive(PROCEDURE(o));
     dispose_recursive(CAPTURED(o));
+  } else if (is_partial(o)) {
+    dispose_recursive(PARTIAL_FUNCTION(o));
+    for (int i = 0; i < PARTIAL_NVALUES(o); i++)
+      dispose_recursive(PARTIAL_VALUES(o)[i]);
   }
   dispose(o);
 }
@@ -59,15 +66,24 @@ bool is_nil(const obj *o) {
 }
 
 bool compare_recursive(const obj *x, const obj *y) {
-  if (x == NULL) return y == NULL;
+  if (x == NULL || y == NULL) return x == y;
+  if (is_number(x) || is_number(y)) return compare(x, y);
   if (x->objtype != y->objtype) return false;
-  if (is_atom(x)) return strcmp(ATOM(x), ATOM(y)) == 0;
+  if (is_atom(x)) return x == y;
   if (is_primitive(x)) return PRIMITIVE(x) == PRIMITIVE(y);
 
   // List: cars must match and cdrs must match
   if (is_list(x))
     return compare_recursive(CAR(x), CAR(y)) && compare_recursive(CDR(x), CDR(y));
-  else return x == y;
+
+  // Vector: same length and all elements match
+  if (is_vector(x)) {
+    if (VECTOR_LENGTH(x) != VECTOR_LENGTH(y)) return false;
+    for (int i = 0; i < VECTOR_LENGTH(x); i++)
+      if (!compare_recursive(VECTOR_ITEMS(x)[i], VECTOR_ITEMS(y)[i])) return false;
+    return true;
+  }
+  return x == y;
 }
 
 obj* ith(const obj* o, int i) {   
@@ -82,11 +98,13 @@ obj* sublist(const obj* o, int i) {
   return sublist(CDR(o), i - 1);
 }
 
-obj* join_lists(obj *list1, obj *list2) {
+obj* join_lists(obj *list1, obj *list2, GarbageCollector *gc) {
   if (!list1) return list2;
   if (!list2) return list1;
-  if (!CDR(list1)) CDR(list1) = list2;
-  else join_lists(CDR(list1), list2);
+  if (!CDR(list1)) {
+    CDR(list1) = list2;
+    gc_write_barrier(gc, list1);
+  } else join_lists(CDR(list1), list2, gc);
   return list1;
 }
 
@@ -122,11 +140,11 @@ bool list_contains(const obj* list, const obj* query) {
  * @param o: An object that is a list to copy
  * @return: A pointer to a new list object
  */
-static obj* copy_list_recursive(const obj *o) {
+static obj* copy_list_recursive(const obj *o, GarbageCollector *gc) {
   if (!o) return NULL;
-  obj* car = copy_recursive(CAR(o));
-  obj* cdr = copy_recursive(CDR(o));
-  return new_list_set(car, cdr);
+  obj* car = copy_recursive(CAR(o), gc);
+  obj* cdr = copy_recursive(CDR(o), gc);
+  return new_list_set(car, cdr, gc);
 }
 
 /**
@@ -136,7 +154,8 @@ static obj* copy_list_recursive(const obj *o) {
  * @param o: A list object that is a primitive
  * @return: A deep copy of the list object
  */
-static obj* copy_primitive(const obj* o) {
+static obj* copy_primitive(const obj* o, GarbageCollector *gc) {
   if (!o) return NULL;
-  return new_primitive(*PRIMITIVE(o));
+  return new_primitive(PRIMITIVE(o), gc);
 }
+
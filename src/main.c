@@ -12,10 +12,13 @@
  *  ./lisp my-program.lisp
  *
  * Run lisp program file and then the repl
- *  ./lisp my-program.lisp -r
+ *  ./lisp -r my-program.lisp
  *
  * Run lisp interpreter with specific bootstrap file
  *  ./lisp -b my-bootstrap.lisp
+ *
+ * Run lisp program file with the tree-walking evaluator rather than the bytecode VM
+ *  ./lisp -i my-program.lisp
  */
 
 #include <unistd.h>
@@ -36,6 +39,7 @@ struct InterpreterConfig {
   char const *bootstrap_path;
   char const *program_path;
   bool run_repl;
+  bool use_vm;
   bool verbose;
   char history_buffer[HISTORY_FILE_LENGTH];
   char *history_file;
@@ -44,7 +48,7 @@ struct InterpreterConfig {
 static void parse_command_line_args(int argc, char* argv[], struct InterpreterConfig *config);
 static void print_version_information();
 
-const char *const optstring = ":rb:t:vh";
+const char *const optstring = ":rb:t:ivh";
 
 // If not history file was specified on CLI, then get it from home directory
 static void set_history_file(struct InterpreterConfig *config) {
@@ -80,7 +84,7 @@ int main(int argc, char* argv[]) {
   set_history_file(&config);
   
   return run_lisp(config.bootstrap_path, config.program_path,
-                  config.run_repl, config.history_file, config.verbose);
+                  config.run_repl, config.history_file, config.use_vm, config.verbose);
 }
 
 /**
@@ -98,44 +102,48 @@ static void parse_command_line_args(int argc, char* argv[],
   config->bootstrap_path = NULL;
   config->program_path = NULL;
   config->run_repl = true;
+  config->use_vm = true;
   config->verbose = false;
   config->history_file = NULL;
 
+  // Let getopt see every argument before taking the program path, so that options given after
+  // the path (which GNU getopt moves ahead of it) are not ignored
   bool repl_flag = false;
-  while (optind < argc) {
-    char c;
-    if ((c = getopt(argc, argv, optstring)) != -1) {
-      switch(c) {
-        case 'r': {
-          repl_flag = true;
-          break;
-        }
-        case 'b': {
-          config->bootstrap_path = optarg;
-          break;
-        }
-        case 't': {
-          config->history_file = optarg;
-          break;
-        }
-        case 'v': {
-          config->verbose = true;
-          break;
-        }
-        case 'h': {
-          print_version_information();
-          exit(0);
-        }
-        default: break;
+  int c;
+  while ((c = getopt(argc, argv, optstring)) != -1) {
+    switch(c) {
+      case 'r': {
+        repl_flag = true;
+        break;
+      }
+      case 'b': {
+        config->bootstrap_path = optarg;
+        break;
+      }
+      case 't': {
+        config->history_file = optarg;
+        break;
+      }
+      case 'i': {
+        config->use_vm = false;
+        break;
       }
-    } else {
-      if (optind < argc) {
-        config->program_path = argv[optind];
-        config->run_repl = repl_flag;
+      case 'v': {
+        config->verbose = true;
+        break;
       }
-      break;
+      case 'h': {
+        print_version_information();
+        exit(0);
+      }
+      default: break;
     }
   }
+
+  if (optind < argc) {
+    config->program_path = argv[optind];
+    config->run_repl = repl_flag;
+  }
 }
 
 /**
@@ -10,121 +10,344 @@
 #include <evaluator.h>
 #include <environment.h>
 #include <stack-trace.h>
+#include <bignum.h>
 
 
-// function typedefs for Z^2 --> Z, and R^2 --> R
-typedef int (*intArithmeticFuncPtr)(int, int);
-typedef float (*floatArithmeticFuncPtr)(float, float);
+// Outcome of applying an arithmetic operation to two 64-bit integers
+typedef enum int_step_result {
+  STEP_DONE,              // the result fits in 64 bits
+  STEP_OVERFLOW,          // the result doesn't fit, and the operation must be done with bignums
+  STEP_DIVIDE_BY_ZERO     // the operation was a division (or modulus) by zero
+} int_step_result;
 
-// Static declarations
-static obj *apply_arithmetic(const obj *args, intArithmeticFuncPtr int_op,
-                             floatArithmeticFuncPtr float_op, LispInterpreter *interpreter);
+// Static function declarations
+static bool check_numbers(int argc, obj *const *argv);
+static obj *fold_arithmetic(math_op op, int argc, obj *const *argv, LispInterpreter *interpreter);
+static int_step_result int_step(math_op op, int64_t *x, int64_t y);
+static bool bignum_step(math_op op, Bignum **x, const obj *y);
+static double float_step(math_op op, double x, double y);
+static obj *bignum_result(Bignum *x, GarbageCollector *gc);
+static obj *compare_chain(math_op op, int argc, obj *const *argv, LispInterpreter *interpreter);
+static bool compare_numbers(math_op op, const obj *x, const obj *y);
 
-// List of reserved words in the lisp language
-static atom_t const math_reserved_atoms[] = { "+", "-", "*", "/", "%",
-                                              "=", ">", ">=", "<", "<=", NULL };
+// Declarations of the math primitives, in the order of their operations (see math_op)
+static const primitive_def math_primitives[] = {
+  { "+",   NULL, &add,    0, VARIADIC },
+  { "-",   NULL, &sub,    1, VARIADIC },
+  { "*",   NULL, &mul,    0, VARIADIC },
+  { "/",   NULL, &divide, 1, VARIADIC },
+  { "%",   NULL, &mod,    2, 2 },
+  { "min", NULL, &min,    1, VARIADIC },
+  { "max", NULL, &max,    1, VARIADIC },
+  { "=",   NULL, &equal,  2, VARIADIC },
+  { ">",   NULL, &gt,     2, VARIADIC },
+  { ">=",  NULL, &gte,    2, VARIADIC },
+  { "<",   NULL, &lt,     2, VARIADIC },
+  { "<=",  NULL, &lte,    2, VARIADIC },
+  { NULL,  NULL, NULL,    0, 0 }
+};
 
-// List of the primitives associated with each of the reserved words
-static const primitive_t math_primitives[]= { &add, &sub, &mul, &divide, &mod,
-                                              &equal, &gt, &gte, &lt, &lte, NULL };
-
-obj* get_math_library() {
-  return create_environment(math_reserved_atoms, math_primitives);
+obj* get_math_library(SymbolTable *symbols, GarbageCollector *gc) {
+  return create_environment(math_primitives, symbols, gc);
 }
 
-// Define basic functions for arithmetic operations on two numbers
-#define def_single_op(name, T, op) static inline T name ## _ ## T ##s (T x, T y) { return x op y; }
-#define def_two_ops(name, op) def_single_op(name, int, op) def_single_op(name, float, op)
-def_two_ops(add, +)
-def_two_ops(sub, -)
-def_two_ops(mul, *)
-def_two_ops(divide, /)
-def_single_op(mod, int, %)
-static float mod_floats(float x, float y) { // This one needs it's own special definition
+static double mod_floats(double x, double y) { // This one needs it's own special definition
   x = x > 0 ? x : -x;
   y = y > 0 ? y : -y;
   while (x >= y) x -= y;
   return x;
 }
 
-// Function definitions for integer and floating point allocators
-#define def_number_allocator(T) static obj* allocate_ ## T (T value, GarbageCollector* gc) {\
-  obj* o = new_int(value); \
-  gc_add(gc, o); \
-  return o; }
+// macros for defining the arithmetic primitives and the comparison primitives
+#define def_arithmetic_primitive(name) def_function(name) { \
+  return fold_arithmetic(math_ ## name, argc, argv, interpreter); \
+}
+#define def_comparison_primitive(name) def_function(name) { \
+  return compare_chain(math_ ## name, argc, argv, interpreter); \
+}
+def_arithmetic_primitive(add)
+def_arithmetic_primitive(sub)
+def_arithmetic_primitive(mul)
+def_arithmetic_primitive(divide)
+def_arithmetic_primitive(mod)
+def_arithmetic_primitive(min)
+def_arithmetic_primitive(max)
+def_comparison_primitive(equal)
+def_comparison_primitive(gt)
+def_comparison_primitive(gte)
+def_comparison_primitive(lt)
+def_comparison_primitive(lte)
+
+obj *math_apply(math_op op, const obj *first, const obj *second, LispInterpreter *interpreter) {
+  obj *argv[] = { (obj *) first, (obj *) second };
+  if (op <= math_max) return fold_arithmetic(op, 2, argv, interpreter);
+  return compare_chain(op, 2, argv, interpreter);
+}
+
+bool math_primitive_op(const primitive_def *primitive, math_op *op) {
+  for (int i = 0; math_primitives[i].name != NULL; i++) {
+    if (&math_primitives[i] == primitive) {
+      *op = (math_op) i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Function: check_numbers
+ * -----------------------
+ * Checks that the values of the arguments to a math primitive are all numbers
+ * @param argc: The number of arguments
+ * @param argv: The values of the arguments
+ * @return: True if they are all numbers, false (having reported an error) otherwise
+ */
+static bool check_numbers(int argc, obj *const *argv) {
+  for (int i = 0; i < argc; i++) {
+    if (!is_number(argv[i])) {
+      LOG_ERROR("Argument %d did not evaluate to a number.", i + 1);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Function: fold_arithmetic
+ * -------------------------
+ * Applies an arithmetic operation to the values of one or more arguments, from left to right.
+ * The result is kept in a local 64-bit integer for as long as the arguments are fixnums and
+ * the result fits, in a bignum from the first bignum argument or overflow on, and in a local
+ * double from the first float argument on. Only the final result is made into an object, and
+ * an integer result is a fixnum if it fits in one. With fewer than two arguments, addition and
+ * multiplication start from their identity, so that (+) is 0, (- x) negates and (/ x) is the reciprocal.
+ * @param op: The arithmetic operation to apply
+ * @param argc: The number of arguments, at least one unless the operation has an identity
+ * @param argv: The values of the arguments
+ * @param interpreter: Interpreter to allocate a bignum or float result from
+ * @return: The result of the operation, or NULL if an argument is not a number or an integer is divided by zero
+ */
+static obj *fold_arithmetic(math_op op, int argc, obj *const *argv, LispInterpreter *interpreter) {
+  if (!check_numbers(argc, argv)) return NULL;
+  GarbageCollector *gc = &interpreter->gc;
+
+  obj *seeded[2];
+  if (argc < 2 && op <= math_divide) {
+    seeded[0] = new_integer(op == math_add || op == math_sub ? 0 : 1, gc);
+    if (argc == 1) seeded[1] = argv[0];
+    argv = seeded;
+    argc++;
+  }
+
+  enum { INT_RESULT, BIGNUM_RESULT, FLOAT_RESULT } kind;
+  int64_t int_result = 0;
+  Bignum *big_result = NULL;
+  double float_result = 0;
+  if (is_int(argv[0])) {
+    kind = INT_RESULT;
+    int_result = get_int(argv[0]);
+  } else if (is_bignum(argv[0])) {
+    kind = BIGNUM_RESULT;
+    big_result = bignum_copy(BIGNUM(argv[0]));
+  } else {
+    kind = FLOAT_RESULT;
+    float_result = get_float(argv[0]);
+  }
+
+  for (int i = 1; i < argc; i++) {
+    const obj *y = argv[i];
+    if (kind == INT_RESULT && is_int(y)) {
+      int_step_result step = int_step(op, &int_result, get_int(y));
+      if (step == STEP_DONE) continue;
+      if (step == STEP_DIVIDE_BY_ZERO) goto divide_by_zero;
+    }
+
+    // Widen the result as far as the next argument needs
+    if (kind != FLOAT_RESULT && is_float(y)) {
+      float_result = kind == INT_RESULT ? (double) int_result : bignum_to_double(big_result);
+      bignum_free(big_result);
+      big_result = NULL;
+      kind = FLOAT_RESULT;
+    } else if (kind == INT_RESULT) {
+      big_result = bignum_from_int(int_result);
+      kind = BIGNUM_RESULT;
+    }
 
-def_number_allocator(int)
+    if (kind == FLOAT_RESULT) float_result = float_step(op, float_result, get_float(y));
+    else if (!bignum_step(op, &big_result, y)) goto divide_by_zero;
+  }
 
-def_number_allocator(float)
+  obj *result;
+  if (kind == INT_RESULT) result = new_integer(int_result, gc);
+  else if (kind == BIGNUM_RESULT) result = bignum_result(big_result, gc);
+  else result = new_float(float_result, gc);
+  gc_add(gc, result);
+  return result;
 
-// macro for defining a the primitive operator
-#define def_math_op_primitive(name) def_primitive(name) { \
-  return apply_arithmetic(args, &(name ## _ints), &(name ## _floats), interpreter); \
+divide_by_zero:
+  bignum_free(big_result);
+  LOG_ERROR("Integer division by zero.");
+  return NULL;
 }
-def_math_op_primitive(add)
-def_math_op_primitive(sub)
-def_math_op_primitive(mul)
-def_math_op_primitive(divide)
-def_math_op_primitive(mod)
-
-// Define a mathematical comparison primitive
-#define def_math_compare_primitive(name, op) def_primitive(name) { \
-  if (!CHECK_NARGS(args, 2)) return NULL; \
-  obj* first = eval(ith(args, 0), interpreter); \
-  if (first == NULL) return NULL; \
-  if (!is_number(first)) { \
-      LOG_ERROR("First argument did not evaluate to a number."); \
-      return NULL; \
-  } \
-  obj* second = eval(ith(args, 1), interpreter); \
-  if (second == NULL) return NULL; \
-  if (!is_number(second)) { \
-    LOG_ERROR("Second argument did not evaluate to a number."); \
-    return NULL; \
-  } \
-  if (is_int(first) && is_int(second)) \
-    return get_int(first) op get_int(second) ? t(&interpreter->gc) : nil(&interpreter->gc); \
-  return get_float(first) op get_float(second) ? t(&interpreter->gc) : nil(&interpreter->gc); \
+
+/**
+ * Function: int_step
+ * ------------------
+ * Applies an arithmetic operation to two 64-bit integers, checking for overflow
+ * @param op: The arithmetic operation
+ * @param x: The first integer, to which the result is written if it fits in 64 bits
+ * @param y: The second integer
+ * @return: Whether the result was written, overflowed, or would be a division by zero
+ */
+static int_step_result int_step(math_op op, int64_t *x, int64_t y) {
+  int64_t result;
+  switch (op) {
+    case math_add:
+      if (add_overflows(*x, y, &result)) return STEP_OVERFLOW;
+      break;
+    case math_sub:
+      if (sub_overflows(*x, y, &result)) return STEP_OVERFLOW;
+      break;
+    case math_mul:
+      if (mul_overflows(*x, y, &result)) return STEP_OVERFLOW;
+      break;
+    case math_min: result = y < *x ? y : *x; break;
+    case math_max: result = y > *x ? y : *x; break;
+    default:
+      if (y == 0) return STEP_DIVIDE_BY_ZERO;
+      if (y == -1) { // INT64_MIN / -1 traps
+        if (op == math_mod) result = 0;
+        else if (sub_overflows(0, *x, &result)) return STEP_OVERFLOW;
+      } else {
+        result = op == math_divide ? *x / y : *x % y;
+      }
+      break;
+  }
+  *x = result;
+  return STEP_DONE;
 }
-def_math_compare_primitive(equal, ==)
-def_math_compare_primitive(gt, >)
-def_math_compare_primitive(gte, >=)
-def_math_compare_primitive(lt, <)
-def_math_compare_primitive(lte, <=)
 
 /**
- * Function: apply_arithmetic
- * --------------------------
- * Apply an arithmetic operation, the core of all operators
- * @param args: The lisp object containing the argument list
- * @param envp: The environment to apply the operation in
- * @param int_op: The operation corresponding to applying to integers
- * @param float_op: The operation corresponding to applying to floating point numbers
- * @return: The result of applying the arithmetic operation to the values of the arguments
+ * Function: bignum_step
+ * ---------------------
+ * Applies an arithmetic operation to a bignum and an integer, replacing the bignum with the result
+ * @param op: The arithmetic operation
+ * @param x: The first operand, which is freed and replaced by the result
+ * @param y: The second operand, a fixnum or bignum
+ * @return: True if the result was written, false (leaving x as it was) if it would be a division by zero
  */
-static obj *apply_arithmetic(const obj *args, intArithmeticFuncPtr int_op,
-                             floatArithmeticFuncPtr float_op, LispInterpreter *interpreter) {
-  if (!CHECK_NARGS(args, 2)) return NULL;
-
-  obj* first = eval(ith(args, 0), interpreter);
-  if (first == NULL) return NULL;
-  if (!is_number(first)) {
-    LOG_ERROR("First argument did not evaluate to a number.");
-    return NULL;
+static bool bignum_step(math_op op, Bignum **x, const obj *y) {
+  Bignum *converted = is_int(y) ? bignum_from_int(get_int(y)) : NULL;
+  const Bignum *operand = converted != NULL ? converted : BIGNUM(y);
+  Bignum *result = NULL;
+  switch (op) {
+    case math_add:    result = bignum_add(*x, operand); break;
+    case math_sub:    result = bignum_sub(*x, operand); break;
+    case math_mul:    result = bignum_mul(*x, operand); break;
+    case math_divide: bignum_divmod(*x, operand, &result, NULL); break;
+    case math_mod:    bignum_divmod(*x, operand, NULL, &result); break;
+    default: {
+      int order = bignum_compare(operand, *x);
+      bool replace = op == math_min ? order < 0 : order > 0;
+      result = bignum_copy(replace ? operand : *x);
+      break;
+    }
   }
+  bignum_free(converted);
+  if (result == NULL) return false; // division by zero
+  bignum_free(*x);
+  *x = result;
+  return true;
+}
 
-  obj* second = eval(ith(args, 1), interpreter);
-  if (second == NULL) return NULL;
-  if (!is_number(second)) {
-    LOG_ERROR("Second argument did not evaluate to a number.");
-    return NULL;
+/**
+ * Function: float_step
+ * --------------------
+ * Applies an arithmetic operation to two doubles
+ * @param op: The arithmetic operation
+ * @param x: The first operand
+ * @param y: The second operand
+ * @return: The result of the operation
+ */
+static double float_step(math_op op, double x, double y) {
+  switch (op) {
+    case math_add:    return x + y;
+    case math_sub:    return x - y;
+    case math_mul:    return x * y;
+    case math_divide: return x / y;
+    case math_min:    return y < x ? y : x;
+    case math_max:    return y > x ? y : x;
+    default:          return mod_floats(x, y);
   }
+}
 
-  if (first->objtype == float_obj || second->objtype == float_obj ) {
-    float value = float_op(get_float(first), get_float(second));
-    return allocate_float(value, &interpreter->gc);
+/**
+ * Function: bignum_result
+ * -----------------------
+ * Makes an integer object from a bignum result, as a fixnum if it fits in one
+ * @param x: The result, which the object takes ownership of (or which is freed)
+ * @param gc: Garbage collector to allocate a bignum object from
+ * @return: The integer object
+ */
+static obj *bignum_result(Bignum *x, GarbageCollector *gc) {
+  int64_t value;
+  if (bignum_to_int(x, &value) && value >= FIXNUM_MIN && value <= FIXNUM_MAX) {
+    bignum_free(x);
+    return new_int(value);
+  }
+  return new_bignum(x, gc);
+}
+
+/**
+ * Function: compare_chain
+ * -----------------------
+ * Applies a comparison to each pair of adjacent arguments, such that (< a b c) holds if a < b and b < c
+ * @param op: The comparison to apply
+ * @param argc: The number of arguments
+ * @param argv: The values of the arguments
+ * @param interpreter: Interpreter to get the truth atom or nil from
+ * @return: The truth atom if every comparison holds, nil if one doesn't, or NULL if an argument is not a number
+ */
+static obj *compare_chain(math_op op, int argc, obj *const *argv, LispInterpreter *interpreter) {
+  if (!check_numbers(argc, argv)) return NULL;
+
+  for (int i = 1; i < argc; i++)
+    if (!compare_numbers(op, argv[i - 1], argv[i])) return nil(interpreter);
+  return t(interpreter);
+}
+
+/**
+ * Function: compare_numbers
+ * -------------------------
+ * Applies a comparison to two numbers. Integers (fixnums and bignums) are compared exactly,
+ * and a float with any number is compared as doubles.
+ * @param op: The comparison to apply
+ * @param x: The first number
+ * @param y: The second number
+ * @return: Whether the comparison holds, which it doesn't if either number is not a number (NaN)
+ */
+static bool compare_numbers(math_op op, const obj *x, const obj *y) {
+  int order;
+  if (is_int(x) && is_int(y)) {
+    int64_t a = get_int(x), b = get_int(y);
+    order = (a > b) - (a < b);
+  } else if (is_float(x) || is_float(y)) {
+    double a = get_float(x), b = get_float(y);
+    if (a != a || b != b) return false;
+    order = (a > b) - (a < b);
   } else {
-    int value = int_op(get_int(first), get_int(second));
-    return allocate_int(value, &interpreter->gc);
+    Bignum *a = is_int(x) ? bignum_from_int(get_int(x)) : NULL;
+    Bignum *b = is_int(y) ? bignum_from_int(get_int(y)) : NULL;
+    order = bignum_compare(a != NULL ? a : BIGNUM(x), b != NULL ? b : BIGNUM(y));
+    bignum_free(a);
+    bignum_free(b);
+  }
+
+  switch (op) {
+    case math_equal: return order == 0;
+    case math_gt:    return order > 0;
+    case math_gte:   return order >= 0;
+    case math_lt:    return order < 0;
+    default:         return order <= 0;
   }
 }
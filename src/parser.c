@@ -9,9 +9,14 @@
 #include <list.h>
 #include <stack-trace.h>
 #include <primitives.h>
+#include <closure.h>
+#include <bignum.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <assert.h>
 
 
@@ -21,13 +26,16 @@
 
 #define NIL_STR_REP "nil"
 
-static obj* parse_atom(const_expression e, size_t *num_parsed_p);
-static obj* parse_list(const_expression e, size_t *num_parsed_p);
-static obj* get_quote_list();
+static obj* parse_atom(const_expression e, size_t *num_parsed_p, SymbolTable *symbols, GarbageCollector *gc);
+static obj* parse_list(const_expression e, size_t *num_parsed_p, SymbolTable *symbols, GarbageCollector *gc);
+static obj* get_quote_list(SymbolTable *symbols, GarbageCollector *gc);
 static bool contains_dot(const_expression e, size_t length);
 
 static expression unparse_list(const obj *o);
 static expression unparse_closure(const obj* o);
+static expression unparse_partial(const obj* o);
+static expression unparse_vector(const obj* o);
+static expression unparse_hashtable(const obj* o);
 static expression unparse_atom(const obj *o);
 static expression unparse_primitive(const obj *o);
 
@@ -35,7 +43,7 @@ static size_t atom_size(const_expression e);
 static bool is_white_space(char character);
 static int distance_to_next_element(const_expression e);
 
-obj* parse_expression(const_expression e, size_t *num_parsed_p) {
+obj* parse_expression(const_expression e, size_t *num_parsed_p, SymbolTable *symbols, GarbageCollector *gc) {
   assert(e != NULL);
 
   ssize_t start = distance_to_next_element(e);
@@ -54,18 +62,18 @@ obj* parse_expression(const_expression e, size_t *num_parsed_p) {
   size_t expr_size;
 
   if (expr_start[0] == '\'') { // Expression starts with quote character
-    o = get_quote_list();
-    obj* quoted = parse_expression((char *) expr_start + 1, &expr_size);
+    o = get_quote_list(symbols, gc);
+    obj* quoted = parse_expression((char *) expr_start + 1, &expr_size, symbols, gc);
     expr_size += 1; // for the quote character
-    CDR(o) = new_list_set(quoted, NULL);
+    CDR(o) = new_list_set(quoted, NULL, gc);
 
   } else if (expr_start[0] == '(')  { // Expression starts with opening paren
-    o = parse_list((char *) expr_start + 1, &expr_size);
+    o = parse_list((char *) expr_start + 1, &expr_size, symbols, gc);
     expr_size += 1; // for the opening parentheses character
-    if (o == NULL) o = new_list();
+    if (o == NULL) o = new_list(gc);
 
   } else {
-    o = parse_atom(expr_start, &expr_size);
+    o = parse_atom(expr_start, &expr_size, symbols, gc);
   }
 
   if (num_parsed_p != NULL) *num_parsed_p = start + expr_size;
@@ -79,6 +87,9 @@ expression unparse(const obj* o) {
   if (is_primitive(o)) return unparse_primitive(o);
 
   if (is_closure(o)) return unparse_closure(o);
+  if (is_partial(o)) return unparse_partial(o);
+  if (is_vector(o)) return unparse_vector(o);
+  if (is_hashtable(o)) return unparse_hashtable(o);
 
   if (is_list(o)) {
     expression list_expr = unparse_list(o);
@@ -180,11 +191,84 @@ static expression unparse_closure(const obj* o) {
   return strdup(buf);
 }
 
+/**
+ * Function: unparse_partial
+ * -------------------------
+ * Serializes a partial application into a string
+ * @param o: The partial application to serialize
+ * @return: The serialization of the partial application in a string
+ */
+static expression unparse_partial(const obj* o) {
+  if (!is_partial(o)) return NULL;
+
+  const obj *closure = applied_closure(o);
+  int num_applied = NARGS(closure) - PARTIAL_NARGS(o);
+  expression para = unparse(sublist(PARAMETERS(closure), num_applied));
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "<partial:%s, %d args applied>", para, num_applied);
+  free(para);
+  return strdup(buf);
+}
+
+/**
+ * Function: unparse_hashtable
+ * ---------------------------
+ * Serializes a hash table into a string of the form <hash-table:N entries>
+ * @param o: The hash table to serialize
+ * @return: The serialization of the hash table in dynamically allocated memory
+ */
+static expression unparse_hashtable(const obj* o) {
+  if (!is_hashtable(o)) return NULL;
+
+  char buf[64];
+  snprintf(buf, sizeof(buf), "<hash-table:%u entries>", cmap_count(HASHTABLE(o)));
+  return strdup(buf);
+}
+
+/**
+ * Function: unparse_vector
+ * ------------------------
+ * Serializes a vector into a string of its elements between "#(" and ")"
+ * @param o: The vector to serialize
+ * @return: The serialization of the vector in dynamically allocated memory, or NULL if an element could not be serialized
+ */
+static expression unparse_vector(const obj* o) {
+  if (!is_vector(o)) return NULL;
+
+  int length = VECTOR_LENGTH(o);
+  expression *items = malloc((length + 1) * sizeof(expression)); // at least one, for malloc
+  MALLOC_CHECK(items);
+
+  // Serialize each element first, so that the whole string is allocated and copied only once
+  size_t size = strlen("#()") + 1;
+  int i;
+  for (i = 0; i < length; i++) {
+    if ((items[i] = unparse(VECTOR_ITEMS(o)[i])) == NULL) break;
+    size += strlen(items[i]) + 1;
+  }
+
+  expression e = NULL;
+  if (i == length) {
+    e = malloc(size);
+    MALLOC_CHECK(e);
+    char *end = e + sprintf(e, "#(");
+    for (int j = 0; j < length; j++)
+      end += sprintf(end, j == 0 ? "%s" : " %s", items[j]);
+    strcpy(end, ")");
+  }
+
+  for (int j = 0; j < i; j++)
+    free(items[j]);
+  free(items);
+  return e;
+}
+
 /**
  * Function: unparse_atom
  * ----------------------
  * Serializes an atom into a lisp expression in dynamically allocated memory.
- * This function will handle objects of type atom_obj as well as integer_obj and float_obj
+ * This function will handle objects of type atom_obj as well as numbers
  * @param o: Pointer to an atom object
  * @return: Pointer to dynamically allocated memory with the an expression representing the atom
  */
@@ -200,13 +284,20 @@ static expression unparse_atom(const obj *o) {
 
   if (is_int(o)) {
     expression e = calloc(BUFFSIZE, 1);
-    sprintf(e, "%d", get_int(o));
+    sprintf(e, "%" PRId64, get_int(o));
     return e;
   }
 
+  if (is_bignum(o)) return bignum_to_string(BIGNUM(o));
+
   if (is_float(o)) {
+    // The shortest representation that reads back as the same double
+    double value = get_float(o);
     expression e = calloc(BUFFSIZE, 1);
-    sprintf(e, "%g", get_float(o));
+    for (int precision = 15; precision <= 17; precision++) {
+      sprintf(e, "%.*g", precision, value);
+      if (strtod(e, NULL) == value) break;
+    }
     return e;
   }
   LOG_ERROR("Attempted to parse object that is not an atom");
@@ -224,9 +315,7 @@ static expression unparse_primitive(const obj *o) {
   if (o == NULL) return NULL;
   expression e = malloc(strlen(KMAG) + 2 + sizeof(void*) * 8 / 4 + strlen(RESET) + 1);
   MALLOC_CHECK(e);
-  void* p = NULL;
-  memcpy(&p, (void**) PRIMITIVE(o), sizeof(primitive_t));
-  sprintf(e, KMAG "%p" RESET, p);
+  sprintf(e, KMAG "%p" RESET, (const void*) PRIMITIVE(o));
   return e;
 }
 
@@ -235,30 +324,36 @@ static expression unparse_primitive(const obj *o) {
  * --------------------
  * Parses an expression that represents an atom or number.
  * NOTE: If the expression can be turned into an integer or floating point object then it will be
- * and then the returned object will be of the integer_obj or float_obj instead of atom_obj. Also note
- * that integer object is preferred over float object (i.e. "3" will be parsed into an integer even
+ * and then the returned object will be a number (a bignum if the integer is too large for a fixnum)
+ * instead of an atom_obj. Also note that integer object is preferred over float object (i.e. "3" will be parsed into an integer even
  * though it could also be parsed as a float)
  * @param e: A pointer to an atom expression
  * @param num_parsed_p: Pointer to a location to be populated with the number of characters parsed
- * @return: A lisp object representing the parsed atom in dynamically allocated memory
+ * @param symbols: Symbol table to intern the atom in
+ * @param gc: Garbage collector to allocate numbers that aren't immediates from
+ * @return: A lisp object representing the parsed atom, numbers in dynamically allocated memory
  */
-static obj* parse_atom(const_expression e, size_t *num_parsed_p) {
+static obj* parse_atom(const_expression e, size_t *num_parsed_p, SymbolTable *symbols, GarbageCollector *gc) {
   size_t size = atom_size(e);
 
   bool has_decimal = contains_dot(e, size);
 
   char* contents = strncpy(calloc(size + 1, 1), e, size);
   char* end;
-  int int_value = (int) strtol(contents, &end, 0);
-  bool is_integer = contents != end;
+  errno = 0;
+  long long int_value = strtoll(contents, &end, 0);
+  bool is_integer = contents != end && *end == '\0';
+  bool overflowed = errno == ERANGE;
 
-  float float_value = strtof(contents, &end);
-  bool is_float = contents != end;
+  double float_value = strtod(contents, &end);
+  bool is_float = contents != end && *end == '\0';
 
   obj* o;
-  if (is_integer && !has_decimal) o = new_int(int_value);
-  else if (is_float) o = new_float(float_value);
-  else o = new_atom(contents);
+  Bignum *big;
+  if (is_integer && !has_decimal && !overflowed) o = new_integer(int_value, gc);
+  else if (is_integer && !has_decimal && (big = bignum_parse(contents)) != NULL) o = new_bignum(big, gc);
+  else if (is_float) o = new_float(float_value, gc);
+  else o = intern(symbols, contents);
   *num_parsed_p = size;
   free(contents);
   return o;
@@ -273,9 +368,11 @@ static obj* parse_atom(const_expression e, size_t *num_parsed_p) {
  * parentheses as there may be lists nested inside of this list.
  * @param e: An expression representing a list
  * @param num_parsed_p: A pointer to a place where the number of parsed characters may be written. Must be valid
+ * @param symbols: Symbol table to intern the atoms of the list in
+ * @param gc: Garbage collector to allocate the list from
  * @return: Pointer to a lisp data structure object representing the lisp expression
  */
-static obj* parse_list(const_expression e, size_t *num_parsed_p) {
+static obj* parse_list(const_expression e, size_t *num_parsed_p, SymbolTable *symbols, GarbageCollector *gc) {
   int start = distance_to_next_element(e);
   expression exprStart = (char*) e + start;
 
@@ -285,12 +382,12 @@ static obj* parse_list(const_expression e, size_t *num_parsed_p) {
   } // Empty list or the end of a list
 
   size_t exprSize;
-  obj* nextElement = parse_expression(exprStart, &exprSize); // will find closing paren
-  obj* o = new_list_set(nextElement, NULL);
+  obj* nextElement = parse_expression(exprStart, &exprSize, symbols, gc); // will find closing paren
+  obj* o = new_list_set(nextElement, NULL, gc);
 
   size_t restSize;
   expression restOfList = (char*) exprStart + exprSize;
-  CDR(o) = parse_list(restOfList, &restSize);
+  CDR(o) = parse_list(restOfList, &restSize, symbols, gc);
 
   *num_parsed_p = start + exprSize + restSize;
   return o;
@@ -300,13 +397,14 @@ static obj* parse_list(const_expression e, size_t *num_parsed_p) {
  * Function: get_quote_list
  * ------------------------
  * Creates a list where car points to a "quote" atom and cdr points to nothing
+ * @param symbols: Symbol table to intern the "quote" atom in
+ * @param gc: Garbage collector to allocate the list from
  * @return: Pointer to the list object
  */
-static obj* get_quote_list() {
-  size_t i;
-  obj* quote_atom = parse_atom("quote", &i);
+static obj* get_quote_list(SymbolTable *symbols, GarbageCollector *gc) {
+  obj* quote_atom = intern(symbols, "quote");
   if (quote_atom == NULL) return NULL;
-  return new_list_set(quote_atom, NULL);
+  return new_list_set(quote_atom, NULL, gc);
 }
 
 /**
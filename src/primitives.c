@@ -14,6 +14,8 @@
 #include <lisp-objects.h>
 #include <list.h>
 #include <closure.h>
+#include <math-lib.h>
+#include <hash.h>
 
 #include <assert.h>
 #include <string.h>
@@ -21,54 +23,84 @@
 
 // forward declarations of primitives
 static def_primitive(quote);
-static def_primitive(atom);
-static def_primitive(eq);
-static def_primitive(car);
-static def_primitive(cdr);
-static def_primitive(cons);
+static def_function(atom);
+static def_function(eq);
+static def_function(car);
+static def_function(cdr);
+static def_function(cons);
 static def_primitive(cond);
 static def_primitive(set);
-static def_primitive(env);
+static def_function(env);
 static def_primitive(lambda);
 static def_primitive(defmacro);
 
 const obj lisp_NIL; // The empty list / NIL value within lisp.
 const obj lisp_T;   // The true atom.
 
-static atom_t primitive_reserved_names[] = { "quote", "atom", "eq", "car", "cdr", "cons",
-                                             "cond", "set", "env", "lambda", "defmacro", NULL };
-
-static const primitive_t primitive_functions[] = { &quote, &atom, &eq, &car, &cdr, &cons,
-                                                   &cond, &set, &env, &lambda, &defmacro,  NULL };
+// Special forms are applied to their unevaluated arguments, and functions to the values of theirs
+static const primitive_def primitives[] = {
+  { "quote",    &quote,    NULL,   0, VARIADIC },
+  { "atom",     NULL,      &atom,  1, 1 },
+  { "eq",       NULL,      &eq,    2, 2 },
+  { "car",      NULL,      &car,   1, 1 },
+  { "cdr",      NULL,      &cdr,   1, 1 },
+  { "cons",     NULL,      &cons,  2, 2 },
+  { "cond",     &cond,     NULL,   0, VARIADIC },
+  { "set",      &set,      NULL,   0, VARIADIC },
+  { "env",      NULL,      &env,   0, 0 },
+  { "lambda",   &lambda,   NULL,   0, VARIADIC },
+  { "defmacro", &defmacro, NULL,   0, VARIADIC },
+  { NULL,       NULL,      NULL,   0, 0 }
+};
+
+// The names in the body of a lambda expression that a closure made from it may capture
+typedef struct lambda_names {
+  const obj *params;    // Parameters of the lambda expression, which are never captured
+  int first;            // Index of the first name in the cache's vector of names
+  int count;            // Number of names
+} lambda_names;
 
 // Static function declarations
-static bool capture_variables(obj **capturedp, const obj *params, const obj *procedure, const obj *env);
+static const lambda_names *free_variables(const obj *params, const obj *procedure, LispInterpreter *interpreter);
+static void find_free_variables(const obj *params, const obj *expr, CVector *names, int first);
+static bool capture_variables(obj **capturedp, const lambda_names *names, LispInterpreter *interpreter);
 
 
-obj* get_primitive_library() {
-  return create_environment(primitive_reserved_names, primitive_functions);
+obj* get_primitive_library(SymbolTable *symbols, GarbageCollector *gc) {
+  return create_environment(primitives, symbols, gc);
 }
 
-obj* new_primitive(primitive_t primitive) {
-  obj* o = malloc(sizeof(obj) + sizeof(primitive_t));
+obj* new_primitive(const primitive_def *primitive, GarbageCollector *gc) {
+  obj* o = gc_allocate(gc, sizeof(obj) + sizeof(const primitive_def *));
   MALLOC_CHECK(o);
   o->objtype = primitive_obj;
-  o->reachable = false;
-  memcpy(PRIMITIVE(o), &primitive, sizeof(primitive));
+  PRIMITIVE(o) = primitive;
   return o;
 }
 
-// Allocate new truth atom
-obj *t(GarbageCollector *mm) {
-  obj* t = new_atom("t");
-  gc_add(mm, t);
-  return t;
+bool check_arity(const primitive_def *primitive, int nargs) {
+  if (nargs >= primitive->min_args && (primitive->max_args == VARIADIC || nargs <= primitive->max_args))
+    return true;
+
+  if (primitive->min_args == primitive->max_args)
+    log_error(primitive->name, "Expected %d arguments, got %d", primitive->min_args, nargs);
+  else if (primitive->max_args == VARIADIC)
+    log_error(primitive->name, "Expected %d or more arguments, got %d", primitive->min_args, nargs);
+  else
+    log_error(primitive->name, "Expected %d to %d arguments, got %d", primitive->min_args,
+              primitive->max_args, nargs);
+  return false;
+}
+
+// Get the interned truth atom
+obj *t(LispInterpreter *interpreter) {
+  return intern(&interpreter->symbols, "t");
 }
 
 // Allocate new empty list
-obj *nil(GarbageCollector *mm) {
-  obj* list = new_list_set(NULL, NULL);
-  gc_add(mm, list);
+obj *nil(LispInterpreter *interpreter) {
+  obj* list = new_list_set(NULL, NULL, &interpreter->gc);
+  gc_add(&interpreter->gc, list);
   return list;
 }
 
@@ -90,12 +122,11 @@ static def_primitive(quote) {
  * ---------------
  * Checks if an object is an atom
  */
-static def_primitive(atom) {
-  if (!CHECK_NARGS(args, 1)) return NULL;
-  obj* result = eval(CAR(args), interpreter);
-  if (is_list(result)) return is_nil(result) ? t(&interpreter->gc) : nil(&interpreter->gc);
-  if (is_atom(result)) return t(&interpreter->gc);
-  return is_number(result) ? t(&interpreter->gc) : nil(&interpreter->gc);
+static def_function(atom) {
+  obj* value = argv[0];
+  if (is_list(value)) return is_nil(value) ? t(interpreter) : nil(interpreter);
+  if (is_atom(value)) return t(interpreter);
+  return is_number(value) ? t(interpreter) : nil(interpreter);
 }
 
 /**
@@ -103,16 +134,9 @@ static def_primitive(atom) {
  * -------------
  * Test for equality of two objects
  */
-static def_primitive(eq) {
-  if (!CHECK_NARGS(args, 2)) return NULL;
-
-  obj* first = eval(ith(args, 0), interpreter);
-  if (first == NULL) return NULL;
-  obj* second = eval(ith(args, 1), interpreter);
-  if (second == NULL) return NULL;
-
-  bool same = compare(first, second);
-  return same ? t(&interpreter->gc) : nil(&interpreter->gc);
+static def_function(eq) {
+  bool same = compare(argv[0], argv[1]);
+  return same ? t(interpreter) : nil(interpreter);
 }
 
 /**
@@ -121,20 +145,14 @@ static def_primitive(eq) {
  * Takes a single argument, evaluates it, and returns the
  * head of the list which is the result of the evaluation.
  */
-static def_primitive(car) {
-  if (!CHECK_NARGS(args, 1)) return NULL;
-  obj* arg_value = eval(CAR(args), interpreter);
-  if (arg_value == NULL) {
-    LOG_ERROR("Error evaluating argument");
-    return NULL;
-  }
-
-  if (!is_list(arg_value)) {
+static def_function(car) {
+  obj* value = argv[0];
+  if (!is_list(value)) {
     LOG_ERROR("Argument is not a list");
     return NULL;
   }
-  if (is_nil(arg_value)) return nil(&interpreter->gc);
-  return CAR(arg_value);
+  if (is_nil(value)) return nil(interpreter);
+  return CAR(value);
 }
 
 /**
@@ -143,22 +161,16 @@ static def_primitive(car) {
  * Takes a single argument, evaluates it, and returns the
  * tail of the list which is the result of the evaluation.
  */
-static def_primitive(cdr) {
-  if (!CHECK_NARGS(args, 1)) return NULL;
-  obj* arg_value = eval(CAR(args), interpreter);
-  if (arg_value == NULL) {
-    LOG_ERROR("Error evaluating argument");
-    return NULL;
-  }
-
-  if (!is_list(arg_value)) {
+static def_function(cdr) {
+  obj* value = argv[0];
+  if (!is_list(value)) {
     LOG_ERROR("Argument is not a list");
     return NULL;
   }
 
-  if (is_nil(arg_value)) return nil(&interpreter->gc);
-  if (CDR(arg_value) == NULL) return nil(&interpreter->gc);
-  return CDR(arg_value);
+  if (is_nil(value)) return nil(interpreter);
+  if (CDR(value) == NULL) return nil(interpreter);
+  return CDR(value);
 }
 
 /**
@@ -170,27 +182,8 @@ static def_primitive(cdr) {
  * Expects the value of y to be a list and returns a list containing the value
  * of x followed by the elements of the value of y
  */
-static def_primitive(cons) {
-  if (!CHECK_NARGS(args, 2)) return NULL;
-
-  obj* y = ith(args, 1);
-  if (y == NULL) {
-    LOG_ERROR("Could not get second argument");
-    return NULL;
-  }
-
-  obj *car = eval(CAR(args), interpreter);
-  if (car == NULL) {
-    LOG_ERROR("Error evaluating first argument");
-    return NULL;
-  }
-
-  obj* cdr = eval(y, interpreter);
-  if (cdr == NULL) {
-    LOG_ERROR("Error evaluating second argument");
-    return NULL;
-  }
-
+static def_function(cons) {
+  obj* cdr = argv[1];
   if (!is_list(cdr)) {
     // no dot notation (yet) means second arg must be list
     LOG_ERROR("Second argument is not list");
@@ -198,14 +191,14 @@ static def_primitive(cons) {
   }
 
   // Allocate new slot to hold x in result list
-  obj *new_obj = new_list();
+  obj *new_obj = new_list(&interpreter->gc);
   if (new_obj == NULL) {
     LOG_ERROR("could not allocate list element");
     return NULL;
   }
   gc_add(&interpreter->gc, new_obj); // Record allocation
 
-  CAR(new_obj) = car;
+  CAR(new_obj) = argv[0];
   CDR(new_obj) = cdr;
 
   return new_obj;
@@ -220,53 +213,57 @@ static def_primitive(cons) {
  * is returned as the expression
  */
 static def_primitive(cond) {
+  const obj *e = cond_expression(args, interpreter);
+  if (e == NULL) return NULL;
 
-  // recursive base case
-  if (args == NULL) return nil(&interpreter->gc);
-
-  if (!is_list(args)) {
-    LOG_ERROR("Arguments are not a list of pairs");
-    return NULL;
-  }
+  obj *value = eval(e, interpreter);
+  if (value == NULL)
+    LOG_ERROR("Error evaluating value for predicate");
+  return value;
+}
 
-  obj *pair = CAR(args);
+const obj *cond_expression(const obj *args, LispInterpreter *interpreter) {
+  for (; args != NULL; args = CDR(args)) {
+    if (!is_list(args)) {
+      LOG_ERROR("Arguments are not a list of pairs");
+      return NULL;
+    }
 
-  if (!is_list(pair)) {
-    LOG_ERROR("Conditional pair clause is not a list");
-    return NULL;
-  }
+    obj *pair = CAR(args);
 
-  if (is_nil(pair)) {
-    LOG_ERROR("Empty Conditional pair.");
-    return NULL;
-  }
+    if (!is_list(pair)) {
+      LOG_ERROR("Conditional pair clause is not a list");
+      return NULL;
+    }
 
-  if (list_length(pair) != 2) {
-    LOG_ERROR("Conditional pair length was %d, not 2.", list_length(pair));
-    return NULL;
-  }
+    if (is_nil(pair)) {
+      LOG_ERROR("Empty Conditional pair.");
+      return NULL;
+    }
 
-  obj *predicate = eval(CAR(pair), interpreter);
-  if (is_primitive(predicate)) {
-    LOG_ERROR("Cannot cast primitive function as bool.");
-    return NULL;
-  }
+    if (list_length(pair) != 2) {
+      LOG_ERROR("Conditional pair length was %d, not 2.", list_length(pair));
+      return NULL;
+    }
 
-  if (!is_nil(predicate)) {
-    // recursive base case: predicate is true
-    obj* e = ith(pair, 1); // get it's associated value
-    if (e == NULL) {
-      LOG_ERROR("Predicate has no associated value");
+    obj *predicate = eval(CAR(pair), interpreter);
+    if (is_primitive(predicate)) {
+      LOG_ERROR("Cannot cast primitive function as bool.");
       return NULL;
     }
-    obj *value = eval(e, interpreter);
-    if (value == NULL)
-      LOG_ERROR("Error evaluating value for predicate");
-    return value;
+
+    if (!is_nil(predicate)) {
+      // predicate is true: the value is that of its associated expression
+      obj* e = ith(pair, 1);
+      if (e == NULL) LOG_ERROR("Predicate has no associated value");
+      return e;
+    }
   }
+  return nil(interpreter);
+}
 
-  // tail recursion on the remaining predicate-expression pairs
-  return cond(CDR(args), interpreter);
+bool is_cond(const obj *o) {
+  return is_primitive(o) && PRIMITIVE(o)->special == &cond;
 }
 
 /**
@@ -292,46 +289,38 @@ static def_primitive(set) {
     LOG_ERROR("Can only set atom types");
     return NULL;
   }
-  obj* value = eval(ith(args, 1), interpreter);
+  obj* value = eval(ith(args, 1), interpreter); // var_name is interned, so needs no root
   if (value == NULL) {
     LOG_ERROR("Error evaluating right-hand-side");
     return NULL;
   }
 
-  // Make a copy of the result
-  obj* result_cpy = copy_recursive(value);
+  // Make a copy of the result, to be freed by the garbage collector once it is unreachable
+  obj* result_cpy = copy_recursive(value, &interpreter->gc);
   if (result_cpy == NULL) {
     LOG_ERROR("Error copying right-hand-side");
     return NULL;
   }
+  gc_add_recursive(&interpreter->gc, result_cpy);
 
   // Store the result in the environment (potentially over-writing)
-  obj** prev_value_p = lookup_entry(var_name, interpreter->env); // previously bound value
-  if (prev_value_p == NULL) {
-    // no previous value found in environment
-    obj* pair_second = new_list_set(result_cpy, NULL);
-    obj *var_name_copy = copy_recursive(var_name);
-    obj *pair_first = new_list_set(var_name_copy, pair_second);
-    obj *new_link = new_list_set(pair_first, interpreter->env);
-
-    if (var_name_copy == NULL || pair_first == NULL ||
-        pair_second == NULL || new_link == NULL) {
+  obj* holder; // pair cell or frame holding the previously bound value
+  obj** entry = lookup_set_entry(var_name, interpreter, &holder);
+  if (entry == NULL) {
+    // no previous value found in environment: define a new global variable
+    obj* pair_second = new_list_set(result_cpy, NULL, &interpreter->gc);
+    obj* pair_first = new_list_set(var_name, pair_second, &interpreter->gc);
+    if (!define_global(pair_first, interpreter)) {
       LOG_ERROR("Error allocating memory to store variable in environment");
-      dispose_recursive(result_cpy);
-      dispose_recursive(var_name_copy);
-      dispose_recursive(pair_first);
-      dispose_recursive(new_link);
+      dispose(pair_first);
+      dispose(pair_second);
       return NULL;
     }
-
-    interpreter->env = new_link;
   } else {
-    // Over-write previous value
-    // Note: must copy the result into a temporary value *before* disposing of the
-    // previous value because the result value may reference the previous value, as in the
-    // case of self-referential over-writing. For example: (set 'x (cdr x))
-    dispose_recursive(*prev_value_p);         // dispose of the old value
-    *prev_value_p = result_cpy;               // store new value in environment
+    // Over-write previous value. The previous value is not disposed of, since closures that
+    // captured the variable share it: it is freed by the garbage collector once unreachable.
+    *entry = result_cpy;
+    gc_write_barrier(&interpreter->gc, holder); // the binding may be older than the new value
     value = result_cpy;
   }
   return value;
@@ -340,11 +329,10 @@ static def_primitive(set) {
 /**
  * Primitive: env
  * --------------
- * Simply returns the environment
+ * Returns the environment, as a list of key-value pairs
  */
-static def_primitive(env) {
-  if (!check_nargs(__func__, args, 0)) return NULL;
-  return interpreter->env;
+static def_function(env) {
+  return environment_list(interpreter);
 }
 
 /**
@@ -378,36 +366,29 @@ static def_primitive(lambda) {
       return NULL;
     }
   }
-  params = copy_recursive(params); // Params are well-formed, make a copy for saving.
-  obj* procedure = copy_recursive(ith(args, 1));
-
-  if (params ==  NULL || procedure == NULL) {
-    LOG_ERROR("Error copying parameters and body of lambda declaration");
-    dispose_recursive(params);
-    dispose_recursive(procedure);
+  obj* procedure = ith(args, 1);
+  if (procedure == NULL) {
+    LOG_ERROR("Lambda declaration has no body");
     return NULL;
   }
 
-  // Capture variables
+  // The closure shares its parameters, body and captured values with the objects they came from,
+  // since none of them are modified in place: only the new pairs and list cells are its own.
   obj* captured = NULL; // Will store the captured variables
-  bool success = capture_variables(&captured, params, procedure, interpreter->env);
-  if (!success) {
+  const lambda_names *names = free_variables(params, procedure, interpreter);
+  if (names == NULL || !capture_variables(&captured, names, interpreter)) {
     LOG_ERROR("Error while capturing lambda variables");
-    dispose_recursive(params);
-    dispose_recursive(procedure);
     return NULL;
   }
 
   // Create new closure object
-  obj* o = new_closure_set(params, procedure, captured);
+  obj* o = new_closure_set(params, procedure, captured, &interpreter->gc);
   if (o == NULL) {
     LOG_ERROR("Error allocating closure object");
-    dispose_recursive(params);
-    dispose_recursive(procedure);
     return NULL;
   }
 
-  gc_add_recursive(&interpreter->gc, o);
+  gc_add(&interpreter->gc, o);
   return o;
 }
 
@@ -421,44 +402,105 @@ static def_primitive(defmacro) {
   return NULL;
 }
 
+bool free_variable_cache_init(FreeVariableCache *cache) {
+  assert(cache != NULL);
+  cache->bodies = cmap_create(sizeof(obj*), sizeof(lambda_names), fast_hash, NULL, NULL, NULL, 0);
+  if (cache->bodies == NULL) return false;
+  if (!cvec_init(&cache->names, sizeof(obj*), 0, NULL)) {
+    cmap_dispose(cache->bodies);
+    return false;
+  }
+  cache->collections = 0;
+  return true;
+}
+
+void free_variable_cache_dispose(FreeVariableCache *cache) {
+  assert(cache != NULL);
+  cmap_dispose(cache->bodies);
+  cvec_dispose(&cache->names);
+}
+
 /**
- * Function: capture_variables
- * ---------------------------
- * Creates a captured variable list by searching for variable names that exist in both the procedure
- * and the environment. Creates a list of key-value pairs extracted (copied) from the environment.
- * Variable names in the parameter list will not be captured.
- * @param capturedp: Pointer to where the captured list reference should be stored
- * @param params: Parameters to the lambda function (these will not be captured
- * @param procedure: Procedure body of the lambda function to search for variables to bind in
- * @param env: Environment to search for values to capture
- * @return true if variables were captures successfully, false otherwise
+ * Function: free_variables
+ * ------------------------
+ * Gets the names in the body of a lambda expression that a closure made from it may capture, searching
+ * the body only if it isn't in the interpreter's cache already. The cache is keyed by the address of the
+ * body, and objects are only freed by collections, so it is emptied once a collection has been done.
+ * @param params: Parameters of the lambda expression
+ * @param procedure: Body of the lambda expression
+ * @param interpreter: Interpreter whose cache to use
+ * @return: The names, which are valid until the next call, or NULL if memory could not be allocated
  */
-static bool capture_variables(obj **capturedp, const obj *params,
-                              const obj *procedure, const obj *env) {
-  if (procedure == NULL) return true;
-
-  if (is_atom(procedure)) {
-    if (lookup_pair(procedure, *capturedp)) return true; // Already captured
-    // Don't capture parameters (those get bound at apply-time)
-    if (list_contains(params, procedure)) return true;
+static const lambda_names *free_variables(const obj *params, const obj *procedure, LispInterpreter *interpreter) {
+  FreeVariableCache *cache = &interpreter->free_variables;
+  const GCPauseStats *pauses = &interpreter->gc.pauses;
+  int collections = pauses->minor_collections + pauses->major_collections;
+  if (collections != cache->collections) {
+    cmap_clear(cache->bodies);
+    cvec_clear(&cache->names);
+    cache->collections = collections;
+  }
 
-    obj* matching_pair = lookup_pair(procedure, env);
-    if (matching_pair == NULL) return true; // No value to be captured
+  const lambda_names *cached = cmap_lookup(cache->bodies, &procedure);
+  if (cached != NULL && cached->params == params) return cached;
 
-    obj *pair_copy = copy_recursive(matching_pair);
-    if (pair_copy == NULL) return false;
+  lambda_names names = { params, cvec_count(&cache->names), 0 };
+  find_free_variables(params, procedure, &cache->names, names.first);
+  names.count = cvec_count(&cache->names) - names.first;
+  if (cmap_insert(cache->bodies, &procedure, &names) == NULL) return NULL;
+  return cmap_lookup(cache->bodies, &procedure);
+}
 
-    obj *new_list = new_list_set(pair_copy, *capturedp); // Prepend to capture list
-    if (new_list == NULL) {
-      dispose_recursive(pair_copy);
-      return false;
+/**
+ * Function: find_free_variables
+ * -----------------------------
+ * Appends each distinct atom in an expression that is not a parameter to a vector of names, in the
+ * order of a depth-first search
+ * @param params: Parameters to the lambda function (these will not be captured)
+ * @param expr: Expression to search for names in
+ * @param names: Vector of names to append to
+ * @param first: Index of the first name in the vector found for this lambda expression
+ */
+static void find_free_variables(const obj *params, const obj *expr, CVector *names, int first) {
+  for (; expr != NULL; expr = CDR(expr)) {
+    if (is_atom(expr)) {
+      if (list_contains(params, expr)) return; // Don't capture parameters (those get bound at apply-time)
+      for (int i = first; i < cvec_count(names); i++)
+        if (*(obj **) cvec_nth(names, i) == expr) return;  // Already found
+      cvec_append(names, &expr);
+      return;
     }
-    *capturedp = new_list;
+    if (!is_list(expr)) return;
+    find_free_variables(params, CAR(expr), names, first); // depth-first search
+  }
+}
 
-  } else if (is_list(procedure)) { // depth-first search
-    bool success = capture_variables(capturedp, params, CAR(procedure), env);
-    if (!success) return false;
-    return capture_variables(capturedp, params, CDR(procedure), env); // tail recursion
+/**
+ * Function: capture_variables
+ * ---------------------------
+ * Creates a captured variable list from the names in the body of a lambda expression that exist in the
+ * environment. Creates a list of key-value pairs whose values are shared with the environment.
+ * @param capturedp: Pointer to where the captured list reference should be stored
+ * @param names: Names that the lambda expression may capture
+ * @param interpreter: Interpreter whose environment to search for values to capture
+ * @return true if variables were captures successfully, false otherwise
+ */
+static bool capture_variables(obj **capturedp, const lambda_names *names, LispInterpreter *interpreter) {
+  const CVector *all_names = &interpreter->free_variables.names;
+  for (int i = names->first; i < names->first + names->count; i++) {
+    obj *name = *(obj **) cvec_nth(all_names, i);
+    obj** entry = lookup_entry(name, interpreter, NULL);
+    if (entry == NULL) continue; // No value to be captured
+
+    obj *pair = make_pair(name, *entry, false, &interpreter->gc);
+    if (pair == NULL) return false;
+    gc_add(&interpreter->gc, pair);
+    gc_add(&interpreter->gc, CDR(pair));
+
+    obj *new_list = new_list_set(pair, *capturedp, &interpreter->gc); // Prepend to capture list
+    if (new_list == NULL) return false;
+    gc_add(&interpreter->gc, new_list);
+    *capturedp = new_list;
   }
   return true;
 }
@@ -23,7 +23,7 @@ static void int_handler(int signal);
 static LispInterpreter* interpreter;
 
 int run_lisp(const char *bootstrap_path, const char *program_file, bool run_repl,
-             const char *history_file, bool verbose) {
+             const char *history_file, bool use_vm, bool verbose) {
 
   if (bootstrap_path && !check_read_permissions(bootstrap_path)) return errno;
   if (program_file && !check_read_permissions(program_file)) return errno;
@@ -36,6 +36,7 @@ int run_lisp(const char *bootstrap_path, const char *program_file, bool run_repl
     LOG_ERROR("Error initializing interpreter");
     return -1;
   }
+  interpreter.vm.enabled = use_vm;
 
   signal(SIGINT, int_handler); // install signal handler
   if (bootstrap_path != NULL) {
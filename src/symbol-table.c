@@ -0,0 +1,72 @@
+/*
+ * File: symbol-table.c
+ * --------------------
+ * Presents the implementation of the table of interned symbols
+ */
+
+#include <symbol-table.h>
+#include <stack-trace.h>
+
+#include <stdlib.h>
+#include <assert.h>
+
+// Initial capacity of the name index of the symbol table
+#define SYMBOL_INDEX_CAPACITY 512
+
+// Static function declarations
+static void symbol_cleanup(obj **symbolp);
+
+bool symbol_table_init(SymbolTable *symbols) {
+  assert(symbols != NULL);
+  CleanupFn cleanup_fn = (CleanupFn) &symbol_cleanup;
+  if (!cvec_init(&symbols->symbols, sizeof(obj*), SYMBOL_INDEX_CAPACITY / 2, cleanup_fn))
+    return false;
+
+  symbols->index = cmap_create(sizeof(atom_t), sizeof(obj*), string_hash, cmp_cstr, NULL, NULL, SYMBOL_INDEX_CAPACITY);
+  if (symbols->index == NULL) {
+    cvec_dispose(&symbols->symbols);
+    return false;
+  }
+  return true;
+}
+
+obj *intern(SymbolTable *symbols, atom_t name) {
+  assert(symbols != NULL);
+  if (name == NULL) return NULL;
+
+  obj **existing = cmap_lookup(symbols->index, &name);
+  if (existing != NULL) return *existing;
+
+  obj *symbol = new_atom(name);
+  atom_t key = ATOM(symbol); // the key must outlive the name passed in
+  if (cmap_insert(symbols->index, &key, &symbol) == NULL) {
+    free(symbol);
+    return NULL;
+  }
+  cvec_append(&symbols->symbols, &symbol);
+  return symbol;
+}
+
+int symbol_count(const SymbolTable *symbols) {
+  assert(symbols != NULL);
+  return cvec_count(&symbols->symbols);
+}
+
+void symbol_table_dispose(SymbolTable *symbols) {
+  assert(symbols != NULL);
+  cmap_dispose(symbols->index);
+  cvec_dispose(&symbols->symbols);
+}
+
+/**
+ * Function: symbol_cleanup
+ * ------------------------
+ * Frees an interned atom given a pointer to the reference to it. This is
+ * the cleanup function of the vector of symbols. The atom is freed directly,
+ * since dispose does not free atoms.
+ * @param symbolp: Pointer to a reference to the atom to free
+ */
+static void symbol_cleanup(obj **symbolp) {
+  assert(symbolp != NULL);
+  free(*symbolp);
+}
@@ -0,0 +1,205 @@
+/*
+ * File: vector-lib.c
+ * ------------------
+ * Presents the implementation of the vector library
+ */
+
+#include <vector-lib.h>
+#include <environment.h>
+#include <list.h>
+#include <stack-trace.h>
+
+// forward declarations of primitives
+static def_function(make_vector);
+static def_function(vector_ref);
+static def_function(vector_set);
+static def_function(vector_length);
+static def_function(list_to_vector);
+static def_function(vector_to_list);
+
+static const primitive_def vector_primitives[] = {
+  { "make-vector",   NULL, &make_vector,    1, 2 },
+  { "vector-ref",    NULL, &vector_ref,     2, 2 },
+  { "vector-set!",   NULL, &vector_set,     3, 3 },
+  { "vector-length", NULL, &vector_length,  1, 1 },
+  { "list->vector",  NULL, &list_to_vector, 1, 1 },
+  { "vector->list",  NULL, &vector_to_list, 1, 1 },
+  { NULL,            NULL, NULL,            0, 0 }
+};
+
+// Static function declarations
+static bool get_index(const obj *index, int length, int *i);
+static obj *store_value(const obj *value, GarbageCollector *gc);
+
+obj* get_vector_library(SymbolTable *symbols, GarbageCollector *gc) {
+  return create_environment(vector_primitives, symbols, gc);
+}
+
+/**
+ * Primitive: make-vector
+ * ----------------------
+ * Usage: (make-vector n) or (make-vector n fill)
+ *
+ * Makes a vector of n elements, each of which is the value of fill if it is given,
+ * and otherwise the empty list
+ */
+static def_function(make_vector) {
+  obj *length = argv[0];
+  if (!is_int(length) || get_int(length) < 0 || get_int(length) > VECTOR_MAX_LENGTH) {
+    LOG_ERROR("Length is not an integer between 0 and %d", VECTOR_MAX_LENGTH);
+    return NULL;
+  }
+
+  obj *fill = argc == 2 ? store_value(argv[1], &interpreter->gc) : nil(interpreter);
+  obj *vector = new_vector((int) get_int(length), &interpreter->gc);
+  gc_add(&interpreter->gc, vector);
+  for (int i = 0; i < VECTOR_LENGTH(vector); i++)
+    VECTOR_ITEMS(vector)[i] = fill; // elements are values, so they may all share one
+  return vector;
+}
+
+/**
+ * Primitive: vector-ref
+ * ---------------------
+ * Usage: (vector-ref v i)
+ *
+ * Gets the element of v at index i (counting from zero)
+ */
+static def_function(vector_ref) {
+  obj *vector = argv[0];
+  if (!is_vector(vector)) {
+    LOG_ERROR("First argument is not a vector");
+    return NULL;
+  }
+  int i;
+  if (!get_index(argv[1], VECTOR_LENGTH(vector), &i)) return NULL;
+  return VECTOR_ITEMS(vector)[i];
+}
+
+/**
+ * Primitive: vector-set!
+ * ----------------------
+ * Usage: (vector-set! v i x)
+ *
+ * Replaces the element of v at index i with (a copy of) the value of x, and returns v. The
+ * vector is modified in place, and the change is seen through every reference to it.
+ */
+static def_function(vector_set) {
+  obj *vector = argv[0];
+  if (!is_vector(vector)) {
+    LOG_ERROR("First argument is not a vector");
+    return NULL;
+  }
+  int i;
+  if (!get_index(argv[1], VECTOR_LENGTH(vector), &i)) return NULL;
+
+  VECTOR_ITEMS(vector)[i] = store_value(argv[2], &interpreter->gc);
+  gc_write_barrier(&interpreter->gc, vector); // the value may be younger than the vector
+  return vector;
+}
+
+/**
+ * Primitive: vector-length
+ * ------------------------
+ * Usage: (vector-length v)
+ *
+ * Gets the number of elements in v
+ */
+static def_function(vector_length) {
+  obj *vector = argv[0];
+  if (!is_vector(vector)) {
+    LOG_ERROR("Argument is not a vector");
+    return NULL;
+  }
+  return new_int(VECTOR_LENGTH(vector));
+}
+
+/**
+ * Primitive: list->vector
+ * -----------------------
+ * Usage: (list->vector '(a b c)) --> #(a b c)
+ *
+ * Makes a vector of the elements of a list
+ */
+static def_function(list_to_vector) {
+  obj *list = argv[0];
+  if (!is_list(list)) {
+    LOG_ERROR("Argument is not a list");
+    return NULL;
+  }
+
+  int length = is_nil(list) ? 0 : list_length(list);
+  if (length > VECTOR_MAX_LENGTH) {
+    LOG_ERROR("List has more than %d elements", VECTOR_MAX_LENGTH);
+    return NULL;
+  }
+  obj *vector = new_vector(length, &interpreter->gc);
+  gc_add(&interpreter->gc, vector);
+
+  int i = 0;
+  for (const obj *l = list; i < length; l = CDR(l))
+    VECTOR_ITEMS(vector)[i++] = store_value(CAR(l), &interpreter->gc);
+  return vector;
+}
+
+/**
+ * Primitive: vector->list
+ * -----------------------
+ * Usage: (vector->list v)
+ *
+ * Makes a list of the elements of a vector
+ */
+static def_function(vector_to_list) {
+  obj *vector = argv[0];
+  if (!is_vector(vector)) {
+    LOG_ERROR("Argument is not a vector");
+    return NULL;
+  }
+  if (VECTOR_LENGTH(vector) == 0) return nil(interpreter);
+
+  // Built from the last element back, so that each cell is the CDR of the next one made
+  obj *list = NULL;
+  for (int i = VECTOR_LENGTH(vector) - 1; i >= 0; i--) {
+    list = new_list_set(VECTOR_ITEMS(vector)[i], list, &interpreter->gc);
+    gc_add(&interpreter->gc, list);
+  }
+  return list;
+}
+
+/**
+ * Function: get_index
+ * -------------------
+ * Checks that an object is an index into a vector, reporting an error if it isn't
+ * @param index: The object to use as an index
+ * @param length: The length of the vector being indexed
+ * @param i: Location to write the index to
+ * @return: True if the object is an integer between zero and one less than the length, false otherwise
+ */
+static bool get_index(const obj *index, int length, int *i) {
+  if (!is_int(index)) {
+    LOG_ERROR("Index is not an integer");
+    return false;
+  }
+  int64_t value = get_int(index);
+  if (value < 0 || value >= length) {
+    LOG_ERROR("Index %lld out of range for vector of length %d", (long long) value, length);
+    return false;
+  }
+  *i = (int) value;
+  return true;
+}
+
+/**
+ * Function: store_value
+ * ---------------------
+ * Copies a value to store in a vector, as set copies a value to store in the environment,
+ * since the value may be part of the expression being evaluated, which isn't collected
+ * @param value: The value to store
+ * @param gc: Garbage collector to allocate the copy from, and record it with
+ * @return: A copy of the value
+ */
+static obj *store_value(const obj *value, GarbageCollector *gc) {
+  obj *copy = copy_recursive(value, gc);
+  gc_add_recursive(gc, copy);
+  return copy;
+}
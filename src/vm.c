@@ -0,0 +1,615 @@
+/*
+ * File: vm.c
+ * ----------
+ * Presents the implementation of the bytecode virtual machine. Where the compiler supports
+ * it (GCC and Clang), instructions are dispatched with computed gotos, so that each
+ * instruction jumps directly to the next one's handler rather than back through a switch.
+ */
+
+#include <vm.h>
+#include <evaluator.h>
+#include <environment.h>
+#include <primitives.h>
+#include <math-lib.h>
+#include <list.h>
+#include <closure.h>
+#include <stack-trace.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define VM_STACK_SIZE (1 << 20)     // Number of values that the value stack has room for
+#define VM_MAX_FRAMES (1 << 18)     // Most calls to compiled closures that may be in progress at once
+
+#if defined(__GNUC__)
+#define VM_THREADED_DISPATCH
+#endif
+
+// Fixnums, without the function calls of is_int, get_int and new_int (see lisp-objects.h). As a
+// 64-bit integer, the reference to the fixnum v is 4v + 1, so arithmetic can be done on it directly.
+#define BOTH_INTS(x, y) ((((uintptr_t) (x) & (uintptr_t) (y)) & IMMEDIATE_TAG_MASK) == INT_TAG)
+#define TAGGED(o)       ((int64_t) (uintptr_t) (o))
+#define INT_VALUE(o)    ((TAGGED(o) - (int64_t) INT_TAG) / ((int64_t) 1 << IMMEDIATE_SHIFT))
+#define UNTAGGED(t)     ((obj*) (uintptr_t) (t))
+
+// Static function declarations
+static obj *run(VM *vm, const Bytecode *code, obj **base, LispInterpreter *interpreter);
+static bool allocate_stacks(VM *vm, GarbageCollector *gc);
+static bool compare_ints(math_op op, int64_t x, int64_t y);
+static obj **spread_partial(const VM *vm, obj **sp, int nargs);
+static bool replaces_call(VM *vm, const obj *callee, const obj *closure, LispInterpreter *interpreter);
+static obj *call_function(VM *vm, obj *oper, obj **args, int nargs, LispInterpreter *interpreter);
+static obj *quote_value(const VM *vm, obj *value, GarbageCollector *gc);
+static obj *make_closure(const obj *lambda_args, const uint16_t *captures, int num_captures,
+                         obj **args, obj **constants, LispInterpreter *interpreter);
+
+bool vm_init(LispInterpreter *interpreter) {
+  assert(interpreter != NULL);
+  VM *vm = &interpreter->vm;
+  memset(vm, 0, sizeof(VM));
+  vm->enabled = true;
+  vm->t = t(interpreter);
+
+  // The VM's own copy, since quote may be rebound in the global environment
+  obj *pair = lookup_global(intern(&interpreter->symbols, "quote"), interpreter);
+  if (pair == NULL || !is_primitive(CAR(CDR(pair)))) return false;
+  vm->quote = new_primitive(PRIMITIVE(CAR(CDR(pair))), &interpreter->gc);
+  return vm->t != NULL && vm->quote != NULL;
+}
+
+obj *vm_apply(const obj *function, const obj *args, LispInterpreter *interpreter) {
+  const obj *closure = applied_closure(function);
+  assert(closure != NULL && CODE(closure) != NULL);
+  VM *vm = &interpreter->vm;
+  GarbageCollector *gc = &interpreter->gc;
+  if (vm->stack == NULL && !allocate_stacks(vm, gc)) return NULL;
+
+  // The call continues the stack of any call to compiled code that is in progress
+  obj **top = gc->stack_top;
+  obj **sp = top;
+  if (sp + 1 + NARGS(closure) > vm->stack_end) {
+    LOG_ERROR("Stack overflow");
+    return NULL;
+  }
+
+  *sp++ = (obj*) closure;
+  sp = partial_values(function, sp);
+  gc->stack_top = sp;
+  FOR_LIST(args, arg) {
+    if (arg == NULL) break; // no arguments
+    obj *value = eval(arg, interpreter);
+    if (value == NULL) {
+      gc->stack_top = top;
+      return NULL;
+    }
+    *sp++ = value;
+    gc->stack_top = sp;
+  }
+
+  obj *result = run(vm, CODE(closure), sp - NARGS(closure), interpreter);
+  gc->stack_top = top;
+  return result;
+}
+
+obj *vm_apply_primitive(const primitive_def *primitive, const obj *args, LispInterpreter *interpreter) {
+  VM *vm = &interpreter->vm;
+  GarbageCollector *gc = &interpreter->gc;
+  int nargs = list_length(args);
+  if (!check_arity(primitive, nargs)) return NULL;
+  if (vm->stack == NULL && !allocate_stacks(vm, gc)) return NULL;
+
+  // The values are pushed above any call to compiled code that is in progress
+  obj **argv = gc->stack_top;
+  if (argv + nargs > vm->stack_end) {
+    LOG_ERROR("Stack overflow");
+    return NULL;
+  }
+
+  obj **sp = argv;
+  FOR_LIST(args, arg) {
+    if (arg == NULL) break; // no arguments
+    obj *value = eval(arg, interpreter);
+    if (value == NULL) {
+      gc->stack_top = argv;
+      return NULL;
+    }
+    *sp++ = value;
+    gc->stack_top = sp;
+  }
+
+  obj *result = primitive->function(nargs, argv, interpreter);
+  gc->stack_top = argv;
+  return result;
+}
+
+void vm_dispose(VM *vm) {
+  assert(vm != NULL);
+  free(vm->stack);
+  free(vm->frames);
+  dispose(vm->quote);
+  memset(vm, 0, sizeof(VM));
+}
+
+/**
+ * Function: run
+ * -------------
+ * Runs the code of a compiled closure, along with the code of every compiled closure that it
+ * calls, until it returns
+ * @param vm: The VM
+ * @param code: The code of the closure
+ * @param base: The arguments of the call, on the stack just after the closure
+ * @param interpreter: The interpreter to run the code in
+ * @return: The result of the call, or NULL if an error occurred
+ */
+static obj *run(VM *vm, const Bytecode *code, obj **base, LispInterpreter *interpreter) {
+  GarbageCollector *gc = &interpreter->gc;
+  int entry = vm->num_frames;
+  obj **sp = base + code->nargs;
+  obj **constants;
+  const uint16_t *pc;
+  obj *result;
+
+#ifdef VM_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+  static const void *const targets[NUM_OPCODES] = {
+    &&OP_CONST_target, &&OP_ARG_target, &&OP_GLOBAL_target, &&OP_JUMP_target,
+    &&OP_JUMP_IF_NIL_target, &&OP_JUMP_UNLESS_COMPARE_target, &&OP_JUMP_UNLESS_EQ_target,
+    &&OP_ADD_target, &&OP_SUB_target, &&OP_MUL_target, &&OP_MATH_target, &&OP_EQ_target,
+    &&OP_ATOM_target, &&OP_CAR_target, &&OP_CDR_target, &&OP_CONS_target, &&OP_NIL_target,
+    &&OP_LAMBDA_target, &&OP_CALL_target, &&OP_TAIL_CALL_target, &&OP_RETURN_target
+  };
+#define TARGET(op) op##_target:
+#define DISPATCH() goto *targets[*pc++]
+#else
+#define TARGET(op) case op:
+#define DISPATCH() goto dispatch
+#endif
+
+enter:
+  // A new call, with its closure and arguments on the stack below sp
+  if (vm->num_frames == VM_MAX_FRAMES || sp + code->max_stack - code->nargs > vm->stack_end) {
+    LOG_ERROR("Stack overflow");
+    goto error;
+  }
+  vm->frames[vm->num_frames].code = code;
+  vm->frames[vm->num_frames].base = base;
+  vm->frames[vm->num_frames].env = interpreter->env;
+  vm->num_frames++;
+  constants = code->constants;
+  pc = code->code;
+
+  // Safe point: everything in use is on the stack or reachable from the environment
+  gc->stack_top = sp;
+  maybe_collect_garbage(gc, interpreter->env);
+
+#ifdef VM_THREADED_DISPATCH
+  DISPATCH();
+  {
+#else
+dispatch:
+  switch ((opcode) *pc++) {
+#endif
+    TARGET(OP_CONST) {
+      *sp++ = constants[*pc++];
+      DISPATCH();
+    }
+    TARGET(OP_ARG) {
+      *sp++ = base[*pc++];
+      DISPATCH();
+    }
+    TARGET(OP_GLOBAL) {
+      int k = *pc++;
+      obj *pair = constants[k + 1];
+      if (pair == NULL && (pair = lookup_global(constants[k], interpreter)) != NULL)
+        constants[k + 1] = pair; // global pairs are never freed or moved
+      if (pair != NULL) {
+        *sp++ = CAR(CDR(pair));
+      } else {
+        obj **entry = lookup_entry(constants[k], interpreter, NULL); // bound by a caller
+        if (entry == NULL) {
+          LOG_ERROR("Variable: \"%s\" not found in environment", ATOM(constants[k]));
+          goto error;
+        }
+        *sp++ = *entry;
+      }
+      DISPATCH();
+    }
+    TARGET(OP_JUMP) {
+      pc = code->code + *pc;
+      DISPATCH();
+    }
+    TARGET(OP_JUMP_IF_NIL) {
+      obj *value = *--sp;
+      if (is_primitive(value)) {
+        log_error("cond", "Cannot cast primitive function as bool.");
+        goto error;
+      }
+      pc = is_nil(value) ? code->code + *pc : pc + 1;
+      DISPATCH();
+    }
+    TARGET(OP_JUMP_UNLESS_COMPARE) {
+      math_op op = (math_op) *pc++;
+      obj *x = sp[-2], *y = sp[-1];
+      sp -= 2;
+      bool holds;
+      if (BOTH_INTS(x, y)) {
+        holds = compare_ints(op, TAGGED(x), TAGGED(y)); // ordered as the values are
+      } else {
+        if ((result = math_apply(op, x, y, interpreter)) == NULL) goto error;
+        holds = !is_nil(result);
+      }
+      pc = holds ? pc + 1 : code->code + *pc;
+      DISPATCH();
+    }
+    TARGET(OP_JUMP_UNLESS_EQ) {
+      sp -= 2;
+      pc = compare(sp[0], sp[1]) ? pc + 1 : code->code + *pc;
+      DISPATCH();
+    }
+
+    // Fixnum arithmetic overflows the 64-bit tagged references exactly when the result doesn't fit
+    // in a fixnum, in which case math-lib promotes it to a bignum
+    TARGET(OP_ADD) {
+      obj *x = sp[-2], *y = sp[-1];
+      int64_t sum;
+      if (BOTH_INTS(x, y) && !add_overflows(TAGGED(x), TAGGED(y) - (int64_t) INT_TAG, &sum)) sp[-2] = UNTAGGED(sum);
+      else if ((sp[-2] = math_apply(math_add, x, y, interpreter)) == NULL) goto error;
+      sp--;
+      DISPATCH();
+    }
+    TARGET(OP_SUB) {
+      obj *x = sp[-2], *y = sp[-1];
+      int64_t difference;
+      if (BOTH_INTS(x, y) && !sub_overflows(TAGGED(x), TAGGED(y) - (int64_t) INT_TAG, &difference))
+        sp[-2] = UNTAGGED(difference);
+      else if ((sp[-2] = math_apply(math_sub, x, y, interpreter)) == NULL) goto error;
+      sp--;
+      DISPATCH();
+    }
+    TARGET(OP_MUL) {
+      obj *x = sp[-2], *y = sp[-1];
+      int64_t product;
+      if (BOTH_INTS(x, y) && !mul_overflows(INT_VALUE(x), TAGGED(y) - (int64_t) INT_TAG, &product))
+        sp[-2] = UNTAGGED(product + (int64_t) INT_TAG);
+      else if ((sp[-2] = math_apply(math_mul, x, y, interpreter)) == NULL) goto error;
+      sp--;
+      DISPATCH();
+    }
+    TARGET(OP_MATH) {
+      math_op op = (math_op) *pc++;
+      if ((sp[-2] = math_apply(op, sp[-2], sp[-1], interpreter)) == NULL) goto error;
+      sp--;
+      DISPATCH();
+    }
+
+    TARGET(OP_EQ) {
+      sp[-2] = compare(sp[-2], sp[-1]) ? vm->t : nil(interpreter);
+      sp--;
+      DISPATCH();
+    }
+    TARGET(OP_ATOM) {
+      obj *value = sp[-1];
+      bool atom = is_list(value) ? is_nil(value) : is_atom(value) || is_number(value);
+      sp[-1] = atom ? vm->t : nil(interpreter);
+      DISPATCH();
+    }
+    TARGET(OP_CAR) {
+      obj *list = sp[-1];
+      if (!is_list(list)) {
+        log_error("car", "Argument is not a list");
+        goto error;
+      }
+      sp[-1] = is_nil(list) ? nil(interpreter) : CAR(list);
+      DISPATCH();
+    }
+    TARGET(OP_CDR) {
+      obj *list = sp[-1];
+      if (!is_list(list)) {
+        log_error("cdr", "Argument is not a list");
+        goto error;
+      }
+      sp[-1] = is_nil(list) || CDR(list) == NULL ? nil(interpreter) : CDR(list);
+      DISPATCH();
+    }
+    TARGET(OP_CONS) {
+      obj *list = sp[-1];
+      if (!is_list(list)) {
+        log_error("cons", "Second argument is not list");
+        goto error;
+      }
+      obj *cell = new_list_set(sp[-2], list, gc);
+      gc_add(gc, cell);
+      sp[-2] = cell;
+      sp--;
+      DISPATCH();
+    }
+    TARGET(OP_NIL) {
+      *sp++ = nil(interpreter);
+      DISPATCH();
+    }
+    TARGET(OP_LAMBDA) {
+      int k = *pc++;
+      int n = *pc++;
+      obj *closure = make_closure(constants[k], pc, n, base, constants, interpreter);
+      if (closure == NULL) goto error;
+      pc += 3 * n;
+      *sp++ = closure;
+      DISPATCH();
+    }
+
+    TARGET(OP_CALL) {
+      int nargs = *pc++;
+      obj *oper = sp[-nargs - 1];
+      if (is_partial(oper) && PARTIAL_NARGS(oper) == nargs && CODE(applied_closure(oper)) != NULL) {
+        if ((sp = spread_partial(vm, sp, nargs)) == NULL) goto error;
+        nargs = NARGS(applied_closure(oper));
+        oper = sp[-nargs - 1];
+      }
+      if (is_closure(oper) && CODE(oper) != NULL && NARGS(oper) == nargs) {
+        // Call to compiled code: push a frame rather than recursing
+        vm->frames[vm->num_frames - 1].pc = pc;
+        code = CODE(oper);
+        base = sp - nargs;
+        goto enter;
+      }
+
+      obj **args = sp - nargs;
+      if ((result = call_function(vm, oper, args, nargs, interpreter)) == NULL) goto error;
+      sp = args - 1;
+      *sp++ = result;
+      DISPATCH();
+    }
+    TARGET(OP_TAIL_CALL) {
+      int nargs = *pc++;
+      obj *oper = sp[-nargs - 1];
+      if (is_partial(oper) && PARTIAL_NARGS(oper) == nargs && CODE(applied_closure(oper)) != NULL) {
+        if ((sp = spread_partial(vm, sp, nargs)) == NULL) goto error;
+        nargs = NARGS(applied_closure(oper));
+        oper = sp[-nargs - 1];
+      }
+      if (is_closure(oper) && CODE(oper) != NULL && NARGS(oper) == nargs) {
+        if (!replaces_call(vm, oper, base[-1], interpreter)) {
+          // The callee may look up the caller's arguments, so it is called as by OP_CALL
+          vm->frames[vm->num_frames - 1].pc = pc;
+          code = CODE(oper);
+          base = sp - nargs;
+          goto enter;
+        }
+
+        // The callee replaces the current call: its closure and arguments take their place
+        memmove(base - 1, sp - nargs - 1, (nargs + 1) * sizeof(obj*));
+        sp = base + nargs;
+        code = CODE(oper);
+        vm->num_frames--;
+        goto enter;
+      }
+
+      if ((result = call_function(vm, oper, sp - nargs, nargs, interpreter)) == NULL) goto error;
+      goto return_result;
+    }
+    TARGET(OP_RETURN) {
+      result = sp[-1];
+    return_result:
+      sp = base - 1; // pop the arguments and the closure
+      if (--vm->num_frames == entry) return result;
+
+      VMFrame *frame = &vm->frames[vm->num_frames - 1];
+      code = frame->code;
+      pc = frame->pc;
+      base = frame->base;
+      constants = code->constants;
+      *sp++ = result;
+      DISPATCH();
+    }
+#ifndef VM_THREADED_DISPATCH
+    default: break;
+#endif
+  }
+
+#ifdef VM_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+#undef TARGET
+#undef DISPATCH
+
+  LOG_ERROR("Invalid instruction");
+error:
+  vm->num_frames = entry;
+  return NULL;
+}
+
+/**
+ * Function: allocate_stacks
+ * -------------------------
+ * Allocates the value stack and the frames of a VM, registering the value stack with the
+ * garbage collector so that its values are treated as roots
+ * @param vm: The VM
+ * @param gc: The garbage collector
+ * @return: True if the stacks were allocated, false otherwise
+ */
+static bool allocate_stacks(VM *vm, GarbageCollector *gc) {
+  vm->stack = malloc(VM_STACK_SIZE * sizeof(obj*));
+  vm->frames = malloc(VM_MAX_FRAMES * sizeof(VMFrame));
+  if (vm->stack == NULL || vm->frames == NULL) {
+    LOG_ERROR("Error allocating VM stack");
+    free(vm->stack);
+    free(vm->frames);
+    vm->stack = NULL;
+    vm->frames = NULL;
+    return false;
+  }
+  vm->stack_end = vm->stack + VM_STACK_SIZE;
+  gc->stack = gc->stack_top = vm->stack;
+  return true;
+}
+
+/**
+ * Function: compare_ints
+ * ----------------------
+ * Applies a math comparison to two integers
+ * @param op: The comparison to apply
+ * @param x: The first integer
+ * @param y: The second integer
+ * @return: Whether the comparison holds
+ */
+static bool compare_ints(math_op op, int64_t x, int64_t y) {
+  switch (op) {
+    case math_equal: return x == y;
+    case math_gt:    return x > y;
+    case math_gte:   return x >= y;
+    case math_lt:    return x < y;
+    default:         return x <= y;
+  }
+}
+
+/**
+ * Function: spread_partial
+ * ------------------------
+ * Turns a call to a partial application on the stack into a call to its closure, by replacing the
+ * partial application with the closure and inserting the values it applied beneath the arguments
+ * @param vm: The VM
+ * @param sp: The top of the stack, above the partial application and its arguments
+ * @param nargs: The number of arguments, which are all of the partial application's remaining parameters
+ * @return: The new top of the stack, above the closure and all of its arguments, or NULL if the stack overflowed
+ */
+static obj **spread_partial(const VM *vm, obj **sp, int nargs) {
+  obj *partial = sp[-nargs - 1];
+  const obj *closure = applied_closure(partial);
+  int num_values = NARGS(closure) - nargs;
+  if (sp + num_values > vm->stack_end) {
+    LOG_ERROR("Stack overflow");
+    return NULL;
+  }
+
+  memmove(sp - nargs + num_values, sp - nargs, nargs * sizeof(obj*));
+  partial_values(partial, sp - nargs);
+  sp[-nargs - 1] = (obj*) closure;
+  return sp + num_values;
+}
+
+/**
+ * Function: replaces_call
+ * -----------------------
+ * Determines whether a compiled closure called in tail position may replace the call in progress.
+ * Variables are scoped dynamically, so the callee may look up the caller's arguments, unless it
+ * binds the same names itself (see closure_hides).
+ * @param vm: The VM, whose innermost frame is the call in progress
+ * @param callee: The compiled closure being called
+ * @param closure: The closure whose call is in progress
+ * @param interpreter: The interpreter
+ * @return: True if the callee's frame may take the place of the current one
+ */
+static bool replaces_call(VM *vm, const obj *callee, const obj *closure, LispInterpreter *interpreter) {
+  if (callee == closure) return true;
+  vm->num_frames--; // what would be found with the current call gone
+  bool hides = closure_hides(callee, closure, interpreter);
+  vm->num_frames++;
+  return hides;
+}
+
+/**
+ * Function: call_function
+ * -----------------------
+ * Calls a function that is not a compiled closure taking the given number of arguments. Primitives
+ * that aren't special forms are passed the values on the stack directly. Anything else, such as a
+ * closure that could not be compiled, is passed the values of the arguments (quoted where
+ * necessary) by apply
+ * @param vm: The VM
+ * @param oper: The function to call, on the stack just below the arguments
+ * @param args: The values of the arguments on the stack
+ * @param nargs: The number of arguments
+ * @param interpreter: The interpreter
+ * @return: The result of the call, or NULL if an error occurred
+ */
+static obj *call_function(VM *vm, obj *oper, obj **args, int nargs, LispInterpreter *interpreter) {
+  GarbageCollector *gc = &interpreter->gc;
+  if (is_primitive(oper) && PRIMITIVE(oper)->function != NULL) {
+    // The values on the stack are the primitive's arguments, as they are
+    if (!check_arity(PRIMITIVE(oper), nargs)) return NULL;
+    gc->stack_top = args + nargs;
+    return PRIMITIVE(oper)->function(nargs, args, interpreter);
+  }
+
+  obj *list = NULL;
+  for (int i = nargs - 1; i >= 0; i--) {
+    list = new_list_set(quote_value(vm, args[i], gc), list, gc);
+    gc_add(gc, list);
+  }
+
+  // The argument list replaces the arguments on the stack, keeping it (and oper) alive. With no
+  // arguments there is no list to keep, and args may be the end of the stack.
+  if (nargs > 0) args[0] = list;
+  gc->stack_top = nargs > 0 ? args + 1 : args;
+  return apply(oper, list, interpreter);
+}
+
+/**
+ * Function: quote_value
+ * ---------------------
+ * Makes an expression that evaluates to a value
+ * @param vm: The VM
+ * @param value: The value
+ * @param gc: Garbage collector to allocate the expression from
+ * @return: The value itself if it evaluates to itself, otherwise (quote value)
+ */
+static obj *quote_value(const VM *vm, obj *value, GarbageCollector *gc) {
+  if (!is_t(value) && (is_atom(value) || (is_list(value) && !is_nil(value)))) {
+    obj *quoted = new_list_set(vm->quote, new_list_set(value, NULL, gc), gc);
+    gc_add(gc, CDR(quoted));
+    gc_add(gc, quoted);
+    return quoted;
+  }
+  return value;
+}
+
+/**
+ * Function: make_closure
+ * ----------------------
+ * Creates a closure from a lambda expression within a compiled closure, capturing the values
+ * at the addresses that the compiler resolved, just as the lambda primitive would have
+ * captured them by name. Captured values and the lambda's parameters and body are shared, not copied.
+ * @param lambda_args: The arguments of the lambda expression: the parameters and the body
+ * @param captures: The captures of the OP_LAMBDA instruction (see bytecode.h)
+ * @param num_captures: The number of captures
+ * @param args: The values of the enclosing closure's arguments
+ * @param constants: The constants of the enclosing closure's code
+ * @param interpreter: The interpreter
+ * @return: The new closure, or NULL if an error occurred
+ */
+static obj *make_closure(const obj *lambda_args, const uint16_t *captures, int num_captures,
+                         obj **args, obj **constants, LispInterpreter *interpreter) {
+  GarbageCollector *gc = &interpreter->gc;
+
+  // Nothing is evaluated here, so there is no collection until the closure is returned
+  obj *captured = NULL;
+  for (int i = 0; i < num_captures; i++, captures += 3) {
+    obj *value;
+    if (captures[0] == CAPTURE_ARGUMENT) {
+      value = args[captures[1]];
+    } else if (captures[0] == CAPTURE_CONSTANT) {
+      value = constants[captures[1]];
+    } else {
+      obj *pair = constants[captures[1]];
+      if (pair == NULL && (pair = lookup_global(constants[captures[2]], interpreter)) != NULL)
+        constants[captures[1]] = pair;
+      if (pair != NULL) {
+        value = CAR(CDR(pair));
+      } else {
+        obj **entry = lookup_entry(constants[captures[2]], interpreter, NULL);
+        if (entry == NULL) continue; // nothing to capture
+        value = *entry;
+      }
+    }
+    obj *pair = make_pair(constants[captures[2]], value, false, gc);
+    gc_add(gc, pair);
+    gc_add(gc, CDR(pair));
+    captured = new_list_set(pair, captured, gc);
+    gc_add(gc, captured);
+  }
+
+  obj *closure = new_closure_set(CAR(lambda_args), CAR(CDR(lambda_args)), captured, gc);
+  gc_add(gc, closure);
+  return closure;
+}
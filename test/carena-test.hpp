@@ -0,0 +1,134 @@
+#ifndef LISP_CARENA_TEST_HPP
+#define LISP_CARENA_TEST_HPP
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <carena.h>
+
+namespace {
+
+  class ArenaTest : public testing::Test {
+  protected:
+    void SetUp() override { ASSERT_TRUE(carena_init(&arena)); }
+    void TearDown() override { carena_dispose(&arena); }
+
+    CArenaStats stats() {
+      CArenaStats s;
+      carena_stats(&arena, &s);
+      return s;
+    }
+
+    CArena arena;
+  };
+
+  TEST_F(ArenaTest, StartsEmpty) {
+    CArenaStats s = stats();
+    EXPECT_EQ(s.num_pages, 0);
+    EXPECT_EQ(s.allocated_bytes, 0);
+    EXPECT_EQ(s.live_objects, 0);
+    EXPECT_EQ(s.fragmentation, 0);
+  }
+
+  TEST_F(ArenaTest, AllocationsAreAlignedAndDistinct) {
+    std::set<void*> seen;
+    for (size_t size = 1; size <= CARENA_MAX_SIZE; size++) {
+      void *p = carena_alloc(&arena, size);
+      ASSERT_NE(p, nullptr);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % CARENA_GRANULE, 0);
+      EXPECT_TRUE(seen.insert(p).second);
+    }
+    EXPECT_EQ(stats().live_objects, CARENA_MAX_SIZE);
+  }
+
+  TEST_F(ArenaTest, SameSizeIsContiguous) {
+    auto a = static_cast<char*>(carena_alloc(&arena, 24));
+    auto b = static_cast<char*>(carena_alloc(&arena, 24));
+    auto c = static_cast<char*>(carena_alloc(&arena, 24));
+    EXPECT_EQ(b - a, 24);
+    EXPECT_EQ(c - b, 24);
+  }
+
+  TEST_F(ArenaTest, FreedObjectIsReused) {
+    void *a = carena_alloc(&arena, 24);
+    carena_alloc(&arena, 24);
+    carena_free(a);
+    EXPECT_EQ(stats().live_objects, 1);
+    EXPECT_EQ(carena_alloc(&arena, 24), a);
+    EXPECT_EQ(stats().live_objects, 2);
+  }
+
+  TEST_F(ArenaTest, SizeClassesDoNotShareObjects) {
+    void *small = carena_alloc(&arena, 16);
+    carena_free(small);
+    void *large = carena_alloc(&arena, 40);
+    EXPECT_NE(large, small);
+    EXPECT_EQ(stats().num_pages, 2);
+  }
+
+  TEST_F(ArenaTest, ManyPages) {
+    const int n = 100000;
+    std::vector<int*> objects;
+    for (int i = 0; i < n; i++) {
+      auto p = static_cast<int*>(carena_alloc(&arena, sizeof(int) * 6));
+      ASSERT_NE(p, nullptr);
+      for (int j = 0; j < 6; j++) p[j] = i;
+      objects.push_back(p);
+    }
+    for (int i = 0; i < n; i++)
+      ASSERT_EQ(objects[i][5], i);
+
+    CArenaStats s = stats();
+    EXPECT_GT(s.num_pages, 1);
+    EXPECT_EQ(s.allocated_bytes, s.num_pages * CARENA_PAGE_SIZE);
+    EXPECT_EQ(s.live_objects, n);
+    EXPECT_EQ(s.live_bytes, n * 24);
+    EXPECT_LT(s.fragmentation, 0.01);
+
+    // Freeing every other object leaves the pages half empty
+    for (int i = 0; i < n; i += 2) carena_free(objects[i]);
+    s = stats();
+    EXPECT_EQ(s.live_objects, n / 2);
+    EXPECT_GT(s.fragmentation, 0.49);
+    EXPECT_LT(s.fragmentation, 0.51);
+  }
+
+  TEST_F(ArenaTest, Marks) {
+    std::vector<void*> objects;
+    for (int i = 0; i < 10000; i++) objects.push_back(carena_alloc(&arena, 24));
+    for (void *p : objects) EXPECT_FALSE(carena_is_marked(p));
+
+    // Marking every third object leaves its neighbours in the bitmap unmarked
+    for (size_t i = 0; i < objects.size(); i += 3) EXPECT_TRUE(carena_mark(objects[i]));
+    for (size_t i = 0; i < objects.size(); i++) {
+      EXPECT_EQ(carena_is_marked(objects[i]), i % 3 == 0);
+      if (i % 3 == 0) {
+        EXPECT_FALSE(carena_mark(objects[i])); // already marked
+      }
+    }
+
+    carena_clear_marks(&arena);
+    for (void *p : objects) EXPECT_FALSE(carena_is_marked(p));
+  }
+
+  TEST_F(ArenaTest, ReusedObjectsAreUnmarked) {
+    void *p = carena_alloc(&arena, 16);
+    carena_mark(p);
+    carena_free(p);
+    void *q = carena_alloc(&arena, 16);
+    EXPECT_EQ(q, p);
+    EXPECT_FALSE(carena_is_marked(q));
+  }
+
+  TEST_F(ArenaTest, DisposeReleasesPages) {
+    for (int i = 0; i < 10000; i++) carena_alloc(&arena, 8);
+    carena_dispose(&arena);
+    EXPECT_EQ(stats().num_pages, 0);
+    EXPECT_EQ(stats().live_objects, 0);
+    EXPECT_NE(carena_alloc(&arena, 8), nullptr); // still usable after dispose
+  }
+}
+
+#endif //LISP_CARENA_TEST_HPP
@@ -0,0 +1,114 @@
+#ifndef LISP_CCMAP_TEST_HPP
+#define LISP_CCMAP_TEST_HPP
+
+#include <gtest/gtest.h>
+#include <ccmap.h>
+
+#include <hash.h>
+#include <ops.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  class ConcurrentMapTest : public testing::Test {
+  protected:
+    ConcurrentMapTest() : ccm(nullptr) { }
+    void SetUp() override {
+      ccm = ccmap_create(sizeof(int), sizeof(int), roberts_hash, (CmpFn) cmp_int, nullptr, nullptr, 0);
+      ASSERT_NE(ccm, nullptr);
+    }
+    void TearDown() override { ccmap_dispose(ccm); }
+    CConcurrentMap *ccm;
+  };
+
+  TEST_F(ConcurrentMapTest, InsertLookup) {
+    EXPECT_EQ(ccmap_count(ccm), 0u);
+    for (int i = 0; i < 1000; i++) {
+      int value = 2 * i;
+      ASSERT_TRUE(ccmap_insert(ccm, &i, &value));
+    }
+    EXPECT_EQ(ccmap_count(ccm), 1000u);
+
+    for (int i = 0; i < 1000; i++) {
+      int value = -1;
+      ASSERT_TRUE(ccmap_lookup(ccm, &i, &value));
+      EXPECT_EQ(value, 2 * i);
+    }
+    int missing = 1000;
+    EXPECT_FALSE(ccmap_lookup(ccm, &missing, nullptr));
+  }
+
+  // Inserting a key that is already there replaces its value
+  TEST_F(ConcurrentMapTest, Replace) {
+    int key = 7, first = 1, second = 2;
+    ccmap_insert(ccm, &key, &first);
+    ccmap_insert(ccm, &key, &second);
+    EXPECT_EQ(ccmap_count(ccm), 1u);
+
+    int value = 0;
+    ASSERT_TRUE(ccmap_lookup(ccm, &key, &value));
+    EXPECT_EQ(value, second);
+  }
+
+  TEST_F(ConcurrentMapTest, RemoveClear) {
+    for (int i = 0; i < 100; i++)
+      ccmap_insert(ccm, &i, &i);
+
+    int key = 42;
+    EXPECT_TRUE(ccmap_remove(ccm, &key));
+    EXPECT_FALSE(ccmap_remove(ccm, &key));
+    EXPECT_FALSE(ccmap_lookup(ccm, &key, nullptr));
+    EXPECT_EQ(ccmap_count(ccm), 99u);
+
+    ccmap_clear(ccm);
+    EXPECT_EQ(ccmap_count(ccm), 0u);
+  }
+
+  // Writers insert and remove keys while readers look them up: a key that is found always
+  // has the value it was inserted with, and the keys that are never removed are all there
+  TEST_F(ConcurrentMapTest, ReadersAndWriters) {
+    constexpr int num_writers = 4;
+    constexpr int num_readers = 4;
+    constexpr int keys_per_writer = 5000;
+    std::atomic<bool> done(false);
+    std::atomic<int> bad_values(0);
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < num_writers; w++) {
+      writers.emplace_back([this, w] {
+        for (int i = w * keys_per_writer; i < (w + 1) * keys_per_writer; i++) {
+          int value = 3 * i;
+          ccmap_insert(ccm, &i, &value);
+          if (i % 2 == 1) ccmap_remove(ccm, &i); // odd keys are removed again
+        }
+      });
+    }
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < num_readers; r++) {
+      readers.emplace_back([this, &done, &bad_values] {
+        while (!done) {
+          for (int i = 0; i < num_writers * keys_per_writer; i += 7) {
+            int value;
+            if (ccmap_lookup(ccm, &i, &value) && value != 3 * i) bad_values++;
+          }
+        }
+      });
+    }
+
+    for (auto &t : writers) t.join();
+    done = true;
+    for (auto &t : readers) t.join();
+
+    EXPECT_EQ(bad_values, 0);
+    EXPECT_EQ(ccmap_count(ccm), (unsigned int) (num_writers * keys_per_writer / 2));
+    for (int i = 0; i < num_writers * keys_per_writer; i++)
+      EXPECT_EQ(ccmap_lookup(ccm, &i, nullptr), i % 2 == 0);
+  }
+
+} // namespace
+
+#endif // LISP_CCMAP_TEST_HPP
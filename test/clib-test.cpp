@@ -2,7 +2,10 @@
 
 #include <permutation-test.hpp>
 #include <cmap-test.hpp>
+#include <ccmap-test.hpp>
 #include <cset-test.hpp>
+#include <hash-test.hpp>
+#include <carena-test.hpp>
 
 namespace {
 
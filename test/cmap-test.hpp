@@ -226,6 +226,131 @@ namespace {
     }
   }
 
+  // Removing keys in any order leaves every other key reachable, including in clusters that
+  // wrap around the end of the table
+  TEST_F(MapIntIntTest, DeleteInterleaved) {
+    constexpr unsigned int capacity = 64;
+    SetUp(hash_to_n<capacity - 8>, (CmpFn) cmp_int, capacity);
+    ASSERT_TRUE(cmap_set_load_factors(cm, 1, 0)); // so that the cluster doesn't grow the table
+
+    constexpr int N = 40;
+    for (int i = 0; i < N; i++)
+      cmap_insert(cm, &i, &i);
+    for (int i = 0; i < N; i += 3)
+      cmap_remove(cm, &i);
+
+    for (int i = 0; i < N; i++) {
+      auto vp = static_cast<const int *>(cmap_lookup(cm, &i));
+      if (i % 3 == 0) {
+        EXPECT_EQ(vp, nullptr);
+      } else {
+        ASSERT_NE(vp, nullptr);
+        EXPECT_EQ(*vp, i);
+      }
+    }
+    EXPECT_EQ(cmap_count(cm), (unsigned int) (N - (N + 2) / 3));
+  }
+
+  // Iteration visits each key exactly once, along with its value
+  TEST_F(MapIntIntTest, Iterate) {
+    SetUp(roberts_hash, (CmpFn) cmp_int, 64);
+
+    constexpr int N = 32;
+    for (int i = 0; i < N; i++) {
+      int value = 2 * i;
+      cmap_insert(cm, &i, &value);
+    }
+
+    int seen[N] = { 0 };
+    for (const void *key = cmap_first(cm); key != nullptr; key = cmap_next(cm, key)) {
+      int k = *static_cast<const int *>(key);
+      ASSERT_TRUE(k >= 0 && k < N);
+      seen[k]++;
+      EXPECT_EQ(*static_cast<const int *>(get_value(cm, key)), 2 * k);
+    }
+    for (int i = 0; i < N; i++)
+      EXPECT_EQ(seen[i], 1);
+  }
+
+  // The table grows to a power of two (keeping it at most 7/8 full), and keeps every key
+  TEST_F(MapIntIntTest, Grow) {
+    SetUp(roberts_hash, (CmpFn) cmp_int, 0);
+
+    constexpr int N = 100000;
+    for (int i = 0; i < N; i++) {
+      int value = -i;
+      ASSERT_NE(cmap_insert(cm, &i, &value), nullptr);
+    }
+    EXPECT_EQ(cmap_count(cm), (unsigned int) N);
+    EXPECT_EQ(cmap_capacity(cm), 1u << 17);
+
+    for (int i = 0; i < N; i++) {
+      auto vp = static_cast<const int *>(cmap_lookup(cm, &i));
+      ASSERT_NE(vp, nullptr);
+      EXPECT_EQ(*vp, -i);
+    }
+  }
+
+  // The capacity hint is rounded up to a power of two, and reserving room grows the table
+  // only if it would otherwise grow before holding that many keys
+  TEST_F(MapIntIntTest, Reserve) {
+    SetUp(roberts_hash, (CmpFn) cmp_int, 100);
+    EXPECT_EQ(cmap_capacity(cm), 128u);
+
+    EXPECT_TRUE(cmap_reserve(cm, 112));
+    EXPECT_EQ(cmap_capacity(cm), 128u);
+    EXPECT_TRUE(cmap_reserve(cm, 113));
+    EXPECT_EQ(cmap_capacity(cm), 256u);
+
+    for (int i = 0; i < 128; i++)
+      cmap_insert(cm, &i, &i);
+    EXPECT_EQ(cmap_capacity(cm), 256u);
+  }
+
+  // Removing keys leaves tombstones in crowded groups, which are cleared by rebuilding the
+  // table rather than growing it, so inserting and removing in turn keeps the capacity fixed
+  TEST_F(MapIntIntTest, Churn) {
+    SetUp(two_hash<int, 0, 1u << 31, 1000000>, (CmpFn) cmp_int, 64);
+
+    for (int i = 0; i < 40; i++)
+      cmap_insert(cm, &i, &i);
+    for (int i = 40; i < 20000; i++) {
+      const int old = i - 40;
+      cmap_remove(cm, &old);
+      cmap_insert(cm, &i, &i);
+      ASSERT_EQ(cmap_lookup(cm, &old), nullptr);
+    }
+    EXPECT_EQ(cmap_count(cm), 40u);
+    EXPECT_EQ(cmap_capacity(cm), 64u);
+    for (int i = 20000 - 40; i < 20000; i++) {
+      auto vp = static_cast<const int *>(cmap_lookup(cm, &i));
+      ASSERT_NE(vp, nullptr);
+      EXPECT_EQ(*vp, i);
+    }
+  }
+
+  // With a minimum load factor, the table shrinks as keys are removed from it
+  TEST_F(MapIntIntTest, Shrink) {
+    SetUp(roberts_hash, (CmpFn) cmp_int, 0);
+    EXPECT_FALSE(cmap_set_load_factors(cm, 0.5, 0.25)); // it would shrink right after growing
+    EXPECT_FALSE(cmap_set_load_factors(cm, 1.5, 0));
+    ASSERT_TRUE(cmap_set_load_factors(cm, 0.5, 0.125));
+
+    constexpr int N = 4096;
+    for (int i = 0; i < N; i++)
+      cmap_insert(cm, &i, &i);
+    EXPECT_EQ(cmap_capacity(cm), 8192u);
+
+    for (int i = 0; i < N - 16; i++)
+      cmap_remove(cm, &i);
+    EXPECT_LE(cmap_capacity(cm), 256u);
+    for (int i = N - 16; i < N; i++) {
+      auto vp = static_cast<const int *>(cmap_lookup(cm, &i));
+      ASSERT_NE(vp, nullptr);
+      EXPECT_EQ(*vp, i);
+    }
+  }
+
   // the next few tests use the permuter library to insert a whole bunch
   // of elements. this doesn't test for anything in particular but just
   // hopefully might catch something wrong that wasn't tested for in other cases
@@ -460,6 +460,224 @@ namespace {
       ASSERT_EQ(*aye, el);
     }
   }
+
+  // ranks stay right as nodes are split, merged and borrowed from
+  TEST_F(SetTestInt, RankInsertDelete) {
+    SetUp();
+    std::set<type> reference_set;
+    for (int round = 0; round < 4; round++) {
+      for (int i = 0; i < (1 << 13); i++) {
+        int el = random() % (1 << 14);
+        if (i % 3 == 0) {
+          set_remove(set, &el);
+          reference_set.erase(el);
+        } else {
+          set_insert(set, &el);
+          reference_set.insert(el);
+        }
+      }
+      ASSERT_EQ(set_size(set), reference_set.size());
+
+      int rank = 0;
+      for (auto el : reference_set)
+        ASSERT_EQ(set_rank(set, &el), rank++);
+    }
+
+    for (auto el : reference_set)
+      set_remove(set, &el);
+    EXPECT_EQ(set_size(set), 0);
+  }
+
+  TEST_F(SetTestInt, Select) {
+    SetUp();
+    std::set<type> elements;
+    for (int i = 0; i < (1 << 14); i++) {
+      int el = random();
+      set_insert(set, &el);
+      elements.insert(el);
+    }
+
+    int k = 0;
+    for (auto el : elements) {
+      auto selected = static_cast<const int *>(set_select(set, k));
+      ASSERT_NE(selected, nullptr);
+      ASSERT_EQ(*selected, el);
+      ASSERT_EQ(set_rank(set, selected), k++);
+    }
+    EXPECT_EQ(set_select(set, k), nullptr);
+    EXPECT_EQ(set_select(set, -1), nullptr);
+  }
+
+  TEST_F(SetTestInt, Iterate) {
+    SetUp();
+    for (int i = 0; i < 10000; i++) {
+      int el = 2 * ((i * 7919) % 10000);
+      set_insert(set, &el);
+    }
+
+    // every element, in order
+    CSetIterator it;
+    int expected = 0;
+    for (void *e = set_iter_at(set, 0, &it); e != nullptr; e = set_iter_next(&it)) {
+      ASSERT_EQ(*static_cast<int *>(e), expected);
+      expected += 2;
+    }
+    EXPECT_EQ(expected, 20000);
+    EXPECT_EQ(set_iter_next(&it), nullptr);
+
+    for (int x = -1; x < 20001; x++) {
+      auto lower = static_cast<const int *>(set_lower_bound(set, &x, &it));
+      if (x >= 19999) {
+        EXPECT_EQ(lower, nullptr);
+      } else {
+        ASSERT_NE(lower, nullptr);
+        ASSERT_EQ(*lower, x < 0 ? 0 : (x + 1) / 2 * 2);
+        ASSERT_EQ(set_iter_get(&it), lower);
+      }
+
+      auto upper = static_cast<const int *>(set_upper_bound(set, &x, &it));
+      if (x >= 19998) {
+        EXPECT_EQ(upper, nullptr);
+      } else {
+        ASSERT_NE(upper, nullptr);
+        ASSERT_EQ(*upper, x < 0 ? 0 : x / 2 * 2 + 2);
+        auto next = static_cast<const int *>(set_iter_next(&it));
+        if (*upper < 19998) {
+          ASSERT_NE(next, nullptr);
+          ASSERT_EQ(*next, *upper + 2);
+        }
+      }
+    }
+  }
+
+  bool sum_visited(const void *element, void *context) {
+    *static_cast<int *>(context) += *static_cast<const int *>(element);
+    return true;
+  }
+
+  bool visit_one(const void *, void *) { return false; }
+
+  TEST_F(SetTestInt, Range) {
+    SetUp();
+    for (int i = 0; i < 1000; i++)
+      set_insert(set, &i);
+
+    int sum = 0;
+    int low = 100, high = 200;
+    EXPECT_EQ(set_range(set, &low, &high, sum_visited, &sum), 100);
+    EXPECT_EQ(sum, (100 + 199) * 100 / 2);
+
+    sum = 0;
+    EXPECT_EQ(set_range(set, nullptr, &low, sum_visited, &sum), 100);
+    EXPECT_EQ(sum, 99 * 100 / 2);
+    EXPECT_EQ(set_range(set, &high, nullptr, sum_visited, &sum), 800);
+    EXPECT_EQ(set_range(set, &high, &low, sum_visited, &sum), 0);
+    EXPECT_EQ(set_range(set, nullptr, nullptr, visit_one, nullptr), 1);
+  }
+
+  TEST_F(SetTestInt, Build) {
+    SetUp();
+    for (int n : { 0, 1, 63, 64, 1000, 4033, 100000 }) {
+      std::vector<type> sorted;
+      for (int i = 0; i < n; i++) {
+        sorted.push_back(3 * i);
+        if (i % 5 == 0) sorted.push_back(3 * i); // repeated elements are stored once
+      }
+      ASSERT_TRUE(set_build(set, sorted.data(), (int) sorted.size()));
+      ASSERT_EQ(set_size(set), n);
+
+      for (int i = 0; i < n; i++) {
+        int el = 3 * i;
+        ASSERT_EQ(set_rank(set, &el), i);
+        ASSERT_EQ(*static_cast<const int *>(set_select(set, i)), el);
+      }
+
+      // the tree that was built is as good as any other for changing afterwards
+      for (int i = 0; i < n; i++) {
+        int el = 3 * i + (i % 2 == 0 ? 0 : 1);
+        if (i % 2 == 0) set_remove(set, &el);
+        else set_insert(set, &el);
+      }
+      ASSERT_EQ(set_size(set), n - (n + 1) / 2 + n / 2);
+      CSetIterator it;
+      int k = 0;
+      for (void *e = set_iter_at(set, 0, &it); e != nullptr; e = set_iter_next(&it), k++)
+        ASSERT_EQ(set_rank(set, e), k);
+      ASSERT_EQ(k, set_size(set));
+    }
+    set_dispose(set);
+  }
+
+  // elements this large get only a few to a node, which makes a deep tree
+  struct Wide {
+    int key;
+    char padding[200];
+  };
+
+  int cmp_wide(const void *a, const void *b) {
+    return cmp_int(&static_cast<const Wide *>(a)->key, &static_cast<const Wide *>(b)->key);
+  }
+
+  int num_cleaned = 0;
+  void cleanup_wide(void *) { num_cleaned++; }
+
+  TEST(SetTestWide, InsertDelete) {
+    CSet *set = new_set(sizeof(Wide), cmp_wide, cleanup_wide);
+    ASSERT_NE(set, nullptr);
+    num_cleaned = 0;
+
+    int N = 1 << 12;
+    for (int i = 0; i < N; i++) {
+      Wide w = { (i * 7919) % N, { } };
+      set_insert(set, &w);
+    }
+    EXPECT_EQ(set_size(set), N);
+
+    for (int i = 0; i < N; i += 2) {
+      Wide w = { i, { } };
+      set_remove(set, &w);
+    }
+    EXPECT_EQ(set_size(set), N / 2);
+    EXPECT_EQ(num_cleaned, N / 2);
+
+    for (int i = 0; i < N; i++) {
+      Wide w = { i, { } };
+      auto found = static_cast<const Wide *>(set_lookup(set, &w));
+      if (i % 2 == 0) {
+        EXPECT_EQ(found, nullptr);
+      } else {
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(found->key, i);
+        EXPECT_EQ(set_rank(set, &w), i / 2);
+      }
+    }
+
+    set_dispose(set);
+    EXPECT_EQ(num_cleaned, N);
+  }
+
+  TEST(SetTestWide, Build) {
+    CSet *set = new_set(sizeof(Wide), cmp_wide, nullptr);
+    ASSERT_NE(set, nullptr);
+
+    int N = 12345;
+    std::vector<Wide> sorted((size_t) N);
+    for (int i = 0; i < N; i++)
+      sorted[i].key = i;
+    ASSERT_TRUE(set_build(set, sorted.data(), N));
+
+    CSetIterator it;
+    int k = 0;
+    for (void *e = set_iter_at(set, 0, &it); e != nullptr; e = set_iter_next(&it))
+      ASSERT_EQ(static_cast<Wide *>(e)->key, k++);
+    EXPECT_EQ(k, N);
+
+    for (int i = 0; i < N; i += 3)
+      set_remove(set, &sorted[i]);
+    for (int i = 0; i < N; i++)
+      ASSERT_EQ(set_rank(set, &sorted[i]), i % 3 == 0 ? CSET_ERROR : i - i / 3 - 1);
+    set_dispose(set);
+  }
 }
 
 #endif //LISP_CSET_TEST_HPP
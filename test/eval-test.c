@@ -1,6 +1,7 @@
 
 #include "test.h"
 #include "eval-test.h"
+#include "vm-test.h"
 #include "parser.h"
 
 #include <assert.h>
@@ -9,6 +10,9 @@
 
 #define TEST_EVAL(e, expected, ...) TEST_ITEM(test_single_eval, e, expected, __VA_ARGS__)
 #define TEST_EVALS(pre, e, expected, ...) TEST_ITEM(test_multi_eval, pre, e, expected, __VA_ARGS__)
+#define TEST_BOTH_EVALS(pre, e, expected, ...) \
+  TEST_ITEM(test_vm_eval, pre, e, expected, true, __VA_ARGS__); \
+  TEST_ITEM(test_vm_eval, pre, e, expected, false, __VA_ARGS__)
 #define TEST_ERROR(e, ...) TEST_EVAL(e, NULL, __VA_ARGS__)
 #define TEST_TRUE(e, ...) TEST_EVAL(e, "t", __VA_ARGS__)
 #define TEST_FALSE(e, ...) TEST_EVAL(e, NIL_STR, __VA_ARGS__)
@@ -194,6 +198,11 @@ DEF_TEST(eq) {
   TEST_FALSE("(eq (cons 'x '(a b c)) '(x a b c))",   "two identical lists aren't equal");
   TEST_FALSE("(eq (cons 'x '(a b c)) '((x) a b c))", "two dissimilar lists aren't equal");
 
+  SERIES(stored_atom, "(set 'x 'abc)");
+  TEST_EVALS(stored_atom, "(eq x 'abc)", "t",                 "stored atom equals parsed atom");
+  TEST_EVALS(stored_atom, "(eq (car (cons x '())) x)", "t",   "stored atom equals itself");
+  TEST_EVALS(stored_atom, "(eq x 'abcd)", NIL_STR,            "stored atom not equal to prefix");
+
   TEST_ERROR("(eq)",                                  "no arguments");
   TEST_ERROR("(eq one)",                              "one argument");
   TEST_ERROR("(eq one two three)",                    "three arguments (too many)");
@@ -291,6 +300,17 @@ DEF_TEST(set) {
          "(set 'x (cons x x))");
   TEST_EVALS(consy, "x", "((1 2 3) 1 2 3)", "over-write with self-referential cons");
 
+  SERIES(from_lambda,
+         "(set 'f (lambda (x) (set 'z x)))",
+         "(f 42)");
+  TEST_EVALS(from_lambda, "z", "42",        "set global from inside lambda");
+
+  SERIES(param, "(set 'inc (lambda (x) (cond ((set 'x (+ x 1)) x))))");
+  TEST_EVALS(param, "(inc 1)", "2",         "set parameter inside lambda");
+
+  SERIES(many_params, "(set 'f (lambda (a b c d e g h) (cond ((set 'h (+ a h)) h))))");
+  TEST_EVALS(many_params, "(f 1 2 3 4 5 6 7)", "8", "set one of many parameters");
+
   TEST_ERROR("(set)",                       "no arguments");
   TEST_ERROR("(set x)",                     "one argument");
   TEST_ERROR("(set x y z)",                 "too many arguments");
@@ -324,6 +344,12 @@ DEF_TEST(math) {
   TEST_EVAL("(/ 42 6)", "7",                "simple divide");
   TEST_EVAL("(/ 42 100)", "0",              "integer division");
   TEST_EVAL("-5", "-5",                     "negative number equals self");
+  TEST_EVAL("(+ 1.5 1)", "2.5",             "float plus integer");
+  TEST_EVAL("(* 2.5 -2.0)", "-5",           "float multiplication");
+  TEST_EVAL("(- 2147483647 1)", "2147483646", "large integer");
+  TEST_EVAL("(- -2147483647 1)", "-2147483648", "large negative integer");
+  TEST_TRUE("(eq (+ 2 3) 5)",               "computed integer equals literal");
+  TEST_TRUE("(eq (* 1.5 2.0) 3.0)",         "computed float equals literal");
 
   TEST_TRUE("(> 5 0)",                      "five is greater than zero");
   TEST_TRUE("(> (+ 4 1) 4)",                "greater than");
@@ -352,9 +378,43 @@ DEF_TEST(math) {
   TEST_EVALS(set_xy, "(/ y x)", "1",        "");
   TEST_EVALS(set_xy, "(% y x)", "6",        "");
 
-  // weird ways to use these things
-  // TEST_EVAL("(+ 1 2 3 4)", "10"); // just kidding, we will use the standard
-  // TEST_EVAL("(* 1 2 3 4)", "24"); // library to implement this functionality
+  // Any number of arguments
+  TEST_EVAL("(+ 1 2 3 4)", "10",            "variadic addition");
+  TEST_EVAL("(* 1 2 3 4)", "24",            "variadic multiplication");
+  TEST_EVAL("(- 10 1 2 3)", "4",            "subtracts the rest from the first");
+  TEST_EVAL("(/ 100 5 2)", "10",            "divides the first by the rest");
+  TEST_EVAL("(+ 1 2 0.5 1)", "4.5",         "float from the first float on");
+  TEST_EVAL("(/ 7 2 2.0)", "1.5",           "integer division before the first float");
+  TEST_EVAL("(min 3 1 2)", "1",             "minimum");
+  TEST_EVAL("(max 3 1 2)", "3",             "maximum");
+  TEST_EVAL("(max 4)", "4",                 "maximum of one number");
+  TEST_EVAL("(max 1 2.5 2)", "2.5",         "maximum of mixed numbers");
+  TEST_EVAL("(+ 2147483647 1)", "2147483648", "integers are 64-bit");
+  TEST_TRUE("(< 1 2 3)",                    "chained comparison holds");
+  TEST_FALSE("(< 1 3 2)",                   "chained comparison doesn't hold");
+  TEST_TRUE("(= 2 2 2.0)",                  "chained equality");
+  TEST_TRUE("(>= 3 3 1.5 -1)",              "chained greater than or equal");
+
+  // Integers that don't fit in a fixnum become bignums
+  TEST_EVAL("(+ 2305843009213693951 1)", "2305843009213693952", "fixnum overflow promotes");
+  TEST_EVAL("(- -2305843009213693952 1)", "-2305843009213693953", "fixnum underflow promotes");
+  TEST_EVAL("(* 9223372036854775807 2)", "18446744073709551614", "64-bit overflow promotes");
+  TEST_EVAL("(- 2305843009213693952 1)", "2305843009213693951", "bignum result demotes");
+  TEST_EVAL("123456789012345678901234567890", "123456789012345678901234567890", "bignum literal");
+  TEST_EVAL("(* 4294967296 4294967296 4294967296)", "79228162514264337593543950336", "bignum product");
+  TEST_EVAL("(/ -123456789012345678901234567891 7)", "-17636684144620811271604938270", "bignum division truncates");
+  TEST_EVAL("(% -123456789012345678901234567891 7)", "-1", "bignum remainder has the sign of the dividend");
+  TEST_EVAL("(/ 123456789012345678901234567891 -123456789012)", "-1000000000002799999", "bignum long division");
+  TEST_TRUE("(< 1 123456789012345678901234567890 1e30)", "bignums compare with other numbers");
+  TEST_TRUE("(eq 123456789012345678901234567890 123456789012345678901234567890)", "bignums are eq by value");
+  TEST_EVAL("(+ 123456789012345678901234567890 0.5)", "1.2345678901234568e+29", "bignum plus float");
+  TEST_ERROR("(/ 123456789012345678901234567890 0)", "bignum division by zero");
+
+  // Floats are doubles
+  TEST_EVAL("(+ 0.1 0.2)", "0.30000000000000004", "double precision");
+  TEST_EVAL("(* 1e200 1e-300)", "1e-100", "small double");
+  TEST_EVAL("(* 1e200 1e200)", "inf", "double overflow");
+  TEST_TRUE("(= (/ 1.0 3) 0.3333333333333333)", "double literal round trip");
 
   // Data type errors
   TEST_ERROR("(+ 5 z)",                      "add with unknown variable");
@@ -366,21 +426,34 @@ DEF_TEST(math) {
   TEST_ERROR("(/ / /)",                      "can't divide math primitives");
 
   TEST_ERROR("(>= e 4)",                     "can't compare unknown var");
-
-  // Too few arguments
-  TEST_ERROR("(+)",                          "no arguments");
+  TEST_ERROR("(+ 1 2 'a)",                   "can't add a later argument");
+  TEST_ERROR("(< 1 2 'a)",                   "can't compare a later argument");
+  TEST_ERROR("(/ 5 0)",                      "integer division by zero");
+  TEST_ERROR("(% 5 0)",                      "integer modulus by zero");
+
+  // Fewer than two arguments
+  TEST_EVAL("(+)", "0",                      "sum of no numbers");
+  TEST_EVAL("(*)", "1",                      "product of no numbers");
+  TEST_EVAL("(+ 3)", "3",                    "sum of one number");
+  TEST_EVAL("(* 3)", "3",                    "product of one number");
+  TEST_EVAL("(- 3)", "-3",                   "negation");
+  TEST_EVAL("(- -2.5)", "2.5",               "float negation");
+  TEST_EVAL("(- -9223372036854775808)", "9223372036854775808", "negation promotes");
+  TEST_EVAL("(/ 4.0)", "0.25",               "reciprocal");
+  TEST_EVAL("(/ 1)", "1",                    "integer reciprocal");
+  TEST_EVAL("(/ 3)", "0",                    "integer reciprocal truncates");
+  TEST_ERROR("(/ 0)",                        "reciprocal of zero");
+  TEST_ERROR("(- 'a)",                       "can't negate an atom");
   TEST_ERROR("(-)",                          "no arguments");
-  TEST_ERROR("(*)",                          "no arguments");
   TEST_ERROR("(/)",                          "no arguments");
   TEST_ERROR("(=)",                          "no arguments");
   TEST_ERROR("(%)",                          "no arguments");
   TEST_ERROR("(% 3)",                        "one argument");
-  TEST_ERROR("(/ 3)",                        "one argument");
+  TEST_ERROR("(< 3)",                        "one argument");
+  TEST_ERROR("(min)",                        "no arguments");
   TEST_ERROR("(= 4)",                        "one argument");
 
   // Too many arguments
-  TEST_ERROR("(- 3 4 5)",                    "too many arguments");
-  TEST_ERROR("(/ 3 4 5)",                    "too many arguments");
   TEST_ERROR("(% 3 4 5)",                    "too many arguments");
 
   TEST_REPORT();
@@ -456,6 +529,7 @@ DEF_TEST(closure) {
          "(set 'f (lambda (x y) (+ x y)))",
          "(set 'add-5 (f 5)");
   TEST_EVALS(one, "(add-5 100)", "105",          "simple variable capture");
+  TEST_EVALS(one, "add-5", "<partial:(y), 1 args applied>", "partial application is a value");
 
 
   SERIES(two,
@@ -463,6 +537,42 @@ DEF_TEST(closure) {
          "(set 'double (lambda (x) (+ x x)))");
   TEST_EVALS(two, "(double 7)", "14",              "variable capture from environment");
 
+  SERIES(three,
+         "(set 'find (lambda (k l) (cond ((eq (car (car l)) k) (car (cdr (car l)))) (t (find k (cdr l))))))",
+         "(set 'f (lambda (x y) (find 'y (env))))");
+  TEST_EVALS(three, "(f 1 2)", "2",                "arguments listed in environment");
+
+  SERIES(four,
+         "(set 'x 1)",
+         "(set 'counter (lambda (y) (cond ((set 'x (+ x y)) x))))");
+  TEST_EVALS(four, "(cons (counter 5) (cons (counter 5) (cons x '())))", "(6 6 1)",
+             "set of captured variable is private to the call");
+
+  SERIES(five,
+         "(set 'x 1)",
+         "(set 'get (lambda () x))",
+         "(set 'x 2)");
+  TEST_EVALS(five, "(cons (get) (cons x '()))", "(1 2)", "captured value outlives global over-write");
+
+  // Names that are not global are scoped dynamically, whether or not they are called in tail
+  // position, and whether closures are run by the VM or tree-walked
+  SERIES(six,
+         "(set 'g (lambda () x))",
+         "(set 'f (lambda (x) (g)))",
+         "(set 'h (lambda (x) (+ 0 (g))))",
+         "(set 'f-interpreted (lambda (x) (cond ((set 'unused 1) (g)))))");
+  TEST_BOTH_EVALS(six, "(f 5)", "5",               "caller's arguments visible to tail call");
+  TEST_BOTH_EVALS(six, "(h 6)", "6",               "caller's arguments visible to call");
+  TEST_BOTH_EVALS(six, "(f-interpreted 7)", "7",   "caller's arguments visible to tail call from interpreted caller");
+
+  // Closures made from the same lambda expression each capture their own values
+  SERIES(seven,
+         "(set 'make (lambda (x) (lambda (y) (+ x y))))",
+         "(set 'make-interpreted (lambda (x) (lambda (y) (cond ((set 'unused 1) (+ x y))))))");
+  TEST_BOTH_EVALS(seven, "(+ ((make 1) 10) ((make 2) 10))", "23", "same lambda expression, different captures");
+  TEST_BOTH_EVALS(seven, "(+ ((make-interpreted 1) 10) ((make-interpreted 2) 10))", "23",
+                  "same lambda expression, different captures, not compiled");
+
   TEST_REPORT();
 }
 
@@ -477,6 +587,17 @@ DEF_TEST(recursion) {
   TEST_EVALS(factorial, "(factorial 5)", "120",        "factorial 5");
   TEST_EVALS(factorial, "(factorial 8)", "40320",      "factorial 8");
   TEST_EVALS(factorial, "(factorial 0)", "1",          "factorial 0");
+  TEST_EVALS(factorial, "(factorial 25)", "15511210043330985984000000", "factorial 25");
+  TEST_EVALS(factorial, "(/ (factorial 400) (factorial 399))", "400", "bignum quotient");
+  TEST_EVALS(factorial, "(% (+ (* (factorial 200) 12345) 678) (factorial 200))", "678", "bignum remainder");
+
+  // Products big enough for Karatsuba's algorithm, checked against (a + 1)^2 - a^2 = 2a + 1
+  SERIES(square,
+         "(set 'factorial (lambda (x) (cond ((= x 0) 1) (t (* x (factorial (- x 1)))))))",
+         "(set 'a (factorial 500))",
+         "(set 'b (+ (factorial 500) 1))");
+  TEST_EVALS(square, "(= (- (* b b) (* a a)) (+ a b))", "t", "large squares");
+  TEST_EVALS(square, "(= (/ (* a (factorial 300)) (factorial 300)) a)", "t", "large unbalanced product");
 
   // ith element
   SERIES(ith,
@@ -536,3 +657,161 @@ DEF_TEST(Y_combinator) {
   TEST_REPORT();
 }
 
+
+DEF_TEST(garbage_collection) {
+  TEST_INIT();
+
+  // Each of these allocates many times more objects than the collection threshold in
+  // a single expression, so garbage is collected while the expression is evaluated
+
+  SERIES(count,
+         "(set 'count (lambda (n)"
+         "(cond"
+         "((= n 0) 0)"
+         "(t (+ 1 (count (- n 1)))))))");
+  TEST_EVALS(count, "(count 2000)", "2000",                        "deep recursion");
+
+  SERIES(fib,
+         "(set 'fib (lambda (n)"
+         "(cond"
+         "((< n 2) n)"
+         "(t (+ (fib (- n 1)) (fib (- n 2)))))))");
+  TEST_EVALS(fib, "(fib 15)", "610",                               "tree recursion");
+
+  SERIES(repeat,
+         "(set 'repeat (lambda (item n)"
+         "(cond"
+         "((= n 1) (cons item '()))"
+         "(t (cons item (repeat item (- n 1)))))))",
+         "(set 'length (lambda (x)"
+         "(cond"
+         "((eq x '()) 0)"
+         "(t (+ 1 (length (cdr x)))))))");
+  TEST_EVALS(repeat, "(length (repeat '(a b) 1000))", "1000",      "list built across collections");
+  TEST_EVALS(repeat, "(car (car (cdr (repeat (cons 55 '()) 500))))", "55", "values survive collections");
+  TEST_EVALS(repeat, "(car (car (cons (cons 7 '()) (repeat 'a 1000))))", "7",
+             "temporary survives collection");
+
+  // Overwrites a binding in a frame that may already have been promoted by a collection
+  SERIES(sum,
+         "(set 'sum (lambda (n acc)"
+         "(cond"
+         "((= n 0) acc)"
+         "(t ((lambda (a b) (sum (- n 1) b)) (set 'acc (+ acc n)) acc)))))");
+  TEST_EVALS(sum, "(sum 1000 0)", "500500",                       "set in promoted frame");
+
+  TEST_REPORT();
+}
+
+DEF_TEST(vector) {
+  TEST_INIT();
+
+  TEST_EVAL("(make-vector 3 0)", "#(0 0 0)",                      "make vector with fill");
+  TEST_EVAL("(make-vector 2)", "#(nil nil)",                      "empty lists by default");
+  TEST_EVAL("(make-vector 0)", "#()",                             "empty vector");
+  TEST_EVAL("(vector-length (make-vector 7 'a))", "7",            "length");
+  TEST_EVAL("(list->vector '(1 2.5 x (y z)))", "#(1 2.5 x (y z))", "list to vector");
+  TEST_EVAL("(vector->list (list->vector '(a b c)))", "(a b c)",  "vector to list");
+  TEST_EVAL("(vector->list (make-vector 0))", "nil",              "empty vector to list");
+  TEST_EVAL("(vector-ref (list->vector '(a b c)) 2)", "c",        "index");
+  TEST_EVAL("(vector-set! (make-vector 3 0) 1 '(a))", "#(0 (a) 0)", "set an element");
+  TEST_FALSE("(atom (make-vector 1))",                            "vector is not an atom");
+
+  TEST_ERROR("(make-vector -1)",                                  "negative length");
+  TEST_ERROR("(make-vector 'a)",                                  "length not an integer");
+  TEST_ERROR("(vector-ref (make-vector 3 0) 3)",                  "index out of range");
+  TEST_ERROR("(vector-ref (make-vector 3 0) -1)",                 "negative index");
+  TEST_ERROR("(vector-ref (make-vector 3 0) 1.0)",                "index not an integer");
+  TEST_ERROR("(vector-ref '(a b) 0)",                             "not a vector");
+  TEST_ERROR("(vector-set! (make-vector 3 0) 1)",                 "missing value");
+  TEST_ERROR("(list->vector 'a)",                                 "not a list");
+
+  // Vectors are modified in place, and are shared rather than copied
+  SERIES(shared,
+         "(set 'v (make-vector 3 0))",
+         "(set 'w v)",
+         "(set 'get (lambda (i) (vector-ref v i)))",
+         "(vector-set! v 0 'a)",
+         "(vector-set! w 1 '(b c))");
+  TEST_EVALS(shared, "v", "#(a (b c) 0)",                         "modified in place");
+  TEST_EVALS(shared, "(eq v w)", "t",                             "set shares the vector");
+  TEST_EVALS(shared, "(cons (get 0) (get 1))", "(a b c)",         "closure shares the vector");
+
+  // Filling a vector in a loop promotes it, so its new elements survive minor collections
+  // only through the write barrier
+  SERIES(table,
+         "(set 'fill (lambda (v i n)"
+         "(cond"
+         "((= i n) v)"
+         "((vector-set! v i (cons i '())) (fill v (+ i 1) n)))))",
+         "(set 'sum (lambda (v i acc)"
+         "(cond"
+         "((= i (vector-length v)) acc)"
+         "(t (sum v (+ i 1) (+ acc (car (vector-ref v i))))))))",
+         "(set 'table (make-vector 20000))",
+         "(fill table 0 20000)");
+  TEST_EVALS(table, "(sum table 0 0)", "199990000",               "elements survive collections");
+  TEST_EVALS(table, "(vector-ref table 12345)", "(12345)",        "element of a large vector");
+
+  TEST_REPORT();
+}
+
+DEF_TEST(hashtable) {
+  TEST_INIT();
+
+  TEST_EVAL("(make-hash-table)", "<hash-table:0 entries>",         "make hash table");
+  TEST_EVAL("(hash-count (hash-set! (make-hash-table 4) 'a 1))", "1", "count");
+  TEST_EVAL("(hash-ref (hash-set! (make-hash-table) 'a '(b)) 'a)", "(b)", "symbol key");
+  TEST_EVAL("(hash-ref (hash-set! (make-hash-table) 42 'x) 42)", "x", "integer key");
+  TEST_EVAL("(hash-ref (hash-set! (make-hash-table) 0.0 'x) -0.0)", "x", "float key");
+  TEST_EVAL("(hash-ref (hash-set! (make-hash-table) 100000000000000000000 'x)"
+            "(* 10000000000 10000000000))", "x",                   "bignum key");
+  TEST_EVAL("(hash-ref (hash-set! (make-hash-table) '(a (1 2)) 'x)"
+            "(cons 'a (cons (cons 1 (cons 2 '())) '())))", "x",    "list key is structural");
+  TEST_EVAL("(hash-ref (hash-set! (make-hash-table) 1 'x) 1.0)", "nil", "integer is not float");
+  TEST_EVAL("(hash-ref (make-hash-table) 'a)", "nil",              "missing key");
+  TEST_EVAL("(hash-ref (make-hash-table) 'a 'none)", "none",       "default value");
+  TEST_EVAL("(hash->list (hash-set! (make-hash-table) 'a 1))", "((a 1))", "entries");
+  TEST_EVAL("(hash-keys (hash-set! (make-hash-table) 'a 1))", "(a)", "keys");
+  TEST_EVAL("(hash->list (make-hash-table))", "nil",               "no entries");
+  TEST_FALSE("(atom (make-hash-table))",                           "hash table is not an atom");
+
+  TEST_ERROR("(make-hash-table -1)",                               "negative size");
+  TEST_ERROR("(hash-ref '((a 1)) 'a)",                             "not a hash table");
+  TEST_ERROR("(hash-set! (make-hash-table) 'a)",                   "missing value");
+  TEST_ERROR("(hash-count 'a)",                                    "count of non hash table");
+
+  // Hash tables are modified in place, and are shared rather than copied
+  SERIES(shared,
+         "(set 'h (make-hash-table))",
+         "(set 'g h)",
+         "(set 'get (lambda (k) (hash-ref h k)))",
+         "(hash-set! h 'a 1)",
+         "(hash-set! g 'b '(2))",
+         "(hash-set! h 'a 3)",
+         "(hash-remove! g 'c)");
+  TEST_EVALS(shared, "(hash-count h)", "2",                        "replaced value");
+  TEST_EVALS(shared, "(eq h g)", "t",                              "set shares the hash table");
+  TEST_EVALS(shared, "(cons (get 'a) (get 'b))", "(3 2)",          "closure shares the hash table");
+  TEST_EVALS(shared, "(hash-count (hash-remove! h 'a))", "1",      "remove");
+  TEST_EVALS(shared, "(hash-ref (hash-remove! g 'a) 'a 'gone)", "gone", "removed key");
+
+  // Filling a hash table grows it many times, and its entries survive collections only if
+  // the table's keys and values are marked
+  SERIES(table,
+         "(set 'fill (lambda (h i n)"
+         "(cond"
+         "((= i n) h)"
+         "((hash-set! h (cons i '()) (* i i)) (fill h (+ i 1) n)))))",
+         "(set 'sum (lambda (h i acc)"
+         "(cond"
+         "((= i 20000) acc)"
+         "(t (sum h (+ i 1) (+ acc (hash-ref h (cons i '()))))))))",
+         "(set 'squares (make-hash-table))",
+         "(fill squares 0 20000)");
+  TEST_EVALS(table, "(hash-count squares)", "20000",               "entries survive collections");
+  TEST_EVALS(table, "(sum squares 0 0)", "2666466670000",           "values survive collections");
+  TEST_EVALS(table, "(hash-ref squares '(12345))", "152399025",    "entry of a large hash table");
+
+  TEST_REPORT();
+}
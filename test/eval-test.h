@@ -136,4 +136,28 @@ DEF_TEST(recursion);
  */
 DEF_TEST(Y_combinator);
 
+/**
+ * Function: test_garbage_collection
+ * ---------------------------------
+ * Tests expressions that allocate enough to collect garbage during their evaluation
+ * @return: The number of tests that failed
+ */
+DEF_TEST(garbage_collection);
+
+/**
+ * Function: test_vector
+ * ---------------------
+ * Tests making, indexing and modifying vectors
+ * @return: The number of tests that failed
+ */
+DEF_TEST(vector);
+
+/**
+ * Function: test_hashtable
+ * ------------------------
+ * Tests making, querying, modifying and iterating over hash tables
+ * @return: The number of tests that failed
+ */
+DEF_TEST(hashtable);
+
 #endif //LISP_EVAL_TEST_H
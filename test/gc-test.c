@@ -0,0 +1,76 @@
+/*
+ * File: gc-test.c
+ * ---------------
+ * Tests of the garbage collector
+ */
+
+#include "gc-test.h"
+#include <interpreter.h>
+#include <list.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#define TEST_COLLECT_LIST(length, nested, ...) TEST_ITEM(test_collect_list, length, nested, __VA_ARGS__)
+#define TEST_RESULT_SIZE 128
+
+// Number of objects allocated from the garbage collector that have not been freed
+static long live_objects(const GarbageCollector *gc) {
+  CArenaStats stats;
+  gc_stats(gc, &stats);
+  return (long) stats.live_objects;
+}
+
+// Number of cells in a list nested through either the CAR or the CDR of each cell
+static int list_depth(const obj *list, bool nested) {
+  int depth = 0;
+  for (const obj *cell = list; cell != NULL; cell = nested ? CAR(cell) : CDR(cell))
+    depth++;
+  return depth;
+}
+
+bool test_collect_list(int length, bool nested, const char *test_name_format, ...) {
+  LispInterpreter interpreter;
+  if (!interpreter_init(&interpreter)) return false;
+  GarbageCollector *gc = &interpreter.gc;
+  long baseline = live_objects(gc);
+
+  obj *list = NULL;
+  for (int i = 0; i < length; i++) {
+    list = nested ? new_list_set(list, NULL, gc) : new_list_set(new_int(i), list, gc);
+    gc_add(gc, list);
+  }
+
+  gc_push_root(gc, &list);
+  collect_garbage(gc, interpreter.env);
+  long kept = live_objects(gc) - baseline;
+  int depth = list_depth(list, nested);
+  gc_pop_roots(gc, 1);
+
+  collect_garbage(gc, interpreter.env);
+  long remaining = live_objects(gc) - baseline;
+  interpreter_dispose(&interpreter);
+
+  char expected[TEST_RESULT_SIZE], result[TEST_RESULT_SIZE];
+  snprintf(expected, sizeof(expected), "kept %d of depth %d, then 0", length, length);
+  snprintf(result, sizeof(result), "kept %ld of depth %d, then %ld", kept, depth, remaining);
+  bool test_result = get_test_result(expected, result);
+
+  va_list vargs;
+  va_start(vargs, test_name_format);
+  print_single_result("Collection", nested ? "nested list" : "list", expected, result,
+                      test_result, test_name_format, vargs);
+  va_end(vargs);
+  return test_result;
+}
+
+DEF_TEST(deep_heaps) {
+  TEST_INIT();
+
+  TEST_COLLECT_LIST(10, false,              "short list");
+  TEST_COLLECT_LIST(1000000, false,         "million element list");
+  TEST_COLLECT_LIST(10, true,               "short nested list");
+  TEST_COLLECT_LIST(1000000, true,          "million deep nested list");
+
+  TEST_REPORT();
+}
@@ -0,0 +1,35 @@
+/*
+ * File: gc-test.h
+ * ---------------
+ * Presents the interface to the garbage collector tests
+ */
+
+#ifndef LISP_GC_TEST_H
+#define LISP_GC_TEST_H
+
+#include "test.h"
+#include <stdbool.h>
+
+/**
+ * Function: test_collect_list
+ * ---------------------------
+ * Tests collecting a list built directly in the heap, first while it is referenced by
+ * a root (when every cell must survive), and then after the root has been removed
+ * (when every cell must be freed).
+ * @param length: The number of cells in the list
+ * @param nested: If true, each cell is the CAR of the previous cell rather than its CDR
+ * @param test_name_format: printf-style format specifier for the test name
+ * @param ...: Variable length arguments for formatting of the test name
+ * @return: True if the right cells survived each collection, false otherwise
+ */
+bool test_collect_list(int length, bool nested, const char *test_name_format, ...);
+
+/**
+ * Function: test_deep_heaps
+ * --------------------------
+ * Tests collecting heaps too deep to mark recursively
+ * @return: The number of tests that failed
+ */
+DEF_TEST(deep_heaps);
+
+#endif //LISP_GC_TEST_H
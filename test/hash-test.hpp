@@ -0,0 +1,104 @@
+#ifndef LISP_HASH_TEST_HPP
+#define LISP_HASH_TEST_HPP
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <hash.h>
+
+namespace {
+
+  TEST(HashTest, BatchMatchesSingle) {
+    std::mt19937 mt(0);
+    std::vector<unsigned char> keys(64 * 40);
+    for (auto &byte : keys)
+      byte = (unsigned char) mt();
+
+    for (size_t keysize = 1; keysize <= 40; keysize++) {
+      std::vector<uint64_t> hashes(64);
+      hash64_batch(keys.data(), keysize, hashes.size(), 12345, hashes.data());
+      for (size_t i = 0; i < hashes.size(); i++)
+        ASSERT_EQ(hashes[i], hash64(&keys[i * keysize], keysize, 12345)) << "keysize " << keysize;
+    }
+  }
+
+  TEST(HashTest, Seeded) {
+    int key = 42;
+    EXPECT_EQ(hash64(&key, sizeof(key), 1), hash64(&key, sizeof(key), 1));
+    EXPECT_NE(hash64(&key, sizeof(key), 1), hash64(&key, sizeof(key), 2));
+  }
+
+  // Sequential keys, which are what a weak hash function does worst on, should collide no more
+  // often than random 32-bit values would (about n^2 / 2^33 times), and should fill the buckets
+  // picked by the low bits of their hashes evenly
+  template <typename K>
+  void check_collisions(K stride) {
+    const int n = 1 << 20;
+    const int num_buckets = 1 << 16;
+    std::vector<unsigned int> hashes(n);
+    std::vector<int> buckets(num_buckets);
+    for (int i = 0; i < n; i++) {
+      K key = (K) i * stride;
+      hashes[i] = fast_hash(&key, sizeof(key));
+      buckets[hashes[i] & (num_buckets - 1)]++;
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    int collisions = 0;
+    for (int i = 1; i < n; i++)
+      collisions += hashes[i] == hashes[i - 1];
+    EXPECT_LT(collisions, 3 * (double) n * n / std::pow(2.0, 33));
+
+    // chi-squared of the bucket counts, which is within a few standard deviations of its mean
+    double expected = (double) n / num_buckets;
+    double chi_squared = 0;
+    for (int count : buckets)
+      chi_squared += (count - expected) * (count - expected) / expected;
+    EXPECT_LT(std::abs(chi_squared - num_buckets), 6 * std::sqrt(2.0 * num_buckets));
+  }
+
+  TEST(HashTest, CollisionsInt) {
+    check_collisions<int>(1);
+  }
+
+  TEST(HashTest, CollisionsPointer) {
+    check_collisions<uint64_t>(16); // like the addresses of objects allocated one after another
+  }
+
+  // Flipping any bit of a key should flip each bit of its hash about half of the time
+  void check_avalanche(size_t keysize) {
+    const int samples = 2000;
+    std::mt19937 mt((unsigned int) keysize);
+    std::vector<unsigned char> key(keysize);
+    std::vector<int> flips(keysize * 8 * 64);
+
+    for (int s = 0; s < samples; s++) {
+      for (auto &byte : key)
+        byte = (unsigned char) mt();
+      uint64_t hash = hash64(key.data(), keysize, 0);
+      for (size_t bit = 0; bit < keysize * 8; bit++) {
+        key[bit / 8] ^= (unsigned char) (1 << (bit % 8));
+        uint64_t flipped = hash ^ hash64(key.data(), keysize, 0);
+        key[bit / 8] ^= (unsigned char) (1 << (bit % 8));
+        for (int out = 0; out < 64; out++)
+          flips[bit * 64 + out] += (int) ((flipped >> out) & 1);
+      }
+    }
+
+    for (size_t i = 0; i < flips.size(); i++) {
+      double p = (double) flips[i] / samples;
+      ASSERT_GT(p, 0.4) << "keysize " << keysize << ", input bit " << i / 64 << ", output bit " << i % 64;
+      ASSERT_LT(p, 0.6) << "keysize " << keysize << ", input bit " << i / 64 << ", output bit " << i % 64;
+    }
+  }
+
+  TEST(HashTest, Avalanche) {
+    for (size_t keysize : { 3, 4, 8, 13, 24, 64 })
+      check_avalanche(keysize);
+  }
+}
+
+#endif //LISP_HASH_TEST_HPP
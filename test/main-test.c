@@ -6,6 +6,8 @@
 
 #include "eval-test.h"
 #include "parse-test.h"
+#include "gc-test.h"
+#include "vm-test.h"
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -35,6 +37,12 @@ int run_all_tests() {
   RUN_TEST(closure);
   RUN_TEST(recursion);
   RUN_TEST(Y_combinator);
+  RUN_TEST(garbage_collection);
+  RUN_TEST(vector);
+  RUN_TEST(hashtable);
+  RUN_TEST(deep_heaps);
+  RUN_TEST(bytecode);
+  RUN_TEST(tail_calls);
 
   return num_fails;
 }
@@ -1,5 +1,6 @@
 
 #include <parser.h>
+#include <interpreter.h>
 #include <list.h>
 #include "parse-test.h"
 #include "test.h"
@@ -12,9 +13,12 @@
 bool test_single_parse(const_expression expr, const_expression expected,
                        const char *test_name_format, ...) {
 
-  obj* o = PARSE(expr);
+  LispInterpreter interpreter;
+  if (!interpreter_init(&interpreter)) return false;
+
+  obj* o = PARSE(expr, &interpreter);
   expression result = unparse(o);
-  dispose_recursive(o);
+  interpreter_dispose(&interpreter);
 
   // compare result to expectation
   bool test_result = get_test_result(expected, result);
@@ -0,0 +1,219 @@
+/*
+ * File: vm-test.c
+ * ---------------
+ * Tests of the bytecode compiler and VM
+ */
+
+#include "vm-test.h"
+#include <interpreter.h>
+#include <environment.h>
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+#define TEST_VM(pre, e, expected, ...) TEST_ITEM(test_vm_eval, pre, e, expected, true, __VA_ARGS__)
+#define TEST_BOTH(pre, e, expected, ...) \
+  TEST_ITEM(test_vm_eval, pre, e, expected, true, __VA_ARGS__); \
+  TEST_ITEM(test_vm_eval, pre, e, expected, false, __VA_ARGS__)
+#define TEST_COMPILED(e, compiled, ...) TEST_ITEM(test_compiled, e, compiled, __VA_ARGS__)
+
+// Macro for easy creation of a series of expressions to evaluate
+#define SERIES(name, ...) const_expression name[] = {__VA_ARGS__, NULL}
+
+bool test_vm_eval(const_expression setup_expressions[], const_expression test_expression,
+                  const_expression expected, bool use_vm, const char *test_name_format, ...) {
+  assert(setup_expressions != NULL);
+  assert(test_expression != NULL);
+
+  LispInterpreter interpreter;
+  if (!interpreter_init(&interpreter)) return false;
+  interpreter.vm.enabled = use_vm;
+
+  for (int i = 0; setup_expressions[i] != NULL; i++)
+    free(interpret_expression(&interpreter, setup_expressions[i]));
+
+  expression result = interpret_expression(&interpreter, test_expression);
+  interpreter_dispose(&interpreter);
+  bool test_result = get_test_result(expected, result);
+
+  va_list vargs;
+  va_start(vargs, test_name_format);
+  print_single_result(use_vm ? "VM" : "Tree-walked", test_expression, expected, result,
+                      test_result, test_name_format, vargs);
+  va_end(vargs);
+
+  free(result);
+  return test_result;
+}
+
+bool test_compiled(const_expression lambda, bool compiled, const char *test_name_format, ...) {
+  LispInterpreter interpreter;
+  if (!interpreter_init(&interpreter)) return false;
+
+  char setup[256];
+  snprintf(setup, sizeof(setup), "(set 'f %s)", lambda);
+  free(interpret_expression(&interpreter, setup));
+  obj *f = lookup(intern(&interpreter.symbols, "f"), &interpreter);
+  bool is_compiled = f != NULL && is_closure(f) && CODE(f) != NULL;
+  interpreter_dispose(&interpreter);
+
+  const char *expected = compiled ? "compiled" : "not compiled";
+  const char *result = is_compiled ? "compiled" : "not compiled";
+  bool test_result = get_test_result(expected, result);
+
+  va_list vargs;
+  va_start(vargs, test_name_format);
+  print_single_result("Compilation", lambda, expected, result, test_result, test_name_format, vargs);
+  va_end(vargs);
+  return test_result;
+}
+
+DEF_TEST(bytecode) {
+  TEST_INIT();
+
+  TEST_COMPILED("(lambda (n) (cond ((< n 2) n) (t (+ n 1))))", true,   "arithmetic and cond");
+  TEST_COMPILED("(lambda (x) (cons (car x) (cdr x)))", true,           "list primitives");
+  TEST_COMPILED("(lambda (x) (lambda (y) (+ x y)))", true,             "nested lambda");
+  TEST_COMPILED("(lambda (x) (set 'y x))", false,                      "set is not compiled");
+  TEST_COMPILED("(lambda (x) (car x x))", false,                       "wrong number of arguments");
+  TEST_COMPILED("(lambda (x) (lambda (t) x))", false,                  "invalid lambda parameters");
+
+  SERIES(fib,
+         "(set 'fib (lambda (n)"
+         "(cond"
+         "((< n 2) n)"
+         "(t (+ (fib (- n 1)) (fib (- n 2)))))))");
+  TEST_BOTH(fib, "(fib 18)", "2584",                                   "fibonacci");
+
+  SERIES(factorial,
+         "(set 'factorial (lambda (x)"
+         "(cond"
+         "((= x 0) 1)"
+         "(t (* x (factorial (- x 1)))))))");
+  TEST_BOTH(factorial, "(factorial 10)", "3628800",                    "factorial");
+  TEST_BOTH(factorial, "(factorial 25)", "15511210043330985984000000", "factorial promotes to bignums");
+
+  SERIES(tak,
+         "(set 'tak (lambda (x y z)"
+         "(cond"
+         "((< y x) (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y)))"
+         "(t z))))");
+  TEST_BOTH(tak, "(tak 12 8 4)", "5",                                  "tak");
+
+  SERIES(sign,
+         "(set 'sign (lambda (x) (cond ((< x 0) '-) ((> x 0) '+))))");
+  TEST_BOTH(sign, "(sign -3)", "-",                                    "cond");
+  TEST_BOTH(sign, "(sign 0)", "nil",                                    "cond without a true clause");
+
+  SERIES(compare, "(set 'compare (lambda (x y) (cons (< x y) (cons (eq x y) '()))))");
+  TEST_BOTH(compare, "(compare 1 2)", "(t nil)",                        "comparisons as values");
+
+  SERIES(apply_fn, "(set 'apply-fn (lambda (f x) (f x)))");
+  TEST_BOTH(apply_fn, "(apply-fn car '(a b))", "a",                     "primitive passed as value");
+  TEST_BOTH(apply_fn, "(apply-fn (lambda (x) (cons x '(b))) 'a)", "(a b)", "closure passed as value");
+  TEST_BOTH(apply_fn, "(apply-fn cons 'a)", NULL,                       "primitive passed as value, wrong arity");
+
+  SERIES(fold, "(set 'fold (lambda (f acc n) (cond ((= n 0) acc) (t (fold f (f acc n) (- n 1))))))");
+  TEST_BOTH(fold, "(fold + 0 100)", "5050",                            "math primitive passed as value");
+
+  SERIES(variadic,
+         "(set 'sum4 (lambda (a b c d) (+ a b c d)))",
+         "(set 'between (lambda (x lo hi) (cond ((<= lo x hi) 'in) (t 'out))))",
+         "(set 'clamp (lambda (x lo hi) (max lo (min x hi))))");
+  TEST_BOTH(variadic, "(sum4 1 2 3 4)", "10",                           "variadic addition");
+  TEST_BOTH(variadic, "(sum4 1 2 3.5 4)", "10.5",                       "variadic addition, mixed");
+  TEST_BOTH(variadic, "(between 5 1 9)", "in",                          "chained comparison");
+  TEST_BOTH(variadic, "(between 0 1 9)", "out",                         "chained comparison doesn't hold");
+  TEST_BOTH(variadic, "(clamp 12 0 10)", "10",                          "min and max");
+  TEST_BOTH(variadic, "(sum4 1 2 3 'a)", NULL,                          "variadic addition of a non-number");
+
+  SERIES(unary, "(set 'unary (lambda (x) (cons (- x) (cons (/ x) (cons (+) (cons (*) '()))))))");
+  TEST_BOTH(unary, "(unary 2.0)", "(-2 0.5 0 1)",                       "arithmetic on fewer than two arguments");
+
+  SERIES(adder,
+         "(set 'add (lambda (x y) (+ x y)))",
+         "(set 'add-to (lambda (x) (add x)))");
+  TEST_BOTH(adder, "((add-to 2) 3)", "5",                              "partial application");
+  TEST_BOTH(adder, "(add 1.5 2)", "3.5",                                "float arithmetic");
+
+  SERIES(partial,
+         "(set 'add3 (lambda (a b c) (+ a (+ b c))))",
+         "(set 'finish (lambda (p) (p 1)))",
+         "(set 'seven (lambda (a b c d e f g) (+ a (+ b (+ c (+ d (+ e (+ f g))))))))");
+  TEST_BOTH(partial, "(((add3 1) 2) 3)", "6",                           "partial application of a partial application");
+  TEST_BOTH(partial, "(finish (add3 1 2))", "4",                        "partial application completed by a tail call");
+  TEST_BOTH(partial, "((seven 1 2 3 4 5 6) 7)", "28",                   "more values applied than fit in one object");
+  TEST_BOTH(partial, "(((seven 1 2 3) 4 5 6) 7)", "28",                 "partial applications chained");
+
+  SERIES(make_adder, "(set 'make-adder (lambda (x) (lambda (y) (+ x y))))");
+  TEST_BOTH(make_adder, "((make-adder 2) 3)", "5",                     "closure made by compiled code");
+
+  SERIES(nest, "(set 'nest (lambda (a) (lambda (b) (lambda (c) (cons a (cons b (cons c '())))))))");
+  TEST_BOTH(nest, "(((nest 1) 2) 3)", "(1 2 3)",                       "closures nested three deep");
+
+  SERIES(late,
+         "(set 'make (lambda (x) (lambda (y) (pair x y))))",
+         "(set 'pair (lambda (x y) (cons x (cons y '()))))");
+  TEST_BOTH(late, "((make 1) 2)", "(1 2)",                             "capture of a later global");
+
+  SERIES(interpreted,
+         "(set 'store (lambda (x) (set 'stored x)))",
+         "(set 'twice (lambda (x) (store (* 2 x))))");
+  TEST_BOTH(interpreted, "(twice 21)", "42",                           "call to closure that is not compiled");
+
+  // Names that are not global are found in the calls in progress, whichever evaluator made them
+  SERIES(dynamic,
+         "(set 'get-x (lambda () x))",
+         "(set 'get-x-interpreted (lambda () (cond ((set 'unused 1) x))))",
+         "(set 'make-get-x (lambda () (lambda () x)))",
+         "(set 'sum (lambda (x) (+ 0 (get-x))))",
+         "(set 'sum-interpreted (lambda (x) (+ 0 (get-x-interpreted))))",
+         "(set 'sum-from-interpreted (lambda (x) (cond ((set 'unused 1) (+ 0 (get-x))))))",
+         "(set 'captures (lambda (x) (car (cons (make-get-x) '()))))",
+         "(set 'nested (lambda (x) (sum-interpreted (+ x 1))))");
+  TEST_BOTH(dynamic, "(sum 5)", "5",                                   "caller's argument");
+  TEST_BOTH(dynamic, "(sum-interpreted 5)", "5",                       "caller's argument, callee not compiled");
+  TEST_BOTH(dynamic, "(sum-from-interpreted 5)", "5",                  "caller's argument, caller not compiled");
+  TEST_BOTH(dynamic, "((captures 5))", "5",                            "caller's argument captured by a closure");
+  TEST_BOTH(dynamic, "(nested 5)", "6",                                "innermost caller's argument");
+  TEST_BOTH(dynamic, "(get-x)", NULL,                                  "no caller binds the name");
+
+  SERIES(errors,
+         "(set 'bad-car (lambda (x) (car x)))",
+         "(set 'undefined (lambda (x) (+ x y)))");
+  TEST_BOTH(errors, "(bad-car 1)", NULL,                               "car of a number");
+  TEST_BOTH(errors, "(undefined 1)", NULL,                             "undefined variable");
+
+  SERIES(count,
+         "(set 'count (lambda (n) (cond ((= n 0) 0) (t (+ 1 (count (- n 1)))))))",
+         "(set 'forever (lambda (n) (+ 1 (forever n))))");
+  TEST_VM(count, "(count 100000)", "100000",                           "deep recursion");
+  TEST_VM(count, "(forever 1)", NULL,                                  "stack overflow");
+
+  TEST_REPORT();
+}
+
+DEF_TEST(tail_calls) {
+  TEST_INIT();
+
+  SERIES(loop, "(set 'loop (lambda (n) (cond ((= n 0) 'done) (t (loop (- n 1))))))");
+  TEST_BOTH(loop, "(loop 300000)", "done",                             "loop in tail position");
+  TEST_VM(loop, "(loop 10000000)", "done",                             "ten million iterations");
+
+  SERIES(parity,
+         "(set 'even (lambda (n) (cond ((= n 0) t) (t (odd (- n 1))))))",
+         "(set 'odd (lambda (n) (cond ((= n 0) '()) (t (even (- n 1))))))");
+  TEST_BOTH(parity, "(even 100001)", "nil",                            "mutual recursion");
+
+  SERIES(lists,
+         "(set 'build (lambda (n acc) (cond ((= n 0) acc) (t (build (- n 1) (cons n acc))))))",
+         "(set 'len (lambda (l acc) (cond ((eq l '()) acc) (t (len (cdr l) (+ acc 1))))))");
+  TEST_BOTH(lists, "(len (build 100000 '()) 0)", "100000",             "iterating over a long list");
+
+  SERIES(interpreted,
+         "(set 'loop-set (lambda (n) (cond ((= n 0) (set 'x 'done)) (t (loop-set (- n 1))))))");
+  TEST_VM(interpreted, "(loop-set 300000)", "done",                    "closure that is not compiled");
+
+  TEST_REPORT();
+}
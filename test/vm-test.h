@@ -0,0 +1,59 @@
+/*
+ * File: vm-test.h
+ * ---------------
+ * Presents the interface to the tests of the bytecode compiler and VM
+ */
+
+#ifndef LISP_VM_TEST_H
+#define LISP_VM_TEST_H
+
+#include "test.h"
+#include <parser.h>
+#include <stdbool.h>
+
+/**
+ * Function: test_vm_eval
+ * ----------------------
+ * Tests the evaluation of an expression after a series of set-up expressions, with compiled
+ * closures either run by the VM or tree-walked
+ * @param setup_expressions: NULL terminated list of expressions to evaluate beforehand
+ * @param test_expression: The expression to evaluate and verify the result of
+ * @param expected: The expected result, or NULL if the evaluation should fail
+ * @param use_vm: If false, compiled closures are tree-walked rather than run by the VM
+ * @param test_name_format: printf-style format specifier for the test name
+ * @param ...: Variable length arguments for formatting of the test name
+ * @return: True if the expression evaluated to the expected result, false otherwise
+ */
+bool test_vm_eval(const_expression setup_expressions[], const_expression test_expression,
+                  const_expression expected, bool use_vm, const char *test_name_format, ...);
+
+/**
+ * Function: test_compiled
+ * -----------------------
+ * Tests whether a lambda expression produces a closure that was compiled to bytecode
+ * @param lambda: The lambda expression to evaluate
+ * @param compiled: Whether the closure should have been compiled
+ * @param test_name_format: printf-style format specifier for the test name
+ * @param ...: Variable length arguments for formatting of the test name
+ * @return: True if the closure was compiled exactly when expected, false otherwise
+ */
+bool test_compiled(const_expression lambda, bool compiled, const char *test_name_format, ...);
+
+/**
+ * Function: test_bytecode
+ * -----------------------
+ * Tests that compiled closures give the same results whether run by the VM or tree-walked,
+ * and that the VM handles recursion too deep for the tree-walking evaluator
+ * @return: The number of tests that failed
+ */
+DEF_TEST(bytecode);
+
+/**
+ * Function: test_tail_calls
+ * -------------------------
+ * Tests that calls in tail position run in constant stack, both in the VM and when tree-walked
+ * @return: The number of tests that failed
+ */
+DEF_TEST(tail_calls);
+
+#endif //LISP_VM_TEST_H